@@ -495,6 +495,7 @@ public class ImageAnalysisAbstractAnalyzerTest {
         @Override
         void clearCache() {
             mImageAnalysisNonBlockingAnalyzer.clearCache();
+            closeYuvConverter();
         }
 
         @Override
@@ -18,6 +18,7 @@ package androidx.camera.core;
 
 import static androidx.camera.core.ImageProcessingUtil.convertJpegBytesToImage;
 import static androidx.camera.core.ImageProcessingUtil.rotateYUV;
+import static androidx.camera.core.ImageProcessingUtil.writeJpegBufferToSurface;
 import static androidx.camera.core.ImageProcessingUtil.writeJpegBytesToSurface;
 import static androidx.camera.testing.impl.ImageProxyUtil.createYUV420ImagePlanes;
 
@@ -29,7 +30,9 @@ import android.graphics.BitmapFactory;
 import android.graphics.Canvas;
 import android.graphics.Color;
 import android.graphics.ImageFormat;
+import android.graphics.Matrix;
 import android.graphics.PixelFormat;
+import android.graphics.Rect;
 import android.media.ImageWriter;
 
 import androidx.annotation.IntRange;
@@ -51,6 +54,8 @@ import org.junit.runner.RunWith;
 import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
 import java.nio.IntBuffer;
 
 /**
@@ -181,6 +186,33 @@ public class ImageProcessingUtilTest {
         imageProxy.close();
     }
 
+    @Test
+    public void writeJpegBufferToSurface_returnsTheSameImage() {
+        // Arrange: create a JPEG image with solid color in a direct buffer.
+        byte[] inputBytes = createJpegBytesWithSolidColor(Color.RED);
+        ByteBuffer inputBuffer = ByteBuffer.allocateDirect(inputBytes.length);
+        inputBuffer.put(inputBytes);
+        inputBuffer.rewind();
+
+        // Act: acquire image and get the bytes.
+        assertThat(writeJpegBufferToSurface(mJpegImageReaderProxy.getSurface(), inputBuffer))
+                .isTrue();
+
+        final ImageProxy imageProxy = mJpegImageReaderProxy.acquireLatestImage();
+        assertThat(imageProxy).isNotNull();
+        ByteBuffer byteBuffer = imageProxy.getPlanes()[0].getBuffer();
+        byteBuffer.rewind();
+        byte[] outputBytes = new byte[byteBuffer.capacity()];
+        byteBuffer.get(outputBytes);
+
+        // Assert: the color and the dimension of the restored image.
+        Bitmap bitmap = BitmapFactory.decodeByteArray(outputBytes, 0, outputBytes.length);
+        assertThat(bitmap.getWidth()).isEqualTo(WIDTH);
+        assertThat(bitmap.getHeight()).isEqualTo(HEIGHT);
+        assertBitmapColor(bitmap, Color.RED, JPEG_ENCODE_ERROR_TOLERANCE);
+        imageProxy.close();
+    }
+
     @Test
     public void convertYuvToJpegBytesIntoSurface_sizeAndRotationAreCorrect() throws IOException {
         final int expectedRotation = 270;
@@ -215,6 +247,39 @@ public class ImageProcessingUtilTest {
         imageProxy.close();
     }
 
+    @SdkSuppress(minSdkVersion = 30)
+    @Test
+    public void convertYuvToJpegBytesIntoSurface_postsSingleDecodableJpeg() {
+        // Arrange: create a YUV_420_888 image with a solid color.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, YUV_WHITE_STUDIO_SWING_BT601[0],
+                YUV_WHITE_STUDIO_SWING_BT601[1], YUV_WHITE_STUDIO_SWING_BT601[2]);
+        int referenceColorRgb = yuvBt601FullSwingToRGB(
+                YUV_WHITE_STUDIO_SWING_BT601[0],
+                YUV_WHITE_STUDIO_SWING_BT601[1],
+                YUV_WHITE_STUDIO_SWING_BT601[2]);
+
+        // Act: encode it with the native encoder, or the YuvImage fallback if it fails.
+        boolean result = ImageProcessingUtil.convertYuvToJpegBytesIntoSurface(yuvImageProxy,
+                100, /*rotationDegrees=*/0, mJpegImageReaderProxy.getSurface());
+
+        // Assert: a single JPEG is posted and decodes to the input color.
+        assertThat(result).isTrue();
+        final ImageProxy imageProxy = mJpegImageReaderProxy.acquireNextImage();
+        assertThat(imageProxy).isNotNull();
+        assertThat(mJpegImageReaderProxy.acquireNextImage()).isNull();
+        ByteBuffer byteBuffer = imageProxy.getPlanes()[0].getBuffer();
+        byteBuffer.rewind();
+        byte[] outputBytes = new byte[byteBuffer.remaining()];
+        byteBuffer.get(outputBytes);
+        Bitmap bitmap = BitmapFactory.decodeByteArray(outputBytes, 0, outputBytes.length);
+        assertThat(bitmap).isNotNull();
+        assertThat(bitmap.getWidth()).isEqualTo(WIDTH);
+        assertThat(bitmap.getHeight()).isEqualTo(HEIGHT);
+        assertBitmapColor(bitmap, referenceColorRgb, JPEG_ENCODE_ERROR_TOLERANCE);
+        imageProxy.close();
+    }
+
     /**
      * Returns JPEG bytes of a image with the given color.
      */
@@ -330,6 +395,30 @@ public class ImageProcessingUtilTest {
         assertThat(mYUVImageProxy.getPlanes()[2].getBuffer().get(0)).isEqualTo(2);
     }
 
+    @Test
+    public void rotateRGB_failsWhenConvertedBufferIsTooSmall() {
+        // Arrange.
+        mYUVImageProxy.setPlanes(createYUV420ImagePlanes(
+                WIDTH,
+                HEIGHT,
+                PIXEL_STRIDE_Y,
+                PIXEL_STRIDE_UV,
+                /*flipUV=*/false,
+                /*incrementValue=*/false));
+        ByteBuffer smallConvertedBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT * 4 - 1);
+
+        // Act.
+        ImageProxy rgbImageProxy = ImageProcessingUtil.convertYUVToRGB(
+                mYUVImageProxy,
+                mRotatedRGBImageReaderProxy,
+                smallConvertedBuffer,
+                /*rotation=*/90,
+                /*onePixelShiftRequested=*/false);
+
+        // Assert.
+        assertThat(rgbImageProxy).isNull();
+    }
+
     @Test
     public void closeYUVImageProxyWhenRGBImageProxyClosed() {
         // Arrange.
@@ -359,6 +448,54 @@ public class ImageProcessingUtilTest {
         assertThat(mYUVImageProxy.isClosed()).isTrue();
     }
 
+    @Test
+    public void convertYUVToRGBWithYuvConverter_layoutChangeFallsBackToGenericConversion() {
+        // Arrange: an I420 frame selects the kernel, then the stream switches to NV12.
+        ImageProxy i420ImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(i420ImageProxy, YUV_RED_STUDIO_SWING_BT601[0],
+                YUV_RED_STUDIO_SWING_BT601[1], YUV_RED_STUDIO_SWING_BT601[2]);
+        ByteBuffer yBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT);
+        ByteBuffer uvBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT / 2);
+        for (int i = 0; i < WIDTH * HEIGHT; i++) {
+            yBuffer.put(i, (byte) YUV_BLUE_STUDIO_SWING_BT601[0]);
+        }
+        for (int i = 0; i < WIDTH * HEIGHT / 2; i += 2) {
+            uvBuffer.put(i, (byte) YUV_BLUE_STUDIO_SWING_BT601[1]);
+            uvBuffer.put(i + 1, (byte) YUV_BLUE_STUDIO_SWING_BT601[2]);
+        }
+        ByteBuffer vBuffer = ((ByteBuffer) uvBuffer.duplicate().position(1)).slice();
+        uvBuffer.limit(WIDTH * HEIGHT / 2 - 1);
+        FakeImageProxy nv12ImageProxy = new FakeImageProxy(new FakeImageInfo());
+        nv12ImageProxy.setWidth(WIDTH);
+        nv12ImageProxy.setHeight(HEIGHT);
+        nv12ImageProxy.setFormat(ImageFormat.YUV_420_888);
+        nv12ImageProxy.setPlanes(new ImageProxy.PlaneProxy[]{
+                createPlane(yBuffer, WIDTH, 1),
+                createPlane(uvBuffer.slice(), WIDTH, 2),
+                createPlane(vBuffer, WIDTH, 2)});
+        ImageProcessingUtil.YuvConverter yuvConverter =
+                new ImageProcessingUtil.YuvConverter(/*rotationDegrees=*/0);
+
+        // Act & Assert: both frames convert to their own color.
+        try (ImageProxy rgbImageProxy = ImageProcessingUtil.convertYUVToRGB(i420ImageProxy,
+                mRGBImageReaderProxy, mRgbConvertedBuffer, /*rotation=*/0,
+                /*onePixelShiftRequested=*/false, yuvConverter)) {
+            assertRGBImageProxyColor(rgbImageProxy, yuvBt601FullSwingToRGB(
+                    YUV_RED_STUDIO_SWING_BT601[0],
+                    YUV_RED_STUDIO_SWING_BT601[1],
+                    YUV_RED_STUDIO_SWING_BT601[2]));
+        }
+        try (ImageProxy rgbImageProxy = ImageProcessingUtil.convertYUVToRGB(nv12ImageProxy,
+                mRGBImageReaderProxy, mRgbConvertedBuffer, /*rotation=*/0,
+                /*onePixelShiftRequested=*/false, yuvConverter)) {
+            assertRGBImageProxyColor(rgbImageProxy, yuvBt601FullSwingToRGB(
+                    YUV_BLUE_STUDIO_SWING_BT601[0],
+                    YUV_BLUE_STUDIO_SWING_BT601[1],
+                    YUV_BLUE_STUDIO_SWING_BT601[2]));
+        }
+        yuvConverter.close();
+    }
+
     @Test
     public void rotateRGB_imageRotated() {
         // Arrange.
@@ -386,6 +523,51 @@ public class ImageProcessingUtilTest {
         rgbImageProxy.close();
     }
 
+    @Test
+    public void rotateRGBWithYuvConverter_colorIsPreserved() {
+        // Arrange.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, YUV_RED_STUDIO_SWING_BT601[0],
+                YUV_RED_STUDIO_SWING_BT601[1], YUV_RED_STUDIO_SWING_BT601[2]);
+        int referenceColorRgb = yuvBt601FullSwingToRGB(
+                YUV_RED_STUDIO_SWING_BT601[0],
+                YUV_RED_STUDIO_SWING_BT601[1],
+                YUV_RED_STUDIO_SWING_BT601[2]);
+        ImageProcessingUtil.YuvConverter yuvConverter =
+                new ImageProcessingUtil.YuvConverter(/*rotationDegrees=*/90);
+
+        // Act: convert twice so the second frame uses the cached kernel.
+        for (int i = 0; i < 2; i++) {
+            ImageProxy rgbImageProxy = ImageProcessingUtil.convertYUVToRGB(
+                    yuvImageProxy,
+                    mRotatedRGBImageReaderProxy,
+                    mRgbConvertedBuffer,
+                    /*rotation=*/90,
+                    /*onePixelShiftRequested=*/false,
+                    yuvConverter);
+
+            // Assert.
+            assertThat(rgbImageProxy.getWidth()).isEqualTo(HEIGHT);
+            assertThat(rgbImageProxy.getHeight()).isEqualTo(WIDTH);
+            ImageProxy.PlaneProxy plane = rgbImageProxy.getPlanes()[0];
+            IntBuffer pixels = plane.getBuffer().asIntBuffer();
+            for (int row = 0; row < WIDTH; row++) {
+                for (int col = 0; col < HEIGHT; col++) {
+                    // ABGR in little endian.
+                    int pixel = pixels.get(row * plane.getRowStride() / 4 + col);
+                    assertThat((double) (pixel & 0xff)).isWithin(1)
+                            .of(Color.red(referenceColorRgb));
+                    assertThat((double) ((pixel >> 8) & 0xff)).isWithin(1)
+                            .of(Color.green(referenceColorRgb));
+                    assertThat((double) ((pixel >> 16) & 0xff)).isWithin(1)
+                            .of(Color.blue(referenceColorRgb));
+                }
+            }
+            rgbImageProxy.close();
+        }
+        yuvConverter.close();
+    }
+
     @SdkSuppress(minSdkVersion = 23)
     @Test
     public void rotateYUV_imageRotated() {
@@ -455,6 +637,248 @@ public class ImageProcessingUtilTest {
                 referenceColorRgb);
     }
 
+    @Test
+    public void convertYUVToBitmap_cropAndScale() {
+        // Arrange.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, YUV_BLUE_STUDIO_SWING_BT601[0],
+                YUV_BLUE_STUDIO_SWING_BT601[1], YUV_BLUE_STUDIO_SWING_BT601[2]);
+        int referenceColorRgb = yuvBt601FullSwingToRGB(
+                YUV_BLUE_STUDIO_SWING_BT601[0],
+                YUV_BLUE_STUDIO_SWING_BT601[1],
+                YUV_BLUE_STUDIO_SWING_BT601[2]);
+
+        // Act: convert the right half of the image, downscaled by 2.
+        Bitmap bitmap = ImageProcessingUtil.convertYUVToBitmap(
+                yuvImageProxy,
+                new Rect(WIDTH / 2, 0, WIDTH, HEIGHT),
+                WIDTH / 4,
+                HEIGHT / 2,
+                ImageProcessingUtil.SCALE_FILTER_BOX);
+
+        // Assert.
+        assertThat(bitmap.getWidth()).isEqualTo(WIDTH / 4);
+        assertThat(bitmap.getHeight()).isEqualTo(HEIGHT / 2);
+        assertBitmapColor(bitmap, referenceColorRgb, 1);
+    }
+
+    @Test
+    public void convertYUVToBitmap_oddCropOriginIsNotShifted() {
+        // Arrange: gray columns getting brighter from left to right.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, 16, 128, 128);
+        ImageProxy.PlaneProxy planeY = yuvImageProxy.getPlanes()[0];
+        ByteBuffer bufferY = planeY.getBuffer();
+        for (int row = 0; row < HEIGHT; row++) {
+            for (int col = 0; col < WIDTH; col++) {
+                bufferY.put(row * planeY.getRowStride() + col * planeY.getPixelStride(),
+                        (byte) (16 + col * 20));
+            }
+        }
+
+        // Act: convert from an odd origin without scaling.
+        Bitmap bitmap = ImageProcessingUtil.convertYUVToBitmap(
+                yuvImageProxy,
+                new Rect(1, 1, WIDTH, HEIGHT),
+                WIDTH - 1,
+                HEIGHT - 1,
+                ImageProcessingUtil.SCALE_FILTER_BILINEAR);
+
+        // Assert: the first column is the second column of the image.
+        for (int col = 0; col < bitmap.getWidth(); col++) {
+            int referenceColorRgb = yuvBt601FullSwingToRGB(16 + (col + 1) * 20, 128, 128);
+            Bitmap column = Bitmap.createBitmap(bitmap, col, 0, 1, bitmap.getHeight());
+            assertBitmapColor(column, referenceColorRgb, 1);
+        }
+    }
+
+    @Test
+    public void convertYUVToTensor_solidColorIsNormalized() {
+        // Arrange.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, YUV_RED_STUDIO_SWING_BT601[0],
+                YUV_RED_STUDIO_SWING_BT601[1], YUV_RED_STUDIO_SWING_BT601[2]);
+        int referenceColorRgb = yuvBt601FullSwingToRGB(
+                YUV_RED_STUDIO_SWING_BT601[0],
+                YUV_RED_STUDIO_SWING_BT601[1],
+                YUV_RED_STUDIO_SWING_BT601[2]);
+        ByteBuffer tensorBuffer = ByteBuffer.allocateDirect(HEIGHT * WIDTH * 3 * 4)
+                .order(ByteOrder.nativeOrder());
+
+        // Act: rotate, so the tensor is HEIGHT wide and WIDTH high.
+        boolean result = ImageProcessingUtil.convertYUVToTensor(
+                yuvImageProxy,
+                /*cropRect=*/null,
+                /*rotationDegrees=*/90,
+                tensorBuffer,
+                HEIGHT,
+                WIDTH,
+                ImageProcessingUtil.TENSOR_DATA_TYPE_FLOAT32,
+                ImageProcessingUtil.TENSOR_LAYOUT_NCHW,
+                /*mean=*/new float[]{0.5f, 0.5f, 0.5f},
+                /*std=*/new float[]{0.5f, 0.5f, 0.5f},
+                /*quantScale=*/1f,
+                /*quantZeroPoint=*/0);
+
+        // Assert: every element of each channel plane has the normalized reference value.
+        assertThat(result).isTrue();
+        FloatBuffer tensor = tensorBuffer.asFloatBuffer();
+        int[] channels = {Color.red(referenceColorRgb), Color.green(referenceColorRgb),
+                Color.blue(referenceColorRgb)};
+        for (int c = 0; c < 3; c++) {
+            float expected = (channels[c] / 255f - 0.5f) / 0.5f;
+            for (int i = 0; i < WIDTH * HEIGHT; i++) {
+                assertThat(tensor.get(c * WIDTH * HEIGHT + i)).isWithin(2f / 255f).of(expected);
+            }
+        }
+    }
+
+    @Test
+    public void computeLumaStatistics_solidColor() {
+        // Arrange.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, /*y=*/250, /*u=*/128, /*v=*/128);
+
+        // Act: sample every other pixel of the bottom right quarter.
+        ImageProcessingUtil.LumaStatistics stats = ImageProcessingUtil.computeLumaStatistics(
+                yuvImageProxy,
+                new Rect(WIDTH / 2, HEIGHT / 2, WIDTH, HEIGHT),
+                /*sampleStep=*/2,
+                /*underExposedThreshold=*/16,
+                /*overExposedThreshold=*/240);
+
+        // Assert.
+        assertThat(stats).isNotNull();
+        assertThat(stats.getHistogram()[250]).isEqualTo(
+                ((WIDTH / 2 + 1) / 2) * ((HEIGHT / 2 + 1) / 2));
+        assertThat(stats.getMean()).isWithin(0.01f).of(250f);
+        assertThat(stats.getVariance()).isWithin(0.01f).of(0f);
+        assertThat(stats.getSharpness()).isWithin(0.01f).of(0f);
+        assertThat(stats.getUnderExposedRatio()).isEqualTo(0f);
+        assertThat(stats.getOverExposedRatio()).isEqualTo(1f);
+    }
+
+    @Test
+    public void detectMotion_onlyChangedFrameMoves() {
+        // Arrange.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, /*y=*/100, /*u=*/128, /*v=*/128);
+        ImageProcessingUtil.MotionDetector motionDetector =
+                new ImageProcessingUtil.MotionDetector(/*downsampleFactor=*/2, /*tileSize=*/2,
+                        /*threshold=*/10);
+
+        // Act: the first frame becomes the reference, the second one is identical.
+        ImageProcessingUtil.MotionResult first = motionDetector.detect(yuvImageProxy, true);
+        ImageProcessingUtil.MotionResult still = motionDetector.detect(yuvImageProxy, true);
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, /*y=*/200, /*u=*/128, /*v=*/128);
+        ImageProcessingUtil.MotionResult moved = motionDetector.detect(yuvImageProxy, true);
+        motionDetector.close();
+
+        // Assert: 8x4 is downsampled to 4x2, which is 2x1 tiles.
+        assertThat(first.getScore()).isEqualTo(1f);
+        assertThat(still.getTilesX()).isEqualTo(2);
+        assertThat(still.getTilesY()).isEqualTo(1);
+        assertThat(still.getScore()).isEqualTo(0f);
+        assertThat(still.getTileMap()).isEqualTo(new byte[]{0, 0});
+        assertThat(moved.getScore()).isEqualTo(1f);
+        assertThat(moved.getTileMap()).isEqualTo(new byte[]{100, 100});
+    }
+
+    @Test
+    public void buildImagePyramid_solidColorIsPreservedAfterClose() {
+        // Arrange.
+        ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
+        fillYuvImageProxyWithYUVColor(yuvImageProxy, /*y=*/250, /*u=*/128, /*v=*/128);
+        ImageProcessingUtil.ImagePyramid imagePyramid =
+                new ImageProcessingUtil.ImagePyramid(/*levelCount=*/3);
+
+        // Act.
+        boolean result = imagePyramid.build(yuvImageProxy);
+
+        // Assert: 8x4 only has one level of at least 2x2 pixels.
+        assertThat(result).isTrue();
+        assertThat(imagePyramid.getLevelCount()).isEqualTo(1);
+        assertThat(imagePyramid.getLevelWidth(0)).isEqualTo(WIDTH / 2);
+        assertThat(imagePyramid.getLevelHeight(0)).isEqualTo(HEIGHT / 2);
+        ByteBuffer level = imagePyramid.getLevelBuffer(0);
+        // The level stays readable after the pyramid is closed.
+        imagePyramid.close();
+        assertThat(level.remaining()).isEqualTo(WIDTH / 2 * HEIGHT / 2);
+        while (level.hasRemaining()) {
+            assertThat(level.get()).isEqualTo((byte) 250);
+        }
+    }
+
+    @SdkSuppress(minSdkVersion = 33)
+    @Test
+    public void convertP010ToBitmap_grayIsConvertedTo10Bit() {
+        // Arrange: limited range mid gray, code values are stored in the upper 10 bits.
+        short codeValue = (short) (512 << 6);
+        ByteBuffer yBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT * 2)
+                .order(ByteOrder.nativeOrder());
+        ByteBuffer uvBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT)
+                .order(ByteOrder.nativeOrder());
+        while (yBuffer.hasRemaining()) {
+            yBuffer.putShort(codeValue);
+        }
+        while (uvBuffer.hasRemaining()) {
+            uvBuffer.putShort(codeValue);
+        }
+        yBuffer.rewind();
+        uvBuffer.rewind();
+        ByteBuffer vBuffer = ((ByteBuffer) uvBuffer.duplicate().position(2)).slice();
+        FakeImageProxy p010ImageProxy = new FakeImageProxy(new FakeImageInfo());
+        p010ImageProxy.setWidth(WIDTH);
+        p010ImageProxy.setHeight(HEIGHT);
+        p010ImageProxy.setFormat(ImageFormat.YCBCR_P010);
+        p010ImageProxy.setPlanes(new ImageProxy.PlaneProxy[]{
+                createPlane(yBuffer, WIDTH * 2, 2),
+                createPlane(uvBuffer, WIDTH * 2, 4),
+                createPlane(vBuffer, WIDTH * 2, 4)});
+        Bitmap bitmap = Bitmap.createBitmap(HEIGHT, WIDTH, Bitmap.Config.RGBA_1010102);
+
+        // Act.
+        boolean result = ImageProcessingUtil.convertP010ToBitmap(p010ImageProxy, bitmap,
+                /*rotationDegrees=*/90, ImageProcessingUtil.HDR_COLOR_STANDARD_BT2020,
+                ImageProcessingUtil.HDR_TRANSFER_NONE);
+
+        // Assert: limited range 512 expands to (512 - 64) * 1023 / 876 in every channel.
+        assertThat(result).isTrue();
+        IntBuffer pixels = ByteBuffer.allocateDirect(bitmap.getByteCount())
+                .order(ByteOrder.nativeOrder()).asIntBuffer();
+        bitmap.copyPixelsToBuffer(pixels);
+        pixels.rewind();
+        while (pixels.hasRemaining()) {
+            int pixel = pixels.get();
+            for (int shift = 0; shift < 30; shift += 10) {
+                assertThat((double) ((pixel >> shift) & 0x3ff)).isWithin(2).of(523);
+            }
+        }
+    }
+
+    @SdkSuppress(minSdkVersion = 33)
+    @Test
+    public void convertP010ToBitmap_chromaNotInterleavedFails() {
+        // Arrange: 16-bit chroma planes that are not interleaved.
+        FakeImageProxy p010ImageProxy = new FakeImageProxy(new FakeImageInfo());
+        p010ImageProxy.setWidth(WIDTH);
+        p010ImageProxy.setHeight(HEIGHT);
+        p010ImageProxy.setFormat(ImageFormat.YCBCR_P010);
+        p010ImageProxy.setPlanes(new ImageProxy.PlaneProxy[]{
+                createPlane(ByteBuffer.allocateDirect(WIDTH * HEIGHT * 2), WIDTH * 2, 2),
+                createPlane(ByteBuffer.allocateDirect(WIDTH * HEIGHT / 2), WIDTH, 2),
+                createPlane(ByteBuffer.allocateDirect(WIDTH * HEIGHT / 2), WIDTH, 2)});
+        Bitmap bitmap = Bitmap.createBitmap(WIDTH, HEIGHT, Bitmap.Config.RGBA_1010102);
+
+        // Act.
+        boolean result = ImageProcessingUtil.convertP010ToBitmap(p010ImageProxy, bitmap,
+                /*rotationDegrees=*/0, ImageProcessingUtil.HDR_COLOR_STANDARD_BT2020,
+                ImageProcessingUtil.HDR_TRANSFER_NONE);
+
+        // Assert.
+        assertThat(result).isFalse();
+    }
+
     @Test
     public void canCopyBetweenBitmapAndByteBufferWithDifferentStrides() {
 
@@ -480,6 +904,101 @@ public class ImageProcessingUtilTest {
         assertBitmapColor(bitmap2, Color.YELLOW, 0);
     }
 
+    @Test
+    public void copyBitmapToByteBuffer_convertsRotatesAndSwizzles() {
+        // Arrange: the left half is red and the right half green.
+        Bitmap bitmap = Bitmap.createBitmap(WIDTH, HEIGHT, Bitmap.Config.ARGB_8888);
+        bitmap.eraseColor(Color.RED);
+        for (int row = 0; row < HEIGHT; row++) {
+            for (int col = WIDTH / 2; col < WIDTH; col++) {
+                bitmap.setPixel(col, row, Color.GREEN);
+            }
+        }
+        int bufferStride = HEIGHT * 3 + PADDING_BYTES;
+        ByteBuffer byteBuffer = ByteBuffer.allocateDirect(bufferStride * WIDTH);
+
+        // Act: rotate into packed RGB with red and blue swapped, then expand to RGB_565.
+        boolean toBuffer = ImageProcessingUtil.copyBitmapToByteBuffer(bitmap, byteBuffer,
+                bufferStride, ImageProcessingUtil.PIXEL_FORMAT_RGB_888, null,
+                /*rotationDegrees=*/90, ImageProcessingUtil.ALPHA_OP_NONE,
+                new int[]{2, 1, 0, 3});
+        Bitmap rgb565Bitmap = Bitmap.createBitmap(HEIGHT, WIDTH, Bitmap.Config.RGB_565);
+        boolean toBitmap = ImageProcessingUtil.copyByteBufferToBitmap(rgb565Bitmap, byteBuffer,
+                bufferStride, ImageProcessingUtil.PIXEL_FORMAT_RGB_888, null,
+                /*rotationDegrees=*/0, ImageProcessingUtil.ALPHA_OP_NONE, null);
+
+        // Assert: the left half is now on top.
+        assertThat(toBuffer).isTrue();
+        assertThat(toBitmap).isTrue();
+        assertThat(byteBuffer.get(0)).isEqualTo((byte) 0);
+        assertThat(byteBuffer.get(2)).isEqualTo((byte) 0xff);
+        assertThat(rgb565Bitmap.getPixel(0, 0)).isEqualTo(Color.BLUE);
+        assertThat(rgb565Bitmap.getPixel(HEIGHT - 1, WIDTH - 1)).isEqualTo(Color.GREEN);
+    }
+
+    @Test(expected = IllegalArgumentException.class)
+    public void copyBitmapToByteBuffer_unsupportedConfigThrows() {
+        Bitmap bitmap = Bitmap.createBitmap(WIDTH, HEIGHT, Bitmap.Config.ALPHA_8);
+        ByteBuffer byteBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT * 4);
+
+        ImageProcessingUtil.copyBitmapToByteBuffer(bitmap, byteBuffer, WIDTH * 4);
+    }
+
+    @Test
+    public void copyBitmapToByteBuffer_negativeCropOrStrideFails() {
+        Bitmap bitmap = Bitmap.createBitmap(WIDTH, HEIGHT, Bitmap.Config.ARGB_8888);
+        ByteBuffer byteBuffer = ByteBuffer.allocateDirect(WIDTH * HEIGHT * 4);
+
+        assertThat(ImageProcessingUtil.copyBitmapToByteBuffer(bitmap, byteBuffer, WIDTH * 4,
+                ImageProcessingUtil.PIXEL_FORMAT_RGBA_8888, new Rect(-1, 0, WIDTH - 1, HEIGHT),
+                /*rotationDegrees=*/0, ImageProcessingUtil.ALPHA_OP_NONE, null)).isFalse();
+        assertThat(ImageProcessingUtil.copyBitmapToByteBuffer(bitmap, byteBuffer, -WIDTH * 4,
+                ImageProcessingUtil.PIXEL_FORMAT_RGBA_8888, null,
+                /*rotationDegrees=*/0, ImageProcessingUtil.ALPHA_OP_NONE, null)).isFalse();
+        assertThat(ImageProcessingUtil.copyByteBufferToBitmap(bitmap, byteBuffer, WIDTH * 4,
+                ImageProcessingUtil.PIXEL_FORMAT_RGBA_8888, new Rect(0, -1, WIDTH, HEIGHT - 1),
+                /*rotationDegrees=*/0, ImageProcessingUtil.ALPHA_OP_NONE, null)).isFalse();
+    }
+
+    @Test
+    public void remapBitmap_scalesDown() {
+        // Arrange: the left half is red and the right half green. The warped frame has several
+        // rows of 64 pixel tiles, so that every thread of the table warps some of them.
+        int width = 256;
+        int height = 512;
+        Bitmap bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888);
+        bitmap.eraseColor(Color.RED);
+        for (int row = 0; row < height; row++) {
+            for (int col = width / 2; col < width; col++) {
+                bitmap.setPixel(col, row, Color.GREEN);
+            }
+        }
+        Matrix transform = new Matrix();
+        transform.setScale(0.5f, 0.5f);
+        ImageProcessingUtil.RemapTable remapTable = ImageProcessingUtil.RemapTable.create(
+                width, height, width / 2, height / 2, transform, null, null,
+                /*threadCount=*/3);
+        Bitmap outputBitmap = Bitmap.createBitmap(width / 2, height / 2,
+                Bitmap.Config.ARGB_8888);
+
+        // Act: warp several frames with the same worker threads.
+        boolean result = true;
+        for (int i = 0; i < 3; i++) {
+            outputBitmap.eraseColor(Color.BLACK);
+            result &= remapTable.remap(bitmap, outputBitmap);
+        }
+        remapTable.close();
+
+        // Assert.
+        assertThat(result).isTrue();
+        for (int row = 0; row < height / 2; row++) {
+            for (int col = 0; col < width / 2; col++) {
+                assertThat(outputBitmap.getPixel(col, row))
+                        .isEqualTo(col < width / 4 ? Color.RED : Color.GREEN);
+            }
+        }
+    }
+
     private void assertSolidYUVColorConvertedToRGBMatchesReferenceRGB(int[] yuvColor,
             int referenceColorRgb) {
         ImageProxy yuvImageProxy = createYuvImageProxyWithPlanes();
@@ -543,6 +1062,28 @@ public class ImageProcessingUtilTest {
         return yuvImageProxy;
     }
 
+    @NonNull
+    private static ImageProxy.PlaneProxy createPlane(@NonNull ByteBuffer buffer, int rowStride,
+            int pixelStride) {
+        return new ImageProxy.PlaneProxy() {
+            @Override
+            public int getRowStride() {
+                return rowStride;
+            }
+
+            @Override
+            public int getPixelStride() {
+                return pixelStride;
+            }
+
+            @NonNull
+            @Override
+            public ByteBuffer getBuffer() {
+                return buffer;
+            }
+        };
+    }
+
     private static void assertRGBImageProxyColor(ImageProxy rgbImageProxy,
             int referenceColorRgb) {
         // Convert to Bitmap
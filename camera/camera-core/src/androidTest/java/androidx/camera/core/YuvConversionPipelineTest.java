@@ -0,0 +1,209 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.camera.core;
+
+import static androidx.camera.testing.impl.ImageProxyUtil.createYUV420ImagePlanes;
+
+import static com.google.common.truth.Truth.assertThat;
+
+import android.graphics.ImageFormat;
+import android.os.Handler;
+import android.os.HandlerThread;
+
+import androidx.camera.testing.impl.fakes.FakeImageInfo;
+import androidx.camera.testing.impl.fakes.FakeImageProxy;
+import androidx.test.ext.junit.runners.AndroidJUnit4;
+import androidx.test.filters.SdkSuppress;
+import androidx.test.filters.SmallTest;
+
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+/**
+ * Unit test for {@link YuvConversionPipeline}.
+ */
+@SmallTest
+@RunWith(AndroidJUnit4.class)
+@SdkSuppress(minSdkVersion = 23)
+public class YuvConversionPipelineTest {
+
+    private static final int WIDTH = 64;
+    private static final int HEIGHT = 32;
+    private static final long TIMESTAMP_NANOS = 1234L;
+
+    private HandlerThread mHandlerThread;
+    private YuvConversionPipeline mPipeline;
+    private final BlockingQueue<YuvConversionPipeline.ConvertedFrame> mFrames =
+            new ArrayBlockingQueue<>(4);
+
+    @Before
+    public void setUp() {
+        mHandlerThread = new HandlerThread("YuvConversionPipelineTest");
+        mHandlerThread.start();
+        mPipeline = YuvConversionPipeline.create(WIDTH, HEIGHT, /*rotationDegrees=*/90,
+                /*capacity=*/2, mHandlerThread.getLooper(), mFrames::offer);
+    }
+
+    @After
+    public void tearDown() {
+        if (mPipeline != null) {
+            mPipeline.close();
+        }
+        mHandlerThread.quitSafely();
+    }
+
+    @Test
+    public void submittedImageIsConvertedAndRotated() throws InterruptedException {
+        // Arrange: mid gray.
+        FakeImageProxy imageProxy = createGrayImageProxy();
+
+        // Act.
+        assertThat(mPipeline).isNotNull();
+        assertThat(mPipeline.submit(imageProxy)).isTrue();
+        imageProxy.close();
+        YuvConversionPipeline.ConvertedFrame frame = mFrames.poll(5, TimeUnit.SECONDS);
+
+        // Assert.
+        assertThat(frame).isNotNull();
+        assertThat(frame.getWidth()).isEqualTo(HEIGHT);
+        assertThat(frame.getHeight()).isEqualTo(WIDTH);
+        assertThat(frame.getTimestampNanos()).isEqualTo(TIMESTAMP_NANOS);
+        ByteBuffer pixels = frame.getBuffer();
+        for (int i = 0; i < frame.getRowStride() * frame.getHeight(); i += 4) {
+            assertThat((double) (pixels.get(i) & 0xff)).isWithin(1).of(128);
+            assertThat((double) (pixels.get(i + 1) & 0xff)).isWithin(1).of(128);
+            assertThat((double) (pixels.get(i + 2) & 0xff)).isWithin(1).of(128);
+            assertThat(pixels.get(i + 3) & 0xff).isEqualTo(255);
+        }
+        frame.close();
+
+        YuvConversionPipeline.LatencyStats stats = mPipeline.getLatencyStats();
+        assertThat(stats.getCount(YuvConversionPipeline.STAGE_CONVERT)).isEqualTo(1);
+        assertThat(stats.getCount(YuvConversionPipeline.STAGE_DELIVER)).isEqualTo(1);
+        assertThat(stats.getDroppedCount()).isEqualTo(0);
+    }
+
+    @Test
+    public void closeWhileSubmittingFromAnotherThread() throws InterruptedException {
+        // Arrange.
+        assertThat(mPipeline).isNotNull();
+        FakeImageProxy imageProxy = createGrayImageProxy();
+        AtomicBoolean closed = new AtomicBoolean();
+        Thread submitThread = new Thread(() -> {
+            while (!closed.get()) {
+                mPipeline.submit(imageProxy);
+                YuvConversionPipeline.ConvertedFrame frame;
+                while ((frame = mFrames.poll()) != null) {
+                    frame.close();
+                }
+            }
+        });
+
+        // Act: close while frames are being copied into the ring.
+        submitThread.start();
+        Thread.sleep(50);
+        mPipeline.close();
+        closed.set(true);
+        submitThread.join(TimeUnit.SECONDS.toMillis(5));
+
+        // Assert: frames submitted after close are rejected.
+        assertThat(submitThread.isAlive()).isFalse();
+        assertThat(mPipeline.submit(imageProxy)).isFalse();
+        imageProxy.close();
+    }
+
+    @Test
+    public void fullRingDropsOldestFrameWaitingForConversionOrDelivery()
+            throws InterruptedException {
+        // Arrange: a ring of 3 holding two converted frames the listener has not received yet,
+        // followed by a frame waiting for conversion.
+        mPipeline.close();
+        mPipeline = YuvConversionPipeline.create(WIDTH, HEIGHT, /*rotationDegrees=*/0,
+                /*capacity=*/3, mHandlerThread.getLooper(), mFrames::offer);
+        assertThat(mPipeline).isNotNull();
+        CountDownLatch looperBlocked = new CountDownLatch(1);
+        new Handler(mHandlerThread.getLooper()).post(() -> {
+            try {
+                looperBlocked.await();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
+        });
+        submitGrayImage(1);
+        submitGrayImage(2);
+        for (int i = 0; i < 500 && mPipeline.getLatencyStats().getCount(
+                YuvConversionPipeline.STAGE_CONVERT) < 2; i++) {
+            Thread.sleep(10);
+        }
+        assertThat(mPipeline.getLatencyStats().getCount(YuvConversionPipeline.STAGE_CONVERT))
+                .isEqualTo(2);
+        mPipeline.setConversionPausedForTesting(true);
+        submitGrayImage(3);
+
+        // Act: the ring is full.
+        submitGrayImage(4);
+        mPipeline.setConversionPausedForTesting(false);
+        looperBlocked.countDown();
+
+        // Assert: the oldest converted frame was dropped, not the newer pending one.
+        for (long timestamp = 2; timestamp <= 4; timestamp++) {
+            YuvConversionPipeline.ConvertedFrame frame = mFrames.poll(5, TimeUnit.SECONDS);
+            assertThat(frame).isNotNull();
+            assertThat(frame.getTimestampNanos()).isEqualTo(timestamp);
+            frame.close();
+        }
+        assertThat(mPipeline.getLatencyStats().getDroppedCount()).isEqualTo(1);
+    }
+
+    private void submitGrayImage(long timestampNanos) {
+        FakeImageProxy imageProxy = createGrayImageProxy(timestampNanos);
+        assertThat(mPipeline.submit(imageProxy)).isTrue();
+        imageProxy.close();
+    }
+
+    private static FakeImageProxy createGrayImageProxy() {
+        return createGrayImageProxy(TIMESTAMP_NANOS);
+    }
+
+    private static FakeImageProxy createGrayImageProxy(long timestampNanos) {
+        FakeImageInfo imageInfo = new FakeImageInfo();
+        imageInfo.setTimestamp(timestampNanos);
+        FakeImageProxy imageProxy = new FakeImageProxy(imageInfo);
+        imageProxy.setWidth(WIDTH);
+        imageProxy.setHeight(HEIGHT);
+        imageProxy.setFormat(ImageFormat.YUV_420_888);
+        imageProxy.setPlanes(createYUV420ImagePlanes(WIDTH, HEIGHT, /*pixelStrideY=*/1,
+                /*pixelStrideUV=*/2, /*flipUV=*/false, /*incrementValue=*/false));
+        for (ImageProxy.PlaneProxy plane : imageProxy.getPlanes()) {
+            ByteBuffer buffer = plane.getBuffer();
+            while (buffer.hasRemaining()) {
+                buffer.put((byte) 128);
+            }
+            buffer.rewind();
+        }
+        return imageProxy;
+    }
+}
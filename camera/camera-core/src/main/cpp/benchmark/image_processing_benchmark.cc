@@ -0,0 +1,289 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Host benchmark of the kernels behind ImageProcessingUtil.
+//
+// Runs every kernel over synthetic frames at common camera sizes, with row strides padded like
+// camera HALs do and with the chroma layouts of YUV_420_888 (I420, NV12, NV21 and planes with a
+// pixel stride of 2 that are not interleaved). Throughput is reported in MB/s of YUV_420_888
+// input, so kernels over the same frame can be compared directly.
+//
+// Usage: image_processing_benchmark [--min-time-ms=N] [filter]
+// Only kernels whose name contains the filter are run.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "image_processing_util.h"
+#include "luma_statistics.h"
+
+namespace {
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+const Resolution kResolutions[] = {
+        {"480p", 640, 480},
+        {"1080p", 1920, 1080},
+        {"4K", 3840, 2160},
+        {"12MP", 4000, 3000},
+};
+
+enum Layout {
+    LAYOUT_I420,
+    LAYOUT_NV12,
+    LAYOUT_NV21,
+    // Pixel stride of 2 with U and V in separate planes, which takes the weave fallback.
+    LAYOUT_GENERIC,
+};
+
+const char* const kLayoutNames[] = {"I420", "NV12", "NV21", "generic"};
+
+// Extra bytes after every plane, so kernels that read one pixel past the end like the pixel
+// shift workaround stay in bounds.
+#define PLANE_SLACK 64
+
+int align_up(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Row strides are a multiple of 64 with at least 32 bytes of padding.
+int padded_stride(int row_bytes) {
+    return align_up(row_bytes + 32, 64);
+}
+
+struct Frame {
+    int width;
+    int height;
+    Layout layout;
+    std::vector<uint8_t> y_plane;
+    std::vector<uint8_t> u_plane;
+    std::vector<uint8_t> v_plane;
+    uint8_t* y;
+    uint8_t* u;
+    uint8_t* v;
+    int stride_y;
+    int stride_u;
+    int stride_v;
+    int pixel_stride_uv;
+};
+
+void fill_random(std::vector<uint8_t>* plane, uint32_t seed) {
+    // Smooth gradient with noise, closer to camera content than white noise.
+    for (size_t i = 0; i < plane->size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        (*plane)[i] = static_cast<uint8_t>((i >> 4) + (seed >> 28));
+    }
+}
+
+void create_frame(int width, int height, Layout layout, Frame* frame) {
+    int halfwidth = (width + 1) / 2;
+    int halfheight = (height + 1) / 2;
+    frame->width = width;
+    frame->height = height;
+    frame->layout = layout;
+    frame->stride_y = padded_stride(width);
+    frame->y_plane.resize(static_cast<size_t>(frame->stride_y) * height + PLANE_SLACK);
+    fill_random(&frame->y_plane, 1);
+    frame->y = frame->y_plane.data();
+
+    switch (layout) {
+        case LAYOUT_I420:
+            frame->pixel_stride_uv = 1;
+            frame->stride_u = frame->stride_v = padded_stride(halfwidth);
+            break;
+        case LAYOUT_NV12:
+        case LAYOUT_NV21:
+        case LAYOUT_GENERIC:
+            frame->pixel_stride_uv = 2;
+            frame->stride_u = frame->stride_v = padded_stride(halfwidth * 2);
+            break;
+    }
+    size_t chroma_size = static_cast<size_t>(frame->stride_u) * halfheight + PLANE_SLACK;
+    frame->u_plane.resize(chroma_size);
+    fill_random(&frame->u_plane, 2);
+    if (layout == LAYOUT_NV12 || layout == LAYOUT_NV21) {
+        // Both planes alias one interleaved buffer.
+        uint8_t* uv = frame->u_plane.data();
+        frame->u = layout == LAYOUT_NV12 ? uv : uv + 1;
+        frame->v = layout == LAYOUT_NV12 ? uv + 1 : uv;
+    } else {
+        frame->v_plane.resize(chroma_size);
+        fill_random(&frame->v_plane, 3);
+        frame->u = frame->u_plane.data();
+        frame->v = frame->v_plane.data();
+    }
+}
+
+struct Options {
+    int min_time_ms = 500;
+    std::string filter;
+};
+
+// Runs the kernel until the minimum time has passed and reports the median iteration.
+void run(const Options& options, const char* kernel, const char* layout,
+         const Resolution& resolution, const std::function<int()>& body) {
+    std::string name = std::string(kernel) + "/" + layout + "/" + resolution.name;
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return;
+    }
+    if (body() != 0) {
+        printf("%-48s failed\n", name.c_str());
+        return;
+    }
+
+    std::vector<double> times;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(options.min_time_ms);
+    do {
+        auto begin = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(end - begin).count());
+    } while (times.size() < 5 || std::chrono::steady_clock::now() < deadline);
+
+    std::sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+    double frame_bytes = static_cast<double>(resolution.width) * resolution.height * 3 / 2;
+    printf("%-48s %9.3f ms %10.1f MB/s %6zu iterations\n", name.c_str(), median * 1000.0,
+           frame_bytes / median / 1e6, times.size());
+}
+
+void benchmark_resolution(const Options& options, const Resolution& resolution) {
+    int width = resolution.width;
+    int height = resolution.height;
+    int halfwidth = (width + 1) / 2;
+    int halfheight = (height + 1) / 2;
+
+    // Outputs are tightly packed, like Bitmaps and the rotation buffers of ImageProcessingUtil.
+    std::vector<uint8_t> abgr(static_cast<size_t>(width) * height * 4);
+    std::vector<uint8_t> rotated(static_cast<size_t>(width) * height * 3 / 2 + PLANE_SLACK);
+    uint8_t* rotated_y = rotated.data();
+    uint8_t* rotated_u = rotated_y + static_cast<size_t>(width) * height;
+    uint8_t* rotated_v = rotated_u + static_cast<size_t>(halfwidth) * halfheight;
+
+    for (int l = LAYOUT_I420; l <= LAYOUT_GENERIC; l++) {
+        Layout layout = static_cast<Layout>(l);
+        const char* layout_name = kLayoutNames[layout];
+        Frame f;
+        create_frame(width, height, layout, &f);
+
+        run(options, "Android420ToABGR", layout_name, resolution, [&]() {
+            return Android420ToABGR(f.y, f.stride_y, f.u, f.stride_u, f.v, f.stride_v,
+                                    f.pixel_stride_uv, abgr.data(), width * 4,
+                                    /* is_full_swing = */true, width, height);
+        });
+
+        // Center crop of 80% scaled to a quarter of the area, like an analysis thumbnail.
+        int crop_width = width * 4 / 5 & ~1;
+        int crop_height = height * 4 / 5 & ~1;
+        int crop_left = (width - crop_width) / 4 * 2;
+        int crop_top = (height - crop_height) / 4 * 2;
+        run(options, "Android420ToABGRScaled", layout_name, resolution, [&]() {
+            return Android420ToABGRScaled(f.y, f.stride_y, f.u, f.stride_u, f.v, f.stride_v,
+                                          f.pixel_stride_uv, crop_left, crop_top, crop_width,
+                                          crop_height, abgr.data(), halfwidth * 4, halfwidth,
+                                          halfheight, libyuv::kFilterBilinear);
+        });
+
+        run(options, "Android420RotateToI420", layout_name, resolution, [&]() {
+            return Android420RotateToI420(f.y, f.stride_y, f.u, f.stride_u, f.v, f.stride_v,
+                                          f.pixel_stride_uv, rotated_y, height, rotated_u,
+                                          halfheight, rotated_v, halfheight, width, height,
+                                          libyuv::kRotate90);
+        });
+
+        if (layout == LAYOUT_GENERIC) {
+            run(options, "weave_pixels", layout_name, resolution, [&]() {
+                const uint8_t* src_u = f.u;
+                const uint8_t* src_v = f.v;
+                uint8_t* dst_uv = rotated_u;
+                for (int y = 0; y < halfheight; y++) {
+                    weave_pixels(src_u, src_v, f.pixel_stride_uv, dst_uv, halfwidth);
+                    src_u += f.stride_u;
+                    src_v += f.stride_v;
+                    dst_uv += halfwidth * 2;
+                }
+                return 0;
+            });
+        }
+
+        if (layout == LAYOUT_NV21) {
+            // Planes of devices with the one pixel shift start one pixel late.
+            run(options, "Android420ToABGRWithPixelShift", layout_name, resolution, [&]() {
+                return Android420ToABGRWithPixelShift(f.y, f.stride_y, f.u, f.stride_u, f.v,
+                                                      f.stride_v, 1, f.pixel_stride_uv,
+                                                      abgr.data(), width * 4, width, height);
+            });
+
+            // Writes the rotated I420 planes back into NV21 planes, as rotateYUV does.
+            Frame d;
+            create_frame(height, width, layout, &d);
+            run(options, "CopyPlaneToPixelStride", layout_name, resolution, [&]() {
+                CopyPlaneToPixelStride(rotated_y, height, d.y, d.stride_y, 1, height, width);
+                CopyPlaneToPixelStride(rotated_u, halfheight, d.u, d.stride_u,
+                                       d.pixel_stride_uv, halfheight, halfwidth);
+                CopyPlaneToPixelStride(rotated_v, halfheight, d.v, d.stride_v,
+                                       d.pixel_stride_uv, halfheight, halfwidth);
+                return 0;
+            });
+        }
+
+        if (layout == LAYOUT_I420) {
+            run(options, "ShiftPixels", layout_name, resolution, [&]() {
+                ShiftPixels(f.y, f.stride_y, f.u, f.stride_u, f.v, f.stride_v, width, height,
+                            1, 1, 1);
+                return 0;
+            });
+
+            LumaStatistics stats;
+            run(options, "ComputeLumaStatistics", layout_name, resolution, [&]() {
+                return ComputeLumaStatistics(f.y, f.stride_y, 1, width, height, 0, 0, width,
+                                             height, 1, 16, 240, &stats);
+            });
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const char* min_time = "--min-time-ms=";
+        if (strncmp(argv[i], min_time, strlen(min_time)) == 0) {
+            options.min_time_ms = atoi(argv[i] + strlen(min_time));
+        } else {
+            options.filter = argv[i];
+        }
+    }
+
+    for (const Resolution& resolution : kResolutions) {
+        benchmark_resolution(options, resolution);
+    }
+    return 0;
+}
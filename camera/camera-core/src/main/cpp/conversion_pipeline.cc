@@ -0,0 +1,264 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "conversion_pipeline.h"
+
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include "libyuv/convert.h"
+
+static int64_t get_monotonic_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+static size_t get_i420_size(int width, int height) {
+    size_t halfwidth = (width + 1) >> 1;
+    size_t halfheight = (height + 1) >> 1;
+    return static_cast<size_t>(width) * height + halfwidth * halfheight * 2;
+}
+
+ConversionPipeline* ConversionPipeline::Create(int width, int height, int rotation, int capacity) {
+    if (width <= 0 || height <= 0 || capacity <= 0) {
+        return nullptr;
+    }
+    // Frames are copied into the ring as I420, so a single kernel serves every input layout.
+    YuvConverter* converter = CreateYuvConverter(YUV_LAYOUT_I420, YUV_KERNEL_OUTPUT_ABGR, width,
+                                                 height, rotation);
+    if (converter == nullptr) {
+        return nullptr;
+    }
+
+    ConversionPipeline* pipeline = new ConversionPipeline();
+    pipeline->converter_ = converter;
+    pipeline->width_ = width;
+    pipeline->height_ = height;
+    bool flip_wh = rotation == 90 || rotation == 270;
+    pipeline->output_width_ = flip_wh ? height : width;
+    pipeline->output_height_ = flip_wh ? width : height;
+    pipeline->capacity_ = capacity;
+
+    size_t input_size = get_i420_size(width, height);
+    size_t output_size = static_cast<size_t>(pipeline->output_stride()) * pipeline->output_height_;
+    pipeline->slots_ = static_cast<Slot*>(calloc(capacity, sizeof(Slot)));
+    pipeline->memory_ = static_cast<uint8_t*>(malloc((input_size + output_size) * capacity));
+    pipeline->event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (pipeline->slots_ == nullptr || pipeline->memory_ == nullptr
+            || pipeline->event_fd_ < 0) {
+        delete pipeline;
+        return nullptr;
+    }
+    for (int i = 0; i < capacity; i++) {
+        Slot& slot = pipeline->slots_[i];
+        slot.state = SLOT_FREE;
+        slot.input = pipeline->memory_ + (input_size + output_size) * i;
+        slot.output = slot.input + input_size;
+    }
+
+    pipeline->worker_ = std::thread(&ConversionPipeline::Run, pipeline);
+    return pipeline;
+}
+
+ConversionPipeline::~ConversionPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    pending_condition_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    if (event_fd_ >= 0) {
+        close(event_fd_);
+    }
+    free(memory_);
+    free(slots_);
+    DestroyYuvConverter(converter_);
+}
+
+uint8_t* ConversionPipeline::output(int slot) const {
+    return slots_[slot].output;
+}
+
+int ConversionPipeline::FindOldest(SlotState state) const {
+    int oldest = -1;
+    for (int i = 0; i < capacity_; i++) {
+        if (slots_[i].state == state
+                && (oldest < 0 || slots_[i].sequence < slots_[oldest].sequence)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+int ConversionPipeline::FindOldestDroppable() const {
+    int oldest = -1;
+    for (int i = 0; i < capacity_; i++) {
+        if ((slots_[i].state == SLOT_PENDING || slots_[i].state == SLOT_DONE)
+                && (oldest < 0 || slots_[i].sequence < slots_[oldest].sequence)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void ConversionPipeline::RecordStage(PipelineStage stage, int64_t start_ns, int64_t end_ns) {
+    uint64_t duration = static_cast<uint64_t>(end_ns - start_ns);
+    PipelineStageStats& stats = stats_[stage];
+    stats.count++;
+    stats.total_ns += duration;
+    if (duration > stats.max_ns) {
+        stats.max_ns = duration;
+    }
+}
+
+int ConversionPipeline::Submit(const YuvPlanes& src, int64_t timestamp_ns) {
+    int64_t start_ns = get_monotonic_time_ns();
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index = FindOldest(SLOT_FREE);
+        // Drop the oldest frame nobody is working on, whether it waits for the worker or for the
+        // consumer.
+        if (index < 0) {
+            index = FindOldestDroppable();
+        }
+        if (index < 0) {
+            dropped_count_++;
+            return -1;
+        }
+        if (slots_[index].state != SLOT_FREE) {
+            dropped_count_++;
+        }
+        slots_[index].state = SLOT_COPYING;
+        slots_[index].sequence = next_sequence_++;
+        slots_[index].timestamp_ns = timestamp_ns;
+    }
+
+    Slot& slot = slots_[index];
+    int halfwidth = (width_ + 1) >> 1;
+    uint8_t* dst_y = slot.input;
+    uint8_t* dst_u = dst_y + static_cast<size_t>(width_) * height_;
+    uint8_t* dst_v = dst_u + static_cast<size_t>(halfwidth) * ((height_ + 1) >> 1);
+    int result = libyuv::Android420ToI420(src.y, src.stride_y, src.u, src.stride_u, src.v,
+                                          src.stride_v, src.pixel_stride_uv, dst_y, width_,
+                                          dst_u, halfwidth, dst_v, halfwidth, width_, height_);
+
+    int64_t end_ns = get_monotonic_time_ns();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (result != 0) {
+            slot.state = SLOT_FREE;
+            return -1;
+        }
+        slot.state = SLOT_PENDING;
+        slot.state_time_ns = end_ns;
+        RecordStage(PIPELINE_STAGE_COPY, start_ns, end_ns);
+    }
+    pending_condition_.notify_one();
+    return 0;
+}
+
+void ConversionPipeline::Run() {
+    int halfwidth = (width_ + 1) >> 1;
+    size_t y_size = static_cast<size_t>(width_) * height_;
+    size_t chroma_size = static_cast<size_t>(halfwidth) * ((height_ + 1) >> 1);
+    while (true) {
+        int index;
+        int64_t start_ns;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pending_condition_.wait(lock, [this, &index]() {
+                index = paused_ ? -1 : FindOldest(SLOT_PENDING);
+                return stopped_ || index >= 0;
+            });
+            if (stopped_) {
+                return;
+            }
+            start_ns = get_monotonic_time_ns();
+            slots_[index].state = SLOT_CONVERTING;
+            RecordStage(PIPELINE_STAGE_QUEUE, slots_[index].state_time_ns, start_ns);
+        }
+
+        Slot& slot = slots_[index];
+        YuvPlanes src = {slot.input, width_, slot.input + y_size, halfwidth,
+                         slot.input + y_size + chroma_size, halfwidth, 1};
+        YuvKernelDestination dst = {{slot.output, nullptr, nullptr}, {output_stride(), 0, 0}};
+        int result = RunYuvConverter(converter_, src, dst);
+
+        int64_t end_ns = get_monotonic_time_ns();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (result != 0) {
+                slot.state = SLOT_FREE;
+                continue;
+            }
+            slot.state = SLOT_DONE;
+            slot.state_time_ns = end_ns;
+            RecordStage(PIPELINE_STAGE_CONVERT, start_ns, end_ns);
+        }
+        uint64_t event = 1;
+        (void) write(event_fd_, &event, sizeof(event));
+    }
+}
+
+bool ConversionPipeline::Acquire(PipelineOutput* output) {
+    // Clear the event before looking at the ring. A frame finished in between sets it again,
+    // which at worst causes a spurious wake up.
+    uint64_t events;
+    (void) read(event_fd_, &events, sizeof(events));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    int index = FindOldest(SLOT_DONE);
+    if (index < 0) {
+        return false;
+    }
+    Slot& slot = slots_[index];
+    slot.state = SLOT_ACQUIRED;
+    RecordStage(PIPELINE_STAGE_DELIVER, slot.state_time_ns, get_monotonic_time_ns());
+    output->slot = index;
+    output->timestamp_ns = slot.timestamp_ns;
+    return true;
+}
+
+void ConversionPipeline::Release(int slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slot >= 0 && slot < capacity_ && slots_[slot].state == SLOT_ACQUIRED) {
+        slots_[slot].state = SLOT_FREE;
+    }
+}
+
+void ConversionPipeline::GetStats(PipelineStageStats stats[PIPELINE_STAGE_COUNT],
+                                  uint64_t* dropped_count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        stats[i] = stats_[i];
+    }
+    *dropped_count = dropped_count_;
+}
+
+void ConversionPipeline::SetPausedForTesting(bool paused) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        paused_ = paused;
+    }
+    pending_condition_.notify_one();
+}
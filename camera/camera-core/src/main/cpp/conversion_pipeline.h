@@ -0,0 +1,146 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_CORE_CONVERSION_PIPELINE_H
+#define CAMERA_CORE_CONVERSION_PIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "yuv_kernels.h"
+
+// Values must match the STAGE_* constants in YuvConversionPipeline.java.
+enum PipelineStage {
+    // Copying the frame into the ring, on the submitting thread.
+    PIPELINE_STAGE_COPY = 0,
+    // Waiting in the ring for the worker.
+    PIPELINE_STAGE_QUEUE = 1,
+    // Converting and rotating on the worker.
+    PIPELINE_STAGE_CONVERT = 2,
+    // Waiting for the consumer to acquire the converted frame.
+    PIPELINE_STAGE_DELIVER = 3,
+    PIPELINE_STAGE_COUNT = 4,
+};
+
+struct PipelineStageStats {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+struct PipelineOutput {
+    int slot;
+    int64_t timestamp_ns;
+};
+
+/**
+ * Converts YUV frames to rotated RGBA on a worker thread.
+ *
+ * <p>Submitted frames are copied into a bounded ring, so the caller can release its image right
+ * away. When the ring is full the oldest frame that is not being converted or held by the
+ * consumer is dropped, whether it waits for the worker or for the consumer. The event fd becomes readable when converted frames are available, which
+ * lets the consumer wait for them on a Looper without blocking the submitting thread.
+ */
+class ConversionPipeline {
+public:
+    /**
+     * Creates a pipeline for frames of the given size, rotated clockwise by rotation degrees.
+     * Returns nullptr on failure.
+     */
+    static ConversionPipeline* Create(int width, int height, int rotation, int capacity);
+
+    // Stops the worker. Converted frames must not be used afterwards.
+    ~ConversionPipeline();
+
+    /**
+     * Copies a frame into the ring. Returns 0 on success and -1 if the frame is dropped because
+     * every slot is busy.
+     */
+    int Submit(const YuvPlanes& src, int64_t timestamp_ns);
+
+    /**
+     * Takes the oldest converted frame. Returns false if there is none. The frame stays valid
+     * until it is released.
+     */
+    bool Acquire(PipelineOutput* output);
+
+    void Release(int slot);
+
+    void GetStats(PipelineStageStats stats[PIPELINE_STAGE_COUNT], uint64_t* dropped_count);
+
+    // Holds submitted frames pending while paused, so tests can fill the ring in a known state.
+    void SetPausedForTesting(bool paused);
+
+    int event_fd() const { return event_fd_; }
+    int capacity() const { return capacity_; }
+    int output_width() const { return output_width_; }
+    int output_height() const { return output_height_; }
+    int output_stride() const { return output_width_ * 4; }
+    uint8_t* output(int slot) const;
+
+private:
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_COPYING,
+        SLOT_PENDING,
+        SLOT_CONVERTING,
+        SLOT_DONE,
+        SLOT_ACQUIRED,
+    };
+
+    struct Slot {
+        SlotState state;
+        uint64_t sequence;
+        int64_t timestamp_ns;
+        // Monotonic time the slot entered its current state.
+        int64_t state_time_ns;
+        uint8_t* input;
+        uint8_t* output;
+    };
+
+    ConversionPipeline() = default;
+
+    void Run();
+    // Returns the oldest slot in the given state, or -1.
+    int FindOldest(SlotState state) const;
+    // Returns the oldest slot that is pending or done, which are the ones that can be dropped,
+    // or -1.
+    int FindOldestDroppable() const;
+    void RecordStage(PipelineStage stage, int64_t start_ns, int64_t end_ns);
+
+    int width_ = 0;
+    int height_ = 0;
+    int output_width_ = 0;
+    int output_height_ = 0;
+    int capacity_ = 0;
+    int event_fd_ = -1;
+    YuvConverter* converter_ = nullptr;
+    uint8_t* memory_ = nullptr;
+    Slot* slots_ = nullptr;
+    std::thread worker_;
+
+    std::mutex mutex_;
+    std::condition_variable pending_condition_;
+    bool stopped_ = false;
+    bool paused_ = false;
+    uint64_t next_sequence_ = 0;
+    uint64_t dropped_count_ = 0;
+    PipelineStageStats stats_[PIPELINE_STAGE_COUNT] = {};
+};
+
+#endif  // CAMERA_CORE_CONVERSION_PIPELINE_H
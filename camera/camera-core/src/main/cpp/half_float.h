@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_CORE_HALF_FLOAT_H
+#define CAMERA_CORE_HALF_FLOAT_H
+
+#include <cstdint>
+#include <cstring>
+
+// Converts a float to the bits of an IEEE 754 half precision float.
+#if defined(__ARM_FP16_FORMAT_IEEE)
+inline uint16_t float_to_half(float value) {
+    __fp16 half = static_cast<__fp16>(value);
+    uint16_t bits;
+    memcpy(&bits, &half, sizeof(bits));
+    return bits;
+}
+#else
+// Round to nearest even conversion for targets without a native half precision type.
+inline uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t float_exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (float_exponent == 0xff) {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+    int exponent = static_cast<int>(float_exponent) - 127 + 15;
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (remainder > midpoint || (remainder == midpoint && (half & 1))) {
+            half++;
+        }
+        return sign | half;
+    }
+    uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        // A carry out of the mantissa correctly bumps the exponent.
+        half++;
+    }
+    return half;
+}
+#endif
+
+#endif  // CAMERA_CORE_HALF_FLOAT_H
@@ -0,0 +1,469 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "image_processing_util.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "libyuv/convert.h"
+#include "libyuv/convert_argb.h"
+#include "libyuv/rotate.h"
+#include "libyuv/scale.h"
+
+void weave_pixels(const uint8_t* src_u,
+                  const uint8_t* src_v,
+                  int src_pixel_stride_uv,
+                  uint8_t* dst_uv,
+                  int width) {
+    int i;
+    for (i = 0; i < width; ++i) {
+        dst_uv[0] = *src_u;
+        dst_uv[1] = *src_v;
+        dst_uv += 2;
+        src_u += src_pixel_stride_uv;
+        src_v += src_pixel_stride_uv;
+    }
+}
+
+libyuv::RotationMode get_rotation_mode(int rotation) {
+    libyuv::RotationMode mode = libyuv::kRotate0;
+    switch (rotation) {
+        case 0:
+            mode = libyuv::kRotate0;
+            break;
+        case 90:
+            mode = libyuv::kRotate90;
+            break;
+        case 180:
+            mode = libyuv::kRotate180;
+            break;
+        case 270:
+            mode = libyuv::kRotate270;
+            break;
+        default:
+            break;
+    }
+    return mode;
+}
+
+int Android420ToABGR(const uint8_t* src_y,
+                     int src_stride_y,
+                     const uint8_t* src_u,
+                     int src_stride_u,
+                     const uint8_t* src_v,
+                     int src_stride_v,
+                     int src_pixel_stride_uv,
+                     uint8_t* dst_abgr,
+                     int dst_stride_abgr,
+                     bool is_full_swing,
+                     int width,
+                     int height) {
+    return Android420ToARGBMatrix(src_y,
+                                  src_stride_y,
+                                  src_v,
+                                  src_stride_v,
+                                  src_u,
+                                  src_stride_u,
+                                  src_pixel_stride_uv,
+                                  dst_abgr,
+                                  dst_stride_abgr,
+                                  is_full_swing
+                                      ? &libyuv::kYvuJPEGConstants : &libyuv::kYvuI601Constants,
+                                  width,
+                                  height);
+}
+
+
+bool is_full_frame(int crop_left, int crop_top, int crop_width, int crop_height,
+                   int dst_width, int dst_height, int width, int height) {
+    return crop_left == 0 && crop_top == 0 && crop_width == width && crop_height == height
+            && dst_width == width && dst_height == height;
+}
+
+bool is_valid_crop(int crop_left, int crop_top, int crop_width, int crop_height,
+                   int width, int height) {
+    return crop_left >= 0 && crop_top >= 0 && crop_width > 0 && crop_height > 0
+            && crop_left + crop_width <= width && crop_top + crop_height <= height;
+}
+
+int Android420ToABGRScaled(const uint8_t* src_y,
+                           int src_stride_y,
+                           const uint8_t* src_u,
+                           int src_stride_u,
+                           const uint8_t* src_v,
+                           int src_stride_v,
+                           int src_pixel_stride_uv,
+                           int crop_left,
+                           int crop_top,
+                           int crop_width,
+                           int crop_height,
+                           uint8_t* dst_abgr,
+                           int dst_stride_abgr,
+                           int dst_width,
+                           int dst_height,
+                           libyuv::FilterMode filter) {
+    // Luma starts exactly at the crop origin. Chroma is subsampled, so for an odd origin it starts
+    // at the chroma sample covering the origin and is off by half a sample, while every read stays
+    // within the chroma of the crop rect.
+    src_y += crop_top * src_stride_y + crop_left;
+    src_u += (crop_top / 2) * src_stride_u + (crop_left / 2) * src_pixel_stride_uv;
+    src_v += (crop_top / 2) * src_stride_v + (crop_left / 2) * src_pixel_stride_uv;
+
+    if (crop_width == dst_width && crop_height == dst_height) {
+        return Android420ToABGR(src_y,
+                                src_stride_y,
+                                src_u,
+                                src_stride_u,
+                                src_v,
+                                src_stride_v,
+                                src_pixel_stride_uv,
+                                dst_abgr,
+                                dst_stride_abgr,
+                                /* is_full_swing = */true,
+                                dst_width,
+                                dst_height);
+    }
+
+    int halfwidth = (dst_width + 1) >> 1;
+    int halfheight = (dst_height + 1) >> 1;
+    int crop_halfwidth = (crop_width + 1) >> 1;
+    int crop_halfheight = (crop_height + 1) >> 1;
+    const ptrdiff_t vu_off = src_v - src_u;
+
+    int result = 0;
+    align_buffer_64(scaled, dst_width * dst_height + halfwidth * halfheight * 2);
+    uint8_t* scaled_y = scaled;
+    uint8_t* scaled_u = scaled + dst_width * dst_height;
+    uint8_t* scaled_v = scaled_u + halfwidth * halfheight;
+    if (src_pixel_stride_uv == 1) {
+        // I420
+        result = libyuv::I420Scale(src_y,
+                                   src_stride_y,
+                                   src_u,
+                                   src_stride_u,
+                                   src_v,
+                                   src_stride_v,
+                                   crop_width,
+                                   crop_height,
+                                   scaled_y,
+                                   dst_width,
+                                   scaled_u,
+                                   halfwidth,
+                                   scaled_v,
+                                   halfwidth,
+                                   dst_width,
+                                   dst_height,
+                                   filter);
+        if (result == 0) {
+            result = Android420ToABGR(scaled_y,
+                                      dst_width,
+                                      scaled_u,
+                                      halfwidth,
+                                      scaled_v,
+                                      halfwidth,
+                                      /* src_pixel_stride_uv = */1,
+                                      dst_abgr,
+                                      dst_stride_abgr,
+                                      /* is_full_swing = */true,
+                                      dst_width,
+                                      dst_height);
+        }
+    } else {
+        const uint8_t* src_uv;
+        int src_stride_uv;
+        uint8_t* plane_uv_mem = nullptr;
+        if (src_pixel_stride_uv == 2 && (vu_off == 1 || vu_off == -1)
+                && src_stride_u == src_stride_v) {
+            // NV12 or NV21, the interleaved plane starts at the lower address.
+            src_uv = vu_off == 1 ? src_u : src_v;
+            src_stride_uv = src_stride_u;
+        } else {
+            // General case fallback weaves the crop into NV12.
+            plane_uv_mem = static_cast<uint8_t*>(malloc(crop_halfwidth * 2 * crop_halfheight));
+            if (plane_uv_mem == nullptr) {
+                free_aligned_buffer_64(scaled);
+                return -1;
+            }
+            uint8_t* dst_uv = plane_uv_mem;
+            for (int y = 0; y < crop_halfheight; y++) {
+                weave_pixels(src_u + y * src_stride_u, src_v + y * src_stride_v,
+                             src_pixel_stride_uv, dst_uv, crop_halfwidth);
+                dst_uv += crop_halfwidth * 2;
+            }
+            src_uv = plane_uv_mem;
+            src_stride_uv = crop_halfwidth * 2;
+        }
+
+        // The scaled chroma stays interleaved in the same order as the source.
+        uint8_t* scaled_uv = scaled_u;
+        result = libyuv::NV12Scale(src_y,
+                                   src_stride_y,
+                                   src_uv,
+                                   src_stride_uv,
+                                   crop_width,
+                                   crop_height,
+                                   scaled_y,
+                                   dst_width,
+                                   scaled_uv,
+                                   halfwidth * 2,
+                                   dst_width,
+                                   dst_height,
+                                   filter);
+        bool is_nv21 = plane_uv_mem == nullptr && vu_off == -1;
+        free(plane_uv_mem);
+        if (result == 0) {
+            result = Android420ToABGR(scaled_y,
+                                      dst_width,
+                                      is_nv21 ? scaled_uv + 1 : scaled_uv,
+                                      halfwidth * 2,
+                                      is_nv21 ? scaled_uv : scaled_uv + 1,
+                                      halfwidth * 2,
+                                      /* src_pixel_stride_uv = */2,
+                                      dst_abgr,
+                                      dst_stride_abgr,
+                                      /* is_full_swing = */true,
+                                      dst_width,
+                                      dst_height);
+        }
+    }
+    free_aligned_buffer_64(scaled);
+    return result;
+}
+
+int Android420ToABGRWithPixelShift(const uint8_t* src_y,
+                                   int src_stride_y,
+                                   const uint8_t* src_u,
+                                   int src_stride_u,
+                                   const uint8_t* src_v,
+                                   int src_stride_v,
+                                   int src_pixel_stride_y,
+                                   int src_pixel_stride_uv,
+                                   uint8_t* dst_abgr,
+                                   int dst_stride_abgr,
+                                   int width,
+                                   int height) {
+    int start_offset_y = src_pixel_stride_y;
+    int start_offset_u = src_pixel_stride_uv;
+    int start_offset_v = src_pixel_stride_uv;
+
+    // Convert yuv to rgb except the last line.
+    int result = Android420ToABGR(src_y + start_offset_y,
+                                  src_stride_y,
+                                  src_u + start_offset_u,
+                                  src_stride_u,
+                                  src_v + start_offset_v,
+                                  src_stride_v,
+                                  src_pixel_stride_uv,
+                                  dst_abgr,
+                                  dst_stride_abgr,
+                                  /* is_full_swing = */true,
+                                  width,
+                                  height - 1);
+    if (result == 0) {
+        // Convert the last row with (width - 1) pixels
+        // since the last pixel's yuv data is missing.
+        result = Android420ToABGR(
+                src_y + start_offset_y + src_stride_y * (height - 1),
+                src_stride_y - 1,
+                src_u + start_offset_u + src_stride_u * (height - 2) / 2,
+                src_stride_u - 1,
+                src_v + start_offset_v + src_stride_v * (height - 2) / 2,
+                src_stride_v - 1,
+                src_pixel_stride_uv,
+                dst_abgr + dst_stride_abgr * (height - 1),
+                dst_stride_abgr,
+                /* is_full_swing = */true,
+                width - 1,
+                1);
+    }
+
+    if (result == 0) {
+        // Set the 2x2 pixels on the right bottom by duplicating the 3rd pixel
+        // from the right to left in each row.
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 2; j++) {
+                int r_ind = dst_stride_abgr * (height - 1 - i) + width * 4 - (j * 4 + 1);
+                int g_ind = dst_stride_abgr * (height - 1 - i) + width * 4 - (j * 4 + 2);
+                int b_ind = dst_stride_abgr * (height - 1 - i) + width * 4 - (j * 4 + 3);
+                int a_ind = dst_stride_abgr * (height - 1 - i) + width * 4 - (j * 4 + 4);
+                dst_abgr[r_ind] = dst_abgr[r_ind - 8];
+                dst_abgr[g_ind] = dst_abgr[g_ind - 8];
+                dst_abgr[b_ind] = dst_abgr[b_ind - 8];
+                dst_abgr[a_ind] = dst_abgr[a_ind - 8];
+            }
+        }
+    }
+    return result;
+}
+
+void ShiftPixels(uint8_t* src_y,
+                 int src_stride_y,
+                 uint8_t* src_u,
+                 int src_stride_u,
+                 uint8_t* src_v,
+                 int src_stride_v,
+                 int width,
+                 int height,
+                 int start_offset_y,
+                 int start_offset_u,
+                 int start_offset_v) {
+    // TODO(b/195990691): extend the pixel shift to handle multiple corrupted pixels.
+    // We don't support multiple pixel shift now.
+    // Y
+    for (int i = 0; i < height; i++) {
+        memmove(&src_y[0 + i * src_stride_y],
+                &src_y[start_offset_y + i * src_stride_y],
+                width - 1);
+
+        src_y[width - start_offset_y + i * src_stride_y] =
+                src_y[src_stride_y - start_offset_y + i * src_stride_y];
+    }
+
+    // U
+    for (int i = 0; i < height / 2; i++) {
+        memmove(&src_u[0 + i * src_stride_u],
+                &src_u[start_offset_u + i * src_stride_u],
+                width / 2 - 1);
+
+        src_u[width / 2 - start_offset_u + i * src_stride_u] =
+                src_u[src_stride_u - start_offset_u + i * src_stride_u];
+    }
+
+    // V
+    for (int i = 0; i < height / 2; i++) {
+        memmove(&src_v[0 + i * src_stride_v],
+                &src_v[start_offset_v + i * src_stride_v],
+                width / 2 - 1);
+
+        src_v[width / 2 - start_offset_v + i * src_stride_v] =
+                src_v[src_stride_v - start_offset_v + i * src_stride_v];
+    }
+}
+
+int Android420RotateToI420(const uint8_t* src_y,
+                           int src_stride_y,
+                           const uint8_t* src_u,
+                           int src_stride_u,
+                           const uint8_t* src_v,
+                           int src_stride_v,
+                           int src_pixel_stride_uv,
+                           uint8_t* dst_y,
+                           int dst_stride_y,
+                           uint8_t* dst_u,
+                           int dst_stride_u,
+                           uint8_t* dst_v,
+                           int dst_stride_v,
+                           int width,
+                           int height,
+                           libyuv::RotationMode mode) {
+    int halfwidth = (width + 1) >> 1;
+    int halfheight = (height + 1) >> 1;
+
+    int result = 0;
+    const ptrdiff_t vu_off = src_v - src_u;
+
+    if (src_pixel_stride_uv == 1) {
+        // I420
+        result = libyuv::I420Rotate(src_y,
+                                    src_stride_y,
+                                    src_u,
+                                    src_stride_u,
+                                    src_v,
+                                    src_stride_v,
+                                    dst_y,
+                                    dst_stride_y,
+                                    dst_u,
+                                    dst_stride_u,
+                                    dst_v,
+                                    dst_stride_v,
+                                    width,
+                                    height,
+                                    mode);
+    } else if (src_pixel_stride_uv == 2 && vu_off == -1 &&
+               src_stride_u == src_stride_v) {
+        // NV21
+        result = libyuv::NV12ToI420Rotate(src_y,
+                                          src_stride_y,
+                                          src_v,
+                                          src_stride_v,
+                                          dst_y,
+                                          dst_stride_y,
+                                          dst_v,
+                                          dst_stride_v,
+                                          dst_u,
+                                          dst_stride_u,
+                                          width,
+                                          height,
+                                          mode);
+    } else if (src_pixel_stride_uv == 2 && vu_off == 1 && src_stride_u == src_stride_v) {
+        // NV12
+        result = libyuv::NV12ToI420Rotate(src_y,
+                                          src_stride_y,
+                                          src_u,
+                                          src_stride_u,
+                                          dst_y,
+                                          dst_stride_y,
+                                          dst_u,
+                                          dst_stride_u,
+                                          dst_v,
+                                          dst_stride_v,
+                                          width,
+                                          height,
+                                          mode);
+    } else {
+        // General case fallback creates NV12
+        align_buffer_64(plane_uv, halfwidth * 2 * halfheight);
+        uint8_t* dst_uv = plane_uv;
+        for (int y = 0; y < halfheight; y++) {
+            weave_pixels(src_u, src_v, src_pixel_stride_uv, dst_uv, halfwidth);
+            src_u += src_stride_u;
+            src_v += src_stride_v;
+            dst_uv += halfwidth * 2;
+        }
+
+        result = libyuv::NV12ToI420Rotate(src_y,
+                                          src_stride_y,
+                                          plane_uv,
+                                          halfwidth * 2,
+                                          dst_y,
+                                          dst_stride_y,
+                                          dst_u,
+                                          dst_stride_u,
+                                          dst_v,
+                                          dst_stride_v,
+                                          width,
+                                          height,
+                                          mode);
+        free_aligned_buffer_64(plane_uv);
+    }
+    return result;
+}
+
+void CopyPlaneToPixelStride(const uint8_t* src,
+                            int src_stride,
+                            uint8_t* dst,
+                            int dst_stride,
+                            int dst_pixel_stride,
+                            int width,
+                            int height) {
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            dst[i * dst_stride + j * dst_pixel_stride] = src[i * src_stride + j];
+        }
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAMERA_CORE_IMAGE_PROCESSING_UTIL_H
+#define CAMERA_CORE_IMAGE_PROCESSING_UTIL_H
+
+// Pure compute of image_processing_util_jni.cc, kept free of JNI and Android headers so it can
+// be built and benchmarked on the host.
+
+#include <cstdint>
+
+#include "libyuv/rotate.h"
+#include "libyuv/scale.h"
+
+#define align_buffer_64(var, size)                                           \
+  uint8_t* var##_mem = (uint8_t*)(malloc((size) + 63));         /* NOLINT */ \
+  uint8_t* var = (uint8_t*)(((intptr_t)(var##_mem) + 63) & ~63) /* NOLINT */
+
+#define free_aligned_buffer_64(var) \
+  free(var##_mem);                  \
+  var = 0
+
+/**
+ * Interleaves width U and V samples into NV12.
+ */
+void weave_pixels(const uint8_t* src_u,
+                  const uint8_t* src_v,
+                  int src_pixel_stride_uv,
+                  uint8_t* dst_uv,
+                  int width);
+
+libyuv::RotationMode get_rotation_mode(int rotation);
+
+/**
+ * Converts Android420 to ABGR with options to choose full swing or studio swing.
+ */
+int Android420ToABGR(const uint8_t* src_y,
+                     int src_stride_y,
+                     const uint8_t* src_u,
+                     int src_stride_u,
+                     const uint8_t* src_v,
+                     int src_stride_v,
+                     int src_pixel_stride_uv,
+                     uint8_t* dst_abgr,
+                     int dst_stride_abgr,
+                     bool is_full_swing,
+                     int width,
+                     int height);
+
+bool is_full_frame(int crop_left, int crop_top, int crop_width, int crop_height,
+                   int dst_width, int dst_height, int width, int height);
+
+bool is_valid_crop(int crop_left, int crop_top, int crop_width, int crop_height,
+                   int width, int height);
+
+/**
+ * Converts the crop rect of Android420 to ABGR of dst_width x dst_height.
+ *
+ * <p>Only the crop rect is read. When the size changes, the YUV planes are scaled first with the
+ * given filter and the color conversion then runs on the small frame, so a thumbnail of a large
+ * stream never touches a full size ARGB frame.
+ *
+ * <p>Luma is read from the exact crop origin. For an odd origin, chroma is read from the chroma
+ * sample covering it, which shifts chroma by half a sample.
+ */
+int Android420ToABGRScaled(const uint8_t* src_y,
+                           int src_stride_y,
+                           const uint8_t* src_u,
+                           int src_stride_u,
+                           const uint8_t* src_v,
+                           int src_stride_v,
+                           int src_pixel_stride_uv,
+                           int crop_left,
+                           int crop_top,
+                           int crop_width,
+                           int crop_height,
+                           uint8_t* dst_abgr,
+                           int dst_stride_abgr,
+                           int dst_width,
+                           int dst_height,
+                           libyuv::FilterMode filter);
+
+/**
+ * Converts Android420 to full swing ABGR, working around the one pixel shift of some devices
+ * where every plane starts one pixel late. The missing bottom right pixels are duplicated from
+ * their neighbors.
+ */
+int Android420ToABGRWithPixelShift(const uint8_t* src_y,
+                                   int src_stride_y,
+                                   const uint8_t* src_u,
+                                   int src_stride_u,
+                                   const uint8_t* src_v,
+                                   int src_stride_v,
+                                   int src_pixel_stride_y,
+                                   int src_pixel_stride_uv,
+                                   uint8_t* dst_abgr,
+                                   int dst_stride_abgr,
+                                   int width,
+                                   int height);
+
+/**
+ * Moves every row of the planes left by the start offset in place, undoing the one pixel shift.
+ */
+void ShiftPixels(uint8_t* src_y,
+                 int src_stride_y,
+                 uint8_t* src_u,
+                 int src_stride_u,
+                 uint8_t* src_v,
+                 int src_stride_v,
+                 int width,
+                 int height,
+                 int start_offset_y,
+                 int start_offset_u,
+                 int start_offset_v);
+
+/**
+ * Rotates Android420 into I420 planes.
+ */
+int Android420RotateToI420(const uint8_t* src_y,
+                           int src_stride_y,
+                           const uint8_t* src_u,
+                           int src_stride_u,
+                           const uint8_t* src_v,
+                           int src_stride_v,
+                           int src_pixel_stride_uv,
+                           uint8_t* dst_y,
+                           int dst_stride_y,
+                           uint8_t* dst_u,
+                           int dst_stride_u,
+                           uint8_t* dst_v,
+                           int dst_stride_v,
+                           int width,
+                           int height,
+                           libyuv::RotationMode mode);
+
+/**
+ * Copies a plane with a pixel stride of 1 into a plane with the given pixel stride.
+ */
+void CopyPlaneToPixelStride(const uint8_t* src,
+                            int src_stride,
+                            uint8_t* dst,
+                            int dst_stride,
+                            int dst_pixel_stride,
+                            int width,
+                            int height);
+
+#endif  // CAMERA_CORE_IMAGE_PROCESSING_UTIL_H
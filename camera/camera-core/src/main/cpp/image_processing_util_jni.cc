@@ -20,141 +20,159 @@
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdlib>
+#include <dlfcn.h>
+#include <mutex>
 
 #include <android/bitmap.h>
+#include <android/data_space.h>
 
 #include "libyuv/convert_argb.h"
 #include "libyuv/rotate_argb.h"
 #include "libyuv/convert.h"
+#include "libyuv/scale.h"
+
+#include "image_processing_util.h"
+#include "image_pyramid.h"
+#include "luma_statistics.h"
+#include "motion_detection.h"
+#include "pixel_copy.h"
+#include "remap.h"
+#include "p010_conversion.h"
+#include "yuv_kernels.h"
+#include "yuv_to_tensor.h"
 
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "YuvToRgbJni", __VA_ARGS__)
 
-#define align_buffer_64(var, size)                                           \
-  uint8_t* var##_mem = (uint8_t*)(malloc((size) + 63));         /* NOLINT */ \
-  uint8_t* var = (uint8_t*)(((intptr_t)(var##_mem) + 63) & ~63) /* NOLINT */
-
-#define free_aligned_buffer_64(var) \
-  free(var##_mem);                  \
-  var = 0
-
-static void weave_pixels(const uint8_t* src_u,
-                        const uint8_t* src_v,
-                        int src_pixel_stride_uv,
-                        uint8_t* dst_uv,
-                        int width) {
-    int i;
-    for (i = 0; i < width; ++i) {
-        dst_uv[0] = *src_u;
-        dst_uv[1] = *src_v;
-        dst_uv += 2;
-        src_u += src_pixel_stride_uv;
-        src_v += src_pixel_stride_uv;
-    }
-}
-
-static libyuv::RotationMode get_rotation_mode(int rotation) {
-    libyuv::RotationMode mode = libyuv::kRotate0;
-    switch (rotation) {
-        case 0:
-            mode = libyuv::kRotate0;
-            break;
-        case 90:
-            mode = libyuv::kRotate90;
-            break;
-        case 180:
-            mode = libyuv::kRotate180;
-            break;
-        case 270:
-            mode = libyuv::kRotate270;
-            break;
-        default:
-            break;
-    }
-    return mode;
-}
-
-// Helper function to convert Android420 to ABGR with options to choose full swing or studio swing.
-static int Android420ToABGR(const uint8_t* src_y,
-                            int src_stride_y,
-                            const uint8_t* src_u,
-                            int src_stride_u,
-                            const uint8_t* src_v,
-                            int src_stride_v,
-                            int src_pixel_stride_uv,
-                            uint8_t* dst_abgr,
-                            int dst_stride_abgr,
-                            bool is_full_swing,
-                            int width,
-                            int height) {
-    return Android420ToARGBMatrix(src_y,
-                                  src_stride_y,
-                                  src_v,
-                                  src_stride_v,
-                                  src_u,
-                                  src_stride_u,
-                                  src_pixel_stride_uv,
-                                  dst_abgr,
-                                  dst_stride_abgr,
-                                  is_full_swing
-                                      ? &libyuv::kYvuJPEGConstants : &libyuv::kYvuI601Constants,
-                                  width,
-                                  height);
-}
-
-
 extern "C" {
-JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeCopyBetweenByteBufferAndBitmap (
+/**
+ * Copies between a direct ByteBuffer and a RGBA_8888 or RGB_565 Bitmap.
+ *
+ * <p>The crop rect is in the source, which is the Bitmap unless is_copy_buffer_to_bitmap is set.
+ * The destination receives the crop rect rotated clockwise by rotation degrees, converted to its
+ * format.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeCopyBetweenByteBufferAndBitmap(
         JNIEnv* env,
         jclass,
         jobject bitmap,
-        jobject converted_buffer,
-        int src_stride_argb,
-        int dst_stride_argb,
-        int width,
-        int height,
-        jboolean isCopyBufferToBitmap
-) {
-    void* bitmapAddress = nullptr;
-    int copyResult;
-
-
-    // get bitmap address
-    int lockResult =  AndroidBitmap_lockPixels(env, bitmap, &bitmapAddress);
-    if (lockResult != 0) {
+        jobject byte_buffer,
+        jint buffer_format,
+        jint buffer_stride,
+        jint crop_left,
+        jint crop_top,
+        jint crop_width,
+        jint crop_height,
+        jint rotation,
+        jint alpha_op,
+        jintArray channel_order,
+        jboolean is_copy_buffer_to_bitmap) {
+    AndroidBitmapInfo bitmap_info;
+    if (AndroidBitmap_getInfo(env, bitmap, &bitmap_info) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        return -1;
+    }
+    PixelFormat bitmap_format;
+    switch (bitmap_info.format) {
+        case ANDROID_BITMAP_FORMAT_RGBA_8888:
+            bitmap_format = PIXEL_FORMAT_RGBA_8888;
+            break;
+        case ANDROID_BITMAP_FORMAT_RGB_565:
+            bitmap_format = PIXEL_FORMAT_RGB_565;
+            break;
+        default:
+            LOGE("Unsupported Bitmap format for copy: %d", bitmap_info.format);
+            return -1;
+    }
+    int buffer_bytes = GetPixelFormatBytes(static_cast<PixelFormat>(buffer_format));
+    if (buffer_bytes == 0) {
+        return -1;
+    }
+    // Negative values would wrap around in the bounds checks below.
+    if (crop_left < 0 || crop_top < 0 || crop_width <= 0 || crop_height <= 0
+            || buffer_stride <= 0) {
+        LOGE("Invalid crop rect or stride for copy");
         return -1;
     }
 
-    // get buffer address
-    uint8_t* bufferAddress = static_cast<uint8_t*>(
-            env->GetDirectBufferAddress(converted_buffer));
-
-    // copy from buffer to bitmap
-    if (isCopyBufferToBitmap) {
-        copyResult = libyuv::ARGBCopy(bufferAddress, src_stride_argb,
-                                      reinterpret_cast<uint8_t *> (bitmapAddress), dst_stride_argb,
-                                      width, height);
+    bool flip_wh = rotation == 90 || rotation == 270;
+    int dst_width = flip_wh ? crop_height : crop_width;
+    int dst_height = flip_wh ? crop_width : crop_height;
+    int64_t crop_right = static_cast<int64_t>(crop_left) + crop_width;
+    int64_t crop_bottom = static_cast<int64_t>(crop_top) + crop_height;
+    int64_t buffer_capacity = env->GetDirectBufferCapacity(byte_buffer);
+    if (is_copy_buffer_to_bitmap) {
+        // The buffer is the source and the Bitmap receives the whole rotated crop rect.
+        if (crop_right * buffer_bytes > buffer_stride
+                || (crop_bottom - 1) * buffer_stride + crop_right * buffer_bytes > buffer_capacity
+                || static_cast<uint32_t>(dst_width) != bitmap_info.width
+                || static_cast<uint32_t>(dst_height) != bitmap_info.height) {
+            return -1;
+        }
+    } else {
+        if (crop_right > bitmap_info.width
+                || crop_bottom > bitmap_info.height
+                || static_cast<int64_t>(dst_width) * buffer_bytes > buffer_stride
+                || static_cast<int64_t>(dst_height - 1) * buffer_stride
+                        + static_cast<int64_t>(dst_width) * buffer_bytes > buffer_capacity) {
+            return -1;
+        }
     }
 
-    // copy from bitmap to buffer
-    else {
-        copyResult = libyuv::ARGBCopy(reinterpret_cast<uint8_t*> (bitmapAddress), src_stride_argb,
-                         bufferAddress, dst_stride_argb, width, height);
+    int order[4];
+    if (channel_order != nullptr) {
+        if (env->GetArrayLength(channel_order) != 4) {
+            return -1;
+        }
+        env->GetIntArrayRegion(channel_order, 0, 4, order);
     }
 
-    // check value of copy
-    if (copyResult != 0) {
+    uint8_t* buffer_ptr = static_cast<uint8_t*>(env->GetDirectBufferAddress(byte_buffer));
+    if (buffer_ptr == nullptr) {
+        return -1;
+    }
+    void* bitmap_ptr = nullptr;
+    if (AndroidBitmap_lockPixels(env, bitmap, &bitmap_ptr) != ANDROID_BITMAP_RESULT_SUCCESS) {
         return -1;
     }
 
+    int result;
+    if (is_copy_buffer_to_bitmap) {
+        result = ConvertPixels(buffer_ptr,
+                               buffer_stride,
+                               static_cast<PixelFormat>(buffer_format),
+                               crop_left,
+                               crop_top,
+                               crop_width,
+                               crop_height,
+                               static_cast<uint8_t*>(bitmap_ptr),
+                               bitmap_info.stride,
+                               bitmap_format,
+                               get_rotation_mode(rotation),
+                               static_cast<AlphaOp>(alpha_op),
+                               channel_order != nullptr ? order : nullptr);
+    } else {
+        result = ConvertPixels(static_cast<uint8_t*>(bitmap_ptr),
+                               bitmap_info.stride,
+                               bitmap_format,
+                               crop_left,
+                               crop_top,
+                               crop_width,
+                               crop_height,
+                               buffer_ptr,
+                               buffer_stride,
+                               static_cast<PixelFormat>(buffer_format),
+                               get_rotation_mode(rotation),
+                               static_cast<AlphaOp>(alpha_op),
+                               channel_order != nullptr ? order : nullptr);
+    }
+
     // balance call to AndroidBitmap_lockPixels
-    int unlockResult = AndroidBitmap_unlockPixels(env,bitmap);
-    if (unlockResult != 0) {
+    if (AndroidBitmap_unlockPixels(env, bitmap) != ANDROID_BITMAP_RESULT_SUCCESS) {
         return -1;
     }
-
-    return 0;
+    return result == 0 ? 0 : -1;
 }
 
 JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeShiftPixel(
@@ -180,37 +198,8 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeShiftPixel(
     uint8_t* src_v_ptr =
             static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v));
 
-    // TODO(b/195990691): extend the pixel shift to handle multiple corrupted pixels.
-    // We don't support multiple pixel shift now.
-    // Y
-    for (int i = 0; i < height; i++) {
-        memmove(&src_y_ptr[0 + i * src_stride_y],
-                &src_y_ptr[start_offset_y + i * src_stride_y],
-                width - 1);
-
-        src_y_ptr[width - start_offset_y + i * src_stride_y] =
-                src_y_ptr[src_stride_y - start_offset_y + i * src_stride_y];
-    }
-
-    // U
-    for (int i = 0; i < height / 2; i++) {
-        memmove(&src_u_ptr[0 + i * src_stride_u],
-                &src_u_ptr[start_offset_u + i * src_stride_u],
-                width / 2 - 1);
-
-        src_u_ptr[width / 2 - start_offset_u + i * src_stride_u] =
-                src_u_ptr[src_stride_u - start_offset_u + i * src_stride_u];
-    }
-
-    // V
-    for (int i = 0; i < height / 2; i++) {
-        memmove(&src_v_ptr[0 + i * src_stride_v],
-                &src_v_ptr[start_offset_v + i * src_stride_v],
-                width / 2 - 1);
-
-        src_v_ptr[width / 2 - start_offset_v + i * src_stride_v] =
-                src_v_ptr[src_stride_v - start_offset_v + i * src_stride_v];
-    }
+    ShiftPixels(src_y_ptr, src_stride_y, src_u_ptr, src_stride_u, src_v_ptr, src_stride_v,
+                width, height, start_offset_y, start_offset_u, start_offset_v);
 
     return 0;
 }
@@ -253,22 +242,301 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeWriteJpegToSu
         return -1;
     }
 
-    // Copy from source to destination.
-    jbyte *jpeg_ptr = env->GetByteArrayElements(jpeg_array, NULL);
+    // Copy from source to destination. GetByteArrayRegion writes straight into the window buffer,
+    // which avoids the extra copy GetByteArrayElements may make of the whole array.
+    uint8_t *buffer_ptr = reinterpret_cast<uint8_t *>(buffer.bits);
+    env->GetByteArrayRegion(jpeg_array, 0, array_size, reinterpret_cast<jbyte *>(buffer_ptr));
+    // Set 0 for the padding bytes.
+    memset(buffer_ptr + array_size, 0, PADDING_BYTES_FOR_CAMERA3_JPEG_BLOB);
+
+    ANativeWindow_unlockAndPost(window);
+    ANativeWindow_release(window);
+    return 0;
+}
+
+/**
+ * Writes the JPEG content of a direct ByteBuffer to the Surface.
+ *
+ * <p>Same as nativeWriteJpegToSurface, but reads from the native address of the buffer so the
+ * JPEG bytes are copied only once.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeWriteJpegBufferToSurface(
+        JNIEnv *env,
+        jclass,
+        jobject jpeg_buffer,
+        jint offset,
+        jint size,
+        jobject surface) {
+    uint8_t *jpeg_ptr = static_cast<uint8_t *>(env->GetDirectBufferAddress(jpeg_buffer));
     if (jpeg_ptr == nullptr) {
+        LOGE("Failed to get JPEG buffer address, the buffer must be direct.");
+        return -1;
+    }
+    if (offset < 0 || size <= 0 || offset + size > env->GetDirectBufferCapacity(jpeg_buffer)) {
+        LOGE("Invalid JPEG buffer range, offset: %d, size: %d", offset, size);
+        return -1;
+    }
+
+    ANativeWindow *window = ANativeWindow_fromSurface(env, surface);
+    if (window == nullptr) {
+        LOGE("Failed to get ANativeWindow");
+        return -1;
+    }
+
+    // See nativeWriteJpegToSurface for why the padding bytes are needed.
+    ANativeWindow_setBuffersGeometry(window,
+                                     size + PADDING_BYTES_FOR_CAMERA3_JPEG_BLOB,
+                                     1, AHARDWAREBUFFER_FORMAT_BLOB);
+
+    ANativeWindow_Buffer buffer;
+    int lockResult = ANativeWindow_lock(window, &buffer, NULL);
+    if (lockResult != 0) {
         ANativeWindow_release(window);
-        LOGE("Failed to get JPEG bytes array pointer.");
+        LOGE("Failed to lock window.");
         return -1;
     }
+
     uint8_t *buffer_ptr = reinterpret_cast<uint8_t *>(buffer.bits);
-    memcpy(buffer_ptr, jpeg_ptr, array_size);
-    // Set 0 for the padding bytes.
-    memset(buffer_ptr + array_size, 0, PADDING_BYTES_FOR_CAMERA3_JPEG_BLOB);
+    memcpy(buffer_ptr, jpeg_ptr + offset, size);
+    memset(buffer_ptr + size, 0, PADDING_BYTES_FOR_CAMERA3_JPEG_BLOB);
 
     ANativeWindow_unlockAndPost(window);
     ANativeWindow_release(window);
+    return 0;
+}
+
+#define CAMERA3_JPEG_BLOB_ID 0x00FF
+
+// Mirrors camera3_jpeg_blob of the camera HAL. The framework reads it from the end of a BLOB
+// buffer to know how many bytes at the start of the buffer are JPEG data.
+struct camera3_jpeg_blob {
+    uint16_t jpeg_blob_id;
+    uint16_t reserved;
+    uint32_t jpeg_size;
+};
+
+typedef int (*AndroidBitmap_compress_func)(const AndroidBitmapInfo* info,
+                                           int32_t dataspace,
+                                           const void* pixels,
+                                           int32_t format,
+                                           int32_t quality,
+                                           void* user_context,
+                                           AndroidBitmap_CompressWriteFunc fn);
+
+/**
+ * Flag to ensure that we only attempt to resolve AndroidBitmap_compress once.
+ */
+static std::once_flag load_bitmap_compress_flag;
+
+/**
+ * Function pointer to the dynamically linked AndroidBitmap_compress method, which is only
+ * available from API 30.
+ */
+static AndroidBitmap_compress_func bitmap_compress_ptr = nullptr;
+
+static AndroidBitmap_compress_func get_bitmap_compress() {
+    std::call_once(load_bitmap_compress_flag, []() {
+        void* handle = dlopen("libjnigraphics.so", RTLD_NOW);
+        if (handle == nullptr) {
+            LOGE("Unable to load libjnigraphics.so");
+            return;
+        }
+        bitmap_compress_ptr = reinterpret_cast<AndroidBitmap_compress_func>(
+                dlsym(handle, "AndroidBitmap_compress"));
+    });
+    return bitmap_compress_ptr;
+}
+
+// Scratch buffers of nativeConvertAndroid420ToJpegSurface. They are kept across captures and only
+// grow, so consecutive captures of the same size do not allocate the ABGR frame or the JPEG output.
+struct JpegScratch {
+    std::mutex lock;
+    uint8_t* abgr = nullptr;
+    size_t abgr_capacity = 0;
+    uint8_t* jpeg = nullptr;
+    size_t jpeg_capacity = 0;
+};
+
+static JpegScratch jpeg_scratch;
+
+// Destination of the encoder output, copied to the BLOB buffer of the JPEG surface once complete.
+struct JpegBlobWriter {
+    JpegScratch* scratch;
+    size_t size;
+    // Leading bytes of the encoder output to drop, used to strip the SOI marker when the SOI
+    // and the Exif segment have already been written.
+    size_t bytes_to_skip;
+};
+
+// Grows the JPEG output of the scratch to at least the given capacity, keeping its content.
+static bool reserve_jpeg_scratch(JpegScratch* scratch, size_t capacity) {
+    if (capacity <= scratch->jpeg_capacity) {
+        return true;
+    }
+    capacity = std::max(capacity, scratch->jpeg_capacity * 2);
+    uint8_t* jpeg = static_cast<uint8_t*>(realloc(scratch->jpeg, capacity));
+    if (jpeg == nullptr) {
+        LOGE("Failed to allocate %zu bytes for JPEG encoding.", capacity);
+        return false;
+    }
+    scratch->jpeg = jpeg;
+    scratch->jpeg_capacity = capacity;
+    return true;
+}
+
+// Grows the ABGR frame of the scratch to at least the given size, dropping its content.
+static bool reserve_abgr_scratch(JpegScratch* scratch, size_t size) {
+    if (size <= scratch->abgr_capacity) {
+        return true;
+    }
+    free(scratch->abgr);
+    scratch->abgr = nullptr;
+    scratch->abgr_capacity = 0;
+    void* abgr = nullptr;
+    if (posix_memalign(&abgr, 64, size) != 0) {
+        LOGE("Failed to allocate %zu bytes for YUV to RGB conversion.", size);
+        return false;
+    }
+    scratch->abgr = static_cast<uint8_t*>(abgr);
+    scratch->abgr_capacity = size;
+    return true;
+}
+
+static bool write_jpeg_blob(void* user_context, const void* data, size_t size) {
+    JpegBlobWriter* writer = static_cast<JpegBlobWriter*>(user_context);
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    size_t skipped = std::min(size, writer->bytes_to_skip);
+    writer->bytes_to_skip -= skipped;
+    src += skipped;
+    size -= skipped;
+    if (!reserve_jpeg_scratch(writer->scratch, writer->size + size)) {
+        return false;
+    }
+    memcpy(writer->scratch->jpeg + writer->size, src, size);
+    writer->size += size;
+    return true;
+}
+
+/**
+ * Encodes YUV_420_888 planes to JPEG and posts it to the BLOB buffer of the Surface.
+ *
+ * <p>The given Exif APP1 segment, if any, is written right after the SOI marker. The JPEG size
+ * is reported to the consumer with a camera3_jpeg_blob at the end of the buffer, the same way
+ * camera HALs do. Returns -1 without posting a buffer on any failure, so that the caller can
+ * fall back to another encoder.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToJpegSurface(
+        JNIEnv* env,
+        jclass,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_y,
+        jint src_pixel_stride_uv,
+        jint width,
+        jint height,
+        jbyteArray exif_segment,
+        jint jpeg_quality,
+        jobject surface) {
+    AndroidBitmap_compress_func bitmap_compress = get_bitmap_compress();
+    if (bitmap_compress == nullptr) {
+        LOGE("AndroidBitmap_compress is not available.");
+        return -1;
+    }
+
+    uint8_t* src_y_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y));
+    uint8_t* src_u_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_u));
+    uint8_t* src_v_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v));
+
+    // The platform encoder only accepts a whole RGB frame, so the frame is converted into the
+    // scratch first. Captures are serialized on the scratch.
+    std::lock_guard<std::mutex> lock(jpeg_scratch.lock);
+    int abgr_stride = width * 4;
+    if (!reserve_abgr_scratch(&jpeg_scratch, static_cast<size_t>(abgr_stride) * height)) {
+        return -1;
+    }
+    int result = Android420ToABGR(src_y_ptr,
+                                  src_stride_y,
+                                  src_u_ptr,
+                                  src_stride_u,
+                                  src_v_ptr,
+                                  src_stride_v,
+                                  src_pixel_stride_uv,
+                                  jpeg_scratch.abgr,
+                                  abgr_stride,
+                                  /* is_full_swing = */true,
+                                  width,
+                                  height);
+    if (result != 0) {
+        LOGE("Failed to convert YUV to RGB for JPEG encoding.");
+        return -1;
+    }
+
+    // The JPEG is encoded before the window is locked: the BLOB buffer is sized to the encoded
+    // JPEG, and a locked buffer has to be queued, so an encoding failure after locking would post
+    // an empty JPEG ahead of the caller's fallback.
+    jsize exif_size = exif_segment != nullptr ? env->GetArrayLength(exif_segment) : 0;
+    if (!reserve_jpeg_scratch(&jpeg_scratch, static_cast<size_t>(2 + exif_size))) {
+        return -1;
+    }
+    // SOI marker followed by the Exif segment. The SOI written by the encoder is dropped.
+    jpeg_scratch.jpeg[0] = 0xFF;
+    jpeg_scratch.jpeg[1] = 0xD8;
+    if (exif_size > 0) {
+        env->GetByteArrayRegion(exif_segment, 0, exif_size,
+                                reinterpret_cast<jbyte*>(jpeg_scratch.jpeg + 2));
+    }
+    JpegBlobWriter writer = {&jpeg_scratch, static_cast<size_t>(2 + exif_size), 2};
+
+    AndroidBitmapInfo info = {};
+    info.width = static_cast<uint32_t>(width);
+    info.height = static_cast<uint32_t>(height);
+    info.stride = static_cast<uint32_t>(abgr_stride);
+    info.format = ANDROID_BITMAP_FORMAT_RGBA_8888;
+    info.flags = ANDROID_BITMAP_FLAGS_ALPHA_OPAQUE;
+    result = bitmap_compress(&info, ADATASPACE_SRGB, jpeg_scratch.abgr,
+                             ANDROID_BITMAP_COMPRESS_FORMAT_JPEG, jpeg_quality, &writer,
+                             write_jpeg_blob);
+    if (result != ANDROID_BITMAP_RESULT_SUCCESS) {
+        LOGE("Failed to encode JPEG: %d", result);
+        return -1;
+    }
+
+    ANativeWindow* window = ANativeWindow_fromSurface(env, surface);
+    if (window == nullptr) {
+        LOGE("Failed to get ANativeWindow");
+        return -1;
+    }
+
+    // Sized to the encoded JPEG, as nativeWriteJpegToSurface does, with the camera3_jpeg_blob
+    // trailer in place of the padding bytes.
+    int32_t buffer_size = static_cast<int32_t>(writer.size + sizeof(camera3_jpeg_blob));
+    ANativeWindow_setBuffersGeometry(window, buffer_size, 1, AHARDWAREBUFFER_FORMAT_BLOB);
+
+    ANativeWindow_Buffer buffer;
+    int lockResult = ANativeWindow_lock(window, &buffer, NULL);
+    if (lockResult != 0) {
+        ANativeWindow_release(window);
+        LOGE("Failed to lock window.");
+        return -1;
+    }
 
-    env->ReleaseByteArrayElements(jpeg_array, jpeg_ptr, 0);
+    uint8_t* buffer_ptr = reinterpret_cast<uint8_t*>(buffer.bits);
+    memcpy(buffer_ptr, jpeg_scratch.jpeg, writer.size);
+
+    camera3_jpeg_blob blob = {};
+    blob.jpeg_blob_id = CAMERA3_JPEG_BLOB_ID;
+    blob.jpeg_size = static_cast<uint32_t>(writer.size);
+    memcpy(buffer_ptr + writer.size, &blob, sizeof(blob));
+
+    ANativeWindow_unlockAndPost(window);
+    ANativeWindow_release(window);
     return 0;
 }
 
@@ -290,7 +558,24 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroi
         jint start_offset_y,
         jint start_offset_u,
         jint start_offset_v,
-        int rotation) {
+        int rotation,
+        jint crop_left,
+        jint crop_top,
+        jint crop_width,
+        jint crop_height,
+        jint dst_width,
+        jint dst_height,
+        jint filter_mode) {
+    bool has_pixel_shift = start_offset_y > 0 || start_offset_u > 0 || start_offset_v > 0;
+    if (!is_valid_crop(crop_left, crop_top, crop_width, crop_height, width, height)
+            || dst_width <= 0 || dst_height <= 0) {
+        return -1;
+    }
+    // The one pixel shift workaround only supports converting the full frame.
+    if (has_pixel_shift && !is_full_frame(crop_left, crop_top, crop_width, crop_height,
+                                          dst_width, dst_height, width, height)) {
+        return -1;
+    }
 
     uint8_t* src_y_ptr =
             static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y));
@@ -299,6 +584,31 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroi
     uint8_t* src_v_ptr =
             static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v));
 
+    libyuv::RotationMode mode = get_rotation_mode(rotation);
+    bool has_rotation = rotation != 0;
+
+    // When rotating, the frame is converted into converted_buffer with a stride of dst_width
+    // pixels first.
+    uint8_t* converted_buffer_ptr = nullptr;
+    if (has_rotation) {
+        if (converted_buffer == nullptr) {
+            LOGE("No intermediate buffer for rotation");
+            return -1;
+        }
+        converted_buffer_ptr =
+                static_cast<uint8_t*>(env->GetDirectBufferAddress(converted_buffer));
+        jlong capacity = env->GetDirectBufferCapacity(converted_buffer);
+        if (converted_buffer_ptr == nullptr
+                || capacity < static_cast<jlong>(dst_width) * dst_height * 4) {
+            LOGE("Intermediate buffer too small: %" PRId64 " bytes for %dx%d",
+                 static_cast<int64_t>(capacity), dst_width, dst_height);
+            return -1;
+        }
+    }
+    bool is_transposed = rotation == 90 || rotation == 270;
+    int window_width = is_transposed ? dst_height : dst_width;
+    int window_height = is_transposed ? dst_width : dst_height;
+
     ANativeWindow* window = ANativeWindow_fromSurface(env, surface);
     if (window == nullptr) {
         return -1;
@@ -309,20 +619,23 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroi
         ANativeWindow_release(window);
         return -1;
     }
-
-    libyuv::RotationMode mode = get_rotation_mode(rotation);
-    bool has_rotation = rotation != 0;
+    // A locked buffer has to be posted, even if nothing was written to it.
+    if (buffer.width < window_width || buffer.height < window_height) {
+        LOGE("Window buffer %dx%d is smaller than the output %dx%d",
+             buffer.width, buffer.height, window_width, window_height);
+        ANativeWindow_unlockAndPost(window);
+        ANativeWindow_release(window);
+        return -1;
+    }
 
     uint8_t* buffer_ptr = reinterpret_cast<uint8_t*>(buffer.bits);
-    uint8_t* converted_buffer_ptr = (has_rotation && converted_buffer != NULL)
-            ? static_cast<uint8_t*>(env->GetDirectBufferAddress(converted_buffer)) : nullptr;
 
     uint8_t* dst_ptr = has_rotation ? converted_buffer_ptr : buffer_ptr;
-    int dst_stride_y = has_rotation ? (width * 4) : (buffer.stride * 4);
+    int dst_stride_y = has_rotation ? (dst_width * 4) : (buffer.stride * 4);
 
     int result = 0;
     // Apply workaround for one pixel shift issue by checking offset.
-    if (start_offset_y > 0 || start_offset_u > 0 || start_offset_v > 0) {
+    if (has_pixel_shift) {
 
         // TODO(b/195990691): extend the pixel shift to handle multiple corrupted pixels.
         // We don't support multiple pixel shift now.
@@ -334,66 +647,35 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroi
             return -1;
         }
 
-        // Convert yuv to rgb except the last line.
-        result = Android420ToABGR(src_y_ptr + start_offset_y,
-                                  src_stride_y,
-                                  src_u_ptr + start_offset_u,
-                                  src_stride_u,
-                                  src_v_ptr + start_offset_v,
-                                  src_stride_v,
-                                  src_pixel_stride_uv,
-                                  dst_ptr,
-                                  dst_stride_y,
-                                  /* is_full_swing = */true,
-                                  width,
-                                  height - 1);
-        if (result == 0) {
-            // Convert the last row with (width - 1) pixels
-            // since the last pixel's yuv data is missing.
-            result = Android420ToABGR(
-                    src_y_ptr + start_offset_y + src_stride_y * (height - 1),
-                    src_stride_y - 1,
-                    src_u_ptr + start_offset_u + src_stride_u * (height - 2) / 2,
-                    src_stride_u - 1,
-                    src_v_ptr + start_offset_v + src_stride_v * (height - 2) / 2,
-                    src_stride_v - 1,
-                    src_pixel_stride_uv,
-                    dst_ptr + dst_stride_y * (height - 1),
-                    dst_stride_y,
-                    /* is_full_swing = */true,
-                    width - 1,
-                    1);
-        }
-
-        if (result == 0) {
-            // Set the 2x2 pixels on the right bottom by duplicating the 3rd pixel
-            // from the right to left in each row.
-            for (int i = 0; i < 2; i++) {
-                for (int j = 0; j < 2; j++) {
-                    int r_ind = dst_stride_y * (height - 1 - i) + width * 4 - (j * 4 + 1);
-                    int g_ind = dst_stride_y * (height - 1 - i) + width * 4 - (j * 4 + 2);
-                    int b_ind = dst_stride_y * (height - 1 - i) + width * 4 - (j * 4 + 3);
-                    int a_ind = dst_stride_y * (height - 1 - i) + width * 4 - (j * 4 + 4);
-                    dst_ptr[r_ind] = dst_ptr[r_ind - 8];
-                    dst_ptr[g_ind] = dst_ptr[g_ind - 8];
-                    dst_ptr[b_ind] = dst_ptr[b_ind - 8];
-                    dst_ptr[a_ind] = dst_ptr[a_ind - 8];
-                }
-            }
-        }
+        result = Android420ToABGRWithPixelShift(src_y_ptr,
+                                                src_stride_y,
+                                                src_u_ptr,
+                                                src_stride_u,
+                                                src_v_ptr,
+                                                src_stride_v,
+                                                src_pixel_stride_y,
+                                                src_pixel_stride_uv,
+                                                dst_ptr,
+                                                dst_stride_y,
+                                                width,
+                                                height);
     } else {
-        result = Android420ToABGR(src_y_ptr + start_offset_y,
-                                          src_stride_y,
-                                          src_u_ptr + start_offset_u,
-                                          src_stride_u,
-                                          src_v_ptr + start_offset_v,
-                                          src_stride_v,
-                                          src_pixel_stride_uv,
-                                          dst_ptr,
-                                          dst_stride_y,
-                                          /* is_full_swing = */true,
-                                          width,
-                                          height);
+        result = Android420ToABGRScaled(src_y_ptr,
+                                        src_stride_y,
+                                        src_u_ptr,
+                                        src_stride_u,
+                                        src_v_ptr,
+                                        src_stride_v,
+                                        src_pixel_stride_uv,
+                                        crop_left,
+                                        crop_top,
+                                        crop_width,
+                                        crop_height,
+                                        dst_ptr,
+                                        dst_stride_y,
+                                        dst_width,
+                                        dst_height,
+                                        static_cast<libyuv::FilterMode>(filter_mode));
     }
 
     // TODO(b/203141655): avoid unnecessary memory copy by merging libyuv API for rotation.
@@ -402,8 +684,8 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroi
                                     dst_stride_y,
                                     buffer_ptr,
                                     buffer.stride * 4,
-                                    width,
-                                    height,
+                                    dst_width,
+                                    dst_height,
                                     mode);
     }
 
@@ -412,6 +694,85 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroi
     return result;
 }
 
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToTensor(
+        JNIEnv* env,
+        jclass,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_y,
+        jint src_pixel_stride_uv,
+        jint width,
+        jint height,
+        jint crop_left,
+        jint crop_top,
+        jint crop_width,
+        jint crop_height,
+        jint rotation,
+        jobject tensor_buffer,
+        jint tensor_width,
+        jint tensor_height,
+        jint data_type,
+        jint layout,
+        jfloatArray mean,
+        jfloatArray std,
+        jfloat quant_scale,
+        jint quant_zero_point) {
+    if (crop_left < 0 || crop_top < 0 || crop_width <= 0 || crop_height <= 0
+            || crop_left + crop_width > width || crop_top + crop_height > height) {
+        LOGE("Invalid crop rect for tensor conversion.");
+        return -1;
+    }
+
+    TensorParams params = {};
+    params.data_type = static_cast<TensorDataType>(data_type);
+    params.layout = static_cast<TensorLayout>(layout);
+    params.quant_scale = quant_scale;
+    params.quant_zero_point = quant_zero_point;
+    if (env->GetArrayLength(mean) != 3 || env->GetArrayLength(std) != 3) {
+        LOGE("Mean and std must have one value per RGB channel.");
+        return -1;
+    }
+    env->GetFloatArrayRegion(mean, 0, 3, params.mean);
+    env->GetFloatArrayRegion(std, 0, 3, params.std);
+
+    int element_size = get_tensor_element_size(params.data_type);
+    uint8_t* tensor_ptr = static_cast<uint8_t*>(env->GetDirectBufferAddress(tensor_buffer));
+    if (tensor_ptr == nullptr || element_size == 0
+            || env->GetDirectBufferCapacity(tensor_buffer)
+                    < static_cast<jlong>(tensor_width) * tensor_height * 3 * element_size) {
+        LOGE("Invalid tensor buffer.");
+        return -1;
+    }
+
+    uint8_t* src_y_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y));
+    uint8_t* src_u_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_u));
+    uint8_t* src_v_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v));
+
+    return Android420ToTensor(src_y_ptr,
+                              src_stride_y,
+                              src_u_ptr,
+                              src_stride_u,
+                              src_v_ptr,
+                              src_stride_v,
+                              src_pixel_stride_uv,
+                              crop_left,
+                              crop_top,
+                              crop_width,
+                              crop_height,
+                              rotation,
+                              tensor_ptr,
+                              tensor_width,
+                              tensor_height,
+                              params);
+}
+
 JNIEXPORT jint
 Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToBitmap(
         JNIEnv* env,
@@ -427,7 +788,18 @@ Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToBitmap(
         jobject bitmap,
         jint bitmap_stride,
         jint width,
-        jint height) {
+        jint height,
+        jint crop_left,
+        jint crop_top,
+        jint crop_width,
+        jint crop_height,
+        jint dst_width,
+        jint dst_height,
+        jint filter_mode) {
+    if (!is_valid_crop(crop_left, crop_top, crop_width, crop_height, width, height)
+            || dst_width <= 0 || dst_height <= 0) {
+        return -1;
+    }
 
     void* bitmapAddress = nullptr;
 
@@ -446,7 +818,7 @@ Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToBitmap(
 
     int dst_stride_y = bitmap_stride;
 
-    int result = Android420ToABGR(
+    int result = Android420ToABGRScaled(
             src_y_ptr ,
             src_stride_y,
             src_u_ptr,
@@ -454,11 +826,15 @@ Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToBitmap(
             src_v_ptr,
             src_stride_v,
             src_pixel_stride_uv,
+            crop_left,
+            crop_top,
+            crop_width,
+            crop_height,
             reinterpret_cast<uint8_t *> (bitmapAddress),
             dst_stride_y,
-            /* is_full_swing = */true,
-            width,
-            height);
+            dst_width,
+            dst_height,
+            static_cast<libyuv::FilterMode>(filter_mode));
 
     if (result != 0) {
         return -1;
@@ -473,17 +849,678 @@ Java_androidx_camera_core_ImageProcessingUtil_nativeConvertAndroid420ToBitmap(
     return 0;
 }
 
-JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeRotateYUV(
+/**
+ * Computes the luma statistics of a region of the Y plane.
+ *
+ * <p>The histogram array receives the 256 bins and the results array receives the mean, the
+ * variance, the sharpness and the under and over exposed ratios, in that order.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeComputeLumaStatistics(
         JNIEnv* env,
         jclass,
         jobject src_y,
         jint src_stride_y,
-        jobject src_u,
-        jint src_stride_u,
-        jobject src_v,
-        jint src_stride_v,
-        jint src_pixel_stride_uv,
-        jobject dst_y,
+        jint src_pixel_stride_y,
+        jint width,
+        jint height,
+        jint roi_left,
+        jint roi_top,
+        jint roi_width,
+        jint roi_height,
+        jint sample_step,
+        jint under_exposed_threshold,
+        jint over_exposed_threshold,
+        jintArray histogram,
+        jfloatArray results) {
+    if (env->GetArrayLength(histogram) != LUMA_HISTOGRAM_BINS
+            || env->GetArrayLength(results) != 5) {
+        LOGE("Invalid output arrays for luma statistics.");
+        return -1;
+    }
+
+    uint8_t* src_y_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y));
+
+    LumaStatistics stats;
+    int result = ComputeLumaStatistics(src_y_ptr,
+                                       src_stride_y,
+                                       src_pixel_stride_y,
+                                       width,
+                                       height,
+                                       roi_left,
+                                       roi_top,
+                                       roi_width,
+                                       roi_height,
+                                       sample_step,
+                                       under_exposed_threshold,
+                                       over_exposed_threshold,
+                                       &stats);
+    if (result != 0) {
+        LOGE("Invalid parameters for luma statistics.");
+        return -1;
+    }
+
+    jfloat values[5] = {stats.mean, stats.variance, stats.sharpness, stats.under_exposed_ratio,
+                        stats.over_exposed_ratio};
+    env->SetIntArrayRegion(histogram, 0, LUMA_HISTOGRAM_BINS,
+                           reinterpret_cast<const jint*>(stats.histogram));
+    env->SetFloatArrayRegion(results, 0, 5, values);
+    return 0;
+}
+
+/**
+ * Converts a P010 image to a RGBA_1010102 or RGBA_F16 Bitmap.
+ *
+ * <p>The output format is taken from the Bitmap. The Bitmap size is the image size after the
+ * rotation.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertP010ToBitmap(
+        JNIEnv* env,
+        jclass,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_uv,
+        jint src_stride_uv,
+        jint width,
+        jint height,
+        jobject bitmap,
+        jint rotation,
+        jint color_standard,
+        jint transfer) {
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        return -1;
+    }
+    bool flip_wh = rotation == 90 || rotation == 270;
+    if (info.width != static_cast<uint32_t>(flip_wh ? height : width)
+            || info.height != static_cast<uint32_t>(flip_wh ? width : height)) {
+        LOGE("Bitmap size does not match the rotated image size.");
+        return -1;
+    }
+
+    uint8_t* src_y_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y));
+    uint8_t* src_uv_ptr =
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_uv));
+
+    void* bitmapAddress = nullptr;
+    int lockResult = AndroidBitmap_lockPixels(env, bitmap, &bitmapAddress);
+    if (lockResult != 0) {
+        return -1;
+    }
+
+    libyuv::RotationMode mode = get_rotation_mode(rotation);
+    int result;
+    switch (info.format) {
+        case ANDROID_BITMAP_FORMAT_RGBA_1010102:
+            result = P010ToRGBA1010102(src_y_ptr,
+                                       src_stride_y,
+                                       src_uv_ptr,
+                                       src_stride_uv,
+                                       static_cast<uint8_t*>(bitmapAddress),
+                                       info.stride,
+                                       width,
+                                       height,
+                                       mode,
+                                       static_cast<HdrColorStandard>(color_standard));
+            break;
+        case ANDROID_BITMAP_FORMAT_RGBA_F16:
+            result = P010ToRGBAF16(src_y_ptr,
+                                   src_stride_y,
+                                   src_uv_ptr,
+                                   src_stride_uv,
+                                   static_cast<uint8_t*>(bitmapAddress),
+                                   info.stride,
+                                   width,
+                                   height,
+                                   mode,
+                                   static_cast<HdrColorStandard>(color_standard),
+                                   static_cast<HdrTransfer>(transfer));
+            break;
+        default:
+            LOGE("Unsupported Bitmap format %d for P010 conversion.", info.format);
+            result = -1;
+            break;
+    }
+
+    // balance call to AndroidBitmap_lockPixels
+    int unlockResult = AndroidBitmap_unlockPixels(env, bitmap);
+    if (result != 0 || unlockResult != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Returns the kernel output writing YUV planes of the given layout, or ABGR if there is none.
+static YuvKernelOutput get_kernel_output(YuvLayout layout) {
+    switch (layout) {
+        case YUV_LAYOUT_I420:
+            return YUV_KERNEL_OUTPUT_I420;
+        case YUV_LAYOUT_NV12:
+            return YUV_KERNEL_OUTPUT_NV12;
+        case YUV_LAYOUT_NV21:
+            return YUV_KERNEL_OUTPUT_NV21;
+        default:
+            return YUV_KERNEL_OUTPUT_ABGR;
+    }
+}
+
+/**
+ * Creates a YuvConverter for the layout of the given source chroma planes. The output is ABGR if
+ * dst_u is null, otherwise the layout of the given destination chroma planes.
+ *
+ * <p>Returns 0 if the destination layout has no kernel.
+ */
+JNIEXPORT jlong Java_androidx_camera_core_ImageProcessingUtil_nativeCreateYuvConverter(
+        JNIEnv* env,
+        jclass,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_uv,
+        jobject dst_u,
+        jint dst_stride_u,
+        jobject dst_v,
+        jint dst_stride_v,
+        jint dst_pixel_stride_uv,
+        jint width,
+        jint height,
+        jint rotation) {
+    YuvLayout layout = DetectYuvLayout(
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_u)),
+            src_stride_u,
+            static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v)),
+            src_stride_v,
+            src_pixel_stride_uv);
+
+    YuvKernelOutput output = YUV_KERNEL_OUTPUT_ABGR;
+    if (dst_u != nullptr) {
+        output = get_kernel_output(DetectYuvLayout(
+                static_cast<uint8_t*>(env->GetDirectBufferAddress(dst_u)),
+                dst_stride_u,
+                static_cast<uint8_t*>(env->GetDirectBufferAddress(dst_v)),
+                dst_stride_v,
+                dst_pixel_stride_uv));
+        if (output == YUV_KERNEL_OUTPUT_ABGR) {
+            return 0;
+        }
+    }
+
+    return reinterpret_cast<jlong>(CreateYuvConverter(layout, output, width, height, rotation));
+}
+
+JNIEXPORT void Java_androidx_camera_core_ImageProcessingUtil_nativeDestroyYuvConverter(
+        JNIEnv*,
+        jclass,
+        jlong converter) {
+    DestroyYuvConverter(reinterpret_cast<YuvConverter*>(converter));
+}
+
+/**
+ * Converts a frame to RGBA with a YuvConverter created for ABGR output. Returns -1 without
+ * posting a buffer to the Surface if the layout of the source planes differs from the one the
+ * converter was created for.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeConvertWithYuvConverter(
+        JNIEnv* env,
+        jclass,
+        jlong converter,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_uv,
+        jobject surface) {
+    YuvConverter* yuv_converter = reinterpret_cast<YuvConverter*>(converter);
+    if (yuv_converter == nullptr || yuv_converter->output != YUV_KERNEL_OUTPUT_ABGR) {
+        return -1;
+    }
+
+    YuvPlanes src = {static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y)),
+                     src_stride_y,
+                     static_cast<uint8_t*>(env->GetDirectBufferAddress(src_u)),
+                     src_stride_u,
+                     static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v)),
+                     src_stride_v,
+                     src_pixel_stride_uv};
+    // Checked before locking the window, as a locked buffer has to be posted.
+    if (!YuvConverterAccepts(yuv_converter, src)) {
+        return -1;
+    }
+
+    ANativeWindow* window = ANativeWindow_fromSurface(env, surface);
+    if (window == nullptr) {
+        return -1;
+    }
+    ANativeWindow_Buffer buffer;
+    int lockResult = ANativeWindow_lock(window, &buffer, NULL);
+    if (lockResult != 0 || buffer.format != WINDOW_FORMAT_RGBA_8888) {
+        ANativeWindow_release(window);
+        return -1;
+    }
+
+    YuvKernelDestination dst = {{reinterpret_cast<uint8_t*>(buffer.bits), nullptr, nullptr},
+                                {buffer.stride * 4, 0, 0}};
+    int result = RunYuvConverter(yuv_converter, src, dst);
+
+    ANativeWindow_unlockAndPost(window);
+    ANativeWindow_release(window);
+    return result;
+}
+
+/**
+ * Rotates a frame into YUV planes with a YuvConverter created for them. Returns -1 without
+ * writing anything if the layout of the source or destination planes differs from the one the
+ * converter was created for.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeRotateWithYuvConverter(
+        JNIEnv* env,
+        jclass,
+        jlong converter,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_uv,
+        jobject dst_y,
+        jint dst_stride_y,
+        jobject dst_u,
+        jint dst_stride_u,
+        jobject dst_v,
+        jint dst_stride_v,
+        jint dst_pixel_stride_uv) {
+    YuvConverter* yuv_converter = reinterpret_cast<YuvConverter*>(converter);
+    if (yuv_converter == nullptr || yuv_converter->output == YUV_KERNEL_OUTPUT_ABGR) {
+        return -1;
+    }
+
+    YuvPlanes src = {static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y)),
+                     src_stride_y,
+                     static_cast<uint8_t*>(env->GetDirectBufferAddress(src_u)),
+                     src_stride_u,
+                     static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v)),
+                     src_stride_v,
+                     src_pixel_stride_uv};
+
+    uint8_t* dst_u_ptr = static_cast<uint8_t*>(env->GetDirectBufferAddress(dst_u));
+    uint8_t* dst_v_ptr = static_cast<uint8_t*>(env->GetDirectBufferAddress(dst_v));
+    if (get_kernel_output(DetectYuvLayout(dst_u_ptr, dst_stride_u, dst_v_ptr, dst_stride_v,
+                                          dst_pixel_stride_uv)) != yuv_converter->output) {
+        return -1;
+    }
+    YuvKernelDestination dst = {{static_cast<uint8_t*>(env->GetDirectBufferAddress(dst_y)),
+                                 dst_u_ptr,
+                                 dst_v_ptr},
+                                {dst_stride_y, dst_stride_u, dst_stride_v}};
+    if (yuv_converter->output == YUV_KERNEL_OUTPUT_NV21) {
+        // The interleaved chroma starts with V.
+        dst.planes[1] = dst_v_ptr;
+        dst.strides[1] = dst_stride_v;
+    }
+    return RunYuvConverter(yuv_converter, src, dst);
+}
+
+JNIEXPORT jlong Java_androidx_camera_core_ImageProcessingUtil_nativeCreateMotionDetector(
+        JNIEnv*,
+        jclass,
+        jint width,
+        jint height,
+        jint downsample_factor,
+        jint tile_size,
+        jint threshold) {
+    return reinterpret_cast<jlong>(
+            CreateMotionDetector(width, height, downsample_factor, tile_size, threshold));
+}
+
+JNIEXPORT void Java_androidx_camera_core_ImageProcessingUtil_nativeDestroyMotionDetector(
+        JNIEnv*,
+        jclass,
+        jlong detector) {
+    DestroyMotionDetector(reinterpret_cast<MotionDetector*>(detector));
+}
+
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeGetMotionTileCount(
+        JNIEnv*,
+        jclass,
+        jlong detector,
+        jboolean vertical) {
+    MotionDetector* motion_detector = reinterpret_cast<MotionDetector*>(detector);
+    return vertical ? motion_detector->tiles_y : motion_detector->tiles_x;
+}
+
+JNIEXPORT void Java_androidx_camera_core_ImageProcessingUtil_nativeResetMotionDetector(
+        JNIEnv*,
+        jclass,
+        jlong detector) {
+    ResetMotionDetector(reinterpret_cast<MotionDetector*>(detector));
+}
+
+/**
+ * Compares the Y plane against the reference of a MotionDetector.
+ *
+ * <p>tile_map receives the mean absolute difference of every tile and score[0] the fraction of
+ * tiles that move.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeDetectMotion(
+        JNIEnv* env,
+        jclass,
+        jlong detector,
+        jobject src_y,
+        jint src_stride_y,
+        jint src_pixel_stride_y,
+        jboolean update_reference,
+        jbyteArray tile_map,
+        jfloatArray score) {
+    MotionDetector* motion_detector = reinterpret_cast<MotionDetector*>(detector);
+    int tile_count = motion_detector->tiles_x * motion_detector->tiles_y;
+    if (env->GetArrayLength(tile_map) < tile_count) {
+        LOGE("Tile map is too small for the motion detector.");
+        return -1;
+    }
+
+    uint8_t* src_y_ptr = static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y));
+    jbyte* tile_map_ptr = env->GetByteArrayElements(tile_map, nullptr);
+    float motion_score = 0.0f;
+    int result = DetectMotion(motion_detector,
+                              src_y_ptr,
+                              src_stride_y,
+                              src_pixel_stride_y,
+                              update_reference,
+                              reinterpret_cast<uint8_t*>(tile_map_ptr),
+                              &motion_score);
+    env->ReleaseByteArrayElements(tile_map, tile_map_ptr, result == 0 ? 0 : JNI_ABORT);
+    if (result != 0) {
+        return -1;
+    }
+    env->SetFloatArrayRegion(score, 0, 1, &motion_score);
+    return 0;
+}
+
+JNIEXPORT jlong Java_androidx_camera_core_ImageProcessingUtil_nativeCreateRemapTable(
+        JNIEnv* env,
+        jclass,
+        jint src_width,
+        jint src_height,
+        jint dst_width,
+        jint dst_height,
+        jfloatArray matrix,
+        jfloatArray intrinsics,
+        jfloatArray distortion,
+        jint thread_count) {
+    float matrix_values[9];
+    float intrinsics_values[5];
+    float distortion_values[5];
+    if (env->GetArrayLength(matrix) != 9) {
+        return 0;
+    }
+    env->GetFloatArrayRegion(matrix, 0, 9, matrix_values);
+    bool has_distortion = intrinsics != nullptr && distortion != nullptr;
+    if (has_distortion) {
+        if (env->GetArrayLength(intrinsics) != 5 || env->GetArrayLength(distortion) != 5) {
+            return 0;
+        }
+        env->GetFloatArrayRegion(intrinsics, 0, 5, intrinsics_values);
+        env->GetFloatArrayRegion(distortion, 0, 5, distortion_values);
+    }
+    return reinterpret_cast<jlong>(CreateRemapTable(src_width,
+                                                    src_height,
+                                                    dst_width,
+                                                    dst_height,
+                                                    matrix_values,
+                                                    has_distortion ? intrinsics_values : nullptr,
+                                                    has_distortion ? distortion_values : nullptr,
+                                                    thread_count));
+}
+
+JNIEXPORT void Java_androidx_camera_core_ImageProcessingUtil_nativeDestroyRemapTable(
+        JNIEnv*,
+        jclass,
+        jlong table) {
+    DestroyRemapTable(reinterpret_cast<RemapTable*>(table));
+}
+
+// Returns the address of a direct buffer holding a plane of the given size, or nullptr if the
+// buffer is too small for it.
+static uint8_t* get_plane_address(JNIEnv* env,
+                                  jobject buffer,
+                                  int width,
+                                  int height,
+                                  int stride,
+                                  int pixel_stride) {
+    if (stride <= 0 || pixel_stride <= 0) {
+        return nullptr;
+    }
+    int64_t row_size = static_cast<int64_t>(width - 1) * pixel_stride + 1;
+    if (row_size > stride || static_cast<int64_t>(height - 1) * stride + row_size
+            > env->GetDirectBufferCapacity(buffer)) {
+        return nullptr;
+    }
+    return static_cast<uint8_t*>(env->GetDirectBufferAddress(buffer));
+}
+
+/**
+ * Warps the planes of a YUV_420_888 frame into the planes of another one. Returns -1 if a plane
+ * is smaller than the size of the table implies.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeRemapYUV(
+        JNIEnv* env,
+        jclass,
+        jlong table,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_uv,
+        jobject dst_y,
+        jint dst_stride_y,
+        jobject dst_u,
+        jint dst_stride_u,
+        jobject dst_v,
+        jint dst_stride_v,
+        jint dst_pixel_stride_uv) {
+    RemapTable* remap_table = reinterpret_cast<RemapTable*>(table);
+    int src_width = remap_table->src_width;
+    int src_height = remap_table->src_height;
+    int dst_width = remap_table->dst_width;
+    int dst_height = remap_table->dst_height;
+    uint8_t* src_y_ptr = get_plane_address(env, src_y, src_width, src_height, src_stride_y, 1);
+    uint8_t* src_u_ptr = get_plane_address(env, src_u, (src_width + 1) / 2,
+                                           (src_height + 1) / 2, src_stride_u,
+                                           src_pixel_stride_uv);
+    uint8_t* src_v_ptr = get_plane_address(env, src_v, (src_width + 1) / 2,
+                                           (src_height + 1) / 2, src_stride_v,
+                                           src_pixel_stride_uv);
+    uint8_t* dst_y_ptr = get_plane_address(env, dst_y, dst_width, dst_height, dst_stride_y, 1);
+    uint8_t* dst_u_ptr = get_plane_address(env, dst_u, (dst_width + 1) / 2,
+                                           (dst_height + 1) / 2, dst_stride_u,
+                                           dst_pixel_stride_uv);
+    uint8_t* dst_v_ptr = get_plane_address(env, dst_v, (dst_width + 1) / 2,
+                                           (dst_height + 1) / 2, dst_stride_v,
+                                           dst_pixel_stride_uv);
+    if (src_y_ptr == nullptr || src_u_ptr == nullptr || src_v_ptr == nullptr
+            || dst_y_ptr == nullptr || dst_u_ptr == nullptr || dst_v_ptr == nullptr) {
+        LOGE("Planes do not match the remap table.");
+        return -1;
+    }
+
+    int result = RemapPlane(remap_table,
+                            /* chroma= */false,
+                            src_y_ptr,
+                            src_stride_y,
+                            1,
+                            dst_y_ptr,
+                            dst_stride_y,
+                            1);
+    if (result == 0) {
+        result = RemapPlane(remap_table,
+                            /* chroma= */true,
+                            src_u_ptr,
+                            src_stride_u,
+                            src_pixel_stride_uv,
+                            dst_u_ptr,
+                            dst_stride_u,
+                            dst_pixel_stride_uv);
+    }
+    if (result == 0) {
+        result = RemapPlane(remap_table,
+                            /* chroma= */true,
+                            src_v_ptr,
+                            src_stride_v,
+                            src_pixel_stride_uv,
+                            dst_v_ptr,
+                            dst_stride_v,
+                            dst_pixel_stride_uv);
+    }
+    return result;
+}
+
+/**
+ * Warps a RGBA_8888 Bitmap into another one.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeRemapBitmap(
+        JNIEnv* env,
+        jclass,
+        jlong table,
+        jobject src_bitmap,
+        jobject dst_bitmap) {
+    RemapTable* remap_table = reinterpret_cast<RemapTable*>(table);
+    AndroidBitmapInfo src_info;
+    AndroidBitmapInfo dst_info;
+    if (AndroidBitmap_getInfo(env, src_bitmap, &src_info) != ANDROID_BITMAP_RESULT_SUCCESS
+            || AndroidBitmap_getInfo(env, dst_bitmap, &dst_info) != ANDROID_BITMAP_RESULT_SUCCESS
+            || src_info.format != ANDROID_BITMAP_FORMAT_RGBA_8888
+            || dst_info.format != ANDROID_BITMAP_FORMAT_RGBA_8888
+            || src_info.width != static_cast<uint32_t>(remap_table->src_width)
+            || src_info.height != static_cast<uint32_t>(remap_table->src_height)
+            || dst_info.width != static_cast<uint32_t>(remap_table->dst_width)
+            || dst_info.height != static_cast<uint32_t>(remap_table->dst_height)) {
+        LOGE("Bitmaps do not match the remap table.");
+        return -1;
+    }
+
+    void* src_ptr = nullptr;
+    void* dst_ptr = nullptr;
+    if (AndroidBitmap_lockPixels(env, src_bitmap, &src_ptr) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        return -1;
+    }
+    if (AndroidBitmap_lockPixels(env, dst_bitmap, &dst_ptr) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        AndroidBitmap_unlockPixels(env, src_bitmap);
+        return -1;
+    }
+    int result = RemapRGBA(remap_table,
+                           static_cast<uint8_t*>(src_ptr),
+                           src_info.stride,
+                           static_cast<uint8_t*>(dst_ptr),
+                           dst_info.stride);
+    AndroidBitmap_unlockPixels(env, dst_bitmap);
+    AndroidBitmap_unlockPixels(env, src_bitmap);
+    return result;
+}
+
+JNIEXPORT jlong Java_androidx_camera_core_ImageProcessingUtil_nativeCreateImagePyramid(
+        JNIEnv*,
+        jclass,
+        jint width,
+        jint height,
+        jint channels,
+        jint level_count) {
+    // The levels are allocated by Java so that the buffers handed out stay valid after the
+    // pyramid is destroyed.
+    return reinterpret_cast<jlong>(CreateImagePyramid(width, height, channels, level_count,
+                                                      /* allocate_levels= */false));
+}
+
+JNIEXPORT void Java_androidx_camera_core_ImageProcessingUtil_nativeDestroyImagePyramid(
+        JNIEnv*,
+        jclass,
+        jlong pyramid) {
+    DestroyImagePyramid(reinterpret_cast<ImagePyramid*>(pyramid));
+}
+
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeGetImagePyramidLevelCount(
+        JNIEnv*,
+        jclass,
+        jlong pyramid) {
+    return reinterpret_cast<ImagePyramid*>(pyramid)->level_count;
+}
+
+/**
+ * Writes the width and height of a level of the pyramid to size.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeGetImagePyramidLevelSize(
+        JNIEnv* env,
+        jclass,
+        jlong pyramid,
+        jint level,
+        jintArray size) {
+    ImagePyramid* image_pyramid = reinterpret_cast<ImagePyramid*>(pyramid);
+    if (level < 0 || level >= image_pyramid->level_count) {
+        return -1;
+    }
+    jint level_size[2] = {image_pyramid->widths[level], image_pyramid->heights[level]};
+    env->SetIntArrayRegion(size, 0, 2, level_size);
+    return 0;
+}
+
+/**
+ * Makes a level of the pyramid write to the given direct ByteBuffer, which the caller keeps
+ * alive for as long as the pyramid.
+ */
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeSetImagePyramidLevel(
+        JNIEnv* env,
+        jclass,
+        jlong pyramid,
+        jint level,
+        jobject buffer) {
+    ImagePyramid* image_pyramid = reinterpret_cast<ImagePyramid*>(pyramid);
+    if (level < 0 || level >= image_pyramid->level_count) {
+        return -1;
+    }
+    uint8_t* buffer_ptr = static_cast<uint8_t*>(env->GetDirectBufferAddress(buffer));
+    if (buffer_ptr == nullptr || env->GetDirectBufferCapacity(buffer)
+            < static_cast<jlong>(image_pyramid->widths[level]) * image_pyramid->heights[level]
+                    * image_pyramid->channels) {
+        return -1;
+    }
+    SetImagePyramidLevel(image_pyramid, level, buffer_ptr);
+    return 0;
+}
+
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeBuildImagePyramid(
+        JNIEnv* env,
+        jclass,
+        jlong pyramid,
+        jobject src,
+        jint src_stride,
+        jint src_pixel_stride,
+        jint width,
+        jint height) {
+    return BuildImagePyramid(reinterpret_cast<ImagePyramid*>(pyramid),
+                             static_cast<uint8_t*>(env->GetDirectBufferAddress(src)),
+                             src_stride,
+                             src_pixel_stride,
+                             width,
+                             height);
+}
+
+JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeRotateYUV(
+        JNIEnv* env,
+        jclass,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_uv,
+        jobject dst_y,
         jint dst_stride_y,
         jint dst_pixel_stride_y,
         jobject dst_u,
@@ -536,114 +1573,30 @@ JNIEXPORT jint Java_androidx_camera_core_ImageProcessingUtil_nativeRotateYUV(
     int rotated_halfwidth = flip_wh ? halfheight : halfwidth;
     int rotated_halfheight = flip_wh ? halfwidth : halfheight;
 
-    int result = 0;
-    const ptrdiff_t vu_off = src_v_ptr - src_u_ptr;
-
-    if (src_pixel_stride_uv == 1) {
-        // I420
-        result = libyuv::I420Rotate(src_y_ptr,
-                                    src_stride_y,
-                                    src_u_ptr,
-                                    src_stride_u,
-                                    src_v_ptr,
-                                    src_stride_v,
-                                    rotated_y_ptr,
-                                    rotated_stride_y,
-                                    rotated_u_ptr,
-                                    rotated_stride_u,
-                                    rotated_v_ptr,
-                                    rotated_stride_v,
-                                    width,
-                                    height,
-                                    mode);
-    } else if (src_pixel_stride_uv == 2 && vu_off == -1 &&
-               src_stride_u == src_stride_v) {
-        // NV21
-        result = libyuv::NV12ToI420Rotate(src_y_ptr,
-                                          src_stride_y,
-                                          src_v_ptr,
-                                          src_stride_v,
-                                          rotated_y_ptr,
-                                          rotated_stride_y,
-                                          rotated_v_ptr,
-                                          rotated_stride_v,
-                                          rotated_u_ptr,
-                                          rotated_stride_u,
-                                          width,
-                                          height,
-                                          mode);
-    } else if (src_pixel_stride_uv == 2 && vu_off == 1 && src_stride_u == src_stride_v) {
-        // NV12
-        result = libyuv::NV12ToI420Rotate(src_y_ptr,
-                                          src_stride_y,
-                                          src_u_ptr,
-                                          src_stride_u,
-                                          rotated_y_ptr,
-                                          rotated_stride_y,
-                                          rotated_u_ptr,
-                                          rotated_stride_u,
-                                          rotated_v_ptr,
-                                          rotated_stride_v,
-                                          width,
-                                          height,
-                                          mode);
-    } else {
-        // General case fallback creates NV12
-        align_buffer_64(plane_uv, halfwidth * 2 * halfheight);
-        uint8_t* dst_uv = plane_uv;
-        for (int y = 0; y < halfheight; y++) {
-            weave_pixels(src_u_ptr, src_v_ptr, src_pixel_stride_uv, dst_uv, halfwidth);
-            src_u_ptr += src_stride_u;
-            src_v_ptr += src_stride_v;
-            dst_uv += halfwidth * 2;
-        }
-
-        result = libyuv::NV12ToI420Rotate(src_y_ptr,
-                                          src_stride_y,
-                                          plane_uv,
-                                          halfwidth * 2,
-                                          rotated_y_ptr,
-                                          rotated_stride_y,
-                                          rotated_u_ptr,
-                                          rotated_stride_u,
-                                          rotated_v_ptr,
-                                          rotated_stride_v,
-                                          width,
-                                          height,
-                                          mode);
-        free_aligned_buffer_64(plane_uv);
-    }
+    int result = Android420RotateToI420(src_y_ptr,
+                                        src_stride_y,
+                                        src_u_ptr,
+                                        src_stride_u,
+                                        src_v_ptr,
+                                        src_stride_v,
+                                        src_pixel_stride_uv,
+                                        rotated_y_ptr,
+                                        rotated_stride_y,
+                                        rotated_u_ptr,
+                                        rotated_stride_u,
+                                        rotated_v_ptr,
+                                        rotated_stride_v,
+                                        width,
+                                        height,
+                                        mode);
 
     if (result == 0) {
-        // Y
-        uint8_t *dst_y = rotated_y_ptr;
-        int rotated_pixel_stride_y = 1;
-        for (int i = 0; i < rotated_height; i++) {
-            for (int j = 0; j < rotated_width; j++) {
-                dst_y_ptr[i * dst_stride_y + j * dst_pixel_stride_y] =
-                        dst_y[i * rotated_stride_y + j * rotated_pixel_stride_y];
-            }
-        }
-
-        // U
-        uint8_t *dst_u = rotated_u_ptr;
-        int rotated_pixel_stride_u = 1;
-        for (int i = 0; i < rotated_halfheight; i++) {
-            for (int j = 0; j < rotated_halfwidth; j++) {
-                dst_u_ptr[i * dst_stride_u + j * dst_pixel_stride_u] =
-                        dst_u[i * rotated_stride_u + j * rotated_pixel_stride_u];
-            }
-        }
-
-        // V
-        uint8_t *dst_v = rotated_v_ptr;
-        int rotated_pixel_stride_v = 1;
-        for (int i = 0; i < rotated_halfheight; i++) {
-            for (int j = 0; j < rotated_halfwidth; j++) {
-                dst_v_ptr[i * dst_stride_v + j * dst_pixel_stride_v] =
-                        dst_v[i * rotated_stride_v + j * rotated_pixel_stride_v];
-            }
-        }
+        CopyPlaneToPixelStride(rotated_y_ptr, rotated_stride_y, dst_y_ptr, dst_stride_y,
+                               dst_pixel_stride_y, rotated_width, rotated_height);
+        CopyPlaneToPixelStride(rotated_u_ptr, rotated_stride_u, dst_u_ptr, dst_stride_u,
+                               dst_pixel_stride_u, rotated_halfwidth, rotated_halfheight);
+        CopyPlaneToPixelStride(rotated_v_ptr, rotated_stride_v, dst_v_ptr, dst_stride_v,
+                               dst_pixel_stride_v, rotated_halfwidth, rotated_halfheight);
     }
 
     return result;
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "image_pyramid.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#define RING_ROWS 5
+
+static int downsampled_size(int size) {
+    return (size + 1) / 2;
+}
+
+ImagePyramid* CreateImagePyramid(int width,
+                                 int height,
+                                 int channels,
+                                 int level_count,
+                                 bool allocate_levels) {
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4 || level_count < 1) {
+        return nullptr;
+    }
+    ImagePyramid* pyramid = static_cast<ImagePyramid*>(calloc(1, sizeof(ImagePyramid)));
+    if (pyramid == nullptr) {
+        return nullptr;
+    }
+    pyramid->channels = channels;
+
+    // All the levels and rings share one allocation.
+    size_t level_offsets[MAX_PYRAMID_LEVELS];
+    size_t ring_offsets[MAX_PYRAMID_LEVELS];
+    size_t size = 0;
+    int level_width = width;
+    int level_height = height;
+    int count = 0;
+    while (count < std::min(level_count, MAX_PYRAMID_LEVELS)
+            && downsampled_size(level_width) >= 2 && downsampled_size(level_height) >= 2) {
+        level_width = downsampled_size(level_width);
+        level_height = downsampled_size(level_height);
+        pyramid->widths[count] = level_width;
+        pyramid->heights[count] = level_height;
+        size_t row_size = static_cast<size_t>(level_width) * channels;
+        // Rings are aligned for the vector loads of the vertical filter.
+        ring_offsets[count] = (size + 63) & ~static_cast<size_t>(63);
+        level_offsets[count] = ring_offsets[count] + row_size * RING_ROWS * sizeof(uint16_t);
+        size = level_offsets[count] + (allocate_levels ? row_size * level_height : 0);
+        count++;
+    }
+    if (count == 0) {
+        free(pyramid);
+        return nullptr;
+    }
+    pyramid->level_count = count;
+    pyramid->memory = static_cast<uint8_t*>(malloc(size));
+    if (pyramid->memory == nullptr) {
+        free(pyramid);
+        return nullptr;
+    }
+    for (int i = 0; i < count; i++) {
+        pyramid->rings[i] = reinterpret_cast<uint16_t*>(pyramid->memory + ring_offsets[i]);
+        pyramid->levels[i] = allocate_levels ? pyramid->memory + level_offsets[i] : nullptr;
+    }
+    return pyramid;
+}
+
+void SetImagePyramidLevel(ImagePyramid* pyramid, int level, uint8_t* memory) {
+    pyramid->levels[level] = memory;
+}
+
+void DestroyImagePyramid(ImagePyramid* pyramid) {
+    if (pyramid != nullptr) {
+        free(pyramid->memory);
+        free(pyramid);
+    }
+}
+
+// Filters a row horizontally with [1 4 6 4 1] and keeps every other pixel. Edge pixels are
+// replicated.
+template <int channels>
+static void filter_row(const uint8_t* __restrict__ src,
+                       int src_pixel_stride,
+                       int src_width,
+                       uint16_t* __restrict__ dst,
+                       int dst_width) {
+    auto at = [&](int x, int c) -> uint16_t {
+        x = std::max(0, std::min(x, src_width - 1));
+        return src[x * src_pixel_stride + c];
+    };
+    auto filter_clamped = [&](int x) {
+        for (int c = 0; c < channels; c++) {
+            dst[x * channels + c] = static_cast<uint16_t>(
+                    at(2 * x - 2, c) + 4 * at(2 * x - 1, c) + 6 * at(2 * x, c)
+                    + 4 * at(2 * x + 1, c) + at(2 * x + 2, c));
+        }
+    };
+
+    // Interior pixels have all their taps in the row and take the branch free loop.
+    int interior_end = std::max(1, std::min(dst_width, (src_width - 3) / 2 + 1));
+    filter_clamped(0);
+    for (int x = 1; x < interior_end; x++) {
+        const uint8_t* p = src + (2 * x) * src_pixel_stride;
+        for (int c = 0; c < channels; c++) {
+            dst[x * channels + c] = static_cast<uint16_t>(
+                    p[c - 2 * src_pixel_stride] + 4 * p[c - src_pixel_stride] + 6 * p[c]
+                    + 4 * p[c + src_pixel_stride] + p[c + 2 * src_pixel_stride]);
+        }
+    }
+    for (int x = interior_end; x < dst_width; x++) {
+        filter_clamped(x);
+    }
+}
+
+// Filters five horizontally filtered rows vertically with [1 4 6 4 1] and normalizes.
+static void filter_column(const uint16_t* __restrict__ r0,
+                          const uint16_t* __restrict__ r1,
+                          const uint16_t* __restrict__ r2,
+                          const uint16_t* __restrict__ r3,
+                          const uint16_t* __restrict__ r4,
+                          uint8_t* __restrict__ dst,
+                          int count) {
+    for (int i = 0; i < count; i++) {
+        uint32_t sum = r0[i] + 4u * r1[i] + 6u * r2[i] + 4u * r3[i] + r4[i];
+        dst[i] = static_cast<uint8_t>((sum + 128) >> 8);
+    }
+}
+
+static void push_row(ImagePyramid* pyramid,
+                     int level,
+                     const uint8_t* row,
+                     int pixel_stride,
+                     int input_width,
+                     int input_height);
+
+// Emits the output rows of a level whose five input rows have arrived.
+static void emit_rows(ImagePyramid* pyramid, int level, int input_height) {
+    int width = pyramid->widths[level];
+    int height = pyramid->heights[level];
+    int channels = pyramid->channels;
+    size_t row_size = static_cast<size_t>(width) * channels;
+    uint16_t* ring = pyramid->rings[level];
+    int last_in = pyramid->rows_in[level] - 1;
+    while (pyramid->rows_out[level] < height) {
+        int y = pyramid->rows_out[level];
+        int needed = std::min(2 * y + 2, input_height - 1);
+        if (needed > last_in) {
+            return;
+        }
+        const uint16_t* taps[RING_ROWS];
+        for (int i = 0; i < RING_ROWS; i++) {
+            int input_row = std::max(0, std::min(2 * y - 2 + i, input_height - 1));
+            taps[i] = ring + (input_row % RING_ROWS) * row_size;
+        }
+        uint8_t* dst = pyramid->levels[level] + y * row_size;
+        filter_column(taps[0], taps[1], taps[2], taps[3], taps[4], dst,
+                      static_cast<int>(row_size));
+        pyramid->rows_out[level]++;
+        if (level + 1 < pyramid->level_count) {
+            push_row(pyramid, level + 1, dst, channels, width, height);
+        }
+    }
+}
+
+static void push_row(ImagePyramid* pyramid,
+                     int level,
+                     const uint8_t* row,
+                     int pixel_stride,
+                     int input_width,
+                     int input_height) {
+    int width = pyramid->widths[level];
+    uint16_t* ring_row = pyramid->rings[level]
+            + (pyramid->rows_in[level] % RING_ROWS) * static_cast<size_t>(width)
+                    * pyramid->channels;
+    switch (pyramid->channels) {
+        case 1:
+            filter_row<1>(row, pixel_stride, input_width, ring_row, width);
+            break;
+        case 2:
+            filter_row<2>(row, pixel_stride, input_width, ring_row, width);
+            break;
+        case 3:
+            filter_row<3>(row, pixel_stride, input_width, ring_row, width);
+            break;
+        default:
+            filter_row<4>(row, pixel_stride, input_width, ring_row, width);
+            break;
+    }
+    pyramid->rows_in[level]++;
+    emit_rows(pyramid, level, input_height);
+}
+
+int BuildImagePyramid(ImagePyramid* pyramid,
+                      const uint8_t* src,
+                      int src_stride,
+                      int src_pixel_stride,
+                      int width,
+                      int height) {
+    if (downsampled_size(width) != pyramid->widths[0]
+            || downsampled_size(height) != pyramid->heights[0]
+            || src_pixel_stride < pyramid->channels) {
+        return -1;
+    }
+    for (int i = 0; i < pyramid->level_count; i++) {
+        if (pyramid->levels[i] == nullptr) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < pyramid->level_count; i++) {
+        pyramid->rows_in[i] = 0;
+        pyramid->rows_out[i] = 0;
+    }
+    for (int y = 0; y < height; y++) {
+        push_row(pyramid, 0, src + y * src_stride, src_pixel_stride, width, height);
+    }
+    return 0;
+}
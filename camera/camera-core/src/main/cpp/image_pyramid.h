@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAMERA_CORE_IMAGE_PYRAMID_H
+#define CAMERA_CORE_IMAGE_PYRAMID_H
+
+#include <cstdint>
+
+#define MAX_PYRAMID_LEVELS 16
+
+/**
+ * Buffers of a Gaussian pyramid, allocated once for a stream and reused for every frame.
+ *
+ * <p>Level i is the source downsampled by 2^(i + 1) with the 5-tap [1 4 6 4 1] / 16 kernel in
+ * both directions. Levels are tightly packed with channels interleaved.
+ */
+struct ImagePyramid {
+    int level_count;
+    int channels;
+    int widths[MAX_PYRAMID_LEVELS];
+    int heights[MAX_PYRAMID_LEVELS];
+    uint8_t* levels[MAX_PYRAMID_LEVELS];
+    // Horizontally filtered input rows of every level, 5 rows each.
+    uint16_t* rings[MAX_PYRAMID_LEVELS];
+    // Input rows received and output rows produced by every level for the current frame.
+    int rows_in[MAX_PYRAMID_LEVELS];
+    int rows_out[MAX_PYRAMID_LEVELS];
+    uint8_t* memory;
+};
+
+/**
+ * Creates the buffers of a pyramid of level_count levels for frames of the given size with 1
+ * to 4 interleaved channels. Levels stop before the frame would become smaller than 2x2 pixels.
+ * If allocate_levels is false, the memory of every level must be given with
+ * SetImagePyramidLevel before building. Returns nullptr if the arguments are invalid or the
+ * memory cannot be allocated.
+ */
+ImagePyramid* CreateImagePyramid(int width,
+                                 int height,
+                                 int channels,
+                                 int level_count,
+                                 bool allocate_levels);
+
+/**
+ * Makes a level of a pyramid created without allocate_levels write to the given memory, which
+ * must hold widths[level] * heights[level] * channels bytes and outlive the builds.
+ */
+void SetImagePyramidLevel(ImagePyramid* pyramid, int level, uint8_t* memory);
+
+void DestroyImagePyramid(ImagePyramid* pyramid);
+
+/**
+ * Builds every level from a frame in one streaming pass. Every row of the source is read once
+ * and every downsampled row is fed to the next level as soon as it is produced, so a level is
+ * built while its input is still in the cache. src_pixel_stride is the distance in bytes between
+ * the pixels of a row. Returns 0 on success, or -1 if the memory of a level is missing.
+ */
+int BuildImagePyramid(ImagePyramid* pyramid,
+                      const uint8_t* src,
+                      int src_stride,
+                      int src_pixel_stride,
+                      int width,
+                      int height);
+
+#endif  // CAMERA_CORE_IMAGE_PYRAMID_H
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "luma_statistics.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Consecutive pixels often have the same value, which serializes the increments of a single
+// histogram on the same counter. Interleaved samples go to separate sub-histograms instead.
+#define SUB_HISTOGRAM_COUNT 4
+
+// Accumulates the Laplacian of the samples of one row. The loop has no branches so it is
+// vectorized by the compiler.
+static void accumulate_laplacian_row(const uint8_t* __restrict__ row,
+                                     int row_stride,
+                                     int pixel_stride,
+                                     int sample_stride,
+                                     int count,
+                                     int64_t* sum,
+                                     uint64_t* sum_squares) {
+    const uint8_t* above = row - row_stride;
+    const uint8_t* below = row + row_stride;
+    // The response of 8-bit input is within [-1020, 1020], so a row sum fits in 32 bits for
+    // every realistic width and the squares are summed in 64 bits.
+    int32_t row_sum = 0;
+    uint64_t row_sum_squares = 0;
+    for (int i = 0; i < count; i++) {
+        int offset = i * sample_stride;
+        int32_t laplacian = 4 * row[offset] - row[offset - pixel_stride]
+                - row[offset + pixel_stride] - above[offset] - below[offset];
+        row_sum += laplacian;
+        row_sum_squares += static_cast<uint32_t>(laplacian * laplacian);
+    }
+    *sum += row_sum;
+    *sum_squares += row_sum_squares;
+}
+
+static void accumulate_histogram_row(const uint8_t* row,
+                                     int sample_stride,
+                                     int count,
+                                     uint32_t (*histograms)[LUMA_HISTOGRAM_BINS]) {
+    int i = 0;
+    for (; i + SUB_HISTOGRAM_COUNT <= count; i += SUB_HISTOGRAM_COUNT) {
+        histograms[0][row[i * sample_stride]]++;
+        histograms[1][row[(i + 1) * sample_stride]]++;
+        histograms[2][row[(i + 2) * sample_stride]]++;
+        histograms[3][row[(i + 3) * sample_stride]]++;
+    }
+    for (; i < count; i++) {
+        histograms[0][row[i * sample_stride]]++;
+    }
+}
+
+int ComputeLumaStatistics(const uint8_t* src_y,
+                          int src_stride_y,
+                          int src_pixel_stride_y,
+                          int width,
+                          int height,
+                          int roi_left,
+                          int roi_top,
+                          int roi_width,
+                          int roi_height,
+                          int sample_step,
+                          int under_exposed_threshold,
+                          int over_exposed_threshold,
+                          LumaStatistics* stats) {
+    if (src_y == nullptr || stats == nullptr || src_pixel_stride_y <= 0 || sample_step <= 0
+            || roi_left < 0 || roi_top < 0 || roi_width <= 0 || roi_height <= 0
+            || roi_left + roi_width > width || roi_top + roi_height > height) {
+        return -1;
+    }
+
+    uint32_t histograms[SUB_HISTOGRAM_COUNT][LUMA_HISTOGRAM_BINS];
+    memset(histograms, 0, sizeof(histograms));
+    int64_t laplacian_sum = 0;
+    uint64_t laplacian_sum_squares = 0;
+    uint32_t laplacian_count = 0;
+
+    int sample_stride = sample_step * src_pixel_stride_y;
+    int columns = (roi_width + sample_step - 1) / sample_step;
+    // Samples of a row that have all four neighbors within the plane.
+    int first_inner = roi_left == 0 ? 1 : 0;
+    int last_inner = roi_left > width - 2
+            ? -1 : std::min(columns - 1, (width - 2 - roi_left) / sample_step);
+    int inner_columns = std::max(last_inner - first_inner + 1, 0);
+
+    for (int y = roi_top; y < roi_top + roi_height; y += sample_step) {
+        const uint8_t* row = src_y + static_cast<size_t>(y) * src_stride_y
+                + static_cast<size_t>(roi_left) * src_pixel_stride_y;
+        accumulate_histogram_row(row, sample_stride, columns, histograms);
+        if (y > 0 && y < height - 1 && inner_columns > 0) {
+            accumulate_laplacian_row(row + first_inner * sample_stride, src_stride_y,
+                                     src_pixel_stride_y, sample_stride, inner_columns,
+                                     &laplacian_sum, &laplacian_sum_squares);
+            laplacian_count += inner_columns;
+        }
+    }
+
+    // Everything else derives from the histogram.
+    uint64_t sum = 0;
+    uint64_t sum_squares = 0;
+    uint32_t count = 0;
+    uint32_t under_exposed = 0;
+    uint32_t over_exposed = 0;
+    for (int i = 0; i < LUMA_HISTOGRAM_BINS; i++) {
+        uint32_t bin = histograms[0][i] + histograms[1][i] + histograms[2][i] + histograms[3][i];
+        stats->histogram[i] = bin;
+        count += bin;
+        sum += static_cast<uint64_t>(bin) * i;
+        sum_squares += static_cast<uint64_t>(bin) * i * i;
+        if (i <= under_exposed_threshold) {
+            under_exposed += bin;
+        }
+        if (i >= over_exposed_threshold) {
+            over_exposed += bin;
+        }
+    }
+
+    double mean = static_cast<double>(sum) / count;
+    stats->sample_count = count;
+    stats->mean = static_cast<float>(mean);
+    stats->variance = static_cast<float>(static_cast<double>(sum_squares) / count - mean * mean);
+    stats->under_exposed_ratio = static_cast<float>(under_exposed) / count;
+    stats->over_exposed_ratio = static_cast<float>(over_exposed) / count;
+    if (laplacian_count > 0) {
+        double laplacian_mean = static_cast<double>(laplacian_sum) / laplacian_count;
+        stats->sharpness = static_cast<float>(
+                static_cast<double>(laplacian_sum_squares) / laplacian_count
+                - laplacian_mean * laplacian_mean);
+    } else {
+        stats->sharpness = 0.0f;
+    }
+    return 0;
+}
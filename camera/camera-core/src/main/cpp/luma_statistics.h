@@ -0,0 +1,61 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_CORE_LUMA_STATISTICS_H
+#define CAMERA_CORE_LUMA_STATISTICS_H
+
+#include <cstdint>
+
+#define LUMA_HISTOGRAM_BINS 256
+
+struct LumaStatistics {
+    uint32_t histogram[LUMA_HISTOGRAM_BINS];
+    // Number of sampled pixels, i.e. the sum of the histogram.
+    uint32_t sample_count;
+    float mean;
+    float variance;
+    // Variance of the 3x3 Laplacian response. Higher is sharper.
+    float sharpness;
+    // Fraction of the samples at or below the under exposure threshold.
+    float under_exposed_ratio;
+    // Fraction of the samples at or above the over exposure threshold.
+    float over_exposed_ratio;
+};
+
+/**
+ * Computes the statistics of a region of a luma plane in one pass.
+ *
+ * <p>Only every sample_step-th pixel of every sample_step-th row of the ROI is visited. The
+ * Laplacian is taken from the direct neighbors of each sample, so it measures full resolution
+ * detail at any step, and it skips samples on the border of the plane.
+ *
+ * <p>Returns 0 on success and -1 if the parameters are invalid.
+ */
+int ComputeLumaStatistics(const uint8_t* src_y,
+                          int src_stride_y,
+                          int src_pixel_stride_y,
+                          int width,
+                          int height,
+                          int roi_left,
+                          int roi_top,
+                          int roi_width,
+                          int roi_height,
+                          int sample_step,
+                          int under_exposed_threshold,
+                          int over_exposed_threshold,
+                          LumaStatistics* stats);
+
+#endif  // CAMERA_CORE_LUMA_STATISTICS_H
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "motion_detection.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "libyuv/scale.h"
+
+// Sum of absolute differences. Branch free, so it is vectorized to SAD instructions.
+static uint32_t sad_row(const uint8_t* __restrict__ a, const uint8_t* __restrict__ b, int width) {
+    uint32_t sum = 0;
+    for (int i = 0; i < width; i++) {
+        sum += static_cast<uint32_t>(abs(a[i] - b[i]));
+    }
+    return sum;
+}
+
+// Box filters a Y plane with a pixel stride into dst. Frames with a pixel stride of 1 go through
+// the SIMD scaler of libyuv.
+static int downsample(const MotionDetector* detector,
+                      const uint8_t* src_y,
+                      int src_stride_y,
+                      int src_pixel_stride_y,
+                      uint8_t* dst) {
+    int factor = detector->downsample_factor;
+    int dst_width = detector->reference_width;
+    int dst_height = detector->reference_height;
+    if (src_pixel_stride_y == 1) {
+        if (factor == 1) {
+            for (int y = 0; y < dst_height; y++) {
+                memcpy(dst + y * dst_width, src_y + y * src_stride_y, dst_width);
+            }
+            return 0;
+        }
+        return libyuv::ScalePlane(src_y, src_stride_y, dst_width * factor, dst_height * factor,
+                                  dst, dst_width, dst_width, dst_height, libyuv::kFilterBox);
+    }
+
+    int area = factor * factor;
+    for (int y = 0; y < dst_height; y++) {
+        uint8_t* dst_row = dst + y * dst_width;
+        for (int x = 0; x < dst_width; x++) {
+            const uint8_t* src = src_y + y * factor * src_stride_y
+                    + x * factor * src_pixel_stride_y;
+            int sum = 0;
+            for (int j = 0; j < factor; j++) {
+                for (int i = 0; i < factor; i++) {
+                    sum += src[j * src_stride_y + i * src_pixel_stride_y];
+                }
+            }
+            dst_row[x] = static_cast<uint8_t>((sum + area / 2) / area);
+        }
+    }
+    return 0;
+}
+
+MotionDetector* CreateMotionDetector(int width,
+                                     int height,
+                                     int downsample_factor,
+                                     int tile_size,
+                                     int threshold) {
+    if (width <= 0 || height <= 0 || downsample_factor <= 0 || tile_size <= 0
+            || downsample_factor > width || downsample_factor > height) {
+        return nullptr;
+    }
+    MotionDetector* detector = static_cast<MotionDetector*>(malloc(sizeof(MotionDetector)));
+    if (detector == nullptr) {
+        return nullptr;
+    }
+    detector->width = width;
+    detector->height = height;
+    detector->downsample_factor = downsample_factor;
+    detector->tile_size = tile_size;
+    detector->threshold = threshold;
+    // Trailing pixels that do not fill a block of the box filter are ignored.
+    detector->reference_width = width / downsample_factor;
+    detector->reference_height = height / downsample_factor;
+    detector->tiles_x = (detector->reference_width + tile_size - 1) / tile_size;
+    detector->tiles_y = (detector->reference_height + tile_size - 1) / tile_size;
+    detector->has_reference = false;
+
+    size_t plane_size = static_cast<size_t>(detector->reference_width)
+            * detector->reference_height;
+    detector->reference = static_cast<uint8_t*>(malloc(plane_size));
+    detector->current = static_cast<uint8_t*>(malloc(plane_size));
+    detector->tile_sums = static_cast<uint32_t*>(malloc(detector->tiles_x * sizeof(uint32_t)));
+    if (detector->reference == nullptr || detector->current == nullptr
+            || detector->tile_sums == nullptr) {
+        DestroyMotionDetector(detector);
+        return nullptr;
+    }
+    return detector;
+}
+
+int DetectMotion(MotionDetector* detector,
+                 const uint8_t* src_y,
+                 int src_stride_y,
+                 int src_pixel_stride_y,
+                 bool update_reference,
+                 uint8_t* tile_map,
+                 float* score) {
+    if (src_pixel_stride_y <= 0) {
+        return -1;
+    }
+    int result = downsample(detector, src_y, src_stride_y, src_pixel_stride_y,
+                            detector->current);
+    if (result != 0) {
+        return result;
+    }
+
+    int tile_count = detector->tiles_x * detector->tiles_y;
+    if (!detector->has_reference) {
+        memset(tile_map, 255, tile_count);
+        *score = 1.0f;
+        std::swap(detector->reference, detector->current);
+        detector->has_reference = true;
+        return 0;
+    }
+
+    int tile_size = detector->tile_size;
+    int width = detector->reference_width;
+    int height = detector->reference_height;
+    int moving_tiles = 0;
+    for (int ty = 0; ty < detector->tiles_y; ty++) {
+        int top = ty * tile_size;
+        int bottom = std::min(top + tile_size, height);
+        memset(detector->tile_sums, 0, detector->tiles_x * sizeof(uint32_t));
+        for (int y = top; y < bottom; y++) {
+            const uint8_t* current_row = detector->current + y * width;
+            const uint8_t* reference_row = detector->reference + y * width;
+            for (int tx = 0; tx < detector->tiles_x; tx++) {
+                int left = tx * tile_size;
+                int tile_width = std::min(tile_size, width - left);
+                detector->tile_sums[tx] += sad_row(current_row + left, reference_row + left,
+                                                   tile_width);
+            }
+        }
+        for (int tx = 0; tx < detector->tiles_x; tx++) {
+            int tile_width = std::min(tile_size, width - tx * tile_size);
+            uint32_t area = static_cast<uint32_t>(tile_width * (bottom - top));
+            uint32_t mean = (detector->tile_sums[tx] + area / 2) / area;
+            tile_map[ty * detector->tiles_x + tx] = static_cast<uint8_t>(std::min(mean, 255u));
+            moving_tiles += static_cast<int>(mean) > detector->threshold;
+        }
+    }
+    *score = static_cast<float>(moving_tiles) / tile_count;
+
+    if (update_reference) {
+        std::swap(detector->reference, detector->current);
+    }
+    return 0;
+}
+
+void ResetMotionDetector(MotionDetector* detector) {
+    detector->has_reference = false;
+}
+
+void DestroyMotionDetector(MotionDetector* detector) {
+    if (detector != nullptr) {
+        free(detector->reference);
+        free(detector->current);
+        free(detector->tile_sums);
+        free(detector);
+    }
+}
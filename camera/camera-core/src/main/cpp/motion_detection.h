@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAMERA_CORE_MOTION_DETECTION_H
+#define CAMERA_CORE_MOTION_DETECTION_H
+
+#include <cstdint>
+
+/**
+ * Compares the Y planes of a stream against a downsampled reference frame.
+ *
+ * <p>Frames are box filtered down by downsample_factor, which also removes most of the sensor
+ * noise, and split into tile_size x tile_size tiles of the downsampled frame. The tiles on the
+ * right and bottom edges may be smaller.
+ */
+struct MotionDetector {
+    int width;
+    int height;
+    int downsample_factor;
+    int tile_size;
+    int threshold;
+    // Size of the downsampled frames.
+    int reference_width;
+    int reference_height;
+    int tiles_x;
+    int tiles_y;
+    bool has_reference;
+    uint8_t* reference;
+    uint8_t* current;
+    // Sum of absolute differences of a row of tiles.
+    uint32_t* tile_sums;
+};
+
+/**
+ * Creates a detector for frames of the given size. A tile moves when the mean absolute
+ * difference of its pixels is above threshold. Returns nullptr if the arguments are invalid or
+ * the memory cannot be allocated.
+ */
+MotionDetector* CreateMotionDetector(int width,
+                                     int height,
+                                     int downsample_factor,
+                                     int tile_size,
+                                     int threshold);
+
+/**
+ * Compares the Y plane against the reference.
+ *
+ * <p>tile_map receives the mean absolute difference of every tile, capped at 255, row by row.
+ * score receives the fraction of tiles that move. Without a reference every tile is reported as
+ * moving. The frame becomes the new reference if update_reference is true or there is no
+ * reference yet. Returns 0 on success.
+ */
+int DetectMotion(MotionDetector* detector,
+                 const uint8_t* src_y,
+                 int src_stride_y,
+                 int src_pixel_stride_y,
+                 bool update_reference,
+                 uint8_t* tile_map,
+                 float* score);
+
+/**
+ * Drops the reference, so the next frame becomes the reference.
+ */
+void ResetMotionDetector(MotionDetector* detector);
+
+void DestroyMotionDetector(MotionDetector* detector);
+
+#endif  // CAMERA_CORE_MOTION_DETECTION_H
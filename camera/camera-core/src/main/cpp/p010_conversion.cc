@@ -0,0 +1,257 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "p010_conversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+
+#include "libyuv/convert_argb.h"
+#include "libyuv/convert_from_argb.h"
+#include "libyuv/rotate_argb.h"
+
+#include "half_float.h"
+
+#define CODE_VALUE_COUNT 1024
+
+// Nominal peak luminance of the HLG reference display and the reference white of BT.2408, in
+// nits. Linear outputs are scaled so that the reference white is 1.0.
+#define HLG_PEAK_LUMINANCE 1000.0f
+#define PQ_PEAK_LUMINANCE 10000.0f
+#define REFERENCE_WHITE_LUMINANCE 203.0f
+
+static const libyuv::YuvConstants* get_yuv_constants(HdrColorStandard color_standard) {
+    switch (color_standard) {
+        case HDR_COLOR_STANDARD_BT2020:
+            return &libyuv::kYuv2020Constants;
+        case HDR_COLOR_STANDARD_BT2020_FULL_RANGE:
+            return &libyuv::kYuvV2020Constants;
+        case HDR_COLOR_STANDARD_BT709:
+            return &libyuv::kYuvH709Constants;
+        default:
+            return nullptr;
+    }
+}
+
+// Converts P010 to AR30 (B in the lowest bits) with the given rotation, using the SIMD row
+// functions of libyuv. AR30 pixels are 32 bits, so the ARGB rotation applies to them as is.
+static int P010ToAR30Rotated(const uint8_t* src_y,
+                             int src_stride_y,
+                             const uint8_t* src_uv,
+                             int src_stride_uv,
+                             uint8_t* dst_ar30,
+                             int dst_stride_ar30,
+                             int width,
+                             int height,
+                             libyuv::RotationMode mode,
+                             const libyuv::YuvConstants* yuv_constants) {
+    // libyuv takes the strides of 16 bit planes in elements.
+    const uint16_t* src_y16 = reinterpret_cast<const uint16_t*>(src_y);
+    const uint16_t* src_uv16 = reinterpret_cast<const uint16_t*>(src_uv);
+    if (mode == libyuv::kRotate0) {
+        return libyuv::P010ToAR30Matrix(src_y16, src_stride_y / 2, src_uv16, src_stride_uv / 2,
+                                        dst_ar30, dst_stride_ar30, yuv_constants, width, height);
+    }
+
+    uint8_t* converted = static_cast<uint8_t*>(malloc(static_cast<size_t>(width) * height * 4));
+    if (converted == nullptr) {
+        return -1;
+    }
+    int result = libyuv::P010ToAR30Matrix(src_y16, src_stride_y / 2, src_uv16,
+                                          src_stride_uv / 2, converted, width * 4,
+                                          yuv_constants, width, height);
+    if (result == 0) {
+        result = libyuv::ARGBRotate(converted, width * 4, dst_ar30, dst_stride_ar30, width,
+                                    height, mode);
+    }
+    free(converted);
+    return result;
+}
+
+static float pq_eotf(float signal) {
+    const float m1 = 2610.0f / 16384.0f;
+    const float m2 = 2523.0f / 4096.0f * 128.0f;
+    const float c1 = 3424.0f / 4096.0f;
+    const float c2 = 2413.0f / 4096.0f * 32.0f;
+    const float c3 = 2392.0f / 4096.0f * 32.0f;
+    float p = powf(signal, 1.0f / m2);
+    return powf(std::max(p - c1, 0.0f) / (c2 - c3 * p), 1.0f / m1);
+}
+
+static float hlg_inverse_oetf(float signal) {
+    const float a = 0.17883277f;
+    const float b = 0.28466892f;
+    const float c = 0.55991073f;
+    if (signal <= 0.5f) {
+        return signal * signal / 3.0f;
+    }
+    return (expf((signal - c) / a) + b) / 12.0f;
+}
+
+// Lookup tables from 10 bit code values, built once per transfer.
+static std::once_flag signal_lut_flag;
+static std::once_flag pq_lut_flag;
+static std::once_flag hlg_lut_flag;
+static uint16_t signal_half_lut[CODE_VALUE_COUNT];
+static uint16_t pq_half_lut[CODE_VALUE_COUNT];
+static float hlg_scene_linear_lut[CODE_VALUE_COUNT];
+// HLG OOTF gain for a quantized scene luminance.
+static float hlg_ootf_gain_lut[CODE_VALUE_COUNT];
+
+static const uint16_t* get_half_lut(HdrTransfer transfer) {
+    if (transfer == HDR_TRANSFER_PQ) {
+        std::call_once(pq_lut_flag, []() {
+            for (int i = 0; i < CODE_VALUE_COUNT; i++) {
+                float linear = pq_eotf(i / 1023.0f) * PQ_PEAK_LUMINANCE;
+                pq_half_lut[i] = float_to_half(linear / REFERENCE_WHITE_LUMINANCE);
+            }
+        });
+        return pq_half_lut;
+    }
+    std::call_once(signal_lut_flag, []() {
+        for (int i = 0; i < CODE_VALUE_COUNT; i++) {
+            signal_half_lut[i] = float_to_half(i / 1023.0f);
+        }
+    });
+    return signal_half_lut;
+}
+
+static void build_hlg_luts() {
+    std::call_once(hlg_lut_flag, []() {
+        // BT.2100 OOTF: Fd = Lw * Ys ^ (gamma - 1) * E, gamma is 1.2 for a 1000 nits display.
+        const float gamma = 1.2f;
+        for (int i = 0; i < CODE_VALUE_COUNT; i++) {
+            hlg_scene_linear_lut[i] = hlg_inverse_oetf(i / 1023.0f);
+            hlg_ootf_gain_lut[i] = HLG_PEAK_LUMINANCE / REFERENCE_WHITE_LUMINANCE
+                    * powf(i / 1023.0f, gamma - 1.0f);
+        }
+    });
+}
+
+#define AR30_B(pixel) ((pixel) & 0x3ff)
+#define AR30_G(pixel) (((pixel) >> 10) & 0x3ff)
+#define AR30_R(pixel) (((pixel) >> 20) & 0x3ff)
+#define HALF_ONE 0x3c00
+
+static void ar30_row_to_f16(const uint32_t* __restrict__ src,
+                            uint16_t* __restrict__ dst,
+                            const uint16_t* __restrict__ lut,
+                            int width) {
+    for (int i = 0; i < width; i++) {
+        uint32_t pixel = src[i];
+        dst[i * 4] = lut[AR30_R(pixel)];
+        dst[i * 4 + 1] = lut[AR30_G(pixel)];
+        dst[i * 4 + 2] = lut[AR30_B(pixel)];
+        dst[i * 4 + 3] = HALF_ONE;
+    }
+}
+
+static void ar30_row_to_f16_hlg(const uint32_t* __restrict__ src,
+                                uint16_t* __restrict__ dst,
+                                int width) {
+    for (int i = 0; i < width; i++) {
+        uint32_t pixel = src[i];
+        float r = hlg_scene_linear_lut[AR30_R(pixel)];
+        float g = hlg_scene_linear_lut[AR30_G(pixel)];
+        float b = hlg_scene_linear_lut[AR30_B(pixel)];
+        // BT.2020 luminance of the scene light.
+        float luminance = 0.2627f * r + 0.6780f * g + 0.0593f * b;
+        int index = std::min(static_cast<int>(luminance * 1023.0f + 0.5f), 1023);
+        float gain = hlg_ootf_gain_lut[index];
+        dst[i * 4] = float_to_half(r * gain);
+        dst[i * 4 + 1] = float_to_half(g * gain);
+        dst[i * 4 + 2] = float_to_half(b * gain);
+        dst[i * 4 + 3] = HALF_ONE;
+    }
+}
+
+int P010ToRGBA1010102(const uint8_t* src_y,
+                      int src_stride_y,
+                      const uint8_t* src_uv,
+                      int src_stride_uv,
+                      uint8_t* dst_rgba,
+                      int dst_stride_rgba,
+                      int width,
+                      int height,
+                      libyuv::RotationMode mode,
+                      HdrColorStandard color_standard) {
+    const libyuv::YuvConstants* yuv_constants = get_yuv_constants(color_standard);
+    if (yuv_constants == nullptr) {
+        return -1;
+    }
+    int result = P010ToAR30Rotated(src_y, src_stride_y, src_uv, src_stride_uv, dst_rgba,
+                                   dst_stride_rgba, width, height, mode, yuv_constants);
+    if (result != 0) {
+        return result;
+    }
+
+    // Swap R and B in place to get the Android channel order.
+    bool flip_wh = mode == libyuv::kRotate90 || mode == libyuv::kRotate270;
+    return libyuv::AR30ToAB30(dst_rgba, dst_stride_rgba, dst_rgba, dst_stride_rgba,
+                              flip_wh ? height : width, flip_wh ? width : height);
+}
+
+int P010ToRGBAF16(const uint8_t* src_y,
+                  int src_stride_y,
+                  const uint8_t* src_uv,
+                  int src_stride_uv,
+                  uint8_t* dst_rgba,
+                  int dst_stride_rgba,
+                  int width,
+                  int height,
+                  libyuv::RotationMode mode,
+                  HdrColorStandard color_standard,
+                  HdrTransfer transfer) {
+    const libyuv::YuvConstants* yuv_constants = get_yuv_constants(color_standard);
+    if (yuv_constants == nullptr || transfer < HDR_TRANSFER_NONE || transfer > HDR_TRANSFER_PQ) {
+        return -1;
+    }
+    bool flip_wh = mode == libyuv::kRotate90 || mode == libyuv::kRotate270;
+    int dst_width = flip_wh ? height : width;
+    int dst_height = flip_wh ? width : height;
+
+    // The matrix is applied by libyuv into 10 bit AR30, then code values are expanded to half
+    // floats through a lookup table that also folds in the transfer function.
+    uint32_t* ar30 = static_cast<uint32_t*>(
+            malloc(static_cast<size_t>(dst_width) * dst_height * sizeof(uint32_t)));
+    if (ar30 == nullptr) {
+        return -1;
+    }
+    int result = P010ToAR30Rotated(src_y, src_stride_y, src_uv, src_stride_uv,
+                                   reinterpret_cast<uint8_t*>(ar30), dst_width * 4, width,
+                                   height, mode, yuv_constants);
+    if (result == 0) {
+        const uint16_t* half_lut = nullptr;
+        if (transfer == HDR_TRANSFER_HLG) {
+            build_hlg_luts();
+        } else {
+            half_lut = get_half_lut(transfer);
+        }
+        for (int y = 0; y < dst_height; y++) {
+            const uint32_t* src_row = ar30 + static_cast<size_t>(y) * dst_width;
+            uint16_t* dst_row = reinterpret_cast<uint16_t*>(dst_rgba + y * dst_stride_rgba);
+            if (half_lut != nullptr) {
+                ar30_row_to_f16(src_row, dst_row, half_lut, dst_width);
+            } else {
+                ar30_row_to_f16_hlg(src_row, dst_row, dst_width);
+            }
+        }
+    }
+    free(ar30);
+    return result;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_CORE_P010_CONVERSION_H
+#define CAMERA_CORE_P010_CONVERSION_H
+
+#include <cstdint>
+
+#include "libyuv/rotate.h"
+
+// Values must match the HDR_COLOR_STANDARD_* constants in ImageProcessingUtil.java.
+enum HdrColorStandard {
+    // BT.2020 matrix, limited range. What camera HDR streams produce.
+    HDR_COLOR_STANDARD_BT2020 = 0,
+    // BT.2020 matrix, full range.
+    HDR_COLOR_STANDARD_BT2020_FULL_RANGE = 1,
+    // BT.709 matrix, limited range.
+    HDR_COLOR_STANDARD_BT709 = 2,
+};
+
+// Values must match the HDR_TRANSFER_* constants in ImageProcessingUtil.java.
+enum HdrTransfer {
+    // Output keeps the encoded signal values, i.e. the transfer of the source.
+    HDR_TRANSFER_NONE = 0,
+    // Source is HLG (ARIB STD-B67). RGBA_F16 output is linearized.
+    HDR_TRANSFER_HLG = 1,
+    // Source is PQ (SMPTE ST 2084). RGBA_F16 output is linearized.
+    HDR_TRANSFER_PQ = 2,
+};
+
+/**
+ * Converts P010 to RGBA_1010102 (R in the lowest bits) with the given rotation.
+ *
+ * <p>Width and height are the source size and strides are in bytes. The output keeps the 10 bits
+ * of the source and the encoded signal values, so it has to be tagged with the dataspace of the
+ * source. Returns 0 on success.
+ */
+int P010ToRGBA1010102(const uint8_t* src_y,
+                      int src_stride_y,
+                      const uint8_t* src_uv,
+                      int src_stride_uv,
+                      uint8_t* dst_rgba,
+                      int dst_stride_rgba,
+                      int width,
+                      int height,
+                      libyuv::RotationMode mode,
+                      HdrColorStandard color_standard);
+
+/**
+ * Converts P010 to RGBA_F16 with the given rotation.
+ *
+ * <p>Width and height are the source size and strides are in bytes. With HDR_TRANSFER_NONE the
+ * output holds the encoded signal in [0, 1]. With HLG or PQ it is linear light with BT.2020
+ * primaries where 1.0 is the 203 nits reference white of BT.2408, i.e. extended range like
+ * scRGB. Returns 0 on success.
+ */
+int P010ToRGBAF16(const uint8_t* src_y,
+                  int src_stride_y,
+                  const uint8_t* src_uv,
+                  int src_stride_uv,
+                  uint8_t* dst_rgba,
+                  int dst_stride_rgba,
+                  int width,
+                  int height,
+                  libyuv::RotationMode mode,
+                  HdrColorStandard color_standard,
+                  HdrTransfer transfer);
+
+#endif  // CAMERA_CORE_P010_CONVERSION_H
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pixel_copy.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "libyuv/convert_argb.h"
+#include "libyuv/convert_from_argb.h"
+#include "libyuv/planar_functions.h"
+#include "libyuv/rotate_argb.h"
+
+// Source rows converted at once. A strip of a 4000 pixel wide frame is 256KB of ARGB.
+#define STRIP_ROWS 16
+
+// Strips are held as libyuv ARGB, i.e. B, G, R, A bytes, since every libyuv conversion has it as
+// input or output. Byte offset of the R, G, B and A channels in an ARGB pixel.
+static const int kArgbChannelOffsets[4] = {2, 1, 0, 3};
+
+int GetPixelFormatBytes(PixelFormat format) {
+    switch (format) {
+        case PIXEL_FORMAT_RGBA_8888:
+            return 4;
+        case PIXEL_FORMAT_RGB_565:
+            return 2;
+        case PIXEL_FORMAT_RGB_888:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+static int to_argb(const uint8_t* src, int src_stride, PixelFormat format, uint8_t* dst_argb,
+                   int dst_stride_argb, int width, int height) {
+    switch (format) {
+        case PIXEL_FORMAT_RGBA_8888:
+            return libyuv::ABGRToARGB(src, src_stride, dst_argb, dst_stride_argb, width, height);
+        case PIXEL_FORMAT_RGB_565:
+            return libyuv::RGB565ToARGB(src, src_stride, dst_argb, dst_stride_argb, width,
+                                        height);
+        case PIXEL_FORMAT_RGB_888:
+            return libyuv::RAWToARGB(src, src_stride, dst_argb, dst_stride_argb, width, height);
+        default:
+            return -1;
+    }
+}
+
+static int from_argb(const uint8_t* src_argb, int src_stride_argb, uint8_t* dst, int dst_stride,
+                     PixelFormat format, int width, int height) {
+    switch (format) {
+        case PIXEL_FORMAT_RGBA_8888:
+            return libyuv::ARGBToABGR(src_argb, src_stride_argb, dst, dst_stride, width, height);
+        case PIXEL_FORMAT_RGB_565:
+            return libyuv::ARGBToRGB565(src_argb, src_stride_argb, dst, dst_stride, width,
+                                        height);
+        case PIXEL_FORMAT_RGB_888:
+            return libyuv::ARGBToRAW(src_argb, src_stride_argb, dst, dst_stride, width, height);
+        default:
+            return -1;
+    }
+}
+
+// Builds the ARGBShuffle mask for a channel order. Returns false for an invalid order.
+static bool build_shuffler(const int* channel_order, uint8_t* shuffler) {
+    for (int channel = 0; channel < 4; channel++) {
+        if (channel_order[channel] < 0 || channel_order[channel] > 3) {
+            return false;
+        }
+        for (int pixel = 0; pixel < 4; pixel++) {
+            shuffler[pixel * 4 + kArgbChannelOffsets[channel]] = static_cast<uint8_t>(
+                    pixel * 4 + kArgbChannelOffsets[channel_order[channel]]);
+        }
+    }
+    return true;
+}
+
+int ConvertPixels(const uint8_t* src,
+                  int src_stride,
+                  PixelFormat src_format,
+                  int crop_left,
+                  int crop_top,
+                  int crop_width,
+                  int crop_height,
+                  uint8_t* dst,
+                  int dst_stride,
+                  PixelFormat dst_format,
+                  libyuv::RotationMode mode,
+                  AlphaOp alpha_op,
+                  const int* channel_order) {
+    int src_bytes = GetPixelFormatBytes(src_format);
+    int dst_bytes = GetPixelFormatBytes(dst_format);
+    if (src_bytes == 0 || dst_bytes == 0 || crop_left < 0 || crop_top < 0 || crop_width <= 0
+            || crop_height <= 0 || alpha_op < ALPHA_OP_NONE || alpha_op > ALPHA_OP_UNPREMULTIPLY) {
+        return -1;
+    }
+    uint8_t shuffler[16];
+    if (channel_order != nullptr && !build_shuffler(channel_order, shuffler)) {
+        return -1;
+    }
+    src += crop_top * src_stride + crop_left * src_bytes;
+
+    // Plain copies skip the strips.
+    if (src_format == dst_format && mode == libyuv::kRotate0 && alpha_op == ALPHA_OP_NONE
+            && channel_order == nullptr) {
+        libyuv::CopyPlane(src, src_stride, dst, dst_stride, crop_width * src_bytes, crop_height);
+        return 0;
+    }
+
+    int strip_stride = crop_width * 4;
+    bool rotate = mode != libyuv::kRotate0;
+    uint8_t* strip = static_cast<uint8_t*>(
+            malloc(static_cast<size_t>(strip_stride) * STRIP_ROWS * (rotate ? 2 : 1)));
+    if (strip == nullptr) {
+        return -1;
+    }
+    uint8_t* rotated_strip = strip + strip_stride * STRIP_ROWS;
+
+    int result = 0;
+    for (int y = 0; y < crop_height && result == 0; y += STRIP_ROWS) {
+        int rows = std::min(STRIP_ROWS, crop_height - y);
+        result = to_argb(src + y * src_stride, src_stride, src_format, strip, strip_stride,
+                         crop_width, rows);
+        if (result == 0 && channel_order != nullptr) {
+            result = libyuv::ARGBShuffle(strip, strip_stride, strip, strip_stride, shuffler,
+                                         crop_width, rows);
+        }
+        if (result == 0 && alpha_op == ALPHA_OP_PREMULTIPLY) {
+            result = libyuv::ARGBAttenuate(strip, strip_stride, strip, strip_stride, crop_width,
+                                           rows);
+        } else if (result == 0 && alpha_op == ALPHA_OP_UNPREMULTIPLY) {
+            result = libyuv::ARGBUnattenuate(strip, strip_stride, strip, strip_stride,
+                                             crop_width, rows);
+        }
+        if (result != 0) {
+            break;
+        }
+
+        // Where the strip lands in the rotated output.
+        const uint8_t* out = strip;
+        int out_stride = strip_stride;
+        int out_width = crop_width;
+        int out_height = rows;
+        int out_left = 0;
+        int out_top = y;
+        switch (mode) {
+            case libyuv::kRotate90:
+                out_stride = rows * 4;
+                out_width = rows;
+                out_height = crop_width;
+                out_left = crop_height - y - rows;
+                out_top = 0;
+                break;
+            case libyuv::kRotate180:
+                out_top = crop_height - y - rows;
+                break;
+            case libyuv::kRotate270:
+                out_stride = rows * 4;
+                out_width = rows;
+                out_height = crop_width;
+                out_left = y;
+                out_top = 0;
+                break;
+            default:
+                break;
+        }
+        if (rotate) {
+            result = libyuv::ARGBRotate(strip, strip_stride, rotated_strip, out_stride,
+                                        crop_width, rows, mode);
+            out = rotated_strip;
+        }
+        if (result == 0) {
+            result = from_argb(out, out_stride, dst + out_top * dst_stride + out_left * dst_bytes,
+                               dst_stride, dst_format, out_width, out_height);
+        }
+    }
+    free(strip);
+    return result;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAMERA_CORE_PIXEL_COPY_H
+#define CAMERA_CORE_PIXEL_COPY_H
+
+#include <cstdint>
+
+#include "libyuv/rotate.h"
+
+// Values must match the PIXEL_FORMAT_* constants in ImageProcessingUtil.java.
+enum PixelFormat {
+    // R, G, B, A bytes, like Bitmap.Config.ARGB_8888.
+    PIXEL_FORMAT_RGBA_8888 = 0,
+    // 16 bit little endian with R in the top bits, like Bitmap.Config.RGB_565.
+    PIXEL_FORMAT_RGB_565 = 1,
+    // Packed R, G, B bytes.
+    PIXEL_FORMAT_RGB_888 = 2,
+};
+
+// Values must match the ALPHA_OP_* constants in ImageProcessingUtil.java.
+enum AlphaOp {
+    ALPHA_OP_NONE = 0,
+    // Multiplies the color channels by alpha.
+    ALPHA_OP_PREMULTIPLY = 1,
+    // Divides the color channels by alpha.
+    ALPHA_OP_UNPREMULTIPLY = 2,
+};
+
+/**
+ * Returns the bytes per pixel of the format, or 0 if the format is unknown.
+ */
+int GetPixelFormatBytes(PixelFormat format);
+
+/**
+ * Copies the crop rect of src into dst, converting the format and rotating it clockwise.
+ *
+ * <p>channel_order may be nullptr. Otherwise the output channel i, in R, G, B, A order, takes
+ * the input channel channel_order[i]. The alpha op applies after the channels are reordered.
+ * Formats without alpha read as opaque. dst receives the rotated crop rect. Rows are processed in
+ * strips that stay in the cache, so every pixel is read and written once. Returns 0 on success.
+ */
+int ConvertPixels(const uint8_t* src,
+                  int src_stride,
+                  PixelFormat src_format,
+                  int crop_left,
+                  int crop_top,
+                  int crop_width,
+                  int crop_height,
+                  uint8_t* dst,
+                  int dst_stride,
+                  PixelFormat dst_format,
+                  libyuv::RotationMode mode,
+                  AlphaOp alpha_op,
+                  const int* channel_order);
+
+#endif  // CAMERA_CORE_PIXEL_COPY_H
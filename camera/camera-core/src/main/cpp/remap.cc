@@ -0,0 +1,339 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "remap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Destination tiles are warped as a unit so the source rows they read stay in the cache.
+#define TILE_SIZE 64
+#define FRACTION_BITS 7
+#define FRACTION_ONE (1 << FRACTION_BITS)
+
+// Maps a destination pixel to the undistorted source position.
+static void transform(const float* matrix, float x, float y, float* src_x, float* src_y) {
+    float w = matrix[6] * x + matrix[7] * y + matrix[8];
+    *src_x = (matrix[0] * x + matrix[1] * y + matrix[2]) / w;
+    *src_y = (matrix[3] * x + matrix[4] * y + matrix[5]) / w;
+}
+
+// Applies the lens distortion model of CameraCharacteristics.LENS_DISTORTION.
+static void distort(const float* intrinsics, const float* distortion, float* x, float* y) {
+    float fx = intrinsics[0];
+    float fy = intrinsics[1];
+    float cx = intrinsics[2];
+    float cy = intrinsics[3];
+    float s = intrinsics[4];
+    float yi = (*y - cy) / fy;
+    float xi = (*x - cx - s * yi) / fx;
+    float r2 = xi * xi + yi * yi;
+    float radial = 1.0f + r2 * (distortion[0] + r2 * (distortion[1] + r2 * distortion[2]));
+    float xc = xi * radial + distortion[3] * 2.0f * xi * yi
+            + distortion[4] * (r2 + 2.0f * xi * xi);
+    float yc = yi * radial + distortion[4] * 2.0f * xi * yi
+            + distortion[3] * (r2 + 2.0f * yi * yi);
+    *x = fx * xc + s * yc + cx;
+    *y = fy * yc + cy;
+}
+
+// Splits a coordinate into an integer part in [0, size - 2] and a fraction in [0, 1], so the
+// right neighbor is always in the source and the last pixel is sampled exactly.
+static void to_fixed(float value, int size, uint16_t* integer, uint8_t* fraction) {
+    int fixed = static_cast<int>(lroundf(value * FRACTION_ONE));
+    fixed = std::max(0, std::min(fixed, (size - 1) * FRACTION_ONE));
+    int whole = std::min(fixed >> FRACTION_BITS, size - 2);
+    *integer = static_cast<uint16_t>(whole);
+    *fraction = static_cast<uint8_t>(fixed - (whole << FRACTION_BITS));
+}
+
+// Fills the entries of a table for planes subsampled by scale. Pixel centers are at +0.5.
+static void build_entries(const float* matrix,
+                          const float* intrinsics,
+                          const float* distortion,
+                          int scale,
+                          int src_width,
+                          int src_height,
+                          int dst_width,
+                          int dst_height,
+                          RemapEntry* entries) {
+    for (int y = 0; y < dst_height; y++) {
+        for (int x = 0; x < dst_width; x++) {
+            float src_x;
+            float src_y;
+            transform(matrix, (x + 0.5f) * scale, (y + 0.5f) * scale, &src_x, &src_y);
+            if (intrinsics != nullptr) {
+                distort(intrinsics, distortion, &src_x, &src_y);
+            }
+            RemapEntry* entry = &entries[y * dst_width + x];
+            to_fixed(src_x / scale - 0.5f, src_width, &entry->x, &entry->fraction_x);
+            to_fixed(src_y / scale - 0.5f, src_height, &entry->y, &entry->fraction_y);
+        }
+    }
+}
+
+// One warp of a plane, split between the calling thread and the workers by rows of tiles.
+struct RemapJob {
+    void (*run)(const RemapJob& job, int first_tile_row, int tile_row_step);
+    const RemapEntry* entries;
+    int width;
+    int height;
+    const uint8_t* src;
+    int src_stride;
+    int src_pixel_stride;
+    uint8_t* dst;
+    int dst_stride;
+    int dst_pixel_stride;
+    int thread_count;
+};
+
+// Threads started with a table and woken for every warp, instead of creating threads per plane.
+struct RemapWorkers {
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    std::vector<std::thread> threads;
+    const RemapJob* job = nullptr;
+    // Incremented for every job, so that each worker runs it once.
+    uint64_t generation = 0;
+    // Workers that have not finished the current job.
+    int busy_count = 0;
+    bool quit = false;
+};
+
+// Worker index is the row of tiles it starts at, the calling thread takes row 0.
+static void run_worker(RemapWorkers* workers, int index) {
+    uint64_t generation = 0;
+    while (true) {
+        const RemapJob* job;
+        {
+            std::unique_lock<std::mutex> lock(workers->mutex);
+            workers->start_condition.wait(lock, [workers, generation]() {
+                return workers->quit || workers->generation != generation;
+            });
+            if (workers->quit) {
+                return;
+            }
+            generation = workers->generation;
+            job = workers->job;
+        }
+        if (index < job->thread_count) {
+            job->run(*job, index, job->thread_count);
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers->mutex);
+            if (--workers->busy_count == 0) {
+                workers->done_condition.notify_one();
+            }
+        }
+    }
+}
+
+static RemapWorkers* create_workers(int count) {
+    RemapWorkers* workers = new RemapWorkers();
+    workers->threads.reserve(count);
+    for (int i = 0; i < count; i++) {
+        workers->threads.emplace_back(run_worker, workers, i + 1);
+    }
+    return workers;
+}
+
+static void destroy_workers(RemapWorkers* workers) {
+    if (workers == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers->mutex);
+        workers->quit = true;
+    }
+    workers->start_condition.notify_all();
+    for (std::thread& thread : workers->threads) {
+        thread.join();
+    }
+    delete workers;
+}
+
+RemapTable* CreateRemapTable(int src_width,
+                             int src_height,
+                             int dst_width,
+                             int dst_height,
+                             const float* matrix,
+                             const float* intrinsics,
+                             const float* distortion,
+                             int thread_count) {
+    // Chroma planes need at least 2x2 pixels for the bilinear sampling, and coordinates are 16
+    // bits.
+    if (src_width < 4 || src_height < 4 || src_width > UINT16_MAX || src_height > UINT16_MAX
+            || dst_width < 2 || dst_height < 2 || thread_count < 1
+            || (intrinsics != nullptr && (distortion == nullptr || intrinsics[0] == 0.0f
+                    || intrinsics[1] == 0.0f))) {
+        return nullptr;
+    }
+    RemapTable* table = static_cast<RemapTable*>(malloc(sizeof(RemapTable)));
+    if (table == nullptr) {
+        return nullptr;
+    }
+    table->src_width = src_width;
+    table->src_height = src_height;
+    table->dst_width = dst_width;
+    table->dst_height = dst_height;
+    table->thread_count = thread_count;
+    table->workers = nullptr;
+    table->entries = static_cast<RemapEntry*>(
+            malloc(static_cast<size_t>(dst_width) * dst_height * sizeof(RemapEntry)));
+    table->chroma_entries = static_cast<RemapEntry*>(
+            malloc(static_cast<size_t>((dst_width + 1) / 2) * ((dst_height + 1) / 2)
+                    * sizeof(RemapEntry)));
+    if (table->entries == nullptr || table->chroma_entries == nullptr) {
+        DestroyRemapTable(table);
+        return nullptr;
+    }
+
+    build_entries(matrix, intrinsics, distortion, 1, src_width, src_height, dst_width, dst_height,
+                  table->entries);
+    build_entries(matrix, intrinsics, distortion, 2, (src_width + 1) / 2, (src_height + 1) / 2,
+                  (dst_width + 1) / 2, (dst_height + 1) / 2, table->chroma_entries);
+    if (thread_count > 1) {
+        table->workers = create_workers(thread_count - 1);
+    }
+    return table;
+}
+
+void DestroyRemapTable(RemapTable* table) {
+    if (table != nullptr) {
+        destroy_workers(table->workers);
+        free(table->entries);
+        free(table->chroma_entries);
+        free(table);
+    }
+}
+
+// Bilinear sampling in fixed point. Branch free, so the arithmetic is vectorized around the
+// gathers of the four neighbors.
+template <int channels>
+static void remap_row(const RemapEntry* __restrict__ entries,
+                      const uint8_t* __restrict__ src,
+                      int src_stride,
+                      int src_pixel_stride,
+                      uint8_t* __restrict__ dst,
+                      int dst_pixel_stride,
+                      int width) {
+    for (int i = 0; i < width; i++) {
+        RemapEntry entry = entries[i];
+        const uint8_t* top = src + entry.y * src_stride + entry.x * src_pixel_stride;
+        const uint8_t* bottom = top + src_stride;
+        int fraction_x = entry.fraction_x;
+        int fraction_y = entry.fraction_y;
+        for (int c = 0; c < channels; c++) {
+            int upper = (top[c] << FRACTION_BITS)
+                    + (top[c + src_pixel_stride] - top[c]) * fraction_x;
+            int lower = (bottom[c] << FRACTION_BITS)
+                    + (bottom[c + src_pixel_stride] - bottom[c]) * fraction_x;
+            int value = (upper << FRACTION_BITS) + (lower - upper) * fraction_y;
+            dst[i * dst_pixel_stride + c] = static_cast<uint8_t>(
+                    (value + (1 << (2 * FRACTION_BITS - 1))) >> (2 * FRACTION_BITS));
+        }
+    }
+}
+
+template <int channels>
+static void remap_tiles(const RemapJob& job, int first_tile_row, int tile_row_step) {
+    for (int tile_top = first_tile_row * TILE_SIZE; tile_top < job.height;
+            tile_top += tile_row_step * TILE_SIZE) {
+        int tile_bottom = std::min(tile_top + TILE_SIZE, job.height);
+        for (int tile_left = 0; tile_left < job.width; tile_left += TILE_SIZE) {
+            int tile_width = std::min(TILE_SIZE, job.width - tile_left);
+            for (int y = tile_top; y < tile_bottom; y++) {
+                remap_row<channels>(job.entries + y * job.width + tile_left, job.src,
+                                    job.src_stride, job.src_pixel_stride,
+                                    job.dst + y * job.dst_stride
+                                            + tile_left * job.dst_pixel_stride,
+                                    job.dst_pixel_stride, tile_width);
+            }
+        }
+    }
+}
+
+// Warps with the rows of tiles interleaved between the calling thread and the workers.
+template <int channels>
+static void remap(const RemapTable* table,
+                  const RemapEntry* entries,
+                  int width,
+                  int height,
+                  const uint8_t* src,
+                  int src_stride,
+                  int src_pixel_stride,
+                  uint8_t* dst,
+                  int dst_stride,
+                  int dst_pixel_stride) {
+    int tile_rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    RemapJob job = {remap_tiles<channels>, entries, width, height, src, src_stride,
+                    src_pixel_stride, dst, dst_stride, dst_pixel_stride,
+                    std::min(table->thread_count, tile_rows)};
+    RemapWorkers* workers = table->workers;
+    if (workers == nullptr || job.thread_count == 1) {
+        job.run(job, 0, 1);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers->mutex);
+        workers->job = &job;
+        workers->generation++;
+        workers->busy_count = static_cast<int>(workers->threads.size());
+    }
+    workers->start_condition.notify_all();
+    job.run(job, 0, job.thread_count);
+    std::unique_lock<std::mutex> lock(workers->mutex);
+    workers->done_condition.wait(lock, [workers]() { return workers->busy_count == 0; });
+}
+
+int RemapPlane(const RemapTable* table,
+               bool chroma,
+               const uint8_t* src,
+               int src_stride,
+               int src_pixel_stride,
+               uint8_t* dst,
+               int dst_stride,
+               int dst_pixel_stride) {
+    if (src_pixel_stride <= 0 || dst_pixel_stride <= 0) {
+        return -1;
+    }
+    if (chroma) {
+        remap<1>(table, table->chroma_entries, (table->dst_width + 1) / 2,
+                 (table->dst_height + 1) / 2, src, src_stride, src_pixel_stride, dst, dst_stride,
+                 dst_pixel_stride);
+    } else {
+        remap<1>(table, table->entries, table->dst_width, table->dst_height, src, src_stride,
+                 src_pixel_stride, dst, dst_stride, dst_pixel_stride);
+    }
+    return 0;
+}
+
+int RemapRGBA(const RemapTable* table,
+              const uint8_t* src,
+              int src_stride,
+              uint8_t* dst,
+              int dst_stride) {
+    remap<4>(table, table->entries, table->dst_width, table->dst_height, src, src_stride, 4, dst,
+             dst_stride, 4);
+    return 0;
+}
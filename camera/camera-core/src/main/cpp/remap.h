@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CAMERA_CORE_REMAP_H
+#define CAMERA_CORE_REMAP_H
+
+#include <cstdint>
+
+// Source pixel of a destination pixel, in fixed point with 7 fractional bits.
+struct RemapEntry {
+    uint16_t x;
+    uint16_t y;
+    uint8_t fraction_x;
+    uint8_t fraction_y;
+};
+
+// Worker threads of a table, defined in remap.cc.
+struct RemapWorkers;
+
+/**
+ * Source coordinates of every destination pixel, computed once for a camera and crop
+ * configuration.
+ *
+ * <p>There is one table for full resolution planes and one for the chroma planes of YUV 4:2:0
+ * frames. Coordinates outside the source are clamped to the edge. The worker threads are started
+ * with the table and kept until it is destroyed, so warps of the same table must not run
+ * concurrently.
+ */
+struct RemapTable {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    int thread_count;
+    RemapEntry* entries;
+    RemapEntry* chroma_entries;
+    // nullptr if thread_count is 1.
+    RemapWorkers* workers;
+};
+
+/**
+ * Creates a table that maps destination pixels to the source.
+ *
+ * <p>matrix is the 3x3 row major projective transform from destination to source pixel
+ * coordinates. If intrinsics [fx, fy, cx, cy, s] and distortion [k1, k2, k3, p1, p2] are given,
+ * in the convention of CameraCharacteristics and in source pixels, the transformed coordinates
+ * are undistorted coordinates and are distorted into the source, which corrects the lens
+ * distortion. Frames are warped by the calling thread and thread_count - 1 worker threads.
+ * Returns nullptr if the arguments are invalid or the memory cannot be allocated.
+ */
+RemapTable* CreateRemapTable(int src_width,
+                             int src_height,
+                             int dst_width,
+                             int dst_height,
+                             const float* matrix,
+                             const float* intrinsics,
+                             const float* distortion,
+                             int thread_count);
+
+void DestroyRemapTable(RemapTable* table);
+
+/**
+ * Warps an 8-bit plane with bilinear sampling. chroma selects the table of 4:2:0 chroma planes.
+ * Returns 0 on success.
+ */
+int RemapPlane(const RemapTable* table,
+               bool chroma,
+               const uint8_t* src,
+               int src_stride,
+               int src_pixel_stride,
+               uint8_t* dst,
+               int dst_stride,
+               int dst_pixel_stride);
+
+/**
+ * Warps a 4 bytes per pixel frame, like RGBA_8888, with bilinear sampling. Returns 0 on success.
+ */
+int RemapRGBA(const RemapTable* table,
+              const uint8_t* src,
+              int src_stride,
+              uint8_t* dst,
+              int dst_stride);
+
+#endif  // CAMERA_CORE_REMAP_H
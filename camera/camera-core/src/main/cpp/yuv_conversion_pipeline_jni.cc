@@ -0,0 +1,154 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <jni.h>
+
+#include <android/log.h>
+
+#include "conversion_pipeline.h"
+
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "ConversionPipelineJni", __VA_ARGS__)
+
+// Per stage count, total and maximum latency, then the dropped frame count.
+#define STATS_LENGTH (PIPELINE_STAGE_COUNT * 3 + 1)
+
+static ConversionPipeline* get_pipeline(jlong pipeline) {
+    return reinterpret_cast<ConversionPipeline*>(pipeline);
+}
+
+extern "C" {
+JNIEXPORT jlong Java_androidx_camera_core_YuvConversionPipeline_nativeCreate(
+        JNIEnv*,
+        jclass,
+        jint width,
+        jint height,
+        jint rotation,
+        jint capacity) {
+    ConversionPipeline* pipeline = ConversionPipeline::Create(width, height, rotation, capacity);
+    if (pipeline == nullptr) {
+        LOGE("Failed to create the conversion pipeline.");
+    }
+    return reinterpret_cast<jlong>(pipeline);
+}
+
+JNIEXPORT void Java_androidx_camera_core_YuvConversionPipeline_nativeDestroy(
+        JNIEnv*,
+        jclass,
+        jlong pipeline) {
+    delete get_pipeline(pipeline);
+}
+
+JNIEXPORT jint Java_androidx_camera_core_YuvConversionPipeline_nativeGetEventFd(
+        JNIEnv*,
+        jclass,
+        jlong pipeline) {
+    return get_pipeline(pipeline)->event_fd();
+}
+
+JNIEXPORT jobject Java_androidx_camera_core_YuvConversionPipeline_nativeGetOutputBuffer(
+        JNIEnv* env,
+        jclass,
+        jlong pipeline,
+        jint slot) {
+    ConversionPipeline* conversion_pipeline = get_pipeline(pipeline);
+    if (slot < 0 || slot >= conversion_pipeline->capacity()) {
+        return nullptr;
+    }
+    return env->NewDirectByteBuffer(
+            conversion_pipeline->output(slot),
+            static_cast<jlong>(conversion_pipeline->output_stride())
+                    * conversion_pipeline->output_height());
+}
+
+JNIEXPORT jint Java_androidx_camera_core_YuvConversionPipeline_nativeSubmit(
+        JNIEnv* env,
+        jclass,
+        jlong pipeline,
+        jobject src_y,
+        jint src_stride_y,
+        jobject src_u,
+        jint src_stride_u,
+        jobject src_v,
+        jint src_stride_v,
+        jint src_pixel_stride_uv,
+        jlong timestamp_ns) {
+    YuvPlanes src = {static_cast<uint8_t*>(env->GetDirectBufferAddress(src_y)),
+                     src_stride_y,
+                     static_cast<uint8_t*>(env->GetDirectBufferAddress(src_u)),
+                     src_stride_u,
+                     static_cast<uint8_t*>(env->GetDirectBufferAddress(src_v)),
+                     src_stride_v,
+                     src_pixel_stride_uv};
+    return get_pipeline(pipeline)->Submit(src, timestamp_ns);
+}
+
+/**
+ * Acquires the oldest converted frame and writes its slot and timestamp into the output array.
+ * Returns false if no frame is available.
+ */
+JNIEXPORT jboolean Java_androidx_camera_core_YuvConversionPipeline_nativeAcquire(
+        JNIEnv* env,
+        jclass,
+        jlong pipeline,
+        jlongArray frame) {
+    PipelineOutput output;
+    if (!get_pipeline(pipeline)->Acquire(&output)) {
+        return JNI_FALSE;
+    }
+    jlong values[2] = {output.slot, output.timestamp_ns};
+    env->SetLongArrayRegion(frame, 0, 2, values);
+    return JNI_TRUE;
+}
+
+JNIEXPORT void Java_androidx_camera_core_YuvConversionPipeline_nativeRelease(
+        JNIEnv*,
+        jclass,
+        jlong pipeline,
+        jint slot) {
+    get_pipeline(pipeline)->Release(slot);
+}
+
+JNIEXPORT jint Java_androidx_camera_core_YuvConversionPipeline_nativeGetStats(
+        JNIEnv* env,
+        jclass,
+        jlong pipeline,
+        jlongArray stats) {
+    if (env->GetArrayLength(stats) != STATS_LENGTH) {
+        return -1;
+    }
+    PipelineStageStats stage_stats[PIPELINE_STAGE_COUNT];
+    uint64_t dropped_count;
+    get_pipeline(pipeline)->GetStats(stage_stats, &dropped_count);
+
+    jlong values[STATS_LENGTH];
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        values[i * 3] = static_cast<jlong>(stage_stats[i].count);
+        values[i * 3 + 1] = static_cast<jlong>(stage_stats[i].total_ns);
+        values[i * 3 + 2] = static_cast<jlong>(stage_stats[i].max_ns);
+    }
+    values[STATS_LENGTH - 1] = static_cast<jlong>(dropped_count);
+    env->SetLongArrayRegion(stats, 0, STATS_LENGTH, values);
+    return 0;
+}
+
+JNIEXPORT void Java_androidx_camera_core_YuvConversionPipeline_nativeSetPausedForTesting(
+        JNIEnv*,
+        jclass,
+        jlong pipeline,
+        jboolean paused) {
+    get_pipeline(pipeline)->SetPausedForTesting(paused == JNI_TRUE);
+}
+}  // extern "C"
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yuv_kernels.h"
+
+#include <cstddef>
+#include <cstdlib>
+
+#include "libyuv/convert.h"
+#include "libyuv/convert_argb.h"
+#include "libyuv/planar_functions.h"
+
+#define ROTATION_COUNT 4
+#define LAYOUT_COUNT 4
+#define OUTPUT_COUNT 4
+
+static int get_half(int size) {
+    return (size + 1) >> 1;
+}
+
+// Weaves the chroma of an arbitrary layout into NV12.
+static void weave_uv_plane(const YuvPlanes& src, uint8_t* dst_uv, int halfwidth, int halfheight) {
+    const uint8_t* src_u = src.u;
+    const uint8_t* src_v = src.v;
+    for (int y = 0; y < halfheight; y++) {
+        for (int x = 0; x < halfwidth; x++) {
+            dst_uv[x * 2] = src_u[x * src.pixel_stride_uv];
+            dst_uv[x * 2 + 1] = src_v[x * src.pixel_stride_uv];
+        }
+        src_u += src.stride_u;
+        src_v += src.stride_v;
+        dst_uv += halfwidth * 2;
+    }
+}
+
+// Size of the scratch memory of a kernel. The woven chroma comes first, then the rotated I420
+// frame.
+static size_t get_weave_scratch_size(YuvLayout layout, int width, int height) {
+    return layout == YUV_LAYOUT_ANDROID420
+            ? static_cast<size_t>(get_half(width)) * 2 * get_half(height) : 0;
+}
+
+static size_t get_scratch_size(YuvLayout layout,
+                               YuvKernelOutput output,
+                               int width,
+                               int height,
+                               int rotation) {
+    size_t i420_size = 0;
+    if (output == YUV_KERNEL_OUTPUT_ABGR ? rotation != 0 : output != YUV_KERNEL_OUTPUT_I420) {
+        // Chroma, and luma for ABGR, goes through an I420 frame before the final write.
+        size_t chroma_size = static_cast<size_t>(get_half(width)) * get_half(height) * 2;
+        i420_size = output == YUV_KERNEL_OUTPUT_ABGR
+                ? static_cast<size_t>(width) * height + chroma_size : chroma_size;
+    }
+    return get_weave_scratch_size(layout, width, height) + i420_size;
+}
+
+// Rotates a frame of the given layout into I420.
+template <YuvLayout layout, libyuv::RotationMode mode>
+static int rotate_to_i420(const YuvPlanes& src,
+                          uint8_t* woven_uv,
+                          uint8_t* dst_y,
+                          int dst_stride_y,
+                          uint8_t* dst_u,
+                          int dst_stride_u,
+                          uint8_t* dst_v,
+                          int dst_stride_v,
+                          int width,
+                          int height) {
+    if constexpr (layout == YUV_LAYOUT_I420) {
+        return libyuv::I420Rotate(src.y, src.stride_y, src.u, src.stride_u, src.v, src.stride_v,
+                                  dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v,
+                                  width, height, mode);
+    } else if constexpr (layout == YUV_LAYOUT_NV12) {
+        return libyuv::NV12ToI420Rotate(src.y, src.stride_y, src.u, src.stride_u, dst_y,
+                                        dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v,
+                                        width, height, mode);
+    } else if constexpr (layout == YUV_LAYOUT_NV21) {
+        // NV21 is NV12 with U and V swapped.
+        return libyuv::NV12ToI420Rotate(src.y, src.stride_y, src.v, src.stride_v, dst_y,
+                                        dst_stride_y, dst_v, dst_stride_v, dst_u, dst_stride_u,
+                                        width, height, mode);
+    } else {
+        int halfwidth = get_half(width);
+        weave_uv_plane(src, woven_uv, halfwidth, get_half(height));
+        return libyuv::NV12ToI420Rotate(src.y, src.stride_y, woven_uv, halfwidth * 2, dst_y,
+                                        dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v,
+                                        width, height, mode);
+    }
+}
+
+// Converts an unrotated frame to ABGR. The Yvu constants with U and V swapped produce ABGR from
+// the ARGB functions, the same as libyuv does for its ABGR variants.
+template <YuvLayout layout>
+static int convert_to_abgr(const YuvPlanes& src,
+                           uint8_t* woven_uv,
+                           uint8_t* dst_abgr,
+                           int dst_stride_abgr,
+                           int width,
+                           int height) {
+    const libyuv::YuvConstants* constants = &libyuv::kYvuJPEGConstants;
+    if constexpr (layout == YUV_LAYOUT_I420) {
+        return libyuv::I420ToARGBMatrix(src.y, src.stride_y, src.v, src.stride_v, src.u,
+                                        src.stride_u, dst_abgr, dst_stride_abgr, constants,
+                                        width, height);
+    } else if constexpr (layout == YUV_LAYOUT_NV12) {
+        return libyuv::NV21ToARGBMatrix(src.y, src.stride_y, src.u, src.stride_u, dst_abgr,
+                                        dst_stride_abgr, constants, width, height);
+    } else if constexpr (layout == YUV_LAYOUT_NV21) {
+        return libyuv::NV12ToARGBMatrix(src.y, src.stride_y, src.v, src.stride_v, dst_abgr,
+                                        dst_stride_abgr, constants, width, height);
+    } else {
+        int halfwidth = get_half(width);
+        weave_uv_plane(src, woven_uv, halfwidth, get_half(height));
+        return libyuv::NV21ToARGBMatrix(src.y, src.stride_y, woven_uv, halfwidth * 2, dst_abgr,
+                                        dst_stride_abgr, constants, width, height);
+    }
+}
+
+template <YuvLayout layout, libyuv::RotationMode mode, YuvKernelOutput output>
+static int yuv_kernel(const YuvPlanes& src,
+                      const YuvKernelDestination& dst,
+                      int width,
+                      int height,
+                      uint8_t* scratch) {
+    constexpr bool flip_wh = mode == libyuv::kRotate90 || mode == libyuv::kRotate270;
+    int dst_width = flip_wh ? height : width;
+    int dst_height = flip_wh ? width : height;
+    int dst_halfwidth = get_half(dst_width);
+    int dst_halfheight = get_half(dst_height);
+    uint8_t* woven_uv = scratch;
+    uint8_t* i420 = scratch + get_weave_scratch_size(layout, width, height);
+
+    if constexpr (output == YUV_KERNEL_OUTPUT_ABGR) {
+        if constexpr (mode == libyuv::kRotate0) {
+            return convert_to_abgr<layout>(src, woven_uv, dst.planes[0], dst.strides[0], width,
+                                           height);
+        } else {
+            // Rotating the 12 bits per pixel of YUV is cheaper than the 32 of ABGR.
+            uint8_t* i420_y = i420;
+            uint8_t* i420_u = i420_y + static_cast<size_t>(dst_width) * dst_height;
+            uint8_t* i420_v = i420_u + static_cast<size_t>(dst_halfwidth) * dst_halfheight;
+            int result = rotate_to_i420<layout, mode>(src, woven_uv, i420_y, dst_width, i420_u,
+                                                      dst_halfwidth, i420_v, dst_halfwidth,
+                                                      width, height);
+            if (result != 0) {
+                return result;
+            }
+            return libyuv::I420ToARGBMatrix(i420_y, dst_width, i420_v, dst_halfwidth, i420_u,
+                                            dst_halfwidth, dst.planes[0], dst.strides[0],
+                                            &libyuv::kYvuJPEGConstants, dst_width, dst_height);
+        }
+    } else if constexpr (output == YUV_KERNEL_OUTPUT_I420) {
+        return rotate_to_i420<layout, mode>(src, woven_uv, dst.planes[0], dst.strides[0],
+                                            dst.planes[1], dst.strides[1], dst.planes[2],
+                                            dst.strides[2], width, height);
+    } else {
+        // Luma is rotated straight into the destination, chroma is interleaved afterwards.
+        uint8_t* i420_u = i420;
+        uint8_t* i420_v = i420_u + static_cast<size_t>(dst_halfwidth) * dst_halfheight;
+        int result = rotate_to_i420<layout, mode>(src, woven_uv, dst.planes[0], dst.strides[0],
+                                                  i420_u, dst_halfwidth, i420_v, dst_halfwidth,
+                                                  width, height);
+        if (result != 0) {
+            return result;
+        }
+        constexpr bool is_nv12 = output == YUV_KERNEL_OUTPUT_NV12;
+        libyuv::MergeUVPlane(is_nv12 ? i420_u : i420_v, dst_halfwidth,
+                             is_nv12 ? i420_v : i420_u, dst_halfwidth, dst.planes[1],
+                             dst.strides[1], dst_halfwidth, dst_halfheight);
+        return 0;
+    }
+}
+
+#define YUV_KERNELS_FOR_OUTPUT(layout, mode)                                 \
+    {yuv_kernel<layout, mode, YUV_KERNEL_OUTPUT_ABGR>,                       \
+     yuv_kernel<layout, mode, YUV_KERNEL_OUTPUT_I420>,                       \
+     yuv_kernel<layout, mode, YUV_KERNEL_OUTPUT_NV12>,                       \
+     yuv_kernel<layout, mode, YUV_KERNEL_OUTPUT_NV21>}
+
+#define YUV_KERNELS_FOR_ROTATION(layout)                                     \
+    {YUV_KERNELS_FOR_OUTPUT(layout, libyuv::kRotate0),                       \
+     YUV_KERNELS_FOR_OUTPUT(layout, libyuv::kRotate90),                      \
+     YUV_KERNELS_FOR_OUTPUT(layout, libyuv::kRotate180),                     \
+     YUV_KERNELS_FOR_OUTPUT(layout, libyuv::kRotate270)}
+
+// Indexed by layout, rotation / 90 and output.
+static const YuvKernel kYuvKernels[LAYOUT_COUNT][ROTATION_COUNT][OUTPUT_COUNT] = {
+        YUV_KERNELS_FOR_ROTATION(YUV_LAYOUT_I420),
+        YUV_KERNELS_FOR_ROTATION(YUV_LAYOUT_NV12),
+        YUV_KERNELS_FOR_ROTATION(YUV_LAYOUT_NV21),
+        YUV_KERNELS_FOR_ROTATION(YUV_LAYOUT_ANDROID420),
+};
+
+YuvLayout DetectYuvLayout(const uint8_t* src_u,
+                          int src_stride_u,
+                          const uint8_t* src_v,
+                          int src_stride_v,
+                          int src_pixel_stride_uv) {
+    if (src_pixel_stride_uv == 1) {
+        return YUV_LAYOUT_I420;
+    }
+    if (src_pixel_stride_uv == 2 && src_stride_u == src_stride_v) {
+        const ptrdiff_t vu_off = src_v - src_u;
+        if (vu_off == 1) {
+            return YUV_LAYOUT_NV12;
+        }
+        if (vu_off == -1) {
+            return YUV_LAYOUT_NV21;
+        }
+    }
+    return YUV_LAYOUT_ANDROID420;
+}
+
+YuvConverter* CreateYuvConverter(YuvLayout layout,
+                                 YuvKernelOutput output,
+                                 int width,
+                                 int height,
+                                 int rotation) {
+    if (layout < YUV_LAYOUT_I420 || layout > YUV_LAYOUT_ANDROID420
+            || output < YUV_KERNEL_OUTPUT_ABGR || output > YUV_KERNEL_OUTPUT_NV21
+            || width <= 0 || height <= 0 || rotation < 0 || rotation >= 360
+            || rotation % 90 != 0) {
+        return nullptr;
+    }
+    YuvConverter* converter = static_cast<YuvConverter*>(malloc(sizeof(YuvConverter)));
+    if (converter == nullptr) {
+        return nullptr;
+    }
+    converter->kernel = kYuvKernels[layout][rotation / 90][output];
+    converter->layout = layout;
+    converter->output = output;
+    converter->width = width;
+    converter->height = height;
+    converter->rotation = rotation;
+    converter->scratch = nullptr;
+    size_t scratch_size = get_scratch_size(layout, output, width, height, rotation);
+    if (scratch_size > 0) {
+        converter->scratch = static_cast<uint8_t*>(malloc(scratch_size));
+        if (converter->scratch == nullptr) {
+            free(converter);
+            return nullptr;
+        }
+    }
+    return converter;
+}
+
+bool YuvConverterAccepts(const YuvConverter* converter, const YuvPlanes& src) {
+    // The ANDROID420 kernel reads the pixel stride of every frame, so it takes any layout.
+    return converter->layout == YUV_LAYOUT_ANDROID420
+            || DetectYuvLayout(src.u, src.stride_u, src.v, src.stride_v, src.pixel_stride_uv)
+                    == converter->layout;
+}
+
+int RunYuvConverter(const YuvConverter* converter,
+                    const YuvPlanes& src,
+                    const YuvKernelDestination& dst) {
+    if (!YuvConverterAccepts(converter, src)) {
+        return -1;
+    }
+    return converter->kernel(src, dst, converter->width, converter->height, converter->scratch);
+}
+
+void DestroyYuvConverter(YuvConverter* converter) {
+    if (converter != nullptr) {
+        free(converter->scratch);
+        free(converter);
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_CORE_YUV_KERNELS_H
+#define CAMERA_CORE_YUV_KERNELS_H
+
+#include <cstdint>
+
+#include "libyuv/rotate.h"
+
+// Memory layout of the chroma planes of an Android YUV_420_888 image.
+enum YuvLayout {
+    // Planar, U and V have a pixel stride of 1.
+    YUV_LAYOUT_I420 = 0,
+    // Semi-planar with U first, i.e. V starts one byte after U.
+    YUV_LAYOUT_NV12 = 1,
+    // Semi-planar with V first, i.e. U starts one byte after V.
+    YUV_LAYOUT_NV21 = 2,
+    // Anything else. The chroma is woven into NV12 before the conversion.
+    YUV_LAYOUT_ANDROID420 = 3,
+};
+
+// Values must match the YUV_KERNEL_OUTPUT_* constants in ImageProcessingUtil.java.
+enum YuvKernelOutput {
+    // RGBA_8888, in the byte order of libyuv ABGR.
+    YUV_KERNEL_OUTPUT_ABGR = 0,
+    // YUV_420_888 with the I420, NV12 or NV21 layout.
+    YUV_KERNEL_OUTPUT_I420 = 1,
+    YUV_KERNEL_OUTPUT_NV12 = 2,
+    YUV_KERNEL_OUTPUT_NV21 = 3,
+};
+
+struct YuvPlanes {
+    const uint8_t* y;
+    int stride_y;
+    const uint8_t* u;
+    int stride_u;
+    const uint8_t* v;
+    int stride_v;
+    int pixel_stride_uv;
+};
+
+// Destination of a kernel. ABGR only uses the first plane, NV12 and NV21 use the first two
+// with the interleaved chroma in the second.
+struct YuvKernelDestination {
+    uint8_t* planes[3];
+    int strides[3];
+};
+
+typedef int (*YuvKernel)(const YuvPlanes& src,
+                         const YuvKernelDestination& dst,
+                         int width,
+                         int height,
+                         uint8_t* scratch);
+
+/**
+ * A conversion kernel selected once for a stream, together with its scratch memory.
+ *
+ * <p>Frames of a stream normally keep the same layout, size and rotation, so the kernel
+ * specialized for that configuration is looked up when the converter is created and frames go
+ * to it without allocating again. The layout of every frame is still checked against the one
+ * the kernel was selected for, as producers are free to change it.
+ */
+struct YuvConverter {
+    YuvKernel kernel;
+    YuvLayout layout;
+    YuvKernelOutput output;
+    int width;
+    int height;
+    int rotation;
+    uint8_t* scratch;
+};
+
+/**
+ * Returns the layout of the given chroma planes.
+ */
+YuvLayout DetectYuvLayout(const uint8_t* src_u,
+                          int src_stride_u,
+                          const uint8_t* src_v,
+                          int src_stride_v,
+                          int src_pixel_stride_uv);
+
+/**
+ * Creates a converter for frames of the given layout and size, rotated clockwise by rotation
+ * degrees into the given output. Returns nullptr if the rotation is not a multiple of 90 or the
+ * memory cannot be allocated.
+ */
+YuvConverter* CreateYuvConverter(YuvLayout layout,
+                                 YuvKernelOutput output,
+                                 int width,
+                                 int height,
+                                 int rotation);
+
+/**
+ * Returns whether the chroma planes of src have the layout the converter was created for.
+ */
+bool YuvConverterAccepts(const YuvConverter* converter, const YuvPlanes& src);
+
+/**
+ * Converts one frame. src must have the size the converter was created for and dst the size
+ * after rotation. Returns 0 on success, or -1 without writing dst if the layout of src differs
+ * from the one the converter was created for.
+ */
+int RunYuvConverter(const YuvConverter* converter,
+                    const YuvPlanes& src,
+                    const YuvKernelDestination& dst);
+
+void DestroyYuvConverter(YuvConverter* converter);
+
+#endif  // CAMERA_CORE_YUV_KERNELS_H
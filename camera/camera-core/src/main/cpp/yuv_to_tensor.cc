@@ -0,0 +1,297 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "yuv_to_tensor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "half_float.h"
+
+// Bilinear weights are fixed point with 8 fractional bits.
+#define BILINEAR_FRACTION_BITS 8
+#define BILINEAR_ONE (1 << BILINEAR_FRACTION_BITS)
+
+// Source position of one destination column or row. Offsets are in bytes from the start of the
+// plane along that axis, so the pixel stride or row stride is already applied.
+struct SamplePosition {
+    int offset0;
+    int offset1;
+    int weight1;
+};
+
+// Computes the bilinear sample positions of dst_size pixels spread over
+// [src_start, src_start + src_size) of a plane subsampled by 1 << subsample_shift. Positions are
+// clamped to the crop so nothing outside of it is ever read.
+static void compute_sample_positions(int src_start,
+                                     int src_size,
+                                     int dst_size,
+                                     int subsample_shift,
+                                     int step_bytes,
+                                     SamplePosition* positions) {
+    float scale = static_cast<float>(src_size) / dst_size;
+    float subsample = static_cast<float>(1 << subsample_shift);
+    float first = static_cast<float>(src_start >> subsample_shift);
+    float last = static_cast<float>((src_start + src_size - 1) >> subsample_shift);
+    for (int i = 0; i < dst_size; i++) {
+        // Pixel center in luma coordinates, then mapped to the plane.
+        float luma = src_start + (i + 0.5f) * scale;
+        float p = std::min(std::max(luma / subsample - 0.5f, first), last);
+        int index0 = static_cast<int>(p);
+        int index1 = std::min(index0 + 1, static_cast<int>(last));
+        positions[i].offset0 = index0 * step_bytes;
+        positions[i].offset1 = index1 * step_bytes;
+        positions[i].weight1 = static_cast<int>((p - index0) * BILINEAR_ONE + 0.5f);
+    }
+}
+
+static inline int sample_bilinear(const uint8_t* plane,
+                                  const SamplePosition& x,
+                                  const SamplePosition& y) {
+    const uint8_t* row0 = plane + y.offset0;
+    const uint8_t* row1 = plane + y.offset1;
+    int top = row0[x.offset0] * (BILINEAR_ONE - x.weight1) + row0[x.offset1] * x.weight1;
+    int bottom = row1[x.offset0] * (BILINEAR_ONE - x.weight1) + row1[x.offset1] * x.weight1;
+    return (top * (BILINEAR_ONE - y.weight1) + bottom * y.weight1
+            + (1 << (2 * BILINEAR_FRACTION_BITS - 1))) >> (2 * BILINEAR_FRACTION_BITS);
+}
+
+// Converts one row of sampled YUV to normalized RGB. The loop has no branches or aliasing so it
+// is vectorized by the compiler.
+static void yuv_row_to_rgb(const uint8_t* __restrict__ y_row,
+                           const uint8_t* __restrict__ u_row,
+                           const uint8_t* __restrict__ v_row,
+                           const float* __restrict__ scale,
+                           const float* __restrict__ bias,
+                           float* __restrict__ r_row,
+                           float* __restrict__ g_row,
+                           float* __restrict__ b_row,
+                           int width) {
+    for (int i = 0; i < width; i++) {
+        float y = y_row[i];
+        float u = u_row[i] - 128.0f;
+        float v = v_row[i] - 128.0f;
+        // Full swing BT.601, the same matrix as kYvuJPEGConstants.
+        float r = std::min(std::max(y + 1.402f * v, 0.0f), 255.0f);
+        float g = std::min(std::max(y - 0.344136f * u - 0.714136f * v, 0.0f), 255.0f);
+        float b = std::min(std::max(y + 1.772f * u, 0.0f), 255.0f);
+        r_row[i] = r * scale[0] + bias[0];
+        g_row[i] = g * scale[1] + bias[1];
+        b_row[i] = b * scale[2] + bias[2];
+    }
+}
+
+static inline float to_float32(float value) {
+    return value;
+}
+
+static inline uint16_t to_float16(float value) {
+    return float_to_half(value);
+}
+
+static inline int8_t to_int8(float value) {
+    // The quantization scale and zero point are folded into the normalization.
+    return static_cast<int8_t>(std::min(std::max(lrintf(value), -128L), 127L));
+}
+
+template <typename T, T (*convert)(float)>
+static void store_row(const float* r_row,
+                      const float* g_row,
+                      const float* b_row,
+                      TensorLayout layout,
+                      void* dst,
+                      int row,
+                      int width,
+                      int height) {
+    T* __restrict__ out = static_cast<T*>(dst);
+    if (layout == TENSOR_LAYOUT_NHWC) {
+        out += static_cast<size_t>(row) * width * 3;
+        for (int i = 0; i < width; i++) {
+            out[i * 3] = convert(r_row[i]);
+            out[i * 3 + 1] = convert(g_row[i]);
+            out[i * 3 + 2] = convert(b_row[i]);
+        }
+    } else {
+        size_t plane_size = static_cast<size_t>(width) * height;
+        T* __restrict__ r_out = out + static_cast<size_t>(row) * width;
+        T* __restrict__ g_out = r_out + plane_size;
+        T* __restrict__ b_out = g_out + plane_size;
+        for (int i = 0; i < width; i++) {
+            r_out[i] = convert(r_row[i]);
+            g_out[i] = convert(g_row[i]);
+            b_out[i] = convert(b_row[i]);
+        }
+    }
+}
+
+int get_tensor_element_size(TensorDataType data_type) {
+    switch (data_type) {
+        case TENSOR_DATA_TYPE_FLOAT32:
+            return 4;
+        case TENSOR_DATA_TYPE_FLOAT16:
+            return 2;
+        case TENSOR_DATA_TYPE_INT8:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int Android420ToTensor(const uint8_t* src_y,
+                       int src_stride_y,
+                       const uint8_t* src_u,
+                       int src_stride_u,
+                       const uint8_t* src_v,
+                       int src_stride_v,
+                       int src_pixel_stride_uv,
+                       int crop_left,
+                       int crop_top,
+                       int crop_width,
+                       int crop_height,
+                       int rotation,
+                       void* dst,
+                       int dst_width,
+                       int dst_height,
+                       const TensorParams& params) {
+    if (src_y == nullptr || src_u == nullptr || src_v == nullptr || dst == nullptr
+            || crop_left < 0 || crop_top < 0 || crop_width <= 0 || crop_height <= 0
+            || dst_width <= 0 || dst_height <= 0
+            || get_tensor_element_size(params.data_type) == 0
+            || (params.layout != TENSOR_LAYOUT_NHWC && params.layout != TENSOR_LAYOUT_NCHW)
+            || (params.data_type == TENSOR_DATA_TYPE_INT8 && params.quant_scale == 0.0f)) {
+        return -1;
+    }
+
+    bool flip_wh = rotation == 90 || rotation == 270;
+    // Size of the destination before the rotation, i.e. aligned with the crop rect.
+    int unrotated_width = flip_wh ? dst_height : dst_width;
+    int unrotated_height = flip_wh ? dst_width : dst_height;
+
+    // Destination (x, y) maps to unrotated (ux0 + x * dux, uy0 + x * duy) within a row, where
+    // ux0 and uy0 depend on the row.
+    int dux;
+    int duy;
+    switch (rotation) {
+        case 0:
+            dux = 1;
+            duy = 0;
+            break;
+        case 90:
+            dux = 0;
+            duy = -1;
+            break;
+        case 180:
+            dux = -1;
+            duy = 0;
+            break;
+        case 270:
+            dux = 0;
+            duy = 1;
+            break;
+        default:
+            return -1;
+    }
+
+    size_t positions_size = sizeof(SamplePosition) * 2 * (unrotated_width + unrotated_height);
+    size_t rows_size = (sizeof(uint8_t) * 3 + sizeof(float) * 3) * dst_width;
+    uint8_t* scratch = static_cast<uint8_t*>(malloc(positions_size + rows_size));
+    if (scratch == nullptr) {
+        return -1;
+    }
+    SamplePosition* luma_x = reinterpret_cast<SamplePosition*>(scratch);
+    SamplePosition* luma_y = luma_x + unrotated_width;
+    SamplePosition* chroma_x = luma_y + unrotated_height;
+    SamplePosition* chroma_y = chroma_x + unrotated_width;
+    float* r_row = reinterpret_cast<float*>(chroma_y + unrotated_height);
+    float* g_row = r_row + dst_width;
+    float* b_row = g_row + dst_width;
+    uint8_t* y_row = reinterpret_cast<uint8_t*>(b_row + dst_width);
+    uint8_t* u_row = y_row + dst_width;
+    uint8_t* v_row = u_row + dst_width;
+
+    compute_sample_positions(crop_left, crop_width, unrotated_width, 0, 1, luma_x);
+    compute_sample_positions(crop_top, crop_height, unrotated_height, 0, src_stride_y, luma_y);
+    compute_sample_positions(crop_left, crop_width, unrotated_width, 1, src_pixel_stride_uv,
+                             chroma_x);
+    // U and V may have different row strides, so chroma rows are kept as row indices.
+    compute_sample_positions(crop_top, crop_height, unrotated_height, 1, 1, chroma_y);
+
+    // Fold normalization and, for int8, quantization into one multiply-add per channel.
+    float scale[3];
+    float bias[3];
+    for (int c = 0; c < 3; c++) {
+        scale[c] = 1.0f / (255.0f * params.std[c]);
+        bias[c] = -params.mean[c] / params.std[c];
+        if (params.data_type == TENSOR_DATA_TYPE_INT8) {
+            scale[c] /= params.quant_scale;
+            bias[c] = bias[c] / params.quant_scale + params.quant_zero_point;
+        }
+    }
+
+    for (int row = 0; row < dst_height; row++) {
+        int ux;
+        int uy;
+        switch (rotation) {
+            case 0:
+                ux = 0;
+                uy = row;
+                break;
+            case 90:
+                ux = row;
+                uy = unrotated_height - 1;
+                break;
+            case 180:
+                ux = unrotated_width - 1;
+                uy = unrotated_height - 1 - row;
+                break;
+            default:
+                ux = unrotated_width - 1 - row;
+                uy = 0;
+                break;
+        }
+        for (int i = 0; i < dst_width; i++, ux += dux, uy += duy) {
+            const SamplePosition& cy = chroma_y[uy];
+            SamplePosition u_y = {cy.offset0 * src_stride_u, cy.offset1 * src_stride_u,
+                                  cy.weight1};
+            SamplePosition v_y = {cy.offset0 * src_stride_v, cy.offset1 * src_stride_v,
+                                  cy.weight1};
+            y_row[i] = sample_bilinear(src_y, luma_x[ux], luma_y[uy]);
+            u_row[i] = sample_bilinear(src_u, chroma_x[ux], u_y);
+            v_row[i] = sample_bilinear(src_v, chroma_x[ux], v_y);
+        }
+
+        yuv_row_to_rgb(y_row, u_row, v_row, scale, bias, r_row, g_row, b_row, dst_width);
+
+        switch (params.data_type) {
+            case TENSOR_DATA_TYPE_FLOAT32:
+                store_row<float, to_float32>(r_row, g_row, b_row, params.layout, dst, row,
+                                             dst_width, dst_height);
+                break;
+            case TENSOR_DATA_TYPE_FLOAT16:
+                store_row<uint16_t, to_float16>(r_row, g_row, b_row, params.layout, dst, row,
+                                                dst_width, dst_height);
+                break;
+            case TENSOR_DATA_TYPE_INT8:
+                store_row<int8_t, to_int8>(r_row, g_row, b_row, params.layout, dst, row,
+                                           dst_width, dst_height);
+                break;
+        }
+    }
+
+    free(scratch);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_CORE_YUV_TO_TENSOR_H
+#define CAMERA_CORE_YUV_TO_TENSOR_H
+
+#include <cstdint>
+
+// Values must match the TENSOR_* constants in ImageProcessingUtil.java.
+enum TensorDataType {
+    TENSOR_DATA_TYPE_FLOAT32 = 0,
+    TENSOR_DATA_TYPE_FLOAT16 = 1,
+    TENSOR_DATA_TYPE_INT8 = 2,
+};
+
+enum TensorLayout {
+    TENSOR_LAYOUT_NHWC = 0,
+    TENSOR_LAYOUT_NCHW = 1,
+};
+
+struct TensorParams {
+    TensorDataType data_type;
+    TensorLayout layout;
+    // Per channel (R, G, B) normalization: value = (rgb / 255 - mean) / std.
+    float mean[3];
+    float std[3];
+    // Only used by TENSOR_DATA_TYPE_INT8: q = round(value / quant_scale) + quant_zero_point.
+    float quant_scale;
+    int32_t quant_zero_point;
+};
+
+/**
+ * Returns the size in bytes of one tensor element of the given type, or 0 if the type is unknown.
+ */
+int get_tensor_element_size(TensorDataType data_type);
+
+/**
+ * Converts the crop rect of an Android YUV_420_888 image into a normalized RGB tensor of
+ * dst_width x dst_height x 3 elements.
+ *
+ * <p>Cropping, bilinear scaling, clockwise rotation, full swing BT.601 color conversion,
+ * normalization and quantization are all done while the tensor is written, so the source is only
+ * read at the sampled positions and no intermediate frame is allocated. dst_width and dst_height
+ * are the tensor dimensions after the rotation.
+ *
+ * <p>Returns 0 on success and -1 if the parameters are invalid.
+ */
+int Android420ToTensor(const uint8_t* src_y,
+                       int src_stride_y,
+                       const uint8_t* src_u,
+                       int src_stride_u,
+                       const uint8_t* src_v,
+                       int src_stride_v,
+                       int src_pixel_stride_uv,
+                       int crop_left,
+                       int crop_top,
+                       int crop_width,
+                       int crop_height,
+                       int rotation,
+                       void* dst,
+                       int dst_width,
+                       int dst_height,
+                       const TensorParams& params);
+
+#endif  // CAMERA_CORE_YUV_TO_TENSOR_H
@@ -34,6 +34,7 @@ import androidx.annotation.IntRange;
 import androidx.annotation.NonNull;
 import androidx.annotation.Nullable;
 import androidx.annotation.VisibleForTesting;
+import androidx.camera.core.ImageProcessingUtil.YuvConverter;
 import androidx.camera.core.impl.ImageReaderProxy;
 import androidx.camera.core.impl.utils.futures.Futures;
 import androidx.camera.core.internal.compat.ImageWriterCompat;
@@ -114,6 +115,11 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
     @Nullable
     @VisibleForTesting ByteBuffer mVRotatedBuffer;
 
+    // Native conversion kernel selected for the current stream and rotation.
+    @GuardedBy("mAnalyzerLock")
+    @Nullable
+    private YuvConverter mYuvConverter;
+
     // Lock that synchronizes the access to mSubscribedAnalyzer/mUserExecutor to prevent mismatch.
     private final Object mAnalyzerLock = new Object();
 
@@ -151,7 +157,7 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
     abstract void onValidImageAvailable(@NonNull ImageProxy imageProxy);
 
     /**
-     * Called by {@link ImageAnalysis} to release cached images.
+     * Called by {@link ImageAnalysis} to release cached images and the {@link YuvConverter}.
      */
     abstract void clearCache();
 
@@ -174,6 +180,7 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
         ByteBuffer yRotatedBuffer;
         ByteBuffer uRotatedBuffer;
         ByteBuffer vRotatedBuffer;
+        YuvConverter yuvConverter;
         int currentBufferRotationDegrees = mOutputImageRotationEnabled ? mRelativeRotation : 0;
         boolean outputImageDirty;
 
@@ -197,12 +204,23 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
                 createHelperBuffer(imageProxy);
             }
 
+            // The converter only depends on the stream and the rotation, so it is kept until the
+            // rotation changes.
+            if (mProcessedImageReaderProxy != null && (mYuvConverter == null
+                    || mYuvConverter.getRotationDegrees() != currentBufferRotationDegrees)) {
+                if (mYuvConverter != null) {
+                    mYuvConverter.close();
+                }
+                mYuvConverter = new YuvConverter(currentBufferRotationDegrees);
+            }
+
             processedImageReaderProxy = mProcessedImageReaderProxy;
             processedImageWriter = mProcessedImageWriter;
             rgbConvertedBuffer = mRGBConvertedBuffer;
             yRotatedBuffer = mYRotatedBuffer;
             uRotatedBuffer = mURotatedBuffer;
             vRotatedBuffer = mVRotatedBuffer;
+            yuvConverter = mYuvConverter;
         }
 
         ListenableFuture<Void> future;
@@ -210,7 +228,7 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
         if (analyzer != null && executor != null && mIsAttached) {
             ImageProxy processedImageProxy = null;
 
-            if (processedImageReaderProxy != null) {
+            if (processedImageReaderProxy != null && yuvConverter != null) {
                 if (mOutputImageFormat == OUTPUT_IMAGE_FORMAT_RGBA_8888) {
                     processedImageProxy =
                             convertYUVToRGB(
@@ -218,7 +236,8 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
                                     processedImageReaderProxy,
                                     rgbConvertedBuffer,
                                     currentBufferRotationDegrees,
-                                    mOnePixelShiftEnabled);
+                                    mOnePixelShiftEnabled,
+                                    yuvConverter);
                 } else if (mOutputImageFormat == ImageAnalysis.OUTPUT_IMAGE_FORMAT_YUV_420_888) {
                     // Apply one pixel shift before other processing, e.g. rotation.
                     if (mOnePixelShiftEnabled) {
@@ -235,7 +254,8 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
                                 yRotatedBuffer,
                                 uRotatedBuffer,
                                 vRotatedBuffer,
-                                currentBufferRotationDegrees);
+                                currentBufferRotationDegrees,
+                                yuvConverter);
                     }
                 }
             }
@@ -383,6 +403,19 @@ abstract class ImageAnalysisAbstractAnalyzer implements ImageReaderProxy.OnImage
         clearCache();
     }
 
+    /**
+     * Releases the {@link YuvConverter}, which was selected for the current stream. Called from
+     * {@link #clearCache()} as the pipeline may be recreated with another stream afterwards.
+     */
+    void closeYuvConverter() {
+        synchronized (mAnalyzerLock) {
+            if (mYuvConverter != null) {
+                mYuvConverter.close();
+                mYuvConverter = null;
+            }
+        }
+    }
+
     @GuardedBy("mAnalyzerLock")
     private void createHelperBuffer(@NonNull ImageProxy imageProxy) {
         if (mOutputImageFormat == ImageAnalysis.OUTPUT_IMAGE_FORMAT_YUV_420_888) {
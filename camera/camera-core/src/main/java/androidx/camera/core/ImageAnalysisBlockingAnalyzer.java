@@ -59,6 +59,7 @@ final class ImageAnalysisBlockingAnalyzer extends ImageAnalysisAbstractAnalyzer
 
     @Override
     void clearCache() {
-        // no-op. The blocking analyzer does not cache images.
+        // The blocking analyzer does not cache images.
+        closeYuvConverter();
     }
 }
@@ -123,6 +123,7 @@ final class ImageAnalysisNonBlockingAnalyzer extends ImageAnalysisAbstractAnalyz
                 mCachedImage = null;
             }
         }
+        closeYuvConverter();
     }
 
     /**
@@ -21,12 +21,16 @@ import static androidx.camera.core.ImageProcessingUtil.Result.SUCCESS;
 
 import android.graphics.Bitmap;
 import android.graphics.ImageFormat;
+import android.graphics.Matrix;
+import android.graphics.PixelFormat;
+import android.graphics.Rect;
 import android.media.Image;
 import android.media.ImageWriter;
 import android.os.Build;
 import android.util.Log;
 import android.view.Surface;
 
+import androidx.annotation.GuardedBy;
 import androidx.annotation.IntRange;
 import androidx.annotation.NonNull;
 import androidx.annotation.Nullable;
@@ -34,11 +38,17 @@ import androidx.annotation.RequiresApi;
 import androidx.annotation.RestrictTo;
 import androidx.camera.core.impl.ImageOutputConfig;
 import androidx.camera.core.impl.ImageReaderProxy;
+import androidx.camera.core.impl.utils.ExifData;
+import androidx.camera.core.impl.utils.ExifOutputStream;
 import androidx.camera.core.internal.compat.ImageWriterCompat;
 import androidx.camera.core.internal.utils.ImageUtil;
 import androidx.core.util.Preconditions;
 
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
 import java.nio.ByteBuffer;
+import java.util.Arrays;
 import java.util.Locale;
 
 /**
@@ -49,18 +59,637 @@ import java.util.Locale;
 public final class ImageProcessingUtil {
 
     private static final String TAG = "ImageProcessingUtil";
+    // A JPEG with only the SOI and EOI markers, used to extract the Exif APP1 segment.
+    private static final byte[] EMPTY_JPEG = {(byte) 0xFF, (byte) 0xD8, (byte) 0xFF, (byte) 0xD9};
     private static int sImageCount = 0;
 
     static {
         System.loadLibrary("image_processing_util_jni");
     }
 
+    /** Tensor elements are 32-bit floats. */
+    public static final int TENSOR_DATA_TYPE_FLOAT32 = 0;
+    /** Tensor elements are IEEE 754 half precision floats. */
+    public static final int TENSOR_DATA_TYPE_FLOAT16 = 1;
+    /** Tensor elements are quantized signed 8-bit integers. */
+    public static final int TENSOR_DATA_TYPE_INT8 = 2;
+
+    /** Tensor is laid out as height x width x RGB. */
+    public static final int TENSOR_LAYOUT_NHWC = 0;
+    /** Tensor is laid out as RGB x height x width. */
+    public static final int TENSOR_LAYOUT_NCHW = 1;
+
+    /** Scales with bilinear filtering. Value matches libyuv::kFilterBilinear. */
+    public static final int SCALE_FILTER_BILINEAR = 2;
+    /** Scales with box filtering, best for large downscales. Value matches libyuv::kFilterBox. */
+    public static final int SCALE_FILTER_BOX = 3;
+
+    /** P010 input uses the BT.2020 matrix with limited range, as camera HDR streams do. */
+    public static final int HDR_COLOR_STANDARD_BT2020 = 0;
+    /** P010 input uses the BT.2020 matrix with full range. */
+    public static final int HDR_COLOR_STANDARD_BT2020_FULL_RANGE = 1;
+    /** P010 input uses the BT.709 matrix with limited range. */
+    public static final int HDR_COLOR_STANDARD_BT709 = 2;
+
+    /** Output keeps the encoded signal values of the P010 input. */
+    public static final int HDR_TRANSFER_NONE = 0;
+    /** P010 input is HLG encoded, RGBA_F16 output is linearized. */
+    public static final int HDR_TRANSFER_HLG = 1;
+    /** P010 input is PQ encoded, RGBA_F16 output is linearized. */
+    public static final int HDR_TRANSFER_PQ = 2;
+
+    /** Pixels are R, G, B, A bytes, like {@link Bitmap.Config#ARGB_8888}. */
+    public static final int PIXEL_FORMAT_RGBA_8888 = 0;
+    /** Pixels are 16-bit with R in the top bits, like {@link Bitmap.Config#RGB_565}. */
+    public static final int PIXEL_FORMAT_RGB_565 = 1;
+    /** Pixels are packed R, G, B bytes. */
+    public static final int PIXEL_FORMAT_RGB_888 = 2;
+
+    /** Copies the alpha and color channels as they are. */
+    public static final int ALPHA_OP_NONE = 0;
+    /** Multiplies the color channels by alpha. */
+    public static final int ALPHA_OP_PREMULTIPLY = 1;
+    /** Divides the color channels by alpha. */
+    public static final int ALPHA_OP_UNPREMULTIPLY = 2;
+
     enum Result {
         UNKNOWN,
         SUCCESS,
         ERROR_CONVERSION,  // Native conversion error.
     }
 
+    /** Luma statistics of a frame, see {@link #computeLumaStatistics}. */
+    public static final class LumaStatistics {
+        private final int[] mHistogram;
+        private final float mMean;
+        private final float mVariance;
+        private final float mSharpness;
+        private final float mUnderExposedRatio;
+        private final float mOverExposedRatio;
+
+        LumaStatistics(@NonNull int[] histogram, @NonNull float[] results) {
+            mHistogram = histogram;
+            mMean = results[0];
+            mVariance = results[1];
+            mSharpness = results[2];
+            mUnderExposedRatio = results[3];
+            mOverExposedRatio = results[4];
+        }
+
+        /** Returns the 256 bin histogram of the sampled luma values. */
+        @NonNull
+        public int[] getHistogram() {
+            return mHistogram;
+        }
+
+        /** Returns the mean luma value. */
+        public float getMean() {
+            return mMean;
+        }
+
+        /** Returns the variance of the luma values. */
+        public float getVariance() {
+            return mVariance;
+        }
+
+        /**
+         * Returns the variance of the Laplacian of the luma plane. Higher values mean a sharper
+         * image; the scale depends on the content, so it is best compared between frames.
+         */
+        public float getSharpness() {
+            return mSharpness;
+        }
+
+        /** Returns the fraction of samples at or below the under exposure threshold. */
+        public float getUnderExposedRatio() {
+            return mUnderExposedRatio;
+        }
+
+        /** Returns the fraction of samples at or above the over exposure threshold. */
+        public float getOverExposedRatio() {
+            return mOverExposedRatio;
+        }
+    }
+
+    /**
+     * A native YUV conversion kernel cached for one stream.
+     *
+     * <p>The kernel specialized for the chroma layout, size and rotation of the stream is selected
+     * on the first frame, so later frames skip the intermediate buffers of {@link #convertYUVToRGB}
+     * and {@link #rotateYUV}. Every frame is still checked against the layout the kernel was
+     * selected for, and frames that differ fail so that the caller uses the generic conversion.
+     * Only RGBA and YUV image outputs are specialized, {@link #convertYUVToBitmap} always uses the
+     * generic conversion. The converter must be closed to release the native kernel.
+     */
+    public static final class YuvConverter {
+        private final int mRotationDegrees;
+        @GuardedBy("this")
+        private long mNativeConverter;
+        @GuardedBy("this")
+        private int mWidth;
+        @GuardedBy("this")
+        private int mHeight;
+        // True if there is no kernel for the stream, or the converter is closed.
+        @GuardedBy("this")
+        private boolean mDisabled;
+
+        public YuvConverter(@ImageOutputConfig.RotationDegreesValue int rotationDegrees) {
+            mRotationDegrees = rotationDegrees;
+        }
+
+        public int getRotationDegrees() {
+            return mRotationDegrees;
+        }
+
+        synchronized boolean convertToRGB(@NonNull ImageProxy imageProxy,
+                @NonNull Surface surface) {
+            if (!prepare(imageProxy, null)) {
+                return false;
+            }
+            return nativeConvertWithYuvConverter(
+                    mNativeConverter,
+                    imageProxy.getPlanes()[0].getBuffer(),
+                    imageProxy.getPlanes()[0].getRowStride(),
+                    imageProxy.getPlanes()[1].getBuffer(),
+                    imageProxy.getPlanes()[1].getRowStride(),
+                    imageProxy.getPlanes()[2].getBuffer(),
+                    imageProxy.getPlanes()[2].getRowStride(),
+                    imageProxy.getPlanes()[1].getPixelStride(),
+                    surface) == 0;
+        }
+
+        synchronized boolean rotateYUV(@NonNull ImageProxy imageProxy,
+                @NonNull Image rotatedImage) {
+            if (rotatedImage.getPlanes()[0].getPixelStride() != 1
+                    || !prepare(imageProxy, rotatedImage)) {
+                return false;
+            }
+            return nativeRotateWithYuvConverter(
+                    mNativeConverter,
+                    imageProxy.getPlanes()[0].getBuffer(),
+                    imageProxy.getPlanes()[0].getRowStride(),
+                    imageProxy.getPlanes()[1].getBuffer(),
+                    imageProxy.getPlanes()[1].getRowStride(),
+                    imageProxy.getPlanes()[2].getBuffer(),
+                    imageProxy.getPlanes()[2].getRowStride(),
+                    imageProxy.getPlanes()[1].getPixelStride(),
+                    rotatedImage.getPlanes()[0].getBuffer(),
+                    rotatedImage.getPlanes()[0].getRowStride(),
+                    rotatedImage.getPlanes()[1].getBuffer(),
+                    rotatedImage.getPlanes()[1].getRowStride(),
+                    rotatedImage.getPlanes()[2].getBuffer(),
+                    rotatedImage.getPlanes()[2].getRowStride(),
+                    rotatedImage.getPlanes()[1].getPixelStride()) == 0;
+        }
+
+        /** Releases the native kernel. Later conversions fail. */
+        public synchronized void close() {
+            mDisabled = true;
+            if (mNativeConverter != 0) {
+                nativeDestroyYuvConverter(mNativeConverter);
+                mNativeConverter = 0;
+            }
+        }
+
+        // Selects the kernel on the first frame. Returns false if the frame cannot be converted,
+        // the native converter also rejects frames whose layout differs from the first one.
+        @GuardedBy("this")
+        private boolean prepare(@NonNull ImageProxy imageProxy, @Nullable Image rotatedImage) {
+            if (mDisabled) {
+                return false;
+            }
+            if (mNativeConverter == 0) {
+                mWidth = imageProxy.getWidth();
+                mHeight = imageProxy.getHeight();
+                mNativeConverter = nativeCreateYuvConverter(
+                        imageProxy.getPlanes()[1].getBuffer(),
+                        imageProxy.getPlanes()[1].getRowStride(),
+                        imageProxy.getPlanes()[2].getBuffer(),
+                        imageProxy.getPlanes()[2].getRowStride(),
+                        imageProxy.getPlanes()[1].getPixelStride(),
+                        rotatedImage == null ? null : rotatedImage.getPlanes()[1].getBuffer(),
+                        rotatedImage == null ? 0 : rotatedImage.getPlanes()[1].getRowStride(),
+                        rotatedImage == null ? null : rotatedImage.getPlanes()[2].getBuffer(),
+                        rotatedImage == null ? 0 : rotatedImage.getPlanes()[2].getRowStride(),
+                        rotatedImage == null ? 0 : rotatedImage.getPlanes()[1].getPixelStride(),
+                        mWidth,
+                        mHeight,
+                        mRotationDegrees);
+                if (mNativeConverter == 0) {
+                    Logger.w(TAG, "No YUV kernel for the stream, using the generic conversion");
+                    mDisabled = true;
+                    return false;
+                }
+            }
+            return imageProxy.getWidth() == mWidth && imageProxy.getHeight() == mHeight;
+        }
+    }
+
+    /** Motion of a frame against the reference, see {@link MotionDetector}. */
+    public static final class MotionResult {
+        private final byte[] mTileMap;
+        private final int mTilesX;
+        private final int mTilesY;
+        private final float mScore;
+
+        MotionResult(@NonNull byte[] tileMap, int tilesX, int tilesY, float score) {
+            mTileMap = tileMap;
+            mTilesX = tilesX;
+            mTilesY = tilesY;
+            mScore = score;
+        }
+
+        /**
+         * Returns the mean absolute luma difference of every tile, capped at 255 and stored
+         * unsigned, row by row.
+         */
+        @NonNull
+        public byte[] getTileMap() {
+            return mTileMap;
+        }
+
+        /** Returns the number of tiles in a row of the tile map. */
+        public int getTilesX() {
+            return mTilesX;
+        }
+
+        /** Returns the number of rows of the tile map. */
+        public int getTilesY() {
+            return mTilesY;
+        }
+
+        /** Returns the fraction of tiles whose mean difference is above the threshold. */
+        public float getScore() {
+            return mScore;
+        }
+    }
+
+    /**
+     * Detects motion between the frames of a stream.
+     *
+     * <p>The Y plane of every frame is box filtered down and compared tile by tile against a
+     * retained reference frame, so analysis can skip inference on static frames. The first frame
+     * becomes the reference and is reported as moving everywhere. The detector must be closed to
+     * release the native memory.
+     */
+    public static final class MotionDetector {
+        private final int mDownsampleFactor;
+        private final int mTileSize;
+        private final int mThreshold;
+        @GuardedBy("this")
+        private long mNativeDetector;
+        @GuardedBy("this")
+        private int mWidth;
+        @GuardedBy("this")
+        private int mHeight;
+        @GuardedBy("this")
+        private boolean mClosed;
+
+        /**
+         * Creates a detector. The native memory is allocated on the first frame.
+         *
+         * @param downsampleFactor factor the frames are downsampled by before the comparison.
+         * @param tileSize         size of the tiles in downsampled pixels.
+         * @param threshold        mean absolute luma difference above which a tile moves.
+         */
+        public MotionDetector(@IntRange(from = 1) int downsampleFactor,
+                @IntRange(from = 1) int tileSize,
+                @IntRange(from = 0, to = 255) int threshold) {
+            mDownsampleFactor = downsampleFactor;
+            mTileSize = tileSize;
+            mThreshold = threshold;
+        }
+
+        /**
+         * Compares a YUV image against the reference.
+         *
+         * @param imageProxy      input image proxy in YUV, of the same size for every call.
+         * @param updateReference true to make the image the new reference. Keeping the reference
+         *                        detects slow changes that are below the threshold between two
+         *                        consecutive frames.
+         * @return the motion, or null if the image cannot be compared.
+         */
+        @Nullable
+        public synchronized MotionResult detect(@NonNull ImageProxy imageProxy,
+                boolean updateReference) {
+            if (mClosed || !isSupportedYUVFormat(imageProxy)) {
+                return null;
+            }
+            if (mNativeDetector == 0) {
+                mWidth = imageProxy.getWidth();
+                mHeight = imageProxy.getHeight();
+                mNativeDetector = nativeCreateMotionDetector(mWidth, mHeight, mDownsampleFactor,
+                        mTileSize, mThreshold);
+                if (mNativeDetector == 0) {
+                    Logger.e(TAG, "Failed to create the motion detector");
+                    mClosed = true;
+                    return null;
+                }
+            }
+            if (imageProxy.getWidth() != mWidth || imageProxy.getHeight() != mHeight) {
+                Logger.e(TAG, "Image size changed for the motion detector");
+                return null;
+            }
+
+            int tilesX = nativeGetMotionTileCount(mNativeDetector, false);
+            int tilesY = nativeGetMotionTileCount(mNativeDetector, true);
+            byte[] tileMap = new byte[tilesX * tilesY];
+            float[] score = new float[1];
+            int result = nativeDetectMotion(
+                    mNativeDetector,
+                    imageProxy.getPlanes()[0].getBuffer(),
+                    imageProxy.getPlanes()[0].getRowStride(),
+                    imageProxy.getPlanes()[0].getPixelStride(),
+                    updateReference,
+                    tileMap,
+                    score);
+            if (result != 0) {
+                Logger.e(TAG, "Motion detection failure");
+                return null;
+            }
+            return new MotionResult(tileMap, tilesX, tilesY, score[0]);
+        }
+
+        /** Drops the reference, so the next frame becomes the reference. */
+        public synchronized void reset() {
+            if (mNativeDetector != 0) {
+                nativeResetMotionDetector(mNativeDetector);
+            }
+        }
+
+        /** Releases the native memory. Later calls to {@link #detect} return null. */
+        public synchronized void close() {
+            mClosed = true;
+            if (mNativeDetector != 0) {
+                nativeDestroyMotionDetector(mNativeDetector);
+                mNativeDetector = 0;
+            }
+        }
+    }
+
+    /**
+     * Warps frames through a lookup table computed once for a camera and crop configuration.
+     *
+     * <p>The source position of every output pixel is computed when the table is created, from a
+     * perspective transform and optionally the lens distortion of the camera. Frames are then
+     * warped natively with bilinear sampling, split into tiles between the given number of
+     * threads. The table must be closed to release the native memory.
+     */
+    public static final class RemapTable {
+        private final int mSrcWidth;
+        private final int mSrcHeight;
+        private final int mDstWidth;
+        private final int mDstHeight;
+        @GuardedBy("this")
+        private long mNativeTable;
+
+        private RemapTable(long nativeTable, int srcWidth, int srcHeight, int dstWidth,
+                int dstHeight) {
+            mNativeTable = nativeTable;
+            mSrcWidth = srcWidth;
+            mSrcHeight = srcHeight;
+            mDstWidth = dstWidth;
+            mDstHeight = dstHeight;
+        }
+
+        /**
+         * Creates a table.
+         *
+         * @param srcWidth     width of the source frames.
+         * @param srcHeight    height of the source frames.
+         * @param dstWidth     width of the warped frames.
+         * @param dstHeight    height of the warped frames.
+         * @param transform    maps source pixel coordinates to warped pixel coordinates, e.g. a
+         *                     {@link Matrix#setPolyToPoly} from the corners of a document to the
+         *                     output rectangle. Must be invertible.
+         * @param intrinsics   null, or the [fx, fy, cx, cy, s] of
+         *                     {@code CameraCharacteristics.LENS_INTRINSIC_CALIBRATION} scaled to
+         *                     the source frames, to also correct the lens distortion.
+         * @param distortion   the [k1, k2, k3, p1, p2] of
+         *                     {@code CameraCharacteristics.LENS_DISTORTION}, required with
+         *                     intrinsics.
+         * @param threadCount  number of threads warping a frame, the calling one included. The
+         *                     other ones are kept until the table is closed.
+         * @return the table, or null if it cannot be created.
+         */
+        @Nullable
+        public static RemapTable create(int srcWidth, int srcHeight, int dstWidth, int dstHeight,
+                @NonNull Matrix transform,
+                @Nullable float[] intrinsics,
+                @Nullable float[] distortion,
+                @IntRange(from = 1) int threadCount) {
+            Matrix inverse = new Matrix();
+            if (!transform.invert(inverse)) {
+                Logger.e(TAG, "Remap transform is not invertible");
+                return null;
+            }
+            float[] values = new float[9];
+            inverse.getValues(values);
+            long nativeTable = nativeCreateRemapTable(srcWidth, srcHeight, dstWidth, dstHeight,
+                    values, intrinsics, distortion, threadCount);
+            if (nativeTable == 0) {
+                Logger.e(TAG, "Failed to create the remap table");
+                return null;
+            }
+            return new RemapTable(nativeTable, srcWidth, srcHeight, dstWidth, dstHeight);
+        }
+
+        /**
+         * Warps a YUV image into the planes of a YUV_420_888 image of the warped size.
+         *
+         * @return true if the warp succeeds, otherwise false.
+         */
+        public synchronized boolean remap(@NonNull ImageProxy imageProxy,
+                @NonNull Image outputImage) {
+            if (mNativeTable == 0 || !isSupportedYUVFormat(imageProxy)
+                    || imageProxy.getWidth() != mSrcWidth || imageProxy.getHeight() != mSrcHeight
+                    || outputImage.getFormat() != ImageFormat.YUV_420_888
+                    || outputImage.getWidth() != mDstWidth
+                    || outputImage.getHeight() != mDstHeight
+                    || imageProxy.getPlanes()[0].getPixelStride() != 1
+                    || outputImage.getPlanes()[0].getPixelStride() != 1) {
+                Logger.e(TAG, "Images do not match the remap table");
+                return false;
+            }
+            return nativeRemapYUV(
+                    mNativeTable,
+                    imageProxy.getPlanes()[0].getBuffer(),
+                    imageProxy.getPlanes()[0].getRowStride(),
+                    imageProxy.getPlanes()[1].getBuffer(),
+                    imageProxy.getPlanes()[1].getRowStride(),
+                    imageProxy.getPlanes()[2].getBuffer(),
+                    imageProxy.getPlanes()[2].getRowStride(),
+                    imageProxy.getPlanes()[1].getPixelStride(),
+                    outputImage.getPlanes()[0].getBuffer(),
+                    outputImage.getPlanes()[0].getRowStride(),
+                    outputImage.getPlanes()[1].getBuffer(),
+                    outputImage.getPlanes()[1].getRowStride(),
+                    outputImage.getPlanes()[2].getBuffer(),
+                    outputImage.getPlanes()[2].getRowStride(),
+                    outputImage.getPlanes()[1].getPixelStride()) == 0;
+        }
+
+        /**
+         * Warps a {@link Bitmap.Config#ARGB_8888} bitmap into another one of the warped size.
+         *
+         * @return true if the warp succeeds, otherwise false.
+         */
+        public synchronized boolean remap(@NonNull Bitmap bitmap, @NonNull Bitmap outputBitmap) {
+            if (mNativeTable == 0) {
+                return false;
+            }
+            return nativeRemapBitmap(mNativeTable, bitmap, outputBitmap) == 0;
+        }
+
+        /** Releases the native memory. Later warps fail. */
+        public synchronized void close() {
+            if (mNativeTable != 0) {
+                nativeDestroyRemapTable(mNativeTable);
+                mNativeTable = 0;
+            }
+        }
+    }
+
+    /**
+     * A Gaussian pyramid of the frames of a stream, in buffers allocated once.
+     *
+     * <p>Level i is the frame downsampled by 2^(i + 1) with a separable 5-tap Gaussian kernel.
+     * All the levels are built natively in one streaming pass over the frame, so detectors that
+     * work at several scales can share them instead of each downscaling the frame. The pyramid is
+     * built from the Y plane of YUV images or from all the channels of RGBA_8888 images. The
+     * pyramid must be closed to release the native memory.
+     */
+    public static final class ImagePyramid {
+        private final int mRequestedLevelCount;
+        @GuardedBy("this")
+        private long mNativePyramid;
+        @GuardedBy("this")
+        private int mWidth;
+        @GuardedBy("this")
+        private int mHeight;
+        @GuardedBy("this")
+        private int mChannelCount;
+        @GuardedBy("this")
+        private ByteBuffer[] mLevels = new ByteBuffer[0];
+        @GuardedBy("this")
+        private int[][] mLevelSizes = new int[0][];
+        @GuardedBy("this")
+        private boolean mClosed;
+
+        /**
+         * Creates a pyramid. The native memory is allocated on the first frame.
+         *
+         * @param levelCount number of levels. Fewer levels are built if the frames become
+         *                   smaller than 2x2 pixels.
+         */
+        public ImagePyramid(@IntRange(from = 1) int levelCount) {
+            mRequestedLevelCount = levelCount;
+        }
+
+        /**
+         * Builds the levels from a YUV or RGBA_8888 image of the same size and format as the
+         * first one. The levels of the previous image are overwritten.
+         *
+         * @return true if the levels are built, otherwise false.
+         */
+        public synchronized boolean build(@NonNull ImageProxy imageProxy) {
+            if (mClosed) {
+                return false;
+            }
+            int channelCount;
+            if (isSupportedYUVFormat(imageProxy)) {
+                channelCount = 1;
+            } else if (imageProxy.getFormat() == PixelFormat.RGBA_8888
+                    && imageProxy.getPlanes().length == 1) {
+                channelCount = 4;
+            } else {
+                Logger.e(TAG, "Unsupported format for the image pyramid");
+                return false;
+            }
+            if (mNativePyramid == 0) {
+                mWidth = imageProxy.getWidth();
+                mHeight = imageProxy.getHeight();
+                mChannelCount = channelCount;
+                mNativePyramid = nativeCreateImagePyramid(mWidth, mHeight, mChannelCount,
+                        mRequestedLevelCount);
+                if (mNativePyramid == 0) {
+                    Logger.e(TAG, "Failed to create the image pyramid");
+                    mClosed = true;
+                    return false;
+                }
+                // The levels are allocated in Java and only written by the native pyramid, so
+                // buffers returned by getLevelBuffer stay valid after close.
+                int levelCount = nativeGetImagePyramidLevelCount(mNativePyramid);
+                mLevels = new ByteBuffer[levelCount];
+                mLevelSizes = new int[levelCount][2];
+                for (int i = 0; i < levelCount; i++) {
+                    if (nativeGetImagePyramidLevelSize(mNativePyramid, i, mLevelSizes[i]) != 0) {
+                        Logger.e(TAG, "Failed to get the size of image pyramid level " + i);
+                        close();
+                        return false;
+                    }
+                    mLevels[i] = ByteBuffer.allocateDirect(
+                            mLevelSizes[i][0] * mLevelSizes[i][1] * mChannelCount);
+                    if (nativeSetImagePyramidLevel(mNativePyramid, i, mLevels[i]) != 0) {
+                        Logger.e(TAG, "Failed to set image pyramid level " + i);
+                        close();
+                        return false;
+                    }
+                }
+            }
+            if (imageProxy.getWidth() != mWidth || imageProxy.getHeight() != mHeight
+                    || channelCount != mChannelCount) {
+                Logger.e(TAG, "Image does not match the image pyramid");
+                return false;
+            }
+            return nativeBuildImagePyramid(
+                    mNativePyramid,
+                    imageProxy.getPlanes()[0].getBuffer(),
+                    imageProxy.getPlanes()[0].getRowStride(),
+                    imageProxy.getPlanes()[0].getPixelStride(),
+                    mWidth,
+                    mHeight) == 0;
+        }
+
+        /** Returns the number of levels, 0 before the first frame. */
+        public synchronized int getLevelCount() {
+            return mLevels.length;
+        }
+
+        /** Returns the number of interleaved channels of the levels. */
+        public synchronized int getChannelCount() {
+            return mChannelCount;
+        }
+
+        /**
+         * Returns the pixels of a level, tightly packed. They are overwritten by the next call to
+         * {@link #build}, and stay readable after {@link #close}.
+         */
+        @NonNull
+        public synchronized ByteBuffer getLevelBuffer(int level) {
+            return mLevels[level].duplicate();
+        }
+
+        public synchronized int getLevelWidth(int level) {
+            return mLevelSizes[level][0];
+        }
+
+        public synchronized int getLevelHeight(int level) {
+            return mLevelSizes[level][1];
+        }
+
+        /** Releases the native memory. Later builds fail. */
+        public synchronized void close() {
+            mClosed = true;
+            mLevels = new ByteBuffer[0];
+            mLevelSizes = new int[0][];
+            if (mNativePyramid != 0) {
+                nativeDestroyImagePyramid(mNativePyramid);
+                mNativePyramid = 0;
+            }
+        }
+    }
+
     private ImageProcessingUtil() {
     }
 
@@ -100,14 +729,55 @@ public final class ImageProcessingUtil {
      * @param bitmap            source bitmap
      * @param byteBuffer        destination ByteBuffer
      * @param bufferStride      the stride of the ByteBuffer
+     * @throws IllegalArgumentException if the bitmap is not {@link Bitmap.Config#ARGB_8888} or
+     *                                  {@link Bitmap.Config#RGB_565}.
      */
     public static void copyBitmapToByteBuffer(@NonNull Bitmap bitmap,
             @NonNull ByteBuffer byteBuffer, int bufferStride) {
-        int bitmapStride = bitmap.getRowBytes();
-        int width = bitmap.getWidth();
-        int height = bitmap.getHeight();
-        nativeCopyBetweenByteBufferAndBitmap(bitmap, byteBuffer, bitmapStride, bufferStride, width,
-                height, false);
+        checkSupportedBitmapConfig(bitmap);
+        copyBitmapToByteBuffer(bitmap, byteBuffer, bufferStride, PIXEL_FORMAT_RGBA_8888, null, 0,
+                ALPHA_OP_NONE, null);
+    }
+
+    /**
+     * Copies a region of a Bitmap to a ByteBuffer, converting the pixels in a single native pass.
+     *
+     * <p>The bitmap must be {@link Bitmap.Config#ARGB_8888} or {@link Bitmap.Config#RGB_565}.
+     * The ByteBuffer receives the crop rect rotated clockwise by {@code rotationDegrees}. The
+     * channels are reordered first, then the alpha op is applied. Formats without alpha read as
+     * opaque.
+     *
+     * @param bitmap          source bitmap.
+     * @param byteBuffer      destination direct ByteBuffer.
+     * @param bufferStride    row stride of the ByteBuffer in bytes.
+     * @param bufferFormat    one of the {@code PIXEL_FORMAT_*} constants.
+     * @param cropRect        region of the bitmap to copy, or null for the whole bitmap.
+     * @param rotationDegrees clockwise rotation applied to the crop rect.
+     * @param alphaOp         one of the {@code ALPHA_OP_*} constants.
+     * @param channelOrder    null, or the input channel of every output channel in R, G, B, A
+     *                        order, e.g. {2, 1, 0, 3} swaps red and blue.
+     * @return true if the copy succeeds, otherwise false.
+     */
+    public static boolean copyBitmapToByteBuffer(@NonNull Bitmap bitmap,
+            @NonNull ByteBuffer byteBuffer, int bufferStride, int bufferFormat,
+            @Nullable Rect cropRect,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            int alphaOp,
+            @Nullable int[] channelOrder) {
+        if (cropRect == null) {
+            cropRect = new Rect(0, 0, bitmap.getWidth(), bitmap.getHeight());
+        }
+        if (!isValidCopy(bitmap, cropRect, bufferStride)) {
+            return false;
+        }
+        int result = nativeCopyBetweenByteBufferAndBitmap(bitmap, byteBuffer, bufferFormat,
+                bufferStride, cropRect.left, cropRect.top, cropRect.width(), cropRect.height(),
+                rotationDegrees, alphaOp, channelOrder, false);
+        if (result != 0) {
+            Logger.e(TAG, "Bitmap to ByteBuffer copy failure");
+            return false;
+        }
+        return true;
     }
 
     /**
@@ -116,15 +786,84 @@ public final class ImageProcessingUtil {
      * @param bitmap            destination Bitmap
      * @param byteBuffer        source ByteBuffer
      * @param bufferStride      the stride of the ByteBuffer
-     *
+     * @throws IllegalArgumentException if the bitmap is not {@link Bitmap.Config#ARGB_8888} or
+     *                                  {@link Bitmap.Config#RGB_565}.
      */
     public static void copyByteBufferToBitmap(@NonNull Bitmap bitmap,
             @NonNull ByteBuffer byteBuffer, int bufferStride) {
-        int bitmapStride = bitmap.getRowBytes();
-        int width = bitmap.getWidth();
-        int height = bitmap.getHeight();
-        nativeCopyBetweenByteBufferAndBitmap(bitmap, byteBuffer, bufferStride, bitmapStride, width,
-                height, true);
+        checkSupportedBitmapConfig(bitmap);
+        copyByteBufferToBitmap(bitmap, byteBuffer, bufferStride, PIXEL_FORMAT_RGBA_8888, null, 0,
+                ALPHA_OP_NONE, null);
+    }
+
+    /**
+     * Copies a region of a ByteBuffer to a Bitmap, converting the pixels in a single native pass.
+     *
+     * <p>The bitmap must be {@link Bitmap.Config#ARGB_8888} or {@link Bitmap.Config#RGB_565} and
+     * have the size of the crop rect after rotation. See
+     * {@link #copyBitmapToByteBuffer(Bitmap, ByteBuffer, int, int, Rect, int, int, int[])} for
+     * the conversion.
+     *
+     * @param bitmap          destination bitmap.
+     * @param byteBuffer      source direct ByteBuffer.
+     * @param bufferStride    row stride of the ByteBuffer in bytes.
+     * @param bufferFormat    one of the {@code PIXEL_FORMAT_*} constants.
+     * @param cropRect        region of the ByteBuffer to copy, or null for the size of the bitmap
+     *                        before rotation.
+     * @param rotationDegrees clockwise rotation applied to the crop rect.
+     * @param alphaOp         one of the {@code ALPHA_OP_*} constants.
+     * @param channelOrder    null, or the input channel of every output channel in R, G, B, A
+     *                        order.
+     * @return true if the copy succeeds, otherwise false.
+     */
+    public static boolean copyByteBufferToBitmap(@NonNull Bitmap bitmap,
+            @NonNull ByteBuffer byteBuffer, int bufferStride, int bufferFormat,
+            @Nullable Rect cropRect,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            int alphaOp,
+            @Nullable int[] channelOrder) {
+        if (cropRect == null) {
+            boolean flipWH = rotationDegrees == 90 || rotationDegrees == 270;
+            cropRect = new Rect(0, 0, flipWH ? bitmap.getHeight() : bitmap.getWidth(),
+                    flipWH ? bitmap.getWidth() : bitmap.getHeight());
+        }
+        if (!isValidCopy(bitmap, cropRect, bufferStride)) {
+            return false;
+        }
+        int result = nativeCopyBetweenByteBufferAndBitmap(bitmap, byteBuffer, bufferFormat,
+                bufferStride, cropRect.left, cropRect.top, cropRect.width(), cropRect.height(),
+                rotationDegrees, alphaOp, channelOrder, true);
+        if (result != 0) {
+            Logger.e(TAG, "ByteBuffer to Bitmap copy failure");
+            return false;
+        }
+        return true;
+    }
+
+    private static boolean isSupportedBitmapConfig(@NonNull Bitmap bitmap) {
+        return bitmap.getConfig() == Bitmap.Config.ARGB_8888
+                || bitmap.getConfig() == Bitmap.Config.RGB_565;
+    }
+
+    private static void checkSupportedBitmapConfig(@NonNull Bitmap bitmap) {
+        Preconditions.checkArgument(isSupportedBitmapConfig(bitmap),
+                "Unsupported Bitmap config for copy: " + bitmap.getConfig());
+    }
+
+    // Logs why a copy between a Bitmap and a ByteBuffer cannot be done.
+    private static boolean isValidCopy(@NonNull Bitmap bitmap, @NonNull Rect cropRect,
+            int bufferStride) {
+        if (!isSupportedBitmapConfig(bitmap)) {
+            Logger.e(TAG, "Unsupported Bitmap config for copy: " + bitmap.getConfig());
+            return false;
+        }
+        if (cropRect.left < 0 || cropRect.top < 0 || cropRect.width() <= 0
+                || cropRect.height() <= 0 || bufferStride <= 0) {
+            Logger.e(TAG, "Invalid crop rect " + cropRect + " or stride " + bufferStride
+                    + " for copy");
+            return false;
+        }
+        return true;
     }
 
     /**
@@ -144,6 +883,29 @@ public final class ImageProcessingUtil {
         return true;
     }
 
+    /**
+     * Writes the JPEG data of a direct {@link ByteBuffer} as an Image into the Surface. The bytes
+     * between the position and the limit of the buffer are written. Returns true if it succeeds
+     * and false otherwise.
+     *
+     * <p>Unlike {@link #writeJpegBytesToSurface(Surface, byte[])}, the data is copied from the
+     * native address of the buffer directly into the Surface.
+     */
+    public static boolean writeJpegBufferToSurface(
+            @NonNull Surface surface,
+            @NonNull ByteBuffer jpegBuffer) {
+        Preconditions.checkNotNull(jpegBuffer);
+        Preconditions.checkNotNull(surface);
+        Preconditions.checkArgument(jpegBuffer.isDirect(), "JPEG buffer must be direct");
+
+        if (nativeWriteJpegBufferToSurface(jpegBuffer, jpegBuffer.position(),
+                jpegBuffer.remaining(), surface) != 0) {
+            Logger.e(TAG, "Failed to enqueue JPEG image.");
+            return false;
+        }
+        return true;
+    }
+
     /**
      * Convert a YUV_420_888 Image to a JPEG bytes data as an Image into the Surface.
      *
@@ -168,6 +930,18 @@ public final class ImageProcessingUtil {
             @IntRange(from = 1, to = 100) int jpegQuality,
             @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
             @NonNull Surface outputSurface) {
+        if (Build.VERSION.SDK_INT >= 30) {
+            if (!isSupportedYUVFormat(imageProxy)) {
+                Logger.e(TAG, "Unsupported format for YUV to JPEG");
+                return false;
+            }
+            // The native encoder leaves the Surface untouched when it fails, so the YuvImage
+            // encoder below can still post the JPEG.
+            if (convertYuvToJpegIntoSurfaceNative(imageProxy, jpegQuality, rotationDegrees,
+                    outputSurface)) {
+                return true;
+            }
+        }
         try {
             byte[] jpegBytes =
                     ImageUtil.yuvImageToJpegByteArray(
@@ -201,6 +975,74 @@ public final class ImageProcessingUtil {
             @Nullable ByteBuffer rgbConvertedBuffer,
             @IntRange(from = 0, to = 359) int rotationDegrees,
             boolean onePixelShiftEnabled) {
+        return convertYUVToRGB(imageProxy, rgbImageReaderProxy, rgbConvertedBuffer,
+                rotationDegrees, onePixelShiftEnabled, /*cropRect=*/null, SCALE_FILTER_BILINEAR);
+    }
+
+    /**
+     * Converts image proxy in YUV to RGB with the kernel cached in the given converter.
+     *
+     * <p>Falls back to {@link #convertYUVToRGB(ImageProxy, ImageReaderProxy, ByteBuffer, int,
+     * boolean)} if the converter cannot be used, e.g. when one pixel shift is enabled.
+     *
+     * @param imageProxy           input image proxy in YUV.
+     * @param rgbImageReaderProxy  output image reader proxy in RGB.
+     * @param rgbConvertedBuffer   intermediate image buffer for the fallback conversion.
+     * @param rotationDegrees      output image rotation degrees.
+     * @param onePixelShiftEnabled true if one pixel shift should be applied, otherwise false.
+     * @param yuvConverter         converter of the stream.
+     * @return output image proxy in RGB.
+     */
+    @Nullable
+    public static ImageProxy convertYUVToRGB(
+            @NonNull ImageProxy imageProxy,
+            @NonNull ImageReaderProxy rgbImageReaderProxy,
+            @Nullable ByteBuffer rgbConvertedBuffer,
+            @IntRange(from = 0, to = 359) int rotationDegrees,
+            boolean onePixelShiftEnabled,
+            @NonNull YuvConverter yuvConverter) {
+        boolean flipWH = rotationDegrees == 90 || rotationDegrees == 270;
+        if (!onePixelShiftEnabled
+                && isSupportedYUVFormat(imageProxy)
+                && yuvConverter.getRotationDegrees() == rotationDegrees
+                && rgbImageReaderProxy.getWidth()
+                        == (flipWH ? imageProxy.getHeight() : imageProxy.getWidth())
+                && rgbImageReaderProxy.getHeight()
+                        == (flipWH ? imageProxy.getWidth() : imageProxy.getHeight())
+                && yuvConverter.convertToRGB(imageProxy, rgbImageReaderProxy.getSurface())) {
+            return acquireRGBImageProxy(imageProxy, rgbImageReaderProxy);
+        }
+        return convertYUVToRGB(imageProxy, rgbImageReaderProxy, rgbConvertedBuffer,
+                rotationDegrees, onePixelShiftEnabled);
+    }
+
+    /**
+     * Converts the crop rect of an image proxy in YUV to RGB, scaled to the size of the output
+     * image reader proxy.
+     *
+     * <p>Only the crop rect of the input is read, and scaling is done on the YUV planes before
+     * the color conversion, so small outputs of large inputs are much cheaper than converting
+     * the whole image.
+     *
+     * @param imageProxy           input image proxy in YUV.
+     * @param rgbImageReaderProxy  output image reader proxy in RGB. Its size, after rotation, is
+     *                             the output size.
+     * @param rgbConvertedBuffer   intermediate image buffer for format conversion.
+     * @param rotationDegrees      output image rotation degrees.
+     * @param onePixelShiftEnabled true if one pixel shift should be applied, otherwise false.
+     * @param cropRect             region of the input to convert, or null for the whole image.
+     * @param filterMode           {@link #SCALE_FILTER_BILINEAR} or {@link #SCALE_FILTER_BOX}.
+     * @return output image proxy in RGB.
+     */
+    @Nullable
+    public static ImageProxy convertYUVToRGB(
+            @NonNull ImageProxy imageProxy,
+            @NonNull ImageReaderProxy rgbImageReaderProxy,
+            @Nullable ByteBuffer rgbConvertedBuffer,
+            @IntRange(from = 0, to = 359) int rotationDegrees,
+            boolean onePixelShiftEnabled,
+            @Nullable Rect cropRect,
+            int filterMode) {
         if (!isSupportedYUVFormat(imageProxy)) {
             Logger.e(TAG, "Unsupported format for YUV to RGB");
             return null;
@@ -212,13 +1054,40 @@ public final class ImageProcessingUtil {
             return null;
         }
 
+        boolean flipWH = rotationDegrees == 90 || rotationDegrees == 270;
+        int outputWidth = flipWH ? rgbImageReaderProxy.getHeight()
+                : rgbImageReaderProxy.getWidth();
+        int outputHeight = flipWH ? rgbImageReaderProxy.getWidth()
+                : rgbImageReaderProxy.getHeight();
+        if (cropRect == null) {
+            cropRect = new Rect(0, 0, imageProxy.getWidth(), imageProxy.getHeight());
+        }
+        // The native one pixel shift workaround only supports converting the full image, so it
+        // is applied in place first for cropped or scaled conversions.
+        boolean isFullFrame = cropRect.left == 0 && cropRect.top == 0
+                && cropRect.width() == imageProxy.getWidth()
+                && cropRect.height() == imageProxy.getHeight()
+                && outputWidth == imageProxy.getWidth()
+                && outputHeight == imageProxy.getHeight();
+        if (onePixelShiftEnabled && !isFullFrame) {
+            if (applyPixelShiftInternal(imageProxy) == ERROR_CONVERSION) {
+                Logger.e(TAG, "One pixel shift for YUV failure");
+                return null;
+            }
+            onePixelShiftEnabled = false;
+        }
+
         // Convert YUV To RGB and write data to surface
         Result result = convertYUVToRGBInternal(
                 imageProxy,
                 rgbImageReaderProxy.getSurface(),
                 rgbConvertedBuffer,
                 rotationDegrees,
-                onePixelShiftEnabled);
+                onePixelShiftEnabled,
+                cropRect,
+                outputWidth,
+                outputHeight,
+                filterMode);
 
         if (result == ERROR_CONVERSION) {
             Logger.e(TAG, "YUV to RGB conversion failure");
@@ -233,6 +1102,13 @@ public final class ImageProcessingUtil {
             sImageCount++;
         }
 
+        return acquireRGBImageProxy(imageProxy, rgbImageReaderProxy);
+    }
+
+    @Nullable
+    private static ImageProxy acquireRGBImageProxy(
+            @NonNull ImageProxy imageProxy,
+            @NonNull ImageReaderProxy rgbImageReaderProxy) {
         // Retrieve ImageProxy in RGB
         final ImageProxy rgbImageProxy = rgbImageReaderProxy.acquireLatestImage();
         if (rgbImageProxy == null) {
@@ -265,9 +1141,33 @@ public final class ImageProcessingUtil {
      */
     @NonNull
     public static Bitmap convertYUVToBitmap(@NonNull ImageProxy imageProxy) {
+        return convertYUVToBitmap(imageProxy, /*cropRect=*/null, imageProxy.getWidth(),
+                imageProxy.getHeight(), SCALE_FILTER_BILINEAR);
+    }
+
+    /**
+     * Converts the crop rect of an image proxy in YUV to a {@link Bitmap} of the given size.
+     *
+     * <p>Only the crop rect of the input is read and scaling is done before the color
+     * conversion. If input format is invalid, {@link IllegalArgumentException} will be thrown.
+     * If the conversion to bitmap failed, {@link UnsupportedOperationException} will be thrown.
+     *
+     * @param imageProxy   input image proxy in YUV.
+     * @param cropRect     region of the input to convert, or null for the whole image.
+     * @param outputWidth  width of the output bitmap.
+     * @param outputHeight height of the output bitmap.
+     * @param filterMode   {@link #SCALE_FILTER_BILINEAR} or {@link #SCALE_FILTER_BOX}.
+     * @return bitmap output bitmap in RGBA.
+     */
+    @NonNull
+    public static Bitmap convertYUVToBitmap(@NonNull ImageProxy imageProxy,
+            @Nullable Rect cropRect, int outputWidth, int outputHeight, int filterMode) {
         if (imageProxy.getFormat() != ImageFormat.YUV_420_888) {
             throw new IllegalArgumentException("Input image format must be YUV_420_888");
         }
+        if (cropRect == null) {
+            cropRect = new Rect(0, 0, imageProxy.getWidth(), imageProxy.getHeight());
+        }
 
         int imageWidth = imageProxy.getWidth();
         int imageHeight = imageProxy.getHeight();
@@ -277,8 +1177,7 @@ public final class ImageProcessingUtil {
         int srcPixelStrideY = imageProxy.getPlanes()[0].getPixelStride();
         int srcPixelStrideUV = imageProxy.getPlanes()[1].getPixelStride();
 
-        Bitmap bitmap = Bitmap.createBitmap(imageProxy.getWidth(),
-                imageProxy.getHeight(), Bitmap.Config.ARGB_8888);
+        Bitmap bitmap = Bitmap.createBitmap(outputWidth, outputHeight, Bitmap.Config.ARGB_8888);
         int bitmapStride = bitmap.getRowBytes();
 
         int result = nativeConvertAndroid420ToBitmap(
@@ -293,13 +1192,217 @@ public final class ImageProcessingUtil {
                 bitmap,
                 bitmapStride,
                 imageWidth,
-                imageHeight);
+                imageHeight,
+                cropRect.left,
+                cropRect.top,
+                cropRect.width(),
+                cropRect.height(),
+                outputWidth,
+                outputHeight,
+                filterMode);
         if (result != 0) {
             throw new UnsupportedOperationException("YUV to RGB conversion failed");
         }
         return bitmap;
     }
 
+    /**
+     * Converts the crop rect of a YUV image proxy into a normalized RGB tensor for ML inference.
+     *
+     * <p>Cropping, scaling to the tensor size, rotation, color conversion, normalization and
+     * quantization are done natively in a single pass over the output, without intermediate
+     * {@link Bitmap}s. Each channel value is computed as {@code (rgb / 255 - mean) / std}. For
+     * {@link #TENSOR_DATA_TYPE_INT8} it is then quantized as
+     * {@code round(value / quantScale) + quantZeroPoint}. Multi-byte elements are written in the
+     * native byte order.
+     *
+     * @param imageProxy      input image proxy in YUV.
+     * @param cropRect        region of the input image to convert, or null for the whole image.
+     * @param rotationDegrees clockwise rotation applied to the cropped image.
+     * @param tensorBuffer    direct output buffer with room for
+     *                        {@code tensorWidth * tensorHeight * 3} elements.
+     * @param tensorWidth     width of the tensor, after rotation.
+     * @param tensorHeight    height of the tensor, after rotation.
+     * @param dataType        one of the {@code TENSOR_DATA_TYPE_*} constants.
+     * @param layout          one of the {@code TENSOR_LAYOUT_*} constants.
+     * @param mean            per channel mean, in R, G, B order.
+     * @param std             per channel standard deviation, in R, G, B order.
+     * @param quantScale      quantization scale, only used for {@link #TENSOR_DATA_TYPE_INT8}.
+     * @param quantZeroPoint  quantization zero point, only used for
+     *                        {@link #TENSOR_DATA_TYPE_INT8}.
+     * @return true if the conversion succeeds, otherwise false.
+     */
+    public static boolean convertYUVToTensor(
+            @NonNull ImageProxy imageProxy,
+            @Nullable Rect cropRect,
+            @IntRange(from = 0, to = 359) int rotationDegrees,
+            @NonNull ByteBuffer tensorBuffer,
+            int tensorWidth,
+            int tensorHeight,
+            int dataType,
+            int layout,
+            @NonNull float[] mean,
+            @NonNull float[] std,
+            float quantScale,
+            int quantZeroPoint) {
+        if (!isSupportedYUVFormat(imageProxy)) {
+            Logger.e(TAG, "Unsupported format for YUV to tensor");
+            return false;
+        }
+        if (!isSupportedRotationDegrees(rotationDegrees)) {
+            Logger.e(TAG, "Unsupported rotation degrees for YUV to tensor");
+            return false;
+        }
+        Preconditions.checkArgument(tensorBuffer.isDirect(), "Tensor buffer must be direct");
+        Preconditions.checkArgument(mean.length == 3 && std.length == 3,
+                "Mean and std must have one value per RGB channel");
+        if (cropRect == null) {
+            cropRect = new Rect(0, 0, imageProxy.getWidth(), imageProxy.getHeight());
+        }
+
+        int result = nativeConvertAndroid420ToTensor(
+                imageProxy.getPlanes()[0].getBuffer(),
+                imageProxy.getPlanes()[0].getRowStride(),
+                imageProxy.getPlanes()[1].getBuffer(),
+                imageProxy.getPlanes()[1].getRowStride(),
+                imageProxy.getPlanes()[2].getBuffer(),
+                imageProxy.getPlanes()[2].getRowStride(),
+                imageProxy.getPlanes()[0].getPixelStride(),
+                imageProxy.getPlanes()[1].getPixelStride(),
+                imageProxy.getWidth(),
+                imageProxy.getHeight(),
+                cropRect.left,
+                cropRect.top,
+                cropRect.width(),
+                cropRect.height(),
+                rotationDegrees,
+                tensorBuffer,
+                tensorWidth,
+                tensorHeight,
+                dataType,
+                layout,
+                mean,
+                std,
+                quantScale,
+                quantZeroPoint);
+        if (result != 0) {
+            Logger.e(TAG, "YUV to tensor conversion failure");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Computes the luma histogram, mean, variance, sharpness and exposure ratios of a YUV image.
+     *
+     * <p>All the statistics come from a single native pass over the Y plane. Only every
+     * {@code sampleStep}-th pixel of every {@code sampleStep}-th row is visited, which is
+     * usually enough for exposure and blur checks and makes the pass much cheaper.
+     *
+     * @param imageProxy            input image proxy in YUV.
+     * @param roi                   region of the image to analyze, or null for the whole image.
+     * @param sampleStep            distance in pixels between the samples, 1 for every pixel.
+     * @param underExposedThreshold luma value at or below which a sample is under exposed.
+     * @param overExposedThreshold  luma value at or above which a sample is over exposed.
+     * @return the statistics, or null if the computation fails.
+     */
+    @Nullable
+    public static LumaStatistics computeLumaStatistics(
+            @NonNull ImageProxy imageProxy,
+            @Nullable Rect roi,
+            @IntRange(from = 1) int sampleStep,
+            @IntRange(from = 0, to = 255) int underExposedThreshold,
+            @IntRange(from = 0, to = 255) int overExposedThreshold) {
+        if (!isSupportedYUVFormat(imageProxy)) {
+            Logger.e(TAG, "Unsupported format for luma statistics");
+            return null;
+        }
+        if (roi == null) {
+            roi = new Rect(0, 0, imageProxy.getWidth(), imageProxy.getHeight());
+        }
+
+        int[] histogram = new int[256];
+        float[] results = new float[5];
+        int result = nativeComputeLumaStatistics(
+                imageProxy.getPlanes()[0].getBuffer(),
+                imageProxy.getPlanes()[0].getRowStride(),
+                imageProxy.getPlanes()[0].getPixelStride(),
+                imageProxy.getWidth(),
+                imageProxy.getHeight(),
+                roi.left,
+                roi.top,
+                roi.width(),
+                roi.height(),
+                sampleStep,
+                underExposedThreshold,
+                overExposedThreshold,
+                histogram,
+                results);
+        if (result != 0) {
+            Logger.e(TAG, "Luma statistics failure");
+            return null;
+        }
+        return new LumaStatistics(histogram, results);
+    }
+
+    /**
+     * Converts a {@link ImageFormat#YCBCR_P010} image to a 10-bit or half float {@link Bitmap}.
+     *
+     * <p>The output format is taken from the bitmap, which must be
+     * {@link Bitmap.Config#RGBA_1010102} or {@link Bitmap.Config#RGBA_F16} and have the size of the
+     * image after rotation. RGBA_1010102 output keeps the encoded signal, so the caller is
+     * responsible for tagging the bitmap with the color space of the source. RGBA_F16 output is
+     * linear with BT.2020 primaries for {@link #HDR_TRANSFER_HLG} and {@link #HDR_TRANSFER_PQ},
+     * where 1.0 is the 203 nits reference white.
+     *
+     * @param imageProxy      input image proxy in P010.
+     * @param bitmap          output bitmap.
+     * @param rotationDegrees clockwise rotation applied to the image.
+     * @param colorStandard   one of the {@code HDR_COLOR_STANDARD_*} constants.
+     * @param transfer        one of the {@code HDR_TRANSFER_*} constants.
+     * @return true if the conversion succeeds, otherwise false.
+     */
+    @RequiresApi(33)
+    public static boolean convertP010ToBitmap(
+            @NonNull ImageProxy imageProxy,
+            @NonNull Bitmap bitmap,
+            @IntRange(from = 0, to = 359) int rotationDegrees,
+            int colorStandard,
+            int transfer) {
+        if (imageProxy.getFormat() != ImageFormat.YCBCR_P010) {
+            Logger.e(TAG, "Unsupported format for P010 to bitmap");
+            return false;
+        }
+        if (!isSupportedRotationDegrees(rotationDegrees)) {
+            Logger.e(TAG, "Unsupported rotation degrees for P010 to bitmap");
+            return false;
+        }
+
+        // P010 interleaves 16-bit U and V samples, starting with U, so the U plane holds the
+        // interleaved chroma.
+        if (imageProxy.getPlanes().length != 3
+                || imageProxy.getPlanes()[1].getPixelStride() != 4) {
+            Logger.e(TAG, "Unsupported chroma layout for P010 to bitmap");
+            return false;
+        }
+        int result = nativeConvertP010ToBitmap(
+                imageProxy.getPlanes()[0].getBuffer(),
+                imageProxy.getPlanes()[0].getRowStride(),
+                imageProxy.getPlanes()[1].getBuffer(),
+                imageProxy.getPlanes()[1].getRowStride(),
+                imageProxy.getWidth(),
+                imageProxy.getHeight(),
+                bitmap,
+                rotationDegrees,
+                colorStandard,
+                transfer);
+        if (result != 0) {
+            Logger.e(TAG, "P010 to bitmap conversion failure");
+            return false;
+        }
+        return true;
+    }
+
     /**
      * Applies one pixel shift workaround for YUV image
      *
@@ -342,6 +1445,34 @@ public final class ImageProcessingUtil {
             @NonNull ByteBuffer uRotatedBuffer,
             @NonNull ByteBuffer vRotatedBuffer,
             @IntRange(from = 0, to = 359) int rotationDegrees) {
+        return rotateYUV(imageProxy, rotatedImageReaderProxy, rotatedImageWriter, yRotatedBuffer,
+                uRotatedBuffer, vRotatedBuffer, rotationDegrees, /*yuvConverter=*/null);
+    }
+
+    /**
+     * Rotates YUV image proxy, with the kernel cached in the given converter when it has one for
+     * the stream.
+     *
+     * @param imageProxy              input image proxy.
+     * @param rotatedImageReaderProxy input image reader proxy.
+     * @param rotatedImageWriter      output image writer.
+     * @param yRotatedBuffer          intermediate image buffer for y plane rotation.
+     * @param uRotatedBuffer          intermediate image buffer for u plane rotation.
+     * @param vRotatedBuffer          intermediate image buffer for v plane rotation.
+     * @param rotationDegrees         output image rotation degrees.
+     * @param yuvConverter            converter of the stream, or null.
+     * @return rotated image proxy or null if rotation fails or format is not supported.
+     */
+    @Nullable
+    public static ImageProxy rotateYUV(
+            @NonNull ImageProxy imageProxy,
+            @NonNull ImageReaderProxy rotatedImageReaderProxy,
+            @NonNull ImageWriter rotatedImageWriter,
+            @NonNull ByteBuffer yRotatedBuffer,
+            @NonNull ByteBuffer uRotatedBuffer,
+            @NonNull ByteBuffer vRotatedBuffer,
+            @IntRange(from = 0, to = 359) int rotationDegrees,
+            @Nullable YuvConverter yuvConverter) {
         if (!isSupportedYUVFormat(imageProxy)) {
             Logger.e(TAG, "Unsupported format for rotate YUV");
             return null;
@@ -363,7 +1494,8 @@ public final class ImageProcessingUtil {
                     yRotatedBuffer,
                     uRotatedBuffer,
                     vRotatedBuffer,
-                    rotationDegrees);
+                    rotationDegrees,
+                    yuvConverter);
         }
 
         if (result == ERROR_CONVERSION) {
@@ -390,6 +1522,62 @@ public final class ImageProcessingUtil {
         return wrappedRotatedImageProxy;
     }
 
+    /**
+     * Encodes the YUV_420_888 image natively and writes the JPEG data into the buffer of the
+     * Surface. The platform JPEG encoder used by the native code requires API 30.
+     *
+     * <p>Returns false without posting a buffer to the Surface if it fails.
+     */
+    @RequiresApi(30)
+    private static boolean convertYuvToJpegIntoSurfaceNative(
+            @NonNull ImageProxy imageProxy,
+            @IntRange(from = 1, to = 100) int jpegQuality,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            @NonNull Surface outputSurface) {
+        byte[] exifSegment;
+        try {
+            exifSegment = createExifSegment(ExifData.create(imageProxy, rotationDegrees));
+        } catch (IOException e) {
+            Logger.e(TAG, "Failed to create Exif segment", e);
+            return false;
+        }
+
+        int result = nativeConvertAndroid420ToJpegSurface(
+                imageProxy.getPlanes()[0].getBuffer(),
+                imageProxy.getPlanes()[0].getRowStride(),
+                imageProxy.getPlanes()[1].getBuffer(),
+                imageProxy.getPlanes()[1].getRowStride(),
+                imageProxy.getPlanes()[2].getBuffer(),
+                imageProxy.getPlanes()[2].getRowStride(),
+                imageProxy.getPlanes()[0].getPixelStride(),
+                imageProxy.getPlanes()[1].getPixelStride(),
+                imageProxy.getWidth(),
+                imageProxy.getHeight(),
+                exifSegment,
+                jpegQuality,
+                outputSurface);
+        if (result != 0) {
+            Logger.w(TAG, "Failed to encode YUV to JPEG natively.");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Returns the APP1 segment, marker included, that {@link ExifOutputStream} writes for the
+     * given {@link ExifData}.
+     */
+    @NonNull
+    private static byte[] createExifSegment(@NonNull ExifData exifData) throws IOException {
+        ByteArrayOutputStream byteArrayOutputStream = new ByteArrayOutputStream();
+        try (OutputStream out = new ExifOutputStream(byteArrayOutputStream, exifData)) {
+            out.write(EMPTY_JPEG);
+        }
+        byte[] bytes = byteArrayOutputStream.toByteArray();
+        // Strip the SOI and EOI markers.
+        return Arrays.copyOfRange(bytes, 2, bytes.length - 2);
+    }
+
     private static boolean isSupportedYUVFormat(@NonNull ImageProxy imageProxy) {
         return imageProxy.getFormat() == ImageFormat.YUV_420_888
                 && imageProxy.getPlanes().length == 3;
@@ -409,7 +1597,11 @@ public final class ImageProcessingUtil {
             @NonNull Surface surface,
             @Nullable ByteBuffer rgbConvertedBuffer,
             @ImageOutputConfig.RotationDegreesValue int rotation,
-            boolean onePixelShiftEnabled) {
+            boolean onePixelShiftEnabled,
+            @NonNull Rect cropRect,
+            int outputWidth,
+            int outputHeight,
+            int filterMode) {
         int imageWidth = imageProxy.getWidth();
         int imageHeight = imageProxy.getHeight();
         int srcStrideY = imageProxy.getPlanes()[0].getRowStride();
@@ -438,7 +1630,14 @@ public final class ImageProcessingUtil {
                 startOffsetY,
                 startOffsetU,
                 startOffsetV,
-                rotation);
+                rotation,
+                cropRect.left,
+                cropRect.top,
+                cropRect.width(),
+                cropRect.height(),
+                outputWidth,
+                outputHeight,
+                filterMode);
         if (result != 0) {
             return ERROR_CONVERSION;
         }
@@ -487,7 +1686,8 @@ public final class ImageProcessingUtil {
             @NonNull ByteBuffer yRotatedBuffer,
             @NonNull ByteBuffer uRotatedBuffer,
             @NonNull ByteBuffer vRotatedBuffer,
-            @ImageOutputConfig.RotationDegreesValue int rotationDegrees) {
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            @Nullable YuvConverter yuvConverter) {
         int imageWidth = imageProxy.getWidth();
         int imageHeight = imageProxy.getHeight();
         int srcStrideY = imageProxy.getPlanes()[0].getRowStride();
@@ -500,6 +1700,12 @@ public final class ImageProcessingUtil {
             return ERROR_CONVERSION;
         }
 
+        if (yuvConverter != null && yuvConverter.getRotationDegrees() == rotationDegrees
+                && yuvConverter.rotateYUV(imageProxy, rotatedImage)) {
+            ImageWriterCompat.queueInputImage(rotatedImageWriter, rotatedImage);
+            return SUCCESS;
+        }
+
         int result = nativeRotateYUV(
                 imageProxy.getPlanes()[0].getBuffer(),
                 srcStrideY,
@@ -535,13 +1741,39 @@ public final class ImageProcessingUtil {
 
     private static native int nativeCopyBetweenByteBufferAndBitmap(Bitmap bitmap,
             ByteBuffer byteBuffer,
-            int sourceStride, int destinationStride, int width, int height,
+            int bufferFormat,
+            int bufferStride,
+            int cropLeft,
+            int cropTop,
+            int cropWidth,
+            int cropHeight,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            int alphaOp,
+            @Nullable int[] channelOrder,
             boolean isCopyBufferToBitmap);
 
 
     private static native int nativeWriteJpegToSurface(@NonNull byte[] jpegArray,
             @NonNull Surface surface);
 
+    private static native int nativeWriteJpegBufferToSurface(@NonNull ByteBuffer jpegBuffer,
+            int offset, int size, @NonNull Surface surface);
+
+    private static native int nativeConvertAndroid420ToJpegSurface(
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideY,
+            int srcPixelStrideUV,
+            int width,
+            int height,
+            @Nullable byte[] exifSegment,
+            @IntRange(from = 1, to = 100) int jpegQuality,
+            @NonNull Surface surface);
+
     private static native int nativeConvertAndroid420ToABGR(
             @NonNull ByteBuffer srcByteBufferY,
             int srcStrideY,
@@ -558,7 +1790,14 @@ public final class ImageProcessingUtil {
             int startOffsetY,
             int startOffsetU,
             int startOffsetV,
-            @ImageOutputConfig.RotationDegreesValue int rotationDegrees);
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            int cropLeft,
+            int cropTop,
+            int cropWidth,
+            int cropHeight,
+            int outputWidth,
+            int outputHeight,
+            int filterMode);
 
     private static native int nativeConvertAndroid420ToBitmap(
             @NonNull ByteBuffer srcByteBufferY,
@@ -572,8 +1811,179 @@ public final class ImageProcessingUtil {
             @NonNull Bitmap bitmap,
             int bitmapStride,
             int width,
+            int height,
+            int cropLeft,
+            int cropTop,
+            int cropWidth,
+            int cropHeight,
+            int outputWidth,
+            int outputHeight,
+            int filterMode);
+
+    private static native int nativeConvertAndroid420ToTensor(
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideY,
+            int srcPixelStrideUV,
+            int width,
+            int height,
+            int cropLeft,
+            int cropTop,
+            int cropWidth,
+            int cropHeight,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            @NonNull ByteBuffer tensorBuffer,
+            int tensorWidth,
+            int tensorHeight,
+            int dataType,
+            int layout,
+            @NonNull float[] mean,
+            @NonNull float[] std,
+            float quantScale,
+            int quantZeroPoint);
+
+    private static native int nativeComputeLumaStatistics(
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            int srcPixelStrideY,
+            int width,
+            int height,
+            int roiLeft,
+            int roiTop,
+            int roiWidth,
+            int roiHeight,
+            int sampleStep,
+            int underExposedThreshold,
+            int overExposedThreshold,
+            @NonNull int[] histogram,
+            @NonNull float[] results);
+
+    private static native long nativeCreateYuvConverter(
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideUV,
+            @Nullable ByteBuffer dstByteBufferU,
+            int dstStrideU,
+            @Nullable ByteBuffer dstByteBufferV,
+            int dstStrideV,
+            int dstPixelStrideUV,
+            int width,
+            int height,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees);
+
+    private static native void nativeDestroyYuvConverter(long converter);
+
+    private static native int nativeConvertWithYuvConverter(
+            long converter,
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideUV,
+            @NonNull Surface surface);
+
+    private static native int nativeRotateWithYuvConverter(
+            long converter,
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideUV,
+            @NonNull ByteBuffer dstByteBufferY,
+            int dstStrideY,
+            @NonNull ByteBuffer dstByteBufferU,
+            int dstStrideU,
+            @NonNull ByteBuffer dstByteBufferV,
+            int dstStrideV,
+            int dstPixelStrideUV);
+
+    private static native long nativeCreateMotionDetector(int width, int height,
+            int downsampleFactor, int tileSize, int threshold);
+
+    private static native void nativeDestroyMotionDetector(long detector);
+
+    private static native int nativeGetMotionTileCount(long detector, boolean vertical);
+
+    private static native void nativeResetMotionDetector(long detector);
+
+    private static native int nativeDetectMotion(
+            long detector,
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            int srcPixelStrideY,
+            boolean updateReference,
+            @NonNull byte[] tileMap,
+            @NonNull float[] score);
+
+    private static native long nativeCreateRemapTable(int srcWidth, int srcHeight,
+            int dstWidth, int dstHeight, @NonNull float[] matrix, @Nullable float[] intrinsics,
+            @Nullable float[] distortion, int threadCount);
+
+    private static native void nativeDestroyRemapTable(long table);
+
+    private static native int nativeRemapYUV(
+            long table,
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideUV,
+            @NonNull ByteBuffer dstByteBufferY,
+            int dstStrideY,
+            @NonNull ByteBuffer dstByteBufferU,
+            int dstStrideU,
+            @NonNull ByteBuffer dstByteBufferV,
+            int dstStrideV,
+            int dstPixelStrideUV);
+
+    private static native int nativeRemapBitmap(long table, @NonNull Bitmap bitmap,
+            @NonNull Bitmap outputBitmap);
+
+    private static native long nativeCreateImagePyramid(int width, int height, int channelCount,
+            int levelCount);
+
+    private static native void nativeDestroyImagePyramid(long pyramid);
+
+    private static native int nativeGetImagePyramidLevelCount(long pyramid);
+
+    private static native int nativeGetImagePyramidLevelSize(long pyramid, int level,
+            @NonNull int[] size);
+
+    private static native int nativeSetImagePyramidLevel(long pyramid, int level,
+            @NonNull ByteBuffer buffer);
+
+    private static native int nativeBuildImagePyramid(
+            long pyramid,
+            @NonNull ByteBuffer srcByteBuffer,
+            int srcStride,
+            int srcPixelStride,
+            int width,
             int height);
 
+    private static native int nativeConvertP010ToBitmap(
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferUV,
+            int srcStrideUV,
+            int width,
+            int height,
+            @NonNull Bitmap bitmap,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            int colorStandard,
+            int transfer);
+
     private static native int nativeShiftPixel(
             @NonNull ByteBuffer srcByteBufferY,
             int srcStrideY,
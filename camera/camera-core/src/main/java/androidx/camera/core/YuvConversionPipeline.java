@@ -0,0 +1,368 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.camera.core;
+
+import android.graphics.ImageFormat;
+import android.os.Looper;
+import android.os.MessageQueue;
+import android.os.ParcelFileDescriptor;
+
+import androidx.annotation.GuardedBy;
+import androidx.annotation.IntRange;
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+import androidx.annotation.RequiresApi;
+import androidx.annotation.RestrictTo;
+import androidx.annotation.VisibleForTesting;
+import androidx.camera.core.impl.ImageOutputConfig;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+/**
+ * Converts YUV images to rotated RGBA on a native worker thread.
+ *
+ * <p>{@link #submit(ImageProxy)} copies the image into a bounded ring and returns, so the
+ * image can be closed right away and the camera thread is not blocked by the conversion. When
+ * the ring is full the oldest frame that is not being converted or held by the listener is
+ * dropped, whether it is waiting for conversion or for delivery. Converted frames are delivered to the listener on the given {@link Looper}, which lets
+ * the conversion of the next frame overlap with the processing of the current one.
+ */
+@RequiresApi(23)
+@RestrictTo(RestrictTo.Scope.LIBRARY_GROUP)
+public final class YuvConversionPipeline {
+
+    private static final String TAG = "YuvConversionPipeline";
+
+    static {
+        System.loadLibrary("image_processing_util_jni");
+    }
+
+    /** Copying the image into the ring, on the submitting thread. */
+    public static final int STAGE_COPY = 0;
+    /** Waiting in the ring for the worker thread. */
+    public static final int STAGE_QUEUE = 1;
+    /** Converting and rotating on the worker thread. */
+    public static final int STAGE_CONVERT = 2;
+    /** Waiting for the listener to receive the converted frame. */
+    public static final int STAGE_DELIVER = 3;
+    private static final int STAGE_COUNT = 4;
+
+    /** Receives converted frames. */
+    public interface OnFrameConvertedListener {
+        /**
+         * Called on the looper of the pipeline with a converted frame. The frame must be closed
+         * to return its slot to the ring.
+         */
+        void onFrameConverted(@NonNull ConvertedFrame frame);
+    }
+
+    /** A converted RGBA_8888 frame, backed by a slot of the ring. */
+    public final class ConvertedFrame implements AutoCloseable {
+        private final int mSlot;
+        private final long mTimestampNanos;
+        private boolean mClosed;
+
+        ConvertedFrame(int slot, long timestampNanos) {
+            mSlot = slot;
+            mTimestampNanos = timestampNanos;
+        }
+
+        /** Returns the pixels, valid until the frame is closed. */
+        @NonNull
+        public ByteBuffer getBuffer() {
+            return mOutputBuffers[mSlot].duplicate();
+        }
+
+        public int getWidth() {
+            return mOutputWidth;
+        }
+
+        public int getHeight() {
+            return mOutputHeight;
+        }
+
+        public int getRowStride() {
+            return mOutputWidth * 4;
+        }
+
+        /** Returns the timestamp of the image the frame was converted from. */
+        public long getTimestampNanos() {
+            return mTimestampNanos;
+        }
+
+        @Override
+        public void close() {
+            synchronized (mLock) {
+                if (mClosed || mNativePipeline == 0) {
+                    return;
+                }
+                mClosed = true;
+                nativeRelease(mNativePipeline, mSlot);
+            }
+        }
+    }
+
+    /** Latency counters of the stages of the pipeline. */
+    public static final class LatencyStats {
+        private final long[] mStats;
+
+        LatencyStats(@NonNull long[] stats) {
+            mStats = stats;
+        }
+
+        /** Returns the number of frames that went through the stage. */
+        public long getCount(int stage) {
+            return mStats[stage * 3];
+        }
+
+        /** Returns the average time frames spent in the stage. */
+        public long getAverageNanos(int stage) {
+            long count = getCount(stage);
+            return count == 0 ? 0 : mStats[stage * 3 + 1] / count;
+        }
+
+        /** Returns the longest time a frame spent in the stage. */
+        public long getMaxNanos(int stage) {
+            return mStats[stage * 3 + 2];
+        }
+
+        /** Returns the number of frames dropped because the ring was full. */
+        public long getDroppedCount() {
+            return mStats[STAGE_COUNT * 3];
+        }
+    }
+
+    private final Object mLock = new Object();
+    @GuardedBy("mLock")
+    private long mNativePipeline;
+    // Number of submit calls copying into the ring outside of mLock. The native pipeline is not
+    // destroyed until they return.
+    @GuardedBy("mLock")
+    private int mSubmitsInFlight;
+    @GuardedBy("mLock")
+    private boolean mClosing;
+    private final int mWidth;
+    private final int mHeight;
+    private final int mOutputWidth;
+    private final int mOutputHeight;
+    private final ByteBuffer[] mOutputBuffers;
+    private final ParcelFileDescriptor mEventFd;
+    private final MessageQueue mMessageQueue;
+    private final OnFrameConvertedListener mListener;
+
+    private YuvConversionPipeline(long nativePipeline, int width, int height, int rotationDegrees,
+            int capacity, @NonNull ParcelFileDescriptor eventFd, @NonNull Looper looper,
+            @NonNull OnFrameConvertedListener listener) {
+        mNativePipeline = nativePipeline;
+        mWidth = width;
+        mHeight = height;
+        boolean flipWH = rotationDegrees == 90 || rotationDegrees == 270;
+        mOutputWidth = flipWH ? height : width;
+        mOutputHeight = flipWH ? width : height;
+        mOutputBuffers = new ByteBuffer[capacity];
+        for (int i = 0; i < capacity; i++) {
+            mOutputBuffers[i] = nativeGetOutputBuffer(nativePipeline, i);
+        }
+        mEventFd = eventFd;
+        mMessageQueue = looper.getQueue();
+        mListener = listener;
+        mMessageQueue.addOnFileDescriptorEventListener(mEventFd.getFileDescriptor(),
+                MessageQueue.OnFileDescriptorEventListener.EVENT_INPUT,
+                (fd, events) -> {
+                    deliverFrames();
+                    return MessageQueue.OnFileDescriptorEventListener.EVENT_INPUT;
+                });
+    }
+
+    /**
+     * Creates a pipeline for YUV_420_888 images of the given size.
+     *
+     * @param width           width of the images.
+     * @param height          height of the images.
+     * @param rotationDegrees clockwise rotation applied to the images.
+     * @param capacity        number of frames in the ring.
+     * @param looper          looper the listener is called on.
+     * @param listener        receives the converted frames.
+     * @return the pipeline, or null if it cannot be created.
+     */
+    @Nullable
+    public static YuvConversionPipeline create(int width, int height,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees,
+            @IntRange(from = 1) int capacity,
+            @NonNull Looper looper,
+            @NonNull OnFrameConvertedListener listener) {
+        long nativePipeline = nativeCreate(width, height, rotationDegrees, capacity);
+        if (nativePipeline == 0) {
+            return null;
+        }
+        ParcelFileDescriptor eventFd;
+        try {
+            // The native fd stays owned by the pipeline, the listener uses a duplicate.
+            eventFd = ParcelFileDescriptor.fromFd(nativeGetEventFd(nativePipeline));
+        } catch (IOException e) {
+            Logger.e(TAG, "Failed to duplicate the event fd", e);
+            nativeDestroy(nativePipeline);
+            return null;
+        }
+        return new YuvConversionPipeline(nativePipeline, width, height, rotationDegrees,
+                capacity, eventFd, looper, listener);
+    }
+
+    /**
+     * Copies the image into the ring for conversion. The image can be closed as soon as this
+     * returns.
+     *
+     * @return false if the image cannot be converted, or is dropped because every frame of the
+     * ring is busy.
+     */
+    public boolean submit(@NonNull ImageProxy imageProxy) {
+        if (imageProxy.getFormat() != ImageFormat.YUV_420_888
+                || imageProxy.getPlanes().length != 3
+                || imageProxy.getWidth() != mWidth
+                || imageProxy.getHeight() != mHeight) {
+            Logger.e(TAG, "Unsupported image for the conversion pipeline");
+            return false;
+        }
+        long nativePipeline;
+        synchronized (mLock) {
+            if (mNativePipeline == 0 || mClosing) {
+                return false;
+            }
+            nativePipeline = mNativePipeline;
+            mSubmitsInFlight++;
+        }
+        // The copy of the full frame runs without mLock, so that releasing frames and reading
+        // the stats are not blocked by it. The native ring is thread safe.
+        try {
+            return nativeSubmit(
+                    nativePipeline,
+                    imageProxy.getPlanes()[0].getBuffer(),
+                    imageProxy.getPlanes()[0].getRowStride(),
+                    imageProxy.getPlanes()[1].getBuffer(),
+                    imageProxy.getPlanes()[1].getRowStride(),
+                    imageProxy.getPlanes()[2].getBuffer(),
+                    imageProxy.getPlanes()[2].getRowStride(),
+                    imageProxy.getPlanes()[1].getPixelStride(),
+                    imageProxy.getImageInfo().getTimestamp()) == 0;
+        } finally {
+            synchronized (mLock) {
+                if (--mSubmitsInFlight == 0 && mClosing) {
+                    mLock.notifyAll();
+                }
+            }
+        }
+    }
+
+    /** Returns the latency counters accumulated since the pipeline was created. */
+    @NonNull
+    public LatencyStats getLatencyStats() {
+        long[] stats = new long[STAGE_COUNT * 3 + 1];
+        synchronized (mLock) {
+            if (mNativePipeline != 0) {
+                nativeGetStats(mNativePipeline, stats);
+            }
+        }
+        return new LatencyStats(stats);
+    }
+
+    /**
+     * Stops the worker thread and releases the ring, after waiting for the images being submitted
+     * to be copied. Frames received by the listener must not be used afterwards.
+     */
+    public void close() {
+        mMessageQueue.removeOnFileDescriptorEventListener(mEventFd.getFileDescriptor());
+        synchronized (mLock) {
+            if (mNativePipeline == 0 || mClosing) {
+                return;
+            }
+            mClosing = true;
+            boolean interrupted = false;
+            while (mSubmitsInFlight > 0) {
+                try {
+                    mLock.wait();
+                } catch (InterruptedException e) {
+                    interrupted = true;
+                }
+            }
+            if (interrupted) {
+                Thread.currentThread().interrupt();
+            }
+            nativeDestroy(mNativePipeline);
+            mNativePipeline = 0;
+        }
+        try {
+            mEventFd.close();
+        } catch (IOException e) {
+            Logger.w(TAG, "Failed to close the event fd", e);
+        }
+    }
+
+    /**
+     * Keeps submitted images waiting for conversion while paused, so that tests can fill the ring
+     * with frames in a known state.
+     */
+    @VisibleForTesting
+    void setConversionPausedForTesting(boolean paused) {
+        synchronized (mLock) {
+            if (mNativePipeline != 0) {
+                nativeSetPausedForTesting(mNativePipeline, paused);
+            }
+        }
+    }
+
+    private void deliverFrames() {
+        long[] frame = new long[2];
+        while (true) {
+            synchronized (mLock) {
+                if (mNativePipeline == 0 || !nativeAcquire(mNativePipeline, frame)) {
+                    return;
+                }
+            }
+            mListener.onFrameConverted(new ConvertedFrame((int) frame[0], frame[1]));
+        }
+    }
+
+    private static native long nativeCreate(int width, int height,
+            @ImageOutputConfig.RotationDegreesValue int rotationDegrees, int capacity);
+
+    private static native void nativeDestroy(long pipeline);
+
+    private static native int nativeGetEventFd(long pipeline);
+
+    @Nullable
+    private static native ByteBuffer nativeGetOutputBuffer(long pipeline, int slot);
+
+    private static native int nativeSubmit(
+            long pipeline,
+            @NonNull ByteBuffer srcByteBufferY,
+            int srcStrideY,
+            @NonNull ByteBuffer srcByteBufferU,
+            int srcStrideU,
+            @NonNull ByteBuffer srcByteBufferV,
+            int srcStrideV,
+            int srcPixelStrideUV,
+            long timestampNanos);
+
+    private static native boolean nativeAcquire(long pipeline, @NonNull long[] frame);
+
+    private static native void nativeRelease(long pipeline, int slot);
+
+    private static native int nativeGetStats(long pipeline, @NonNull long[] stats);
+
+    private static native void nativeSetPausedForTesting(long pipeline, boolean paused);
+}
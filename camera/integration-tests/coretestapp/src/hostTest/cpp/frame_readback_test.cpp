@@ -0,0 +1,226 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host test of the pixel buffer object and fence ring of frame_readback.cpp, rendering known
+// patterns into a pbuffer of a Mesa OpenGL ES 3.0 context. See CMakeLists.txt.
+
+#include "frame_readback.h"
+
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+            abort();                                                                           \
+        }                                                                                      \
+    } while (0)
+
+namespace {
+    constexpr int WIDTH = 64;
+    constexpr int HEIGHT = 32;
+    constexpr uint64_t TIMEOUT_NS = 1000000000ULL;
+    // Exit code for ctest to report the test as skipped.
+    constexpr int SKIPPED = 77;
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Surfaceless Mesa does not need a display server, the default display is used otherwise.
+    EGLDisplay OpenDisplay() {
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (clientExtensions != nullptr
+                && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+            auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                    eglGetProcAddress("eglGetPlatformDisplayEXT"));
+            if (getPlatformDisplay != nullptr) {
+                EGLDisplay surfaceless = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                                            EGL_DEFAULT_DISPLAY, nullptr);
+                if (surfaceless != EGL_NO_DISPLAY && eglInitialize(surfaceless, nullptr, nullptr)) {
+                    return surfaceless;
+                }
+            }
+        }
+        EGLDisplay defaultDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (defaultDisplay != EGL_NO_DISPLAY && eglInitialize(defaultDisplay, nullptr, nullptr)) {
+            return defaultDisplay;
+        }
+        return EGL_NO_DISPLAY;
+    }
+
+    // Makes a WIDTH x HEIGHT RGBA_8888 pbuffer of an OpenGL ES 3.0 context current.
+    bool MakeContextCurrent() {
+        display = OpenDisplay();
+        if (display == EGL_NO_DISPLAY || !eglBindAPI(EGL_OPENGL_ES_API)) {
+            return false;
+        }
+        const EGLint configAttributes[] = {
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+                EGL_RED_SIZE, 8,
+                EGL_GREEN_SIZE, 8,
+                EGL_BLUE_SIZE, 8,
+                EGL_ALPHA_SIZE, 8,
+                EGL_NONE};
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount)
+                || configCount == 0) {
+            return false;
+        }
+        const EGLint surfaceAttributes[] = {EGL_WIDTH, WIDTH, EGL_HEIGHT, HEIGHT, EGL_NONE};
+        EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+        EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                                              contextAttributes);
+        return surface != EGL_NO_SURFACE && context != EGL_NO_CONTEXT
+               && eglMakeCurrent(display, surface, surface, context);
+    }
+
+    // Red ramps with the frame, green marks the bottom half and blue the right half, so that the
+    // frame, the row order and the row stride of a readback are all checked.
+    void RenderPattern(int frame) {
+        glEnable(GL_SCISSOR_TEST);
+        for (int top = 0; top < 2; top++) {
+            for (int right = 0; right < 2; right++) {
+                glScissor(right * WIDTH / 2, top * HEIGHT / 2, WIDTH / 2, HEIGHT / 2);
+                glClearColor(static_cast<float>(frame * 16) / 255.0f, top ? 0.0f : 1.0f,
+                             right ? 1.0f : 0.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+        }
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    void CheckPattern(const uint8_t *pixels, int frame) {
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                // Rows are bottom-up.
+                const uint8_t *pixel = pixels + (static_cast<size_t>(y) * WIDTH + x) * 4;
+                CHECK(pixel[0] == frame * 16);
+                CHECK(pixel[1] == (y < HEIGHT / 2 ? 255 : 0));
+                CHECK(pixel[2] == (x < WIDTH / 2 ? 0 : 255));
+                CHECK(pixel[3] == 255);
+            }
+        }
+    }
+
+    // Acquires the next frame, which must be the given one, and releases it.
+    void AcquireAndCheck(FrameReadback *readback, int frame) {
+        const uint8_t *pixels = nullptr;
+        int64_t timestampNs = -1;
+        int index = AcquireFrameReadback(readback, TIMEOUT_NS, &pixels, &timestampNs);
+        CHECK(index >= 0);
+        CHECK(timestampNs == frame * 1000);
+        CheckPattern(pixels, frame);
+        ReleaseFrameReadback(readback, index);
+    }
+
+    void TestInvalidArguments() {
+        CHECK(CreateFrameReadback(display, 0, HEIGHT, 2) == nullptr);
+        CHECK(CreateFrameReadback(display, WIDTH, HEIGHT, 1) == nullptr);
+        CHECK(CreateFrameReadback(display, WIDTH, HEIGHT, 9) == nullptr);
+    }
+
+    void TestReadsBackEveryFrame() {
+        FrameReadback *readback = CreateFrameReadback(display, WIDTH, HEIGHT, 3);
+        CHECK(readback != nullptr);
+        const uint8_t *pixels = nullptr;
+        int64_t timestampNs = 0;
+        CHECK(AcquireFrameReadback(readback, 0, &pixels, &timestampNs) == -1);
+        // More frames than buffers, so that every buffer is reused.
+        for (int frame = 0; frame < 10; frame++) {
+            RenderPattern(frame);
+            CHECK(QueueFrameReadback(readback, frame * 1000));
+            AcquireAndCheck(readback, frame);
+        }
+        FrameReadbackStats stats = GetFrameReadbackStats(readback);
+        CHECK(stats.queuedCount == 10 && stats.acquiredCount == 10 && stats.droppedCount == 0);
+        CHECK(glGetError() == GL_NO_ERROR);
+        DestroyFrameReadback(readback);
+    }
+
+    void TestOverwritesOldestQueuedFrame() {
+        FrameReadback *readback = CreateFrameReadback(display, WIDTH, HEIGHT, 2);
+        CHECK(readback != nullptr);
+        for (int frame = 0; frame < 3; frame++) {
+            RenderPattern(frame);
+            CHECK(QueueFrameReadback(readback, frame * 1000));
+        }
+        // Frame 0 was overwritten by frame 2, the others are handed back oldest first.
+        AcquireAndCheck(readback, 1);
+        AcquireAndCheck(readback, 2);
+        const uint8_t *pixels = nullptr;
+        int64_t timestampNs = 0;
+        CHECK(AcquireFrameReadback(readback, 0, &pixels, &timestampNs) == -1);
+        FrameReadbackStats stats = GetFrameReadbackStats(readback);
+        CHECK(stats.queuedCount == 3 && stats.acquiredCount == 2 && stats.droppedCount == 1);
+        DestroyFrameReadback(readback);
+    }
+
+    void TestDropsFramesWhileEveryBufferIsAcquired() {
+        FrameReadback *readback = CreateFrameReadback(display, WIDTH, HEIGHT, 2);
+        CHECK(readback != nullptr);
+        const uint8_t *pixels[2] = {};
+        int indices[2];
+        int64_t timestampNs = 0;
+        for (int frame = 0; frame < 2; frame++) {
+            RenderPattern(frame);
+            CHECK(QueueFrameReadback(readback, frame * 1000));
+            indices[frame] = AcquireFrameReadback(readback, TIMEOUT_NS, &pixels[frame],
+                                                  &timestampNs);
+            CHECK(indices[frame] >= 0);
+        }
+        RenderPattern(2);
+        CHECK(!QueueFrameReadback(readback, 2000));
+        // Both mapped buffers still hold their frame.
+        CheckPattern(pixels[0], 0);
+        CheckPattern(pixels[1], 1);
+        ReleaseFrameReadback(readback, indices[0]);
+        ReleaseFrameReadback(readback, indices[1]);
+
+        RenderPattern(3);
+        CHECK(QueueFrameReadback(readback, 3000));
+        AcquireAndCheck(readback, 3);
+        FrameReadbackStats stats = GetFrameReadbackStats(readback);
+        CHECK(stats.queuedCount == 3 && stats.acquiredCount == 3 && stats.droppedCount == 1);
+        DestroyFrameReadback(readback);
+    }
+}  // namespace
+
+int main() {
+    if (!MakeContextCurrent()) {
+        fprintf(stderr, "Skipped: no OpenGL ES 3.0 pbuffer context.\n");
+        return SKIPPED;
+    }
+    TestInvalidArguments();
+    FrameReadback *probe = CreateFrameReadback(display, WIDTH, HEIGHT, 2);
+    if (probe == nullptr) {
+        fprintf(stderr, "Skipped: no asynchronous readback support.\n");
+        return SKIPPED;
+    }
+    DestroyFrameReadback(probe);
+
+    TestReadsBackEveryFrame();
+    TestOverwritesOldestQueuedFrame();
+    TestDropsFramesWhileEveryBufferIsAcquired();
+    printf("All frame readback tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "frame_readback.h"
+
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+namespace {
+    auto constexpr LOG_TAG = "FrameReadback";
+
+    // Logs to logcat, or to stderr when the readback is built for the host tests.
+    __attribute__((format(printf, 1, 2))) void LogError(const char *format, ...) {
+        va_list args;
+        va_start(args, format);
+#ifdef __ANDROID__
+        __android_log_vprint(ANDROID_LOG_ERROR, LOG_TAG, format, args);
+#else
+        fprintf(stderr, "E/%s: ", LOG_TAG);
+        vfprintf(stderr, format, args);
+        fputc('\n', stderr);
+#endif
+        va_end(args);
+    }
+
+    constexpr int MIN_DEPTH = 2;
+    constexpr int MAX_DEPTH = 8;
+
+    // EGL_KHR_fence_sync methods, resolved with eglGetProcAddress on first use.
+    PFNEGLCREATESYNCKHRPROC createSyncKHR = nullptr;
+    PFNEGLCLIENTWAITSYNCKHRPROC clientWaitSyncKHR = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC destroySyncKHR = nullptr;
+
+    bool LoadFenceSyncMethods() {
+        static std::once_flag loadFlag;
+        std::call_once(loadFlag, []() {
+            createSyncKHR = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(
+                    eglGetProcAddress("eglCreateSyncKHR"));
+            clientWaitSyncKHR = reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(
+                    eglGetProcAddress("eglClientWaitSyncKHR"));
+            destroySyncKHR = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(
+                    eglGetProcAddress("eglDestroySyncKHR"));
+        });
+        return createSyncKHR != nullptr && clientWaitSyncKHR != nullptr
+               && destroySyncKHR != nullptr;
+    }
+
+    enum SlotState {
+        SLOT_FREE,
+        // glReadPixels is queued and the fence is pending or signalled.
+        SLOT_QUEUED,
+        // Mapped by AcquireFrameReadback().
+        SLOT_ACQUIRED
+    };
+
+    struct Slot {
+        GLuint buffer;
+        EGLSyncKHR fence;
+        SlotState state;
+        int64_t timestampNs;
+        // Order of the queued frames, to hand them back oldest first.
+        uint64_t sequence;
+    };
+
+    bool SupportsEs3() {
+        const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+        int major = 0;
+        int minor = 0;
+        if (version == nullptr || sscanf(version, "OpenGL ES %d.%d", &major, &minor) != 2) {
+            return false;
+        }
+        return major >= 3;
+    }
+}  // namespace
+
+struct FrameReadback {
+    EGLDisplay display;
+    int width;
+    int height;
+    int depth;
+    GLsizeiptr size;
+    Slot slots[MAX_DEPTH];
+    // Slot the next frame is read into.
+    int next;
+    uint64_t sequence;
+    FrameReadbackStats stats;
+};
+
+FrameReadback *CreateFrameReadback(EGLDisplay display, int width, int height, int depth) {
+    if (width <= 0 || height <= 0 || depth < MIN_DEPTH || depth > MAX_DEPTH) {
+        LogError("Invalid readback of %dx%d frames with %d buffers.", width, height, depth);
+        return nullptr;
+    }
+    if (!SupportsEs3()) {
+        LogError("Pixel buffer objects require OpenGL ES 3.0.");
+        return nullptr;
+    }
+    const char *eglExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (eglExtensions == nullptr || strstr(eglExtensions, "EGL_KHR_fence_sync") == nullptr
+            || !LoadFenceSyncMethods()) {
+        LogError("Readback requires EGL_KHR_fence_sync.");
+        return nullptr;
+    }
+
+    auto *readback = new FrameReadback();
+    readback->display = display;
+    readback->width = width;
+    readback->height = height;
+    readback->depth = depth;
+    readback->size = static_cast<GLsizeiptr>(width) * height * 4;
+
+    GLuint buffers[MAX_DEPTH];
+    glGenBuffers(depth, buffers);
+    for (int i = 0; i < depth; i++) {
+        readback->slots[i].buffer = buffers[i];
+        readback->slots[i].fence = EGL_NO_SYNC_KHR;
+        readback->slots[i].state = SLOT_FREE;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, readback->size, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    GLenum glError = glGetError();
+    if (glError != GL_NO_ERROR) {
+        LogError("Failed to allocate readback buffers with OpenGL error 0x%04x.", glError);
+        DestroyFrameReadback(readback);
+        return nullptr;
+    }
+    return readback;
+}
+
+void DestroyFrameReadback(FrameReadback *readback) {
+    GLuint buffers[MAX_DEPTH];
+    for (int i = 0; i < readback->depth; i++) {
+        Slot &slot = readback->slots[i];
+        if (slot.fence != EGL_NO_SYNC_KHR) {
+            destroySyncKHR(readback->display, slot.fence);
+        }
+        // Deleting a mapped buffer unmaps it.
+        buffers[i] = slot.buffer;
+    }
+    glDeleteBuffers(readback->depth, buffers);
+    delete readback;
+}
+
+int GetFrameReadbackWidth(const FrameReadback *readback) {
+    return readback->width;
+}
+
+int GetFrameReadbackHeight(const FrameReadback *readback) {
+    return readback->height;
+}
+
+bool QueueFrameReadback(FrameReadback *readback, int64_t timestampNs) {
+    // Skip the buffers held by the caller. A queued frame that was not acquired yet is
+    // overwritten, so a slow consumer gets the latest frames.
+    int index = -1;
+    for (int i = 0; i < readback->depth; i++) {
+        int candidate = (readback->next + i) % readback->depth;
+        if (readback->slots[candidate].state != SLOT_ACQUIRED) {
+            index = candidate;
+            break;
+        }
+    }
+    if (index == -1) {
+        readback->stats.droppedCount++;
+        return false;
+    }
+
+    Slot &slot = readback->slots[index];
+    if (slot.state == SLOT_QUEUED) {
+        destroySyncKHR(readback->display, slot.fence);
+        slot.fence = EGL_NO_SYNC_KHR;
+        slot.state = SLOT_FREE;
+        readback->stats.droppedCount++;
+    }
+
+    // With a pixel pack buffer bound, glReadPixels only queues the copy.
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = createSyncKHR(readback->display, EGL_SYNC_FENCE_KHR, nullptr);
+    if (slot.fence == EGL_NO_SYNC_KHR) {
+        LogError("Failed to create readback fence with EGL error 0x%04x.", eglGetError());
+        readback->stats.droppedCount++;
+        return false;
+    }
+    slot.state = SLOT_QUEUED;
+    slot.timestampNs = timestampNs;
+    slot.sequence = ++readback->sequence;
+    readback->next = (index + 1) % readback->depth;
+    readback->stats.queuedCount++;
+    return true;
+}
+
+int AcquireFrameReadback(FrameReadback *readback, uint64_t timeoutNs, const uint8_t **pixels,
+                         int64_t *timestampNs) {
+    int index = -1;
+    for (int i = 0; i < readback->depth; i++) {
+        const Slot &slot = readback->slots[i];
+        if (slot.state == SLOT_QUEUED
+                && (index == -1 || slot.sequence < readback->slots[index].sequence)) {
+            index = i;
+        }
+    }
+    if (index == -1) {
+        return -1;
+    }
+
+    Slot &slot = readback->slots[index];
+    // The flush makes sure the fence signals even if nothing flushed the context since it was
+    // queued.
+    EGLint status = clientWaitSyncKHR(readback->display, slot.fence,
+                                      EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, timeoutNs);
+    if (status == EGL_TIMEOUT_EXPIRED_KHR) {
+        return -1;
+    }
+    destroySyncKHR(readback->display, slot.fence);
+    slot.fence = EGL_NO_SYNC_KHR;
+    if (status != EGL_CONDITION_SATISFIED_KHR) {
+        LogError("Failed to wait for readback fence with EGL error 0x%04x.", eglGetError());
+        slot.state = SLOT_FREE;
+        readback->stats.droppedCount++;
+        return -1;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback->size, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (mapped == nullptr) {
+        LogError("Failed to map readback buffer with OpenGL error 0x%04x.", glGetError());
+        slot.state = SLOT_FREE;
+        readback->stats.droppedCount++;
+        return -1;
+    }
+
+    slot.state = SLOT_ACQUIRED;
+    readback->stats.acquiredCount++;
+    *pixels = static_cast<const uint8_t *>(mapped);
+    *timestampNs = slot.timestampNs;
+    return index;
+}
+
+void ReleaseFrameReadback(FrameReadback *readback, int index) {
+    Slot &slot = readback->slots[index];
+    if (slot.state != SLOT_ACQUIRED) {
+        return;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.state = SLOT_FREE;
+}
+
+FrameReadbackStats GetFrameReadbackStats(const FrameReadback *readback) {
+    return readback->stats;
+}
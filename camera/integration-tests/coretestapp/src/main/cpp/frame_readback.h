@@ -0,0 +1,67 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_TEST_APP_FRAME_READBACK_H
+#define CAMERA_TEST_APP_FRAME_READBACK_H
+
+#include <EGL/egl.h>
+
+#include <cstdint>
+
+// Reads rendered frames back to the CPU through a ring of pixel buffer objects.
+//
+// QueueFrameReadback() copies the current read surface into the next buffer of the ring with
+// glReadPixels, which returns without waiting for the GPU, and inserts an EGL fence after it.
+// AcquireFrameReadback() maps the oldest queued buffer once its fence has signalled, so the GL
+// pipeline is never stalled by the readback. With a ring of N buffers a frame is handed back at
+// most N - 1 frames after it was rendered, or dropped if it was not acquired by then. Requires
+// OpenGL ES 3.0 and EGL_KHR_fence_sync. All functions must be called on the thread the GL
+// context is current on.
+struct FrameReadback;
+
+struct FrameReadbackStats {
+    int64_t queuedCount;
+    int64_t acquiredCount;
+    // Frames overwritten before they were acquired, or not read because every buffer was held.
+    int64_t droppedCount;
+};
+
+// Creates a ring of depth buffers for frames of the given size, or returns nullptr if the context
+// does not support asynchronous readback.
+FrameReadback *CreateFrameReadback(EGLDisplay display, int width, int height, int depth);
+
+void DestroyFrameReadback(FrameReadback *readback);
+
+int GetFrameReadbackWidth(const FrameReadback *readback);
+
+int GetFrameReadbackHeight(const FrameReadback *readback);
+
+// Queues the read of the current read surface. Returns false if the frame is dropped because
+// every buffer of the ring is held by AcquireFrameReadback().
+bool QueueFrameReadback(FrameReadback *readback, int64_t timestampNs);
+
+// Maps the oldest queued frame if its fence has signalled, or waits for it for up to timeoutNs.
+// Returns the index of the buffer, to be passed to ReleaseFrameReadback(), or -1 if no frame is
+// ready. The RGBA_8888 pixels are bottom-up, with a row stride of width * 4.
+int AcquireFrameReadback(FrameReadback *readback, uint64_t timeoutNs, const uint8_t **pixels,
+                         int64_t *timestampNs);
+
+// Unmaps a buffer returned by AcquireFrameReadback() so it can be reused.
+void ReleaseFrameReadback(FrameReadback *readback, int index);
+
+FrameReadbackStats GetFrameReadbackStats(const FrameReadback *readback);
+
+#endif  // CAMERA_TEST_APP_FRAME_READBACK_H
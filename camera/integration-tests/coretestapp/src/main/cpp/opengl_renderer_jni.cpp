@@ -25,12 +25,15 @@
 #include <jni.h>
 
 #include <cassert>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "frame_readback.h"
+
 namespace {
     auto constexpr LOG_TAG = "OpenGLRendererJni";
 
@@ -205,19 +208,87 @@ R"SRC(#version 300 es
       }
 )SRC";
 
+    // The quad drawn with GL_TRIANGLE_STRIP to create the surface which will be textured with the
+    // camera frame, as interleaved vertex and texture coordinates. This could also be done with a
+    // quad (GL_QUADS) on a different version of OpenGL or with a scaled single triangle in which
+    // we would inscribe the camera texture.
+    //
+    //                       (-1,-1)         (1,-1)
+    //                          +---------------+
+    //                          | \_            |
+    //                          |    \_         |
+    //                          |       +       |
+    //                          |         \_    |
+    //                          |            \_ |
+    //                          +---------------+
+    //                       (-1,1)           (1,1)
+    constexpr GLfloat QUAD_VERTICES[] = {
+            // x, y, s, t
+            -1.0f, 1.0f, 0.0f, 0.0f, // Lower-left
+            1.0f, 1.0f, 1.0f, 0.0f, // Lower-right
+            -1.0f, -1.0f, 0.0f, 1.0f, // Upper-left (notice order here. We're drawing triangles,
+                                      // not a quad.)
+            1.0f, -1.0f, 1.0f, 1.0f  // Upper-right
+    };
+    constexpr GLint QUAD_COMPONENTS = 2;
+    constexpr GLsizei QUAD_STRIDE = 4 * sizeof(GLfloat);
+    constexpr GLsizei QUAD_VERTEX_COUNT = 4;
+
+    constexpr int MATRIX_SIZE = 16;
+
+    // Last value uploaded to a mat4 uniform of the program, so unchanged values are not uploaded
+    // again.
+    struct UniformMatrix {
+        GLint handle;
+        GLfloat value[MATRIX_SIZE];
+        bool uploaded;
+
+        UniformMatrix() : handle(-1), value(), uploaded(false) {}
+    };
+
+    // A surface rendered in addition to the window surface, such as the input surface of an
+    // encoder, with its own MVP and viewport.
+    struct OutputSurface {
+        jint id;
+        ANativeWindow *window;
+        EGLSurface surface;
+        GLint width;
+        GLint height;
+        GLfloat mvpTransform[MATRIX_SIZE];
+    };
+
     struct NativeContext {
         EGLDisplay display;
         EGLConfig config;
         EGLContext context;
         std::pair<ANativeWindow *, EGLSurface> windowSurface;
+        GLint windowWidth;
+        GLint windowHeight;
+        // MVP of the window surface when it is passed as an array.
+        GLfloat windowMvpTransform[MATRIX_SIZE];
+        std::vector<OutputSurface> outputSurfaces;
+        jint nextOutputSurfaceId;
         EGLSurface pbufferSurface;
+        // Surface the context is current on, so switching between outputs is only done when
+        // there is more than one.
+        EGLSurface currentSurface;
         GLuint program;
         GLint positionHandle;
         GLint texCoordsHandle;
         GLint samplerHandle;
-        GLint mvpTransformHandle;
-        GLint texTransformHandle;
+        UniformMatrix mvpTransform;
+        UniformMatrix texTransform;
         GLuint textureId;
+        GLuint vertexBuffer;
+        GLuint vertexArray;
+        PFNGLBINDVERTEXARRAYOESPROC bindVertexArray;
+        PFNGLDELETEVERTEXARRAYSOESPROC deleteVertexArrays;
+        // MVP followed by the texture transform, in a direct buffer owned by the Java renderer.
+        const GLfloat *transformBuffer;
+        // Number of buffers to read the window surface back with, 0 if disabled. The readback
+        // is created on the first frame drawn with the size of the window surface.
+        int readbackDepth;
+        FrameReadback *readback;
         bool supportsHdr;
 
         NativeContext()
@@ -225,14 +296,24 @@ R"SRC(#version 300 es
                   config(nullptr),
                   context(EGL_NO_CONTEXT),
                   windowSurface(std::make_pair(nullptr, EGL_NO_SURFACE)),
+                  windowWidth(0),
+                  windowHeight(0),
+                  windowMvpTransform(),
+                  nextOutputSurfaceId(1),
                   pbufferSurface(EGL_NO_SURFACE),
+                  currentSurface(EGL_NO_SURFACE),
                   program(0),
                   positionHandle(-1),
                   texCoordsHandle(1),
                   samplerHandle(-1),
-                  mvpTransformHandle(-1),
-                  texTransformHandle(-1),
                   textureId(0),
+                  vertexBuffer(0),
+                  vertexArray(0),
+                  bindVertexArray(nullptr),
+                  deleteVertexArrays(nullptr),
+                  transformBuffer(nullptr),
+                  readbackDepth(0),
+                  readback(nullptr),
                   supportsHdr(false) {}
     };
 
@@ -316,6 +397,7 @@ R"SRC(#version 300 es
         if (nativeContext->windowSurface.first) {
             eglMakeCurrent(nativeContext->display, nativeContext->pbufferSurface,
                            nativeContext->pbufferSurface, nativeContext->context);
+            nativeContext->currentSurface = nativeContext->pbufferSurface;
             eglDestroySurface(nativeContext->display,
                               nativeContext->windowSurface.second);
             nativeContext->windowSurface.second = nullptr;
@@ -324,6 +406,90 @@ R"SRC(#version 300 es
         }
     }
 
+    void DestroyOutputSurface(NativeContext *nativeContext, const OutputSurface &outputSurface) {
+        if (nativeContext->currentSurface == outputSurface.surface) {
+            eglMakeCurrent(nativeContext->display, nativeContext->pbufferSurface,
+                           nativeContext->pbufferSurface, nativeContext->context);
+            nativeContext->currentSurface = nativeContext->pbufferSurface;
+        }
+        eglDestroySurface(nativeContext->display, outputSurface.surface);
+        ANativeWindow_release(outputSurface.window);
+    }
+
+    // Makes the context current on the surface and sets the viewport to it. The program, vertex
+    // array, texture and uniforms are context state, so they are kept across surfaces.
+    bool MakeSurfaceCurrent(NativeContext *nativeContext, EGLSurface surface, GLint width,
+                            GLint height) {
+        if (eglMakeCurrent(nativeContext->display, surface, surface,
+                           nativeContext->context) != EGL_TRUE) {
+            EGLenum eglError = eglGetError();
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to make surface current with EGL error: %s",
+                                EGLErrorString(eglError).c_str());
+            return false;
+        }
+        nativeContext->currentSurface = surface;
+
+        CHECK_GL(glViewport(0, 0, width, height));
+        CHECK_GL(glScissor(0, 0, width, height));
+        return true;
+    }
+
+    // Uploads the matrix to its uniform if it differs from the last uploaded value.
+    void UpdateUniformMatrix(UniformMatrix *uniform, const GLfloat *value) {
+        if (uniform->uploaded && memcmp(uniform->value, value, sizeof(uniform->value)) == 0) {
+            return;
+        }
+        memcpy(uniform->value, value, sizeof(uniform->value));
+        CHECK_GL(glUniformMatrix4fv(uniform->handle, /*count=*/1, /*transpose=*/GL_FALSE, value));
+        uniform->uploaded = true;
+    }
+
+    // Uploads the quad to a vertex buffer and records its attributes in a vertex array object
+    // when the context supports them. Otherwise the attributes are set once on the default vertex
+    // array, which no other code of the context changes.
+    void CreateQuad(NativeContext *nativeContext, const char *glExtensions, GLuint verNum) {
+        PFNGLGENVERTEXARRAYSOESPROC genVertexArrays = nullptr;
+        if (verNum >= 300) {
+            genVertexArrays = reinterpret_cast<PFNGLGENVERTEXARRAYSOESPROC>(
+                    eglGetProcAddress("glGenVertexArrays"));
+            nativeContext->bindVertexArray = reinterpret_cast<PFNGLBINDVERTEXARRAYOESPROC>(
+                    eglGetProcAddress("glBindVertexArray"));
+            nativeContext->deleteVertexArrays = reinterpret_cast<PFNGLDELETEVERTEXARRAYSOESPROC>(
+                    eglGetProcAddress("glDeleteVertexArrays"));
+        } else if (strstr(glExtensions, "GL_OES_vertex_array_object") != nullptr) {
+            genVertexArrays = reinterpret_cast<PFNGLGENVERTEXARRAYSOESPROC>(
+                    eglGetProcAddress("glGenVertexArraysOES"));
+            nativeContext->bindVertexArray = reinterpret_cast<PFNGLBINDVERTEXARRAYOESPROC>(
+                    eglGetProcAddress("glBindVertexArrayOES"));
+            nativeContext->deleteVertexArrays = reinterpret_cast<PFNGLDELETEVERTEXARRAYSOESPROC>(
+                    eglGetProcAddress("glDeleteVertexArraysOES"));
+        }
+        if (genVertexArrays == nullptr || nativeContext->bindVertexArray == nullptr
+                || nativeContext->deleteVertexArrays == nullptr) {
+            nativeContext->bindVertexArray = nullptr;
+            nativeContext->deleteVertexArrays = nullptr;
+        } else {
+            CHECK_GL(genVertexArrays(1, &(nativeContext->vertexArray)));
+            CHECK_GL(nativeContext->bindVertexArray(nativeContext->vertexArray));
+        }
+
+        CHECK_GL(glGenBuffers(1, &(nativeContext->vertexBuffer)));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, nativeContext->vertexBuffer));
+        CHECK_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES,
+                              GL_STATIC_DRAW));
+
+        CHECK_GL(glVertexAttribPointer(nativeContext->positionHandle, QUAD_COMPONENTS, GL_FLOAT,
+                                       /*normalized=*/GL_FALSE, QUAD_STRIDE,
+                                       reinterpret_cast<const void *>(0)));
+        CHECK_GL(glEnableVertexAttribArray(nativeContext->positionHandle));
+        CHECK_GL(glVertexAttribPointer(nativeContext->texCoordsHandle, QUAD_COMPONENTS, GL_FLOAT,
+                                       /*normalized=*/GL_FALSE, QUAD_STRIDE,
+                                       reinterpret_cast<const void *>(
+                                               QUAD_COMPONENTS * sizeof(GLfloat))));
+        CHECK_GL(glEnableVertexAttribArray(nativeContext->texCoordsHandle));
+    }
+
     void ThrowException(JNIEnv *env, const char *exceptionName, const char *msg) {
         jclass exClass = env->FindClass(exceptionName);
         assert(exClass != nullptr);
@@ -408,6 +574,7 @@ R"SRC(#version 300 es
         nativeContext->pbufferSurface = eglPbuffer;
 
         eglMakeCurrent(eglDisplay, eglPbuffer, eglPbuffer, eglContext);
+        nativeContext->currentSurface = eglPbuffer;
 
         //Print debug OpenGL information
         const GLubyte *glVendorString = CHECK_GL(glGetString(GL_VENDOR));
@@ -430,8 +597,9 @@ R"SRC(#version 300 es
         bool hasYuvExtension = (strstr(glExtensions, "GL_EXT_YUV_target") != nullptr);
 
         // Check if OpenGL version is ES3.0 or greater
-        GLuint major, minor;
-        sscanf(reinterpret_cast<const char*>(glVersionString), "%d.%d", &major, &minor);
+        // The version string is "OpenGL ES <major>.<minor> <vendor-specific information>".
+        GLuint major = 0, minor = 0;
+        sscanf(reinterpret_cast<const char*>(glVersionString), "OpenGL ES %u.%u", &major, &minor);
         GLuint verNum = (major * 100 + minor * 10);
 
         nativeContext->supportsHdr = hasYuvExtension && verNum >= 300;
@@ -451,21 +619,40 @@ R"SRC(#version 300 es
                 CHECK_GL(glGetUniformLocation(nativeContext->program, "sampler"));
         assert(nativeContext->samplerHandle != -1);
 
-        nativeContext->mvpTransformHandle =
+        nativeContext->mvpTransform = UniformMatrix();
+        nativeContext->mvpTransform.handle =
                 CHECK_GL(glGetUniformLocation(nativeContext->program, "mvpTransform"));
-        assert(nativeContext->mvpTransformHandle != -1);
+        assert(nativeContext->mvpTransform.handle != -1);
 
-        nativeContext->texTransformHandle =
+        nativeContext->texTransform = UniformMatrix();
+        nativeContext->texTransform.handle =
                 CHECK_GL(glGetUniformLocation(nativeContext->program, "texTransform"));
-        assert(nativeContext->texTransformHandle != -1);
+        assert(nativeContext->texTransform.handle != -1);
+
+        // The program is the only one used by the context, so it and the state that does not
+        // change between frames are set once here.
+        CHECK_GL(glUseProgram(nativeContext->program));
+        CHECK_GL(glUniform1i(nativeContext->samplerHandle, 0));
+
+        // Required to use a left-handed coordinate system in order to match our world-space
+        //
+        //                    ________+x
+        //                  /|
+        //                 / |
+        //              +z/  |
+        //                   | +y
+        //
+        CHECK_GL(glFrontFace(GL_CW));
 
         CHECK_GL(glGenTextures(1, &(nativeContext->textureId)));
 
+        CreateQuad(nativeContext, glExtensions, verNum);
+
         return nativeContext;
     }
 
-    void ConnectOutputSurface(NativeContext *nativeContext, ANativeWindow *nativeWindow,
-                              RendererDynamicRange dynamicRange) {
+    EGLSurface CreateWindowSurface(NativeContext *nativeContext, ANativeWindow *nativeWindow,
+                                   RendererDynamicRange dynamicRange) {
         std::vector<GLint> surfaceAttribs;
         const char* eglExtensions = eglQueryString(nativeContext->display, EGL_EXTENSIONS);
         if (dynamicRange == RENDERER_DYN_RNG_HDR_HLG) {
@@ -483,23 +670,41 @@ R"SRC(#version 300 es
         }
         surfaceAttribs.push_back(EGL_NONE);
 
-        EGLSurface surface =
-                eglCreateWindowSurface(nativeContext->display, nativeContext->config,
-                                       nativeWindow, &surfaceAttribs[0]);
+        return eglCreateWindowSurface(nativeContext->display, nativeContext->config,
+                                      nativeWindow, &surfaceAttribs[0]);
+    }
+
+    void ConnectOutputSurface(NativeContext *nativeContext, ANativeWindow *nativeWindow,
+                              RendererDynamicRange dynamicRange) {
+        EGLSurface surface = CreateWindowSurface(nativeContext, nativeWindow, dynamicRange);
         assert(surface != EGL_NO_SURFACE);
 
         nativeContext->windowSurface = std::make_pair(nativeWindow, surface);
+        nativeContext->windowWidth = ANativeWindow_getWidth(nativeWindow);
+        nativeContext->windowHeight = ANativeWindow_getHeight(nativeWindow);
 
-        eglMakeCurrent(nativeContext->display, surface, surface,
-                       nativeContext->context);
-
-        CHECK_GL(glViewport(0, 0, ANativeWindow_getWidth(nativeWindow),
-                            ANativeWindow_getHeight(nativeWindow)));
-        CHECK_GL(glScissor(0, 0, ANativeWindow_getWidth(nativeWindow),
-                           ANativeWindow_getHeight(nativeWindow)));
+        MakeSurfaceCurrent(nativeContext, surface, nativeContext->windowWidth,
+                           nativeContext->windowHeight);
     }
 
     void ClearContext(NativeContext *nativeContext) {
+        if (nativeContext->readback != nullptr) {
+            DestroyFrameReadback(nativeContext->readback);
+            nativeContext->readback = nullptr;
+        }
+
+        if (nativeContext->vertexArray) {
+            CHECK_GL(nativeContext->deleteVertexArrays(1, &(nativeContext->vertexArray)));
+            nativeContext->vertexArray = 0;
+        }
+        nativeContext->bindVertexArray = nullptr;
+        nativeContext->deleteVertexArrays = nullptr;
+
+        if (nativeContext->vertexBuffer) {
+            CHECK_GL(glDeleteBuffers(1, &(nativeContext->vertexBuffer)));
+            nativeContext->vertexBuffer = 0;
+        }
+
         if (nativeContext->program) {
             CHECK_GL(glDeleteProgram(nativeContext->program));
             nativeContext->program = 0;
@@ -507,6 +712,11 @@ R"SRC(#version 300 es
 
         DestroySurface(nativeContext);
 
+        for (const OutputSurface &outputSurface : nativeContext->outputSurfaces) {
+            DestroyOutputSurface(nativeContext, outputSurface);
+        }
+        nativeContext->outputSurfaces.clear();
+
         if (nativeContext->pbufferSurface != EGL_NO_SURFACE) {
             eglDestroySurface(nativeContext->display, nativeContext->pbufferSurface);
             nativeContext->pbufferSurface = EGL_NO_SURFACE;
@@ -515,6 +725,7 @@ R"SRC(#version 300 es
         if (nativeContext->display != EGL_NO_DISPLAY) {
             eglMakeCurrent(nativeContext->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
                            EGL_NO_CONTEXT);
+            nativeContext->currentSurface = EGL_NO_SURFACE;
         }
 
         if (nativeContext->context != EGL_NO_CONTEXT) {
@@ -528,6 +739,105 @@ R"SRC(#version 300 es
         }
     }
 
+    // Queues the read of the window surface, creating the readback for its size if needed.
+    void QueueWindowReadback(NativeContext *nativeContext, jlong timestampNs) {
+        FrameReadback *readback = nativeContext->readback;
+        if (readback != nullptr
+                && (GetFrameReadbackWidth(readback) != nativeContext->windowWidth
+                    || GetFrameReadbackHeight(readback) != nativeContext->windowHeight)) {
+            DestroyFrameReadback(readback);
+            readback = nullptr;
+        }
+        if (readback == nullptr) {
+            readback = CreateFrameReadback(nativeContext->display, nativeContext->windowWidth,
+                                           nativeContext->windowHeight,
+                                           nativeContext->readbackDepth);
+            if (readback == nullptr) {
+                // Not supported by the context, don't try again for every frame.
+                nativeContext->readbackDepth = 0;
+                return;
+            }
+        }
+        nativeContext->readback = readback;
+        QueueFrameReadback(readback, timestampNs);
+    }
+
+    // Draws the camera texture on a surface and presents it, queuing the read of the frame if
+    // requested.
+    bool DrawToSurface(NativeContext *nativeContext, EGLSurface surface, GLint width,
+                       GLint height, const GLfloat *mvpTransform, jlong timestampNs,
+                       bool readBack) {
+        if (nativeContext->currentSurface != surface
+                && !MakeSurfaceCurrent(nativeContext, surface, width, height)) {
+            return false;
+        }
+
+        UpdateUniformMatrix(&(nativeContext->mvpTransform), mvpTransform);
+
+        // This will typically fail if the EGL surface has been detached abnormally. In that case
+        // we will return false below.
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, QUAD_VERTEX_COUNT);
+
+        // Check that all GL operations completed successfully. If not, log an error and return.
+        GLenum glError = glGetError();
+        if (glError != GL_NO_ERROR) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to draw frame due to OpenGL error: %s",
+                                GLErrorString(glError).c_str());
+            return false;
+        }
+
+        // The frame has to be read before the swap, after which the buffer is undefined.
+        if (readBack) {
+            QueueWindowReadback(nativeContext, timestampNs);
+        }
+
+// Only attempt to set presentation time if EGL_EGLEXT_PROTOTYPES is defined.
+// Otherwise, we'll ignore the timestamp.
+#ifdef EGL_EGLEXT_PROTOTYPES
+        eglPresentationTimeANDROID(nativeContext->display, surface, timestampNs);
+#endif  // EGL_EGLEXT_PROTOTYPES
+        EGLBoolean swapped = eglSwapBuffers(nativeContext->display, surface);
+        if (!swapped) {
+            EGLenum eglError = eglGetError();
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to swap buffers with EGL error: %s",
+                                EGLErrorString(eglError).c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    // Draws the camera texture on the window surface and every output surface. The vertex
+    // array, texture and texture transform are bound once for all of them, and uniforms are
+    // only uploaded if they changed.
+    bool DrawFrame(NativeContext *nativeContext, jlong timestampNs,
+                   const GLfloat *windowMvpTransform, const GLfloat *texTransform) {
+        if (nativeContext->bindVertexArray != nullptr) {
+            CHECK_GL(nativeContext->bindVertexArray(nativeContext->vertexArray));
+        }
+
+        UpdateUniformMatrix(&(nativeContext->texTransform), texTransform);
+
+        CHECK_GL(glBindTexture(GL_TEXTURE_EXTERNAL_OES, nativeContext->textureId));
+
+        bool success = true;
+        if (nativeContext->windowSurface.first) {
+            success = DrawToSurface(nativeContext, nativeContext->windowSurface.second,
+                                    nativeContext->windowWidth, nativeContext->windowHeight,
+                                    windowMvpTransform, timestampNs,
+                                    nativeContext->readbackDepth > 0);
+        }
+        // A failing output does not prevent the others from being drawn.
+        for (const OutputSurface &outputSurface : nativeContext->outputSurfaces) {
+            success = DrawToSurface(nativeContext, outputSurface.surface, outputSurface.width,
+                                    outputSurface.height, outputSurface.mvpTransform,
+                                    timestampNs, /*readBack=*/false) && success;
+        }
+        return success;
+    }
+
 }  // namespace
 
 extern "C" {
@@ -570,6 +880,71 @@ Java_androidx_camera_integration_core_OpenGLRenderer_setWindowSurface(
     return JNI_TRUE;
 }
 
+JNIEXPORT jint JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_addWindowSurface(
+        JNIEnv *env, jclass clazz, jlong context, jobject jsurface, jint jdynamicRange) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    auto dynamicRange = static_cast<RendererDynamicRange>(jdynamicRange);
+
+    ANativeWindow *nativeWindow = ANativeWindow_fromSurface(env, jsurface);
+    if (nativeWindow == nullptr) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to add output surface: Unable to "
+                                                        "acquire native window.");
+        return -1;
+    }
+
+    EGLSurface surface = CreateWindowSurface(nativeContext, nativeWindow, dynamicRange);
+    if (surface == EGL_NO_SURFACE) {
+        EGLenum eglError = eglGetError();
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                            "Failed to add output surface with EGL error: %s",
+                            EGLErrorString(eglError).c_str());
+        ANativeWindow_release(nativeWindow);
+        return -1;
+    }
+
+    OutputSurface outputSurface = {};
+    outputSurface.id = nativeContext->nextOutputSurfaceId++;
+    outputSurface.window = nativeWindow;
+    outputSurface.surface = surface;
+    outputSurface.width = ANativeWindow_getWidth(nativeWindow);
+    outputSurface.height = ANativeWindow_getHeight(nativeWindow);
+    // Identity until a transform is set.
+    for (int i = 0; i < MATRIX_SIZE; i += 5) {
+        outputSurface.mvpTransform[i] = 1.0f;
+    }
+    nativeContext->outputSurfaces.push_back(outputSurface);
+    return outputSurface.id;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_setWindowSurfaceTransform(
+        JNIEnv *env, jclass clazz, jlong context, jint id, jfloatArray jmvpTransformArray) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    for (OutputSurface &outputSurface : nativeContext->outputSurfaces) {
+        if (outputSurface.id == id) {
+            env->GetFloatArrayRegion(jmvpTransformArray, 0, MATRIX_SIZE,
+                                     outputSurface.mvpTransform);
+            return JNI_TRUE;
+        }
+    }
+    return JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_removeWindowSurface(
+        JNIEnv *env, jclass clazz, jlong context, jint id) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    auto &outputSurfaces = nativeContext->outputSurfaces;
+    for (auto it = outputSurfaces.begin(); it != outputSurfaces.end(); ++it) {
+        if (it->id == id) {
+            DestroyOutputSurface(nativeContext, *it);
+            outputSurfaces.erase(it);
+            return;
+        }
+    }
+}
+
 JNIEXPORT jint JNICALL
 Java_androidx_camera_integration_core_OpenGLRenderer_getTexName(
         JNIEnv *env, jclass clazz, jlong context) {
@@ -583,114 +958,108 @@ Java_androidx_camera_integration_core_OpenGLRenderer_renderTexture(
         jfloatArray jmvpTransformArray, jboolean mvpDirty, jfloatArray jtexTransformArray) {
     auto *nativeContext = reinterpret_cast<NativeContext *>(context);
 
-    // We use two triangles drawn with GL_TRIANGLE_STRIP to create the surface which will be
-    // textured with the camera frame. This could also be done with a quad (GL_QUADS) on a
-    // different version of OpenGL or with a scaled single triangle in which we would inscribe
-    // the camera texture.
-    //
-    //                       (-1,-1)         (1,-1)
-    //                          +---------------+
-    //                          | \_            |
-    //                          |    \_         |
-    //                          |       +       |
-    //                          |         \_    |
-    //                          |            \_ |
-    //                          +---------------+
-    //                       (-1,1)           (1,1)
-    constexpr GLfloat vertices[] = {
-            -1.0f, 1.0f, // Lower-left
-            1.0f, 1.0f, // Lower-right
-            -1.0f, -1.0f, // Upper-left (notice order here. We're drawing triangles, not a quad.)
-            1.0f, -1.0f  // Upper-right
-    };
-    constexpr GLfloat texCoords[] = {
-            0.0f, 0.0f, // Lower-left
-            1.0f, 0.0f, // Lower-right
-            0.0f, 1.0f, // Upper-left (order must match the vertices)
-            1.0f, 1.0f,  // Upper-right
-    };
-
-    GLint vertexComponents = 2;
-    GLenum vertexType = GL_FLOAT;
-    GLboolean normalized = GL_FALSE;
-    GLsizei vertexStride = 0;
-    CHECK_GL(glVertexAttribPointer(nativeContext->positionHandle,
-                                   vertexComponents, vertexType, normalized,
-                                   vertexStride, vertices));
-    CHECK_GL(glEnableVertexAttribArray(nativeContext->positionHandle));
-
-    CHECK_GL(glVertexAttribPointer(nativeContext->texCoordsHandle,
-                                   vertexComponents, vertexType, normalized,
-                                   vertexStride, texCoords));
-    CHECK_GL(glEnableVertexAttribArray(nativeContext->texCoordsHandle));
-
-    CHECK_GL(glUseProgram(nativeContext->program));
-
-    GLsizei numMatrices = 1;
-    GLboolean transpose = GL_FALSE;
-    // Only re-upload MVP to GPU if it is dirty
+    // Copy the matrices out rather than pinning the arrays, and only copy the MVP if it is dirty.
     if (mvpDirty) {
-        GLfloat *mvpTransformArray =
-                env->GetFloatArrayElements(jmvpTransformArray, nullptr);
-        CHECK_GL(glUniformMatrix4fv(nativeContext->mvpTransformHandle, numMatrices,
-                                    transpose, mvpTransformArray));
-        env->ReleaseFloatArrayElements(jmvpTransformArray, mvpTransformArray,
-                                       JNI_ABORT);
+        env->GetFloatArrayRegion(jmvpTransformArray, 0, MATRIX_SIZE,
+                                 nativeContext->windowMvpTransform);
+    }
+    GLfloat texTransform[MATRIX_SIZE];
+    env->GetFloatArrayRegion(jtexTransformArray, 0, MATRIX_SIZE, texTransform);
+
+    return DrawFrame(nativeContext, timestampNs, nativeContext->windowMvpTransform,
+                     texTransform) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_setTransformBuffer(
+        JNIEnv *env, jclass clazz, jlong context, jobject jtransformBuffer) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    nativeContext->transformBuffer = nullptr;
+    if (jtransformBuffer == nullptr) {
+        return JNI_TRUE;
     }
 
-    CHECK_GL(glUniform1i(nativeContext->samplerHandle, 0));
+    auto *transformBuffer = static_cast<GLfloat *>(env->GetDirectBufferAddress(jtransformBuffer));
+    if (transformBuffer == nullptr
+            || env->GetDirectBufferCapacity(jtransformBuffer) < 2 * MATRIX_SIZE) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to set transform buffer: The "
+                                                        "buffer must be a direct buffer of at "
+                                                        "least %d floats.", 2 * MATRIX_SIZE);
+        return JNI_FALSE;
+    }
+    nativeContext->transformBuffer = transformBuffer;
+    return JNI_TRUE;
+}
 
-    numMatrices = 1;
-    transpose = GL_FALSE;
-    GLfloat *texTransformArray =
-            env->GetFloatArrayElements(jtexTransformArray, nullptr);
-    CHECK_GL(glUniformMatrix4fv(nativeContext->texTransformHandle, numMatrices,
-                                transpose, texTransformArray));
-    env->ReleaseFloatArrayElements(jtexTransformArray, texTransformArray,
-                                   JNI_ABORT);
+JNIEXPORT jboolean JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_renderTextureFromTransformBuffer(
+        JNIEnv *env, jclass clazz, jlong context, jlong timestampNs) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (nativeContext->transformBuffer == nullptr) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to draw frame: No transform "
+                                                        "buffer is set.");
+        return JNI_FALSE;
+    }
 
-    CHECK_GL(glBindTexture(GL_TEXTURE_EXTERNAL_OES, nativeContext->textureId));
+    // The buffer is read in place, dirty tracking of the uniforms skips unchanged matrices.
+    return DrawFrame(nativeContext, timestampNs, nativeContext->transformBuffer,
+                     nativeContext->transformBuffer + MATRIX_SIZE) ? JNI_TRUE : JNI_FALSE;
+}
 
-    // Required to use a left-handed coordinate system in order to match our world-space
-    //
-    //                    ________+x
-    //                  /|
-    //                 / |
-    //              +z/  |
-    //                   | +y
-    //
-    glFrontFace(GL_CW);
+JNIEXPORT void JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_setReadbackDepth(
+        JNIEnv *env, jclass clazz, jlong context, jint depth) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (nativeContext->readback != nullptr) {
+        DestroyFrameReadback(nativeContext->readback);
+        nativeContext->readback = nullptr;
+    }
+    nativeContext->readbackDepth = depth;
+}
 
-    // This will typically fail if the EGL surface has been detached abnormally. In that case we
-    // will return JNI_FALSE below.
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+JNIEXPORT jobject JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_acquireReadbackFrame(
+        JNIEnv *env, jclass clazz, jlong context, jlongArray jframeInfo) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (nativeContext->readback == nullptr) {
+        return nullptr;
+    }
 
-    // Check that all GL operations completed successfully. If not, log an error and return.
-    GLenum glError = glGetError();
-    if (glError != GL_NO_ERROR) {
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
-                            "Failed to draw frame due to OpenGL error: %s",
-                            GLErrorString(glError).c_str());
-        return JNI_FALSE;
+    const uint8_t *pixels = nullptr;
+    int64_t timestampNs = 0;
+    int index = AcquireFrameReadback(nativeContext->readback, /*timeoutNs=*/0, &pixels,
+                                     &timestampNs);
+    if (index == -1) {
+        return nullptr;
     }
 
-// Only attempt to set presentation time if EGL_EGLEXT_PROTOTYPES is defined.
-// Otherwise, we'll ignore the timestamp.
-#ifdef EGL_EGLEXT_PROTOTYPES
-    eglPresentationTimeANDROID(nativeContext->display,
-                               nativeContext->windowSurface.second, timestampNs);
-#endif  // EGL_EGLEXT_PROTOTYPES
-    EGLBoolean swapped = eglSwapBuffers(nativeContext->display,
-                                        nativeContext->windowSurface.second);
-    if (!swapped) {
-        EGLenum eglError = eglGetError();
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
-                            "Failed to swap buffers with EGL error: %s",
-                            EGLErrorString(eglError).c_str());
-        return JNI_FALSE;
+    int width = GetFrameReadbackWidth(nativeContext->readback);
+    int height = GetFrameReadbackHeight(nativeContext->readback);
+    jlong frameInfo[] = {index, timestampNs, width, height};
+    env->SetLongArrayRegion(jframeInfo, 0, 4, frameInfo);
+    return env->NewDirectByteBuffer(const_cast<uint8_t *>(pixels),
+                                    static_cast<jlong>(width) * height * 4);
+}
+
+JNIEXPORT void JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_releaseReadbackFrame(
+        JNIEnv *env, jclass clazz, jlong context, jint index) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (nativeContext->readback != nullptr) {
+        ReleaseFrameReadback(nativeContext->readback, index);
     }
+}
 
-    return JNI_TRUE;
+JNIEXPORT void JNICALL
+Java_androidx_camera_integration_core_OpenGLRenderer_getReadbackStats(
+        JNIEnv *env, jclass clazz, jlong context, jlongArray jstats) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    FrameReadbackStats stats = {};
+    if (nativeContext->readback != nullptr) {
+        stats = GetFrameReadbackStats(nativeContext->readback);
+    }
+    jlong statsArray[] = {stats.queuedCount, stats.acquiredCount, stats.droppedCount};
+    env->SetLongArrayRegion(jstats, 0, 3, statsArray);
 }
 
 JNIEXPORT void JNICALL
@@ -713,12 +1082,28 @@ Java_androidx_camera_integration_core_OpenGLRenderer_updateRenderedDynamicRange(
     if (nativeWindow != nullptr) {
         ANativeWindow_acquire(nativeWindow);
     }
+    std::vector<OutputSurface> outputSurfaces = nativeContext->outputSurfaces;
+    for (const OutputSurface &outputSurface : outputSurfaces) {
+        ANativeWindow_acquire(outputSurface.window);
+    }
     ClearContext(nativeContext);
 
     InitContext(env, nativeContext, dynamicRange, bitDepth);
     if (nativeWindow != nullptr) {
         ConnectOutputSurface(nativeContext, nativeWindow, dynamicRange);
     }
+    // Output surfaces keep their id and transform with the new config.
+    for (OutputSurface &outputSurface : outputSurfaces) {
+        outputSurface.surface = CreateWindowSurface(nativeContext, outputSurface.window,
+                                                    dynamicRange);
+        if (outputSurface.surface == EGL_NO_SURFACE) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to recreate output surface %d.", outputSurface.id);
+            ANativeWindow_release(outputSurface.window);
+            continue;
+        }
+        nativeContext->outputSurfaces.push_back(outputSurface);
+    }
 }
 
 JNIEXPORT jboolean JNICALL
@@ -42,6 +42,11 @@ import com.google.common.util.concurrent.ListenableFuture;
 
 import java.lang.annotation.Retention;
 import java.lang.annotation.RetentionPolicy;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+import java.util.ArrayList;
+import java.util.List;
 import java.util.Locale;
 import java.util.Objects;
 import java.util.Set;
@@ -97,9 +102,19 @@ final class OpenGLRenderer {
     private final float[] mMvpTransform = new float[16];
     private boolean mMvpDirty = true;
 
+    // The MVP followed by the texture transform, read in place by the native renderer so no
+    // array has to be pinned or copied by JNI for each frame.
+    private final FloatBuffer mTransformBuffer =
+            ByteBuffer.allocateDirect(2 * 16 * Float.BYTES).order(
+                    ByteOrder.nativeOrder()).asFloatBuffer();
+    private boolean mUseTransformBuffer = true;
+
     private Size mSurfaceSize = null;
     private int mSurfaceRotationDegrees = 0;
 
+    // Surfaces drawn in addition to the output surface, such as the input surface of an encoder.
+    private final List<OutputSurface> mOutputSurfaces = new ArrayList<>();
+
     private int mRendererDynamicRange = RENDER_DYN_RNG_SDR;
     private int mRendererBitDepth = 8;
 
@@ -120,12 +135,21 @@ final class OpenGLRenderer {
 
     private Pair<Executor, Consumer<Long>> mFrameUpdateListener;
 
+    private FrameReadbackListener mFrameReadbackListener;
+    // Index, timestamp, width and height of a frame read back.
+    private final long[] mReadbackFrameInfo = new long[4];
+
     private final Set<DynamicRange> mHighDynamicRangesSupportedByOutput;
 
     OpenGLRenderer(@NonNull Set<DynamicRange> highDynamicRangesSupportedByOutput) {
         mHighDynamicRangesSupportedByOutput = highDynamicRangesSupportedByOutput;
         // Initialize the GL context on the GL thread
-        mExecutor.execute(() -> mNativeContext = initContext());
+        mExecutor.execute(() -> {
+            mNativeContext = initContext();
+            if (mNativeContext != 0) {
+                setTransformBuffer(mNativeContext, mTransformBuffer);
+            }
+        });
     }
 
     /**
@@ -175,6 +199,8 @@ final class OpenGLRenderer {
                             mRendererBitDepth = newRendererBitDepth;
                             updateRenderedDynamicRange(mNativeContext, mRendererDynamicRange,
                                     mRendererBitDepth);
+                            // The program is recreated, so its uniforms must be uploaded again.
+                            mMvpDirty = true;
                         }
 
                         surfaceRequest.setTransformationInfoListener(
@@ -267,6 +293,75 @@ final class OpenGLRenderer {
         }
     }
 
+    /**
+     * Sets whether the transforms are passed to the native renderer through a direct buffer
+     * rather than float arrays.
+     *
+     * <p>Both modes only upload the uniforms that changed. The direct buffer is read in place by
+     * the native renderer, so the per frame cost of JNI array access is avoided.
+     */
+    void setTransformBufferEnabled(boolean enabled) {
+        try {
+            mExecutor.execute(() -> {
+                if (enabled != mUseTransformBuffer) {
+                    // The MVP is only written to the buffer when it changes.
+                    mMvpDirty = true;
+                }
+                mUseTransformBuffer = enabled;
+            });
+        } catch (RejectedExecutionException e) {
+            // Renderer is shutting down. Ignore.
+        }
+    }
+
+    /**
+     * Sets a listener to receive the frames drawn to the output {@link Surface}, read back
+     * asynchronously through a ring of pixel buffer objects.
+     *
+     * <p>Reading a frame back does not stall rendering. Frames are handed back once the GPU has
+     * written them, at most {@code depth - 1} frames after they were drawn. Frames that are not
+     * handed back by then are dropped. Requires OpenGL ES 3.0, and otherwise no frames are
+     * received.
+     *
+     * @param listener Listener called on the GL thread, or null to stop the readback.
+     * @param depth    Number of frames in flight, from 2 to 8.
+     */
+    void setFrameReadbackListener(@Nullable FrameReadbackListener listener, int depth) {
+        try {
+            mExecutor.execute(() -> {
+                if (mIsShutdown) {
+                    return;
+                }
+                mFrameReadbackListener = listener;
+                setReadbackDepth(mNativeContext, listener != null ? depth : 0);
+            });
+        } catch (RejectedExecutionException e) {
+            // Renderer is shutting down. Ignore.
+        }
+    }
+
+    /**
+     * Returns the number of frames queued for readback, handed back and dropped. The counts
+     * restart when the listener is set or the size of the output surface changes.
+     */
+    @NonNull
+    ListenableFuture<long[]> getFrameReadbackStats() {
+        return CallbackToFutureAdapter.getFuture(completer -> {
+            try {
+                mExecutor.execute(() -> {
+                    long[] stats = new long[3];
+                    if (!mIsShutdown) {
+                        getReadbackStats(mNativeContext, stats);
+                    }
+                    completer.set(stats);
+                });
+            } catch (RejectedExecutionException e) {
+                completer.set(new long[3]);
+            }
+            return "getFrameReadbackStats";
+        });
+    }
+
     void clearFrameUpdateListener() {
         try {
             mExecutor.execute(() -> mFrameUpdateListener = null);
@@ -320,6 +415,81 @@ final class OpenGLRenderer {
         });
     }
 
+    /**
+     * Adds a surface which is drawn in addition to the output surface, such as the input surface
+     * of an encoder.
+     *
+     * <p>Every frame is drawn to the output surface and all added surfaces in a single pass,
+     * sharing the EGL context, the camera texture and the presentation timestamp. Each surface
+     * has its own viewport and center-crop transform.
+     *
+     * @param surface                surface to draw onto.
+     * @param surfaceSize            size of the surface.
+     * @param surfaceRotationDegrees rotation of the surface, as for
+     *                               {@link #attachOutputSurface(Surface, Size, int)}.
+     * @return A {@link ListenableFuture} with the id to remove the surface with, or -1 if the
+     * surface cannot be added.
+     */
+    @SuppressWarnings("ObjectToString")
+    @NonNull
+    ListenableFuture<Integer> addOutputSurface(@NonNull Surface surface,
+            @NonNull Size surfaceSize, int surfaceRotationDegrees) {
+        return CallbackToFutureAdapter.getFuture(completer -> {
+            try {
+                mExecutor.execute(
+                        () -> {
+                            int id = -1;
+                            if (!mIsShutdown) {
+                                id = addWindowSurface(mNativeContext, surface,
+                                        mRendererDynamicRange);
+                            }
+                            if (id != -1) {
+                                mOutputSurfaces.add(new OutputSurface(id, surfaceSize,
+                                        surfaceRotationDegrees));
+                                mMvpDirty = true;
+                            }
+                            completer.set(id);
+                        });
+            } catch (RejectedExecutionException e) {
+                // Renderer is shutting down.
+                completer.set(-1);
+            }
+            return "addOutputSurface [" + this + "]";
+        });
+    }
+
+    /**
+     * Removes a surface added with {@link #addOutputSurface(Surface, Size, int)}.
+     *
+     * @return A {@link ListenableFuture} that signals the surface is no longer drawn to and can
+     * be released.
+     */
+    @SuppressWarnings("ObjectToString")
+    @NonNull
+    ListenableFuture<Void> removeOutputSurface(int id) {
+        return CallbackToFutureAdapter.getFuture(completer -> {
+            try {
+                mExecutor.execute(
+                        () -> {
+                            if (!mIsShutdown) {
+                                removeWindowSurface(mNativeContext, id);
+                            }
+                            for (int i = 0; i < mOutputSurfaces.size(); i++) {
+                                if (mOutputSurfaces.get(i).mId == id) {
+                                    mOutputSurfaces.remove(i);
+                                    break;
+                                }
+                            }
+                            completer.set(null);
+                        });
+            } catch (RejectedExecutionException e) {
+                // Renderer is shutting down. Can notify that the surface is removed.
+                completer.set(null);
+            }
+            return "removeOutputSurface [" + this + "]";
+        });
+    }
+
     void shutdown() {
         try {
             mExecutor.execute(
@@ -327,6 +497,8 @@ final class OpenGLRenderer {
                         if (!mIsShutdown) {
                             closeContext(mNativeContext);
                             mNativeContext = 0;
+                            mOutputSurfaces.clear();
+                            mFrameReadbackListener = null;
                             mIsShutdown = true;
                         }
                         doShutdownExecutorIfNeeded();
@@ -383,13 +555,35 @@ final class OpenGLRenderer {
         }
 
         mTextureRotationDegrees = textureRotationDegrees;
-        if (mSurfaceSize != null) {
+        if (mSurfaceSize != null || !mOutputSurfaces.isEmpty()) {
             if (mMvpDirty) {
-                updateMvpTransform();
+                if (mSurfaceSize != null) {
+                    updateMvpTransform(mSurfaceSize, mSurfaceRotationDegrees, mMvpTransform);
+                }
+                for (OutputSurface outputSurface : mOutputSurfaces) {
+                    updateMvpTransform(outputSurface.mSize, outputSurface.mRotationDegrees,
+                            outputSurface.mMvpTransform);
+                    setWindowSurfaceTransform(mNativeContext, outputSurface.mId,
+                            outputSurface.mMvpTransform);
+                }
+            }
+            boolean success;
+            if (mUseTransformBuffer) {
+                if (mMvpDirty) {
+                    mTransformBuffer.position(0);
+                    mTransformBuffer.put(mMvpTransform);
+                }
+                mTransformBuffer.position(16);
+                mTransformBuffer.put(mTextureTransform);
+                success = renderTextureFromTransformBuffer(mNativeContext, timestampNs);
+            } else {
+                success = renderTexture(mNativeContext, timestampNs, mMvpTransform, mMvpDirty,
+                        mTextureTransform);
             }
-            boolean success = renderTexture(mNativeContext, timestampNs, mMvpTransform, mMvpDirty,
-                    mTextureTransform);
             mMvpDirty = false;
+            if (mFrameReadbackListener != null) {
+                deliverReadbackFrames();
+            }
             if (success && mFrameUpdateListener != null) {
                 Executor executor = Objects.requireNonNull(mFrameUpdateListener.first);
                 Consumer<Long> listener = Objects.requireNonNull(mFrameUpdateListener.second);
@@ -402,6 +596,20 @@ final class OpenGLRenderer {
         }
     }
 
+    /** Hands the frames whose readback has completed to the listener, without waiting. */
+    @WorkerThread
+    private void deliverReadbackFrames() {
+        ByteBuffer pixels;
+        while ((pixels = acquireReadbackFrame(mNativeContext, mReadbackFrameInfo)) != null) {
+            try {
+                mFrameReadbackListener.onFrameReadback(pixels, (int) mReadbackFrameInfo[2],
+                        (int) mReadbackFrameInfo[3], mReadbackFrameInfo[1]);
+            } finally {
+                releaseReadbackFrame(mNativeContext, (int) mReadbackFrameInfo[0]);
+            }
+        }
+    }
+
     /**
      * Calculates the rotation of the source texture between the sensor coordinate space and
      * the device's 'natural' orientation.
@@ -529,15 +737,15 @@ final class OpenGLRenderer {
      * 'center-crop' and is equivalent to {@link android.widget.ImageView.ScaleType#CENTER_CROP}.
      */
     @WorkerThread
-    private void extractPreviewCropFromPreviewSizeAndSurface() {
+    private void extractPreviewCropFromPreviewSizeAndSurface(@NonNull Size surfaceSize,
+            int viewPortRotation) {
         // Swap the dimensions of the surface we are drawing the texture onto if rotating the
         // texture to the surface orientation requires a 90 degree or 270 degree rotation.
-        int viewPortRotation = getViewPortRotation();
         if (viewPortRotation == 90 || viewPortRotation == 270) {
             // Width and height swapped
-            mPreviewCropRect = new RectF(0, 0, mSurfaceSize.getHeight(), mSurfaceSize.getWidth());
+            mPreviewCropRect = new RectF(0, 0, surfaceSize.getHeight(), surfaceSize.getWidth());
         } else {
-            mPreviewCropRect = new RectF(0, 0, mSurfaceSize.getWidth(), mSurfaceSize.getHeight());
+            mPreviewCropRect = new RectF(0, 0, surfaceSize.getWidth(), surfaceSize.getHeight());
         }
 
         android.graphics.Matrix centerCropMatrix = new android.graphics.Matrix();
@@ -555,7 +763,7 @@ final class OpenGLRenderer {
      * the viewport coordinates.
      */
     @WorkerThread
-    private int getViewPortRotation() {
+    private int getViewPortRotation(int surfaceRotationDegrees) {
         // Note that since the rotation defined by Surface#ROTATION_*** are positive when the
         // device is rotated in a counter-clockwise direction and our world-space coordinates
         // define positive angles in the clockwise direction, we add the two together to get the
@@ -563,7 +771,7 @@ final class OpenGLRenderer {
         if (mHasCameraTransform) {
             // If the Surface is connected to the camera, there is surface rotation encoded in
             // the SurfaceTexture.
-            return within360((180 - mTextureRotationDegrees) + mSurfaceRotationDegrees);
+            return within360((180 - mTextureRotationDegrees) + surfaceRotationDegrees);
         } else {
             // When the Surface is connected to an internal OpenGl renderer, the texture rotation
             // is always 0. Use the rotation provided by SurfaceRequest instead.
@@ -642,10 +850,10 @@ final class OpenGLRenderer {
      * the negative z-axis.
      */
     @WorkerThread
-    private void updateViewTransform() {
+    private void updateViewTransform(int viewPortRotation) {
         // Apply the rotation of the ViewPort and look at the center of the image
         float[] upVec = DIRECTION_UP_ROT_0;
-        switch (getViewPortRotation()) {
+        switch (viewPortRotation) {
             case 0:
                 upVec = DIRECTION_UP_ROT_0;
                 break;
@@ -682,12 +890,11 @@ final class OpenGLRenderer {
      * position on the z-axis, 1 unit away.
      */
     @WorkerThread
-    private void updateProjectionTransform() {
+    private void updateProjectionTransform(int viewPortRotation) {
         float viewPortWidth = mPreviewCropRect.width();
         float viewPortHeight = mPreviewCropRect.height();
         // Since projection occurs after rotation of the camera, in order to map directly to model
         // coordinates we need to take into account the surface rotation.
-        int viewPortRotation = getViewPortRotation();
         if (viewPortRotation == 90 || viewPortRotation == 270) {
             viewPortWidth = mPreviewCropRect.height();
             viewPortHeight = mPreviewCropRect.width();
@@ -706,11 +913,17 @@ final class OpenGLRenderer {
      * The MVP is the combination of model, view and projection transforms that take us from the
      * world space to normalized device coordinates (NDC) which OpenGL uses to display images
      * with the correct dimensions on an EGL surface.
+     *
+     * @param surfaceSize            size of the surface drawn onto.
+     * @param surfaceRotationDegrees rotation of the surface drawn onto.
+     * @param mvpTransform           receives the MVP of the surface.
      */
     @WorkerThread
-    private void updateMvpTransform() {
+    private void updateMvpTransform(@NonNull Size surfaceSize, int surfaceRotationDegrees,
+            @NonNull float[] mvpTransform) {
+        int viewPortRotation = getViewPortRotation(surfaceRotationDegrees);
         if (!mIsPreviewCropRectPrecalculated) {
-            extractPreviewCropFromPreviewSizeAndSurface();
+            extractPreviewCropFromPreviewSizeAndSurface(surfaceSize, viewPortRotation);
         }
 
         if (DEBUG) {
@@ -719,8 +932,8 @@ final class OpenGLRenderer {
         }
 
         updateModelTransform();
-        updateViewTransform();
-        updateProjectionTransform();
+        updateViewTransform(viewPortRotation);
+        updateProjectionTransform(viewPortRotation);
 
         Matrix.multiplyMM(mTempMatrix, 0, mViewTransform, 0, mModelTransform, 0);
 
@@ -729,9 +942,9 @@ final class OpenGLRenderer {
             printMatrix("MVTransform", mTempMatrix, 0);
         }
 
-        Matrix.multiplyMM(mMvpTransform, 0, mProjectionTransform, 0, mTempMatrix, 0);
+        Matrix.multiplyMM(mvpTransform, 0, mProjectionTransform, 0, mTempMatrix, 0);
         if (DEBUG) {
-            printMatrix("MVPTransform", mMvpTransform, 0);
+            printMatrix("MVPTransform", mvpTransform, 0);
         }
     }
 
@@ -747,6 +960,34 @@ final class OpenGLRenderer {
                 matrix[offset + 3], matrix[offset + 7], matrix[offset + 11], matrix[offset + 15]));
     }
 
+    /** Receives frames read back from the output surface. */
+    interface FrameReadbackListener {
+        /**
+         * Called on the GL thread with a frame read back from the output surface.
+         *
+         * @param pixels      RGBA_8888 pixels with rows from bottom to top and a row stride of
+         *                    {@code width * 4}. Only valid for the duration of the call.
+         * @param width       width of the frame.
+         * @param height      height of the frame.
+         * @param timestampNs timestamp of the camera frame that was drawn.
+         */
+        void onFrameReadback(@NonNull ByteBuffer pixels, int width, int height, long timestampNs);
+    }
+
+    /** A surface drawn in addition to the output surface. */
+    private static final class OutputSurface {
+        final int mId;
+        final Size mSize;
+        final int mRotationDegrees;
+        final float[] mMvpTransform = new float[16];
+
+        OutputSurface(int id, @NonNull Size size, int rotationDegrees) {
+            mId = id;
+            mSize = size;
+            mRotationDegrees = rotationDegrees;
+        }
+    }
+
     @WorkerThread
     private static native long initContext();
 
@@ -754,6 +995,17 @@ final class OpenGLRenderer {
     private static native boolean setWindowSurface(long nativeContext, @Nullable Surface surface,
             @RendererDynamicRange int dynamicRange);
 
+    @WorkerThread
+    private static native int addWindowSurface(long nativeContext, @NonNull Surface surface,
+            @RendererDynamicRange int dynamicRange);
+
+    @WorkerThread
+    private static native boolean setWindowSurfaceTransform(long nativeContext, int id,
+            @NonNull float[] mvpTransform);
+
+    @WorkerThread
+    private static native void removeWindowSurface(long nativeContext, int id);
+
     @WorkerThread
     private static native int getTexName(long nativeContext);
 
@@ -765,6 +1017,28 @@ final class OpenGLRenderer {
             boolean mvpDirty,
             @NonNull float[] textureTransform);
 
+    @WorkerThread
+    private static native boolean setTransformBuffer(long nativeContext,
+            @Nullable FloatBuffer transformBuffer);
+
+    @WorkerThread
+    private static native boolean renderTextureFromTransformBuffer(long nativeContext,
+            long timestampNs);
+
+    @WorkerThread
+    private static native void setReadbackDepth(long nativeContext, int depth);
+
+    @WorkerThread
+    @Nullable
+    private static native ByteBuffer acquireReadbackFrame(long nativeContext,
+            @NonNull long[] frameInfo);
+
+    @WorkerThread
+    private static native void releaseReadbackFrame(long nativeContext, int index);
+
+    @WorkerThread
+    private static native void getReadbackStats(long nativeContext, @NonNull long[] stats);
+
     @WorkerThread
     private static native void closeContext(long nativeContext);
 
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.graphics.opengl
+
+import android.hardware.HardwareBuffer
+import android.opengl.EGL14
+import android.opengl.GLES20
+import android.os.Build
+import androidx.graphics.opengl.egl.EGLConfigAttributes
+import androidx.graphics.opengl.egl.EGLManager
+import androidx.hardware.HardwareBufferPool
+import androidx.opengl.EGLExt.Companion.EGL_ANDROID_IMAGE_NATIVE_BUFFER
+import androidx.opengl.EGLExt.Companion.EGL_KHR_IMAGE_BASE
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.filters.SdkSuppress
+import androidx.test.filters.SmallTest
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNotEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+
+@SdkSuppress(minSdkVersion = Build.VERSION_CODES.O)
+@RunWith(AndroidJUnit4::class)
+@SmallTest
+class EGLImageCacheTest {
+
+    @Test
+    fun testGetTextureReusesImage() {
+        withImageCache(capacity = 2) { cache ->
+            val first = createBuffer()
+            val second = createBuffer()
+            val third = createBuffer()
+            try {
+                val texture = cache.getTexture(first)
+                assertNotEquals(0, texture)
+                assertEquals(texture, cache.getTexture(first))
+                val boundTexture = IntArray(1)
+                GLES20.glGetIntegerv(GLES20.GL_TEXTURE_BINDING_2D, boundTexture, 0)
+                assertEquals(texture, boundTexture[0])
+
+                assertNotEquals(0, cache.getTexture(second))
+                // Evicts the least recently used buffer, which is the second one
+                cache.getTexture(first)
+                assertNotEquals(0, cache.getTexture(third))
+
+                val stats = cache.stats
+                assertEquals(2L, stats.hits)
+                assertEquals(3L, stats.misses)
+                assertEquals(1L, stats.evictions)
+                assertEquals(2L, stats.size)
+
+                assertTrue(cache.evict(first))
+                assertFalse(cache.evict(second))
+                assertEquals(1L, cache.stats.size)
+                cache.clear()
+                assertEquals(0L, cache.stats.size)
+            } finally {
+                first.close()
+                second.close()
+                third.close()
+            }
+        }
+    }
+
+    @Test
+    fun testReleaseToPoolEvictsBuffersDroppedByThePool() {
+        withImageCache(capacity = 2) { cache ->
+            val pool = HardwareBufferPool(1)
+            try {
+                val first = pool.obtain(10, 10, HardwareBuffer.RGBA_8888, USAGE)!!
+                assertNotEquals(0, cache.getTexture(first))
+                // The pool still holds the buffer, so its image stays cached for the next frame
+                assertTrue(cache.releaseToPool(pool, first))
+                assertEquals(1L, cache.stats.size)
+
+                // The pool evicts the first buffer to make room for one of another size
+                val second = pool.obtain(20, 20, HardwareBuffer.RGBA_8888, USAGE)!!
+                assertNotEquals(0, cache.getTexture(second))
+                assertEquals(2L, cache.stats.size)
+                assertTrue(cache.releaseToPool(pool, second))
+                assertEquals(1L, cache.stats.size)
+
+                pool.close()
+                assertEquals(1, cache.evictUnpooled(pool))
+                assertEquals(0L, cache.stats.size)
+            } finally {
+                pool.close()
+            }
+        }
+    }
+
+    @Test
+    fun testEGLManagerReleaseClosesImageCache() {
+        with(EGLManager()) {
+            try {
+                initialize()
+                createContext(loadConfig(EGLConfigAttributes.RGBA_8888)!!)
+                if (
+                    isExtensionSupported(EGL_KHR_IMAGE_BASE) &&
+                        isExtensionSupported(EGL_ANDROID_IMAGE_NATIVE_BUFFER)
+                ) {
+                    val cache = createImageCache()
+                    val buffer = createBuffer()
+                    try {
+                        assertNotEquals(0, cache.getTexture(buffer))
+                        release()
+                        assertTrue(cache.isClosed)
+                    } finally {
+                        buffer.close()
+                    }
+                }
+            } finally {
+                release()
+            }
+        }
+    }
+
+    private fun createBuffer(): HardwareBuffer =
+        HardwareBuffer.create(10, 10, HardwareBuffer.RGBA_8888, 1, USAGE)
+
+    private fun withImageCache(capacity: Int, block: (cache: EGLImageCache) -> Unit) {
+        with(EGLManager()) {
+            try {
+                initialize()
+                createContext(loadConfig(EGLConfigAttributes.RGBA_8888)!!)
+                if (
+                    isExtensionSupported(EGL_KHR_IMAGE_BASE) &&
+                        isExtensionSupported(EGL_ANDROID_IMAGE_NATIVE_BUFFER)
+                ) {
+                    val cache = EGLImageCache(EGL14.eglGetCurrentDisplay(), capacity)
+                    try {
+                        block(cache)
+                    } finally {
+                        cache.close()
+                        assertTrue(cache.isClosed)
+                    }
+                }
+            } finally {
+                release()
+            }
+        }
+    }
+
+    companion object {
+        private const val USAGE =
+            HardwareBuffer.USAGE_GPU_SAMPLED_IMAGE or HardwareBuffer.USAGE_GPU_COLOR_OUTPUT
+    }
+}
@@ -158,6 +158,129 @@ class SurfaceControlWrapperTest {
         }
     }
 
+    @Test
+    fun testTransactionFrameTimelineRecorder() {
+        val listener = TransactionOnCompleteListener()
+        val recorder = FrameTimelineRecorder(capacity = 4)
+        val scenario = ActivityScenario.launch(SurfaceControlWrapperTestActivity::class.java)
+
+        val destroyLatch = CountDownLatch(1)
+        try {
+            var commitTime = 0L
+            scenario.onActivity {
+                it.setDestroyCallback { destroyLatch.countDown() }
+                val scCompat =
+                    SurfaceControlWrapper.Builder()
+                        .setParent(it.getSurfaceView().holder.surface)
+                        .setDebugName("FrameTimelineRecorderTest")
+                        .build()
+                val buffer =
+                    SurfaceControlUtils.getSolidBuffer(
+                        SurfaceControlWrapperTestActivity.DEFAULT_WIDTH,
+                        SurfaceControlWrapperTestActivity.DEFAULT_HEIGHT,
+                        Color.BLUE
+                    )
+                commitTime = System.nanoTime()
+                SurfaceControlWrapper.Transaction()
+                    .setBuffer(scCompat, buffer)
+                    .setVisibility(scCompat, true)
+                    .setFrameTimelineRecorder(recorder, scCompat, 7)
+                    .addTransactionCompletedListener(listener)
+                    .commit()
+            }
+
+            assertTrue(listener.mLatch.await(3, TimeUnit.SECONDS))
+            // The present fence may signal after the transaction completed
+            var records = recorder.getRecords()
+            val deadline = SystemClock.uptimeMillis() + 3000
+            while (records.isEmpty() && SystemClock.uptimeMillis() < deadline) {
+                Thread.sleep(16)
+                records = recorder.getRecords()
+            }
+            assertEquals(1, records.size)
+            val record = records[0]
+            assertEquals(7L, record.frameId)
+            assertEquals(-1L, record.desiredPresentTimeNanos)
+            assertTrue(record.commitTimeNanos >= commitTime)
+            assertTrue(record.completeTimeNanos >= record.commitTimeNanos)
+
+            val summary = recorder.getSummary()
+            assertEquals(1L, summary.frameCount)
+            assertEquals(0L, summary.missedDeadlineCount)
+
+            recorder.reset()
+            assertTrue(recorder.getRecords().isEmpty())
+        } finally {
+            recorder.close()
+            // ensure activity is destroyed after any failures
+            scenario.moveToState(Lifecycle.State.DESTROYED)
+            assertTrue(destroyLatch.await(3000, TimeUnit.MILLISECONDS))
+        }
+    }
+
+    @Test
+    fun testTransactionFrameScheduler() {
+        val listener = TransactionOnCompleteListener()
+        val scheduler = FrameScheduler(16_666_667L)
+        val scenario = ActivityScenario.launch(SurfaceControlWrapperTestActivity::class.java)
+
+        val destroyLatch = CountDownLatch(1)
+        try {
+            // Nothing was presented yet, so frames start right away
+            val before = System.nanoTime()
+            assertEquals(0, scheduler.predictVsyncs(3).size)
+            val initial = scheduler.schedule(0)
+            assertTrue(initial.startTimeNanos >= before)
+            assertEquals(16_666_667L, initial.vsyncPeriodNanos)
+
+            scenario.onActivity {
+                it.setDestroyCallback { destroyLatch.countDown() }
+                val scCompat =
+                    SurfaceControlWrapper.Builder()
+                        .setParent(it.getSurfaceView().holder.surface)
+                        .setDebugName("FrameSchedulerTest")
+                        .build()
+                val buffer =
+                    SurfaceControlUtils.getSolidBuffer(
+                        SurfaceControlWrapperTestActivity.DEFAULT_WIDTH,
+                        SurfaceControlWrapperTestActivity.DEFAULT_HEIGHT,
+                        Color.BLUE
+                    )
+                SurfaceControlWrapper.Transaction()
+                    .setBuffer(scCompat, buffer)
+                    .setVisibility(scCompat, true)
+                    .setFrameScheduler(scheduler)
+                    .addTransactionCompletedListener(listener)
+                    .commit()
+            }
+
+            assertTrue(listener.mLatch.await(3, TimeUnit.SECONDS))
+            // The present fence may signal after the transaction completed
+            var vsyncs = scheduler.predictVsyncs(3)
+            val deadline = SystemClock.uptimeMillis() + 3000
+            while (vsyncs.isEmpty() && SystemClock.uptimeMillis() < deadline) {
+                Thread.sleep(16)
+                vsyncs = scheduler.predictVsyncs(3)
+            }
+            assertEquals(3, vsyncs.size)
+            assertEquals(vsyncs[1] - vsyncs[0], vsyncs[2] - vsyncs[1])
+
+            val now = System.nanoTime()
+            val schedule = scheduler.schedule(2_000_000L)
+            assertTrue(schedule.startTimeNanos >= now)
+            assertEquals(schedule.commitDeadlineNanos - 2_000_000L, schedule.startTimeNanos)
+            assertEquals(
+                scheduler.compositorLatencyNanos,
+                schedule.desiredPresentTimeNanos - schedule.commitDeadlineNanos
+            )
+        } finally {
+            scheduler.close()
+            // ensure activity is destroyed after any failures
+            scenario.moveToState(Lifecycle.State.DESTROYED)
+            assertTrue(destroyLatch.await(3000, TimeUnit.MILLISECONDS))
+        }
+    }
+
     @SdkSuppress(minSdkVersion = Build.VERSION_CODES.S)
     @Test
     fun testSurfaceTransactionOnCommitCallback() {
@@ -624,6 +747,39 @@ class SurfaceControlWrapperTest {
         )
     }
 
+    @Test
+    fun testTransactionSetDamageRegion_accumulator() {
+        val damage = DamageAccumulator(maxRects = 2)
+        verifySurfaceControlWrapperTest(
+            { surfaceView ->
+                val scCompat =
+                    SurfaceControlWrapper.Builder()
+                        .setParent(surfaceView.holder.surface)
+                        .setDebugName("SurfaceControlWrapperTest")
+                        .build()
+
+                for (i in 0 until 10) {
+                    damage.add(i * 10, 0, i * 10 + 5, 5)
+                }
+                damage.add(Rect(0, 0, 0, 10))
+                assertEquals(10, damage.rectCount)
+                // Buffer colorspace is RGBA, so Color.BLUE will be visually Red
+                SurfaceControlWrapper.Transaction()
+                    .setDamageRegion(scCompat, damage)
+                    .setBuffer(
+                        scCompat,
+                        SurfaceControlUtils.getSolidBuffer(
+                            SurfaceControlWrapperTestActivity.DEFAULT_WIDTH,
+                            SurfaceControlWrapperTestActivity.DEFAULT_HEIGHT,
+                            Color.BLUE
+                        )
+                    )
+            },
+            { bitmap, rect -> Color.RED == bitmap.getPixel(rect.left, rect.top) }
+        )
+        assertTrue(damage.isEmpty)
+    }
+
     @Test
     fun testTransactionSetDesiredPresentTime_now() {
         verifySurfaceControlWrapperTest(
@@ -938,6 +1094,60 @@ class SurfaceControlWrapperTest {
         )
     }
 
+    @Test
+    @SdkSuppress(minSdkVersion = Build.VERSION_CODES.S)
+    fun testTransactionApplyCommands() {
+        verifySurfaceControlWrapperTest(
+            { surfaceView ->
+                val scCompat =
+                    SurfaceControlWrapper.Builder()
+                        .setParent(surfaceView.holder.surface)
+                        .setDebugName("SurfaceControlCompatTest")
+                        .build()
+
+                // Buffer colorspace is RGBA, so Color.BLUE will be visually Red
+                val buffer =
+                    SurfaceControlUtils.getSolidBuffer(
+                        SurfaceControlWrapperTestActivity.DEFAULT_WIDTH,
+                        SurfaceControlWrapperTestActivity.DEFAULT_HEIGHT,
+                        Color.BLUE
+                    )
+
+                // Start with a tiny initial capacity to exercise the buffer growing
+                val commands =
+                    TransactionCommandBuffer(0)
+                        .setVisibility(scCompat, true)
+                        .setLayer(scCompat, 1)
+                        .setAlpha(scCompat, 1.0f)
+                        .setDamageRegion(
+                            scCompat,
+                            arrayOf(Rect(0, 0, 10, 10), Rect(20, 20, 30, 30))
+                        )
+                        .setScale(scCompat, 1.0f, 1.0f)
+                        .setPosition(scCompat, 30f, 30f)
+                assertEquals(6, commands.commandCount)
+
+                SurfaceControlWrapper.Transaction()
+                    .setBuffer(scCompat, buffer)
+                    .applyCommands(commands)
+            },
+            { bitmap, rect ->
+                val coord = intArrayOf(rect.left, rect.top)
+                Color.BLACK ==
+                    bitmap.getPixel(
+                        coord[0] + SurfaceControlWrapperTestActivity.DEFAULT_WIDTH / 2,
+                        coord[1] + 29
+                    ) &&
+                    Color.BLACK ==
+                        bitmap.getPixel(
+                            coord[0] + 29,
+                            coord[1] + SurfaceControlWrapperTestActivity.DEFAULT_HEIGHT / 2
+                        ) &&
+                    Color.RED == bitmap.getPixel(coord[0] + 30, coord[1] + 30)
+            }
+        )
+    }
+
     @Test
     @SdkSuppress(minSdkVersion = Build.VERSION_CODES.S)
     fun testTransactionSetScale() {
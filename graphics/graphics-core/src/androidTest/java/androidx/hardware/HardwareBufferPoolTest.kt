@@ -0,0 +1,163 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.hardware
+
+import android.hardware.HardwareBuffer
+import android.os.Build
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.filters.SdkSuppress
+import androidx.test.filters.SmallTest
+import java.util.concurrent.atomic.AtomicInteger
+import kotlin.concurrent.thread
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertNull
+import org.junit.Assert.assertTrue
+import org.junit.Assert.fail
+import org.junit.Test
+import org.junit.runner.RunWith
+
+@SdkSuppress(minSdkVersion = Build.VERSION_CODES.O)
+@RunWith(AndroidJUnit4::class)
+@SmallTest
+class HardwareBufferPoolTest {
+
+    @Test
+    fun testObtainReusesReleasedBuffer() {
+        val pool = HardwareBufferPool(2)
+        try {
+            val buffer = pool.obtain(2, 3, HardwareBuffer.RGBA_8888, USAGE)!!
+            assertEquals(2, buffer.width)
+            assertEquals(3, buffer.height)
+            assertEquals(HardwareBuffer.RGBA_8888, buffer.format)
+            assertTrue(pool.release(buffer))
+            assertTrue(buffer.isClosed)
+
+            val reused = pool.obtain(2, 3, HardwareBuffer.RGBA_8888, USAGE)!!
+            assertEquals(1L, pool.stats.allocatedCount)
+            // A different size is a different kind of buffer
+            val other = pool.obtain(4, 4, HardwareBuffer.RGBA_8888, USAGE)!!
+
+            val stats = pool.stats
+            assertEquals(1L, stats.hits)
+            assertEquals(2L, stats.misses)
+            assertEquals(2L, stats.allocatedCount)
+            assertEquals(2L, stats.inUseCount)
+            assertTrue(pool.release(reused))
+            assertTrue(pool.release(other))
+        } finally {
+            pool.close()
+        }
+    }
+
+    @Test
+    fun testObtainWhenExhausted() {
+        val pool = HardwareBufferPool(1)
+        try {
+            val buffer = pool.obtain(2, 2, HardwareBuffer.RGBA_8888, USAGE)
+            assertNotNull(buffer)
+            assertNull(pool.obtain(2, 2, HardwareBuffer.RGBA_8888, USAGE))
+            assertEquals(1L, pool.stats.exhausted)
+
+            // Releasing the buffer makes room for a buffer of another kind
+            assertTrue(pool.release(buffer!!))
+            val other = pool.obtain(3, 3, HardwareBuffer.RGBA_8888, USAGE)
+            assertNotNull(other)
+            assertEquals(1L, pool.stats.evictions)
+            assertTrue(pool.release(other!!))
+        } finally {
+            pool.close()
+        }
+    }
+
+    @Test
+    fun testTrim() {
+        val pool = HardwareBufferPool(3)
+        try {
+            val buffers = List(3) { pool.obtain(2, 2, HardwareBuffer.RGBA_8888, USAGE)!! }
+            buffers.forEach { assertTrue(pool.release(it)) }
+            assertEquals(2, pool.trim(1))
+            assertEquals(1L, pool.stats.allocatedCount)
+        } finally {
+            pool.close()
+        }
+    }
+
+    @Test
+    fun testReleaseAfterClose() {
+        val pool = HardwareBufferPool(2)
+        val buffer = pool.obtain(2, 2, HardwareBuffer.RGBA_8888, USAGE)!!
+        pool.close()
+        assertTrue(pool.isClosed)
+        try {
+            pool.obtain(2, 2, HardwareBuffer.RGBA_8888, USAGE)
+            fail("Expected obtain to fail on a closed pool")
+        } catch (e: IllegalStateException) {
+            // Expected
+        }
+        // The last buffer in use releases the native pool
+        assertTrue(pool.release(buffer))
+        assertFalse(pool.release(buffer))
+    }
+
+    @Test
+    fun testObtainAndReleaseFromSeveralThreads() {
+        val pool = HardwareBufferPool(4)
+        val failures = AtomicInteger()
+        try {
+            // Each thread holds at most one buffer, so the pool is never exhausted
+            val threads =
+                List(4) {
+                    thread {
+                        repeat(50) {
+                            val buffer = pool.obtain(2, 2, HardwareBuffer.RGBA_8888, USAGE)
+                            if (buffer == null || !pool.release(buffer)) {
+                                failures.incrementAndGet()
+                            }
+                        }
+                    }
+                }
+            threads.forEach { it.join() }
+            assertEquals(0, failures.get())
+            val stats = pool.stats
+            assertEquals(200L, stats.hits + stats.misses)
+            assertEquals(0L, stats.inUseCount)
+            assertTrue(stats.allocatedCount <= 4L)
+        } finally {
+            pool.close()
+        }
+    }
+
+    @Test
+    fun testReleaseForeignBuffer() {
+        val pool = HardwareBufferPool(1)
+        val buffer = HardwareBuffer.create(2, 2, HardwareBuffer.RGBA_8888, 1, USAGE)
+        try {
+            assertFalse(pool.release(buffer))
+            assertFalse(buffer.isClosed)
+        } finally {
+            buffer.close()
+            pool.close()
+        }
+    }
+
+    companion object {
+        private const val USAGE =
+            HardwareBuffer.USAGE_GPU_SAMPLED_IMAGE or HardwareBuffer.USAGE_CPU_WRITE_OFTEN
+    }
+}
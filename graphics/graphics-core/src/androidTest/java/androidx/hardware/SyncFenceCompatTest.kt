@@ -25,6 +25,8 @@ import androidx.graphics.opengl.egl.EGLManager
 import androidx.graphics.opengl.egl.EGLSpec
 import androidx.graphics.opengl.egl.EGLVersion
 import androidx.graphics.opengl.egl.supportsNativeAndroidFence
+import androidx.graphics.surface.JniBindings
+import androidx.opengl.EGLExt
 import androidx.test.ext.junit.runners.AndroidJUnit4
 import androidx.test.filters.SdkSuppress
 import androidx.test.filters.SmallTest
@@ -104,6 +106,56 @@ class SyncFenceCompatTest {
         }
     }
 
+    @Test
+    @SdkSuppress(minSdkVersion = Build.VERSION_CODES.O)
+    fun testSyncFenceV19_Merge() {
+        testEglManager {
+            initializeWithDefaultConfig()
+            if (supportsNativeAndroidFence()) {
+                val display = EGL14.eglGetDisplay(EGL14.EGL_DEFAULT_DISPLAY)
+                val fences =
+                    Array(3) {
+                        val sync =
+                            EGLExt.eglCreateSyncKHR(
+                                display,
+                                EGLExt.EGL_SYNC_NATIVE_FENCE_ANDROID,
+                                null
+                            )!!
+                        GLES20.glFlush()
+                        val fence = EGLExt.eglDupNativeFenceFDANDROID(display, sync)
+                        EGLExt.eglDestroySyncKHR(display, sync)
+                        fence.mImpl as SyncFenceV19
+                    }
+                val merged = SyncFenceV19.merge("merged", fences)
+                assertTrue(merged.isValid())
+                assertTrue(merged.awaitForever())
+                assertTrue(SyncFenceV19.awaitAll(fences, 0))
+
+                val signalTimes = LongArray(fences.size)
+                SyncFenceV19.getSignalTimesNanos(fences, signalTimes)
+                // The merged fence signals with the last of the fences it was merged from
+                assertEquals(signalTimes.max(), merged.getSignalTimeNanos())
+
+                // The merged fence holds all the fences, querying it grows the scratch space
+                val fds =
+                    arrayOf(fences[0], merged, fences[2])
+                        .map { JniBindings.nDupFenceFd(it) }
+                        .toIntArray()
+                val batchedSignalTimes = LongArray(fds.size)
+                val statuses = IntArray(fds.size)
+                SyncFenceV19.getFenceInfos(fds, batchedSignalTimes, statuses)
+                assertEquals(signalTimes[0], batchedSignalTimes[0])
+                assertEquals(signalTimes.max(), batchedSignalTimes[1])
+                assertEquals(signalTimes[2], batchedSignalTimes[2])
+                statuses.forEach { assertEquals(SyncFenceV19.STATUS_SIGNALED, it) }
+                fds.forEach { SyncFenceV19(it).close() }
+
+                merged.close()
+                fences.forEach { it.close() }
+            }
+        }
+    }
+
     // Helper method used in testing to initialize EGL and default
     // EGLConfig to the ARGB8888 configuration
     private fun EGLManager.initializeWithDefaultConfig() {
@@ -17,11 +17,15 @@
 package androidx.hardware
 
 import android.os.Build
+import android.os.ParcelFileDescriptor
 import androidx.graphics.surface.JniBindings
 import androidx.test.ext.junit.runners.AndroidJUnit4
 import androidx.test.filters.SdkSuppress
 import androidx.test.filters.SmallTest
+import java.io.FileOutputStream
+import java.util.concurrent.TimeUnit
 import org.junit.Assert
+import org.junit.Assert.assertEquals
 import org.junit.Assert.assertFalse
 import org.junit.Assert.assertTrue
 import org.junit.Assert.fail
@@ -92,4 +96,60 @@ class SyncFenceV19Test {
     fun testResolveSyncFileInfoFree() {
         assertTrue(SyncFenceBindings.nResolveSyncFileInfoFree())
     }
+
+    @Test
+    fun testAwaitAnyAndAwaitAll() {
+        // Pipes stand in for sync fences, they are signaled once data can be read
+        val first = ParcelFileDescriptor.createPipe()
+        val second = ParcelFileDescriptor.createPipe()
+        val fences = arrayOf(SyncFenceV19(first[0].detachFd()), SyncFenceV19(second[0].detachFd()))
+        try {
+            val timeoutNanos = TimeUnit.MILLISECONDS.toNanos(10)
+            assertEquals(-1, SyncFenceV19.awaitAny(fences, timeoutNanos))
+            FileOutputStream(second[1].fileDescriptor).write(1)
+            assertEquals(1, SyncFenceV19.awaitAny(fences, timeoutNanos))
+            assertFalse(SyncFenceV19.awaitAll(fences, timeoutNanos))
+            FileOutputStream(first[1].fileDescriptor).write(1)
+            assertTrue(SyncFenceV19.awaitAll(fences, timeoutNanos))
+        } finally {
+            fences.forEach { it.close() }
+            first[1].close()
+            second[1].close()
+        }
+    }
+
+    @Test
+    fun testAwaitInvalidFences() {
+        val fences = arrayOf(SyncFenceV19(-1), SyncFenceV19(-1))
+        assertEquals(0, SyncFenceV19.awaitAny(fences, 0))
+        assertTrue(SyncFenceV19.awaitAll(fences, 0))
+        assertTrue(SyncFenceV19.awaitAll(emptyArray(), 0))
+    }
+
+    @Test
+    fun testMergeInvalidFences() {
+        val merged = SyncFenceV19.merge("merged", arrayOf(SyncFenceV19(-1), SyncFenceV19(-1)))
+        assertFalse(merged.isValid())
+    }
+
+    @SdkSuppress(minSdkVersion = Build.VERSION_CODES.O)
+    @Test
+    fun testGetSignalTimesInvalidFences() {
+        val signalTimes = LongArray(2)
+        SyncFenceV19.getSignalTimesNanos(arrayOf(SyncFenceV19(-1), SyncFenceV19(7)), signalTimes)
+        assertEquals(SyncFenceCompat.SIGNAL_TIME_INVALID, signalTimes[0])
+        assertEquals(SyncFenceCompat.SIGNAL_TIME_INVALID, signalTimes[1])
+    }
+
+    @SdkSuppress(minSdkVersion = Build.VERSION_CODES.O)
+    @Test
+    fun testGetFenceInfosInvalidFences() {
+        val signalTimes = LongArray(2)
+        val statuses = IntArray(2)
+        SyncFenceV19.getFenceInfos(intArrayOf(-1, 7), signalTimes, statuses)
+        assertEquals(SyncFenceCompat.SIGNAL_TIME_INVALID, signalTimes[0])
+        assertEquals(SyncFenceCompat.SIGNAL_TIME_INVALID, signalTimes[1])
+        assertTrue(statuses[0] < 0)
+        assertTrue(statuses[1] < 0)
+    }
 }
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.hardware
+
+import android.os.ParcelFileDescriptor
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.filters.SmallTest
+import java.io.FileOutputStream
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.TimeUnit
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNotEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+import org.junit.runner.RunWith
+
+@RunWith(AndroidJUnit4::class)
+@SmallTest
+class SyncFenceWatcherTest {
+
+    @Test
+    fun testWatchSignaledFileDescriptors() {
+        val signalTimes = ConcurrentHashMap<Long, Long>()
+        val latch = CountDownLatch(3)
+        val watcher =
+            SyncFenceWatcher { tokens, times ->
+                for (i in tokens.indices) {
+                    signalTimes[tokens[i]] = times[i]
+                    latch.countDown()
+                }
+            }
+        val writers = ArrayList<ParcelFileDescriptor>()
+        try {
+            // Pipes stand in for sync fences, they are signaled once data can be read
+            for (token in 1L..3L) {
+                val pipe = ParcelFileDescriptor.createPipe()
+                assertTrue(watcher.watchFileDescriptor(pipe[0].detachFd(), token))
+                writers.add(pipe[1])
+            }
+            assertEquals(3, watcher.pendingCount)
+            for (writer in writers) {
+                FileOutputStream(writer.fileDescriptor).write(1)
+            }
+            assertTrue(latch.await(3000, TimeUnit.MILLISECONDS))
+            for (token in 1L..3L) {
+                val signalTime = signalTimes[token]!!
+                assertNotEquals(SyncFenceCompat.SIGNAL_TIME_PENDING, signalTime)
+                assertNotEquals(SyncFenceCompat.SIGNAL_TIME_INVALID, signalTime)
+            }
+            assertEquals(0, watcher.pendingCount)
+        } finally {
+            writers.forEach { it.close() }
+            watcher.close()
+        }
+    }
+
+    @Test
+    fun testWatchTimeout() {
+        var signalTime = 0L
+        val latch = CountDownLatch(1)
+        val watcher =
+            SyncFenceWatcher { _, times ->
+                signalTime = times[0]
+                latch.countDown()
+            }
+        val pipe = ParcelFileDescriptor.createPipe()
+        try {
+            val timeoutNanos = TimeUnit.MILLISECONDS.toNanos(20)
+            assertTrue(watcher.watchFileDescriptor(pipe[0].detachFd(), 1, timeoutNanos))
+            assertTrue(latch.await(3000, TimeUnit.MILLISECONDS))
+            assertEquals(SyncFenceCompat.SIGNAL_TIME_PENDING, signalTime)
+        } finally {
+            pipe[1].close()
+            watcher.close()
+        }
+    }
+
+    @Test
+    fun testCancel() {
+        val latch = CountDownLatch(1)
+        val watcher = SyncFenceWatcher { _, _ -> latch.countDown() }
+        val pipe = ParcelFileDescriptor.createPipe()
+        try {
+            assertTrue(watcher.watchFileDescriptor(pipe[0].detachFd(), 1))
+            assertTrue(watcher.cancel(1))
+            assertFalse(watcher.cancel(1))
+            FileOutputStream(pipe[1].fileDescriptor).write(1)
+            assertFalse(latch.await(100, TimeUnit.MILLISECONDS))
+        } finally {
+            pipe[1].close()
+            watcher.close()
+        }
+    }
+
+    @Test
+    fun testWatchInvalidFence() {
+        val watcher = SyncFenceWatcher { _, _ -> }
+        try {
+            assertFalse(watcher.watch(SyncFenceV19(-1), 1))
+        } finally {
+            watcher.close()
+        }
+        assertFalse(watcher.watchFileDescriptor(-1, 1))
+    }
+}
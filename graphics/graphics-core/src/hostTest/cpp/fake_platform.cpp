@@ -0,0 +1,277 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_platform.h"
+#include <algorithm>
+#include <android/api-level.h>
+#include <android/hardware_buffer.h>
+#include <android/hardware_buffer_jni.h>
+#include <android/log.h>
+#include <android/native_window_jni.h>
+#include <android/trace.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/system_properties.h>
+#include <unistd.h>
+
+static constexpr int DEFAULT_API_LEVEL = 34;
+
+static std::atomic<int> gApiLevel{DEFAULT_API_LEVEL};
+static std::atomic<bool> gTraceEnabled{false};
+static std::atomic<size_t> gLogCounts[ANDROID_LOG_SILENT + 1];
+static std::atomic<size_t> gHardwareBufferCount{0};
+static std::atomic<uint64_t> gNextHardwareBufferId{1};
+
+static std::mutex gLock;
+static std::map<std::string, std::string> gProperties;
+static std::map<std::string, int64_t> gTraceCounters;
+
+struct AHardwareBuffer {
+    AHardwareBuffer_Desc desc;
+    uint64_t id;
+    std::atomic<int32_t> refCount;
+    uint8_t *data;
+};
+
+struct ANativeWindow {
+    int32_t width;
+    int32_t height;
+    std::atomic<int32_t> refCount;
+};
+
+void FakePlatform::setApiLevel(int apiLevel) {
+    gApiLevel = apiLevel;
+}
+
+void FakePlatform::setSystemProperty(const char *name, const char *value) {
+    std::lock_guard<std::mutex> lock(gLock);
+    gProperties[name] = value;
+}
+
+void FakePlatform::setTraceEnabled(bool enabled) {
+    gTraceEnabled = enabled;
+}
+
+int64_t FakePlatform::getTraceCounter(const char *name) {
+    std::lock_guard<std::mutex> lock(gLock);
+    auto it = gTraceCounters.find(name);
+    return it != gTraceCounters.end() ? it->second : -1;
+}
+
+size_t FakePlatform::getLogCount(int priority) {
+    return priority >= 0 && priority <= ANDROID_LOG_SILENT ? gLogCounts[priority].load() : 0;
+}
+
+size_t FakePlatform::getHardwareBufferCount() {
+    return gHardwareBufferCount;
+}
+
+ANativeWindow *FakePlatform::createWindow(int32_t width, int32_t height) {
+    auto window = new ANativeWindow{width, height, {}};
+    window->refCount = 1;
+    return window;
+}
+
+void FakePlatform::reset() {
+    gApiLevel = DEFAULT_API_LEVEL;
+    gTraceEnabled = false;
+    for (auto &count : gLogCounts) {
+        count = 0;
+    }
+    std::lock_guard<std::mutex> lock(gLock);
+    gProperties.clear();
+    gTraceCounters.clear();
+}
+
+int android_get_device_api_level() {
+    return gApiLevel;
+}
+
+int __system_property_get(const char *name, char *value) {
+    std::lock_guard<std::mutex> lock(gLock);
+    auto it = gProperties.find(name);
+    if (it == gProperties.end()) {
+        value[0] = '\0';
+        return 0;
+    }
+    size_t length = std::min(it->second.size(), static_cast<size_t>(PROP_VALUE_MAX - 1));
+    memcpy(value, it->second.data(), length);
+    value[length] = '\0';
+    return static_cast<int>(length);
+}
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    if (prio >= 0 && prio <= ANDROID_LOG_SILENT) {
+        gLogCounts[prio]++;
+    }
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag);
+    int result = vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return result;
+}
+
+bool ATrace_isEnabled() {
+    return gTraceEnabled;
+}
+
+void ATrace_beginSection(const char *) {}
+
+void ATrace_endSection() {}
+
+void ATrace_setCounter(const char *counterName, int64_t counterValue) {
+    if (gTraceEnabled) {
+        std::lock_guard<std::mutex> lock(gLock);
+        gTraceCounters[counterName] = counterValue;
+    }
+}
+
+/**
+ * Returns the number of bytes of a pixel, or 0 if the format cannot be mapped.
+ */
+static uint32_t bytesPerPixel(uint32_t format) {
+    switch (format) {
+        case AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM:
+        case AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM:
+        case AHARDWAREBUFFER_FORMAT_R10G10B10A2_UNORM:
+            return 4;
+        case AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM:
+            return 3;
+        case AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM:
+            return 2;
+        case AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT:
+            return 8;
+        case AHARDWAREBUFFER_FORMAT_BLOB:
+        case AHARDWAREBUFFER_FORMAT_R8_UNORM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int AHardwareBuffer_allocate(const AHardwareBuffer_Desc *desc, AHardwareBuffer **outBuffer) {
+    if (desc == nullptr || outBuffer == nullptr) {
+        return -EINVAL;
+    }
+    uint32_t pixelSize = bytesPerPixel(desc->format);
+    if (pixelSize == 0 || desc->width == 0 || desc->height == 0 || desc->layers == 0 ||
+        (desc->format == AHARDWAREBUFFER_FORMAT_BLOB && desc->height != 1)) {
+        return -EINVAL;
+    }
+    size_t size = static_cast<size_t>(desc->width) * desc->height * desc->layers * pixelSize;
+    auto data = static_cast<uint8_t *>(calloc(1, size));
+    if (data == nullptr) {
+        return -ENOMEM;
+    }
+    auto buffer = new AHardwareBuffer{*desc, gNextHardwareBufferId++, {}, data};
+    buffer->desc.stride = desc->width;
+    buffer->refCount = 1;
+    gHardwareBufferCount++;
+    *outBuffer = buffer;
+    return 0;
+}
+
+void AHardwareBuffer_acquire(AHardwareBuffer *buffer) {
+    buffer->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AHardwareBuffer_release(AHardwareBuffer *buffer) {
+    if (buffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        free(buffer->data);
+        delete buffer;
+        gHardwareBufferCount--;
+    }
+}
+
+void AHardwareBuffer_describe(const AHardwareBuffer *buffer, AHardwareBuffer_Desc *outDesc) {
+    *outDesc = buffer->desc;
+}
+
+int AHardwareBuffer_lock(AHardwareBuffer *buffer, uint64_t usage, int32_t fence,
+                         const ARect *rect, void **outVirtualAddress) {
+    if (fence >= 0) {
+        struct pollfd pollFd{fence, POLLIN, 0};
+        while (poll(&pollFd, 1, -1) < 0 && errno == EINTR) {}
+        close(fence);
+    }
+    if ((usage & (AHARDWAREBUFFER_USAGE_CPU_READ_MASK | AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK)) ==
+        0) {
+        return -EINVAL;
+    }
+    size_t offset = 0;
+    if (rect != nullptr) {
+        offset = (static_cast<size_t>(rect->top) * buffer->desc.stride + rect->left) *
+                 bytesPerPixel(buffer->desc.format);
+    }
+    *outVirtualAddress = buffer->data + offset;
+    return 0;
+}
+
+int AHardwareBuffer_unlock(AHardwareBuffer *, int32_t *fence) {
+    if (fence != nullptr) {
+        *fence = -1;
+    }
+    return 0;
+}
+
+int AHardwareBuffer_getId(const AHardwareBuffer *buffer, uint64_t *outId) {
+    *outId = buffer->id;
+    return 0;
+}
+
+AHardwareBuffer *AHardwareBuffer_fromHardwareBuffer(JNIEnv *, jobject hardwareBufferObj) {
+    return reinterpret_cast<AHardwareBuffer *>(hardwareBufferObj);
+}
+
+jobject AHardwareBuffer_toHardwareBuffer(JNIEnv *, AHardwareBuffer *hardwareBuffer) {
+    return reinterpret_cast<jobject>(hardwareBuffer);
+}
+
+void ANativeWindow_acquire(ANativeWindow *window) {
+    window->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ANativeWindow_release(ANativeWindow *window) {
+    if (window->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete window;
+    }
+}
+
+int32_t ANativeWindow_getWidth(ANativeWindow *window) {
+    return window->width;
+}
+
+int32_t ANativeWindow_getHeight(ANativeWindow *window) {
+    return window->height;
+}
+
+ANativeWindow *ANativeWindow_fromSurface(JNIEnv *, jobject surface) {
+    auto window = reinterpret_cast<ANativeWindow *>(surface);
+    if (window != nullptr) {
+        ANativeWindow_acquire(window);
+    }
+    return window;
+}
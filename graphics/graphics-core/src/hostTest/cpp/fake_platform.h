@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_FAKE_PLATFORM_H
+#define ANDROIDX_FAKE_PLATFORM_H
+
+#include <android/native_window.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Controls the host implementations of the platform APIs graphics-core uses besides
+ * ASurfaceControl and sync_file: the device API level, system properties, logging, tracing,
+ * AHardwareBuffer and ANativeWindow. AHardwareBuffers are allocated in host memory and
+ * ANativeWindows are only sized handles to create root ASurfaceControls from.
+ *
+ * All methods are thread safe.
+ */
+class FakePlatform {
+public:
+    /**
+     * Sets the level returned by android_get_device_api_level, 34 by default.
+     */
+    static void setApiLevel(int apiLevel);
+
+    static void setSystemProperty(const char *name, const char *value);
+
+    static void setTraceEnabled(bool enabled);
+
+    /**
+     * Returns the last value set for the trace counter, or -1 if it was never set.
+     */
+    static int64_t getTraceCounter(const char *name);
+
+    /**
+     * Returns the number of messages logged with the given priority.
+     */
+    static size_t getLogCount(int priority);
+
+    /**
+     * Returns the number of AHardwareBuffers that are still referenced, to detect leaks.
+     */
+    static size_t getHardwareBufferCount();
+
+    /**
+     * Returns a window with a single reference owned by the caller.
+     */
+    static ANativeWindow *createWindow(int32_t width, int32_t height);
+
+    /**
+     * Restores the defaults and forgets properties, trace counters and log counts.
+     */
+    static void reset();
+};
+
+#endif //ANDROIDX_FAKE_PLATFORM_H
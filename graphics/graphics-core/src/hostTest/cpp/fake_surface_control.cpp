@@ -0,0 +1,653 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_surface_control.h"
+#include "fake_sync.h"
+#include <algorithm>
+#include <android/log.h>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+#define LOG_TAG "FakeCompositor"
+#define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+enum LayerChangeFlags : uint32_t {
+    CHANGE_PARENT = 1 << 0,
+    CHANGE_BUFFER = 1 << 1,
+    CHANGE_VISIBILITY = 1 << 2,
+    CHANGE_Z_ORDER = 1 << 3,
+    CHANGE_DAMAGE = 1 << 4,
+    CHANGE_CROP = 1 << 5,
+    CHANGE_GEOMETRY = 1 << 6,
+    CHANGE_POSITION = 1 << 7,
+    CHANGE_SCALE = 1 << 8,
+    CHANGE_TRANSFORM = 1 << 9,
+    CHANGE_TRANSPARENCY = 1 << 10,
+    CHANGE_ALPHA = 1 << 11,
+    CHANGE_DATA_SPACE = 1 << 12,
+    CHANGE_FRAME_RATE = 1 << 13,
+};
+
+struct ASurfaceControl {
+    std::string name;
+    std::atomic<int32_t> refCount;
+    /** Guarded by the lock of the compositor */
+    FakeLayerState state;
+};
+
+struct LayerChange {
+    ASurfaceControl *surfaceControl;
+    uint32_t flags;
+    FakeLayerState values;
+    int acquireFenceFd;
+};
+
+struct TransactionCallback {
+    void *context;
+    ASurfaceTransaction_OnComplete func;
+    bool isCommit;
+};
+
+struct ASurfaceTransaction {
+    std::vector<LayerChange> changes;
+    std::vector<TransactionCallback> callbacks;
+    int64_t desiredPresentTime = 0;
+};
+
+struct SurfaceStats {
+    ASurfaceControl *surfaceControl;
+    int64_t acquireTime;
+    int previousReleaseFenceFd;
+};
+
+struct ASurfaceTransactionStats {
+    int64_t latchTime;
+    int presentFenceFd;
+    std::vector<SurfaceStats> surfaces;
+};
+
+struct FakeCompositor::AppliedTransaction {
+    uint64_t id;
+    ASurfaceTransaction transaction;
+    ASurfaceTransactionStats stats;
+};
+
+static int64_t now() {
+    struct timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+}
+
+static void closeFd(int fd) {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * Releases the references held by a change that is dropped instead of latched.
+ */
+static void discardChange(LayerChange &change) {
+    if (change.values.buffer != nullptr) {
+        AHardwareBuffer_release(change.values.buffer);
+    }
+    if (change.values.parent != nullptr) {
+        ASurfaceControl_release(change.values.parent);
+    }
+    closeFd(change.acquireFenceFd);
+    ASurfaceControl_release(change.surfaceControl);
+}
+
+static void clearTransaction(ASurfaceTransaction *transaction) {
+    for (auto &change : transaction->changes) {
+        discardChange(change);
+    }
+    transaction->changes.clear();
+    transaction->callbacks.clear();
+    transaction->desiredPresentTime = 0;
+}
+
+static bool isFenceSignaled(int fd) {
+    if (fd < 0) {
+        return true;
+    }
+    struct pollfd pollFd{fd, POLLIN, 0};
+    return poll(&pollFd, 1, 0) > 0;
+}
+
+FakeCompositor &FakeCompositor::getInstance() {
+    static FakeCompositor *compositor = new FakeCompositor();
+    return *compositor;
+}
+
+void FakeCompositor::setVsyncPeriod(int64_t vsyncPeriod) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mVsyncPeriod = vsyncPeriod;
+    mPresentLatency = vsyncPeriod;
+}
+
+void FakeCompositor::setPresentLatency(int64_t presentLatency) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mPresentLatency = presentLatency;
+}
+
+int64_t FakeCompositor::getVsyncPeriod() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mVsyncPeriod;
+}
+
+void FakeCompositor::enqueue(ASurfaceTransaction *transaction) {
+    auto applied = new AppliedTransaction{};
+    applied->transaction = std::move(*transaction);
+    *transaction = ASurfaceTransaction{};
+
+    FakeTransactionRecord record{};
+    record.applyTime = now();
+    record.desiredPresentTime = applied->transaction.desiredPresentTime;
+    record.latchTime = -1;
+    record.presentTime = -1;
+    record.surfaceControlCount = static_cast<uint32_t>(applied->transaction.changes.size());
+    for (const auto &change : applied->transaction.changes) {
+        if (change.flags & CHANGE_BUFFER) {
+            record.bufferCount++;
+        }
+        record.damageRectCount += static_cast<uint32_t>(change.values.damage.size());
+    }
+    record.callbackCount = static_cast<uint32_t>(applied->transaction.callbacks.size());
+
+    std::lock_guard<std::mutex> lock(mLock);
+    applied->id = mNextTransactionId++;
+    record.id = applied->id;
+    if (mRecords.size() == MAX_RECORDS) {
+        mRecords.pop_front();
+    }
+    mRecords.push_back(record);
+    mQueue.push_back(applied);
+}
+
+void FakeCompositor::signalFences(int64_t time) {
+    auto it = std::remove_if(mPendingFences.begin(), mPendingFences.end(),
+                             [time](const PendingFence &fence) {
+                                 if (fence.signalTime > time) {
+                                     return false;
+                                 }
+                                 FakeFence::signal(fence.fd, fence.signalTime);
+                                 close(fence.fd);
+                                 return true;
+                             });
+    mPendingFences.erase(it, mPendingFences.end());
+}
+
+size_t FakeCompositor::composite() {
+    std::vector<AppliedTransaction *> latched;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        int64_t latchTime = now();
+        signalFences(latchTime);
+        while (!mQueue.empty()) {
+            AppliedTransaction *applied = mQueue.front();
+            if (applied->transaction.desiredPresentTime > latchTime + mVsyncPeriod) {
+                break;
+            }
+            bool ready = true;
+            for (const auto &change : applied->transaction.changes) {
+                ready = ready && isFenceSignaled(change.acquireFenceFd);
+            }
+            if (!ready) {
+                break;
+            }
+            mQueue.pop_front();
+            latched.push_back(applied);
+        }
+        if (latched.empty()) {
+            return 0;
+        }
+
+        int64_t presentTime = latchTime + mPresentLatency;
+        int presentFence = FakeFence::create("present");
+        for (AppliedTransaction *applied : latched) {
+            ASurfaceTransactionStats &stats = applied->stats;
+            stats.latchTime = latchTime;
+            stats.presentFenceFd = dup(presentFence);
+            for (auto &change : applied->transaction.changes) {
+                FakeLayerState &state = change.surfaceControl->state;
+                SurfaceStats surfaceStats{change.surfaceControl, latchTime, -1};
+                if (change.flags & CHANGE_PARENT) {
+                    std::swap(state.parent, change.values.parent);
+                }
+                if (change.flags & CHANGE_BUFFER) {
+                    int64_t acquireTime = FakeFence::getSignalTime(change.acquireFenceFd);
+                    if (acquireTime >= 0 && acquireTime != INT64_MAX) {
+                        surfaceStats.acquireTime = acquireTime;
+                    }
+                    if (state.buffer != nullptr) {
+                        int releaseFence = FakeFence::create("release");
+                        surfaceStats.previousReleaseFenceFd = dup(releaseFence);
+                        mPendingFences.push_back(PendingFence{releaseFence, presentTime});
+                    }
+                    std::swap(state.buffer, change.values.buffer);
+                    state.frameNumber++;
+                }
+                if (change.flags & CHANGE_VISIBILITY) state.visible = change.values.visible;
+                if (change.flags & CHANGE_Z_ORDER) state.zOrder = change.values.zOrder;
+                if (change.flags & CHANGE_DAMAGE) state.damage.swap(change.values.damage);
+                if (change.flags & CHANGE_CROP) state.crop = change.values.crop;
+                if (change.flags & CHANGE_GEOMETRY) {
+                    state.source = change.values.source;
+                    state.destination = change.values.destination;
+                    state.transform = change.values.transform;
+                }
+                if (change.flags & CHANGE_POSITION) {
+                    state.x = change.values.x;
+                    state.y = change.values.y;
+                }
+                if (change.flags & CHANGE_SCALE) {
+                    state.xScale = change.values.xScale;
+                    state.yScale = change.values.yScale;
+                }
+                if (change.flags & CHANGE_TRANSFORM) state.transform = change.values.transform;
+                if (change.flags & CHANGE_TRANSPARENCY) {
+                    state.transparency = change.values.transparency;
+                }
+                if (change.flags & CHANGE_ALPHA) state.alpha = change.values.alpha;
+                if (change.flags & CHANGE_DATA_SPACE) state.dataSpace = change.values.dataSpace;
+                if (change.flags & CHANGE_FRAME_RATE) {
+                    state.frameRate = change.values.frameRate;
+                    state.frameRateCompatibility = change.values.frameRateCompatibility;
+                    state.changeFrameRateStrategy = change.values.changeFrameRateStrategy;
+                }
+                stats.surfaces.push_back(surfaceStats);
+            }
+
+            // Transactions are only recorded while they are among the last MAX_RECORDS
+            if (!mRecords.empty() && applied->id >= mRecords.front().id) {
+                FakeTransactionRecord &record = mRecords[applied->id - mRecords.front().id];
+                record.latchTime = latchTime;
+                record.presentTime = presentTime;
+            }
+        }
+        mPendingFences.push_back(PendingFence{presentFence, presentTime});
+        signalFences(latchTime);
+        mCondition.notify_all();
+    }
+
+    // Callbacks may apply new transactions, so they are invoked without holding the lock
+    for (bool commit : {true, false}) {
+        for (AppliedTransaction *applied : latched) {
+            for (const auto &callback : applied->transaction.callbacks) {
+                if (callback.isCommit == commit) {
+                    callback.func(callback.context, &applied->stats);
+                }
+            }
+        }
+    }
+
+    for (AppliedTransaction *applied : latched) {
+        // The changes now hold what the latched values replaced
+        clearTransaction(&applied->transaction);
+        closeFd(applied->stats.presentFenceFd);
+        for (const auto &surfaceStats : applied->stats.surfaces) {
+            closeFd(surfaceStats.previousReleaseFenceFd);
+        }
+        delete applied;
+    }
+    return latched.size();
+}
+
+void FakeCompositor::start() {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mRunning) {
+        return;
+    }
+    mRunning = true;
+    mThread = std::thread([this]() { run(); });
+}
+
+void FakeCompositor::stop() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mRunning) {
+            return;
+        }
+        mRunning = false;
+        mCondition.notify_all();
+        thread = std::move(mThread);
+    }
+    thread.join();
+}
+
+void FakeCompositor::run() {
+    int64_t nextVsync = now();
+    std::unique_lock<std::mutex> lock(mLock);
+    while (mRunning) {
+        int64_t wakeTime = nextVsync;
+        for (const auto &fence : mPendingFences) {
+            wakeTime = std::min(wakeTime, fence.signalTime);
+        }
+        int64_t time = now();
+        if (time < wakeTime) {
+            mCondition.wait_for(lock, std::chrono::nanoseconds(wakeTime - time));
+            continue;
+        }
+        signalFences(time);
+        if (time >= nextVsync) {
+            nextVsync += mVsyncPeriod * ((time - nextVsync) / mVsyncPeriod + 1);
+            lock.unlock();
+            composite();
+            lock.lock();
+        }
+    }
+}
+
+std::vector<FakeTransactionRecord> FakeCompositor::getTransactions() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return std::vector<FakeTransactionRecord>(mRecords.begin(), mRecords.end());
+}
+
+bool FakeCompositor::getLayerState(const ASurfaceControl *surfaceControl,
+                                   FakeLayerState *outState) const {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (std::find(mSurfaceControls.begin(), mSurfaceControls.end(), surfaceControl) ==
+        mSurfaceControls.end()) {
+        return false;
+    }
+    *outState = surfaceControl->state;
+    return true;
+}
+
+size_t FakeCompositor::getPendingTransactionCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mQueue.size();
+}
+
+size_t FakeCompositor::getSurfaceControlCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mSurfaceControls.size();
+}
+
+void FakeCompositor::reset() {
+    stop();
+    std::lock_guard<std::mutex> lock(mLock);
+    mVsyncPeriod = DEFAULT_VSYNC_PERIOD;
+    mPresentLatency = DEFAULT_VSYNC_PERIOD;
+    mRecords.clear();
+}
+
+void FakeCompositor::onSurfaceControlCreated(ASurfaceControl *surfaceControl) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mSurfaceControls.push_back(surfaceControl);
+}
+
+void FakeCompositor::onSurfaceControlDestroyed(ASurfaceControl *surfaceControl) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mSurfaceControls.erase(
+            std::find(mSurfaceControls.begin(), mSurfaceControls.end(), surfaceControl));
+}
+
+static ASurfaceControl *createSurfaceControl(ASurfaceControl *parent, const char *debugName) {
+    auto surfaceControl = new ASurfaceControl{debugName != nullptr ? debugName : "", {}, {}};
+    surfaceControl->refCount = 1;
+    if (parent != nullptr) {
+        ASurfaceControl_acquire(parent);
+        surfaceControl->state.parent = parent;
+    }
+    FakeCompositor::getInstance().onSurfaceControlCreated(surfaceControl);
+    return surfaceControl;
+}
+
+ASurfaceControl *ASurfaceControl_createFromWindow(ANativeWindow *parent, const char *debug_name) {
+    return parent != nullptr ? createSurfaceControl(nullptr, debug_name) : nullptr;
+}
+
+ASurfaceControl *ASurfaceControl_create(ASurfaceControl *parent, const char *debug_name) {
+    return parent != nullptr ? createSurfaceControl(parent, debug_name) : nullptr;
+}
+
+void ASurfaceControl_acquire(ASurfaceControl *surface_control) {
+    surface_control->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ASurfaceControl_release(ASurfaceControl *surface_control) {
+    if (surface_control->refCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    FakeCompositor::getInstance().onSurfaceControlDestroyed(surface_control);
+    if (surface_control->state.buffer != nullptr) {
+        AHardwareBuffer_release(surface_control->state.buffer);
+    }
+    if (surface_control->state.parent != nullptr) {
+        ASurfaceControl_release(surface_control->state.parent);
+    }
+    delete surface_control;
+}
+
+ASurfaceTransaction *ASurfaceTransaction_create() {
+    return new ASurfaceTransaction();
+}
+
+void ASurfaceTransaction_delete(ASurfaceTransaction *transaction) {
+    if (transaction != nullptr) {
+        clearTransaction(transaction);
+        delete transaction;
+    }
+}
+
+void ASurfaceTransaction_apply(ASurfaceTransaction *transaction) {
+    FakeCompositor::getInstance().enqueue(transaction);
+}
+
+int64_t ASurfaceTransactionStats_getLatchTime(ASurfaceTransactionStats *surface_transaction_stats) {
+    return surface_transaction_stats->latchTime;
+}
+
+int ASurfaceTransactionStats_getPresentFenceFd(
+        ASurfaceTransactionStats *surface_transaction_stats) {
+    int fd = surface_transaction_stats->presentFenceFd;
+    return fd >= 0 ? dup(fd) : -1;
+}
+
+void ASurfaceTransactionStats_getASurfaceControls(
+        ASurfaceTransactionStats *surface_transaction_stats,
+        ASurfaceControl ***outASurfaceControls, size_t *outASurfaceControlsSize) {
+    const auto &surfaces = surface_transaction_stats->surfaces;
+    auto surfaceControls = new ASurfaceControl *[surfaces.size()];
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        surfaceControls[i] = surfaces[i].surfaceControl;
+    }
+    *outASurfaceControls = surfaceControls;
+    *outASurfaceControlsSize = surfaces.size();
+}
+
+void ASurfaceTransactionStats_releaseASurfaceControls(ASurfaceControl **surface_controls) {
+    delete[] surface_controls;
+}
+
+/**
+ * Like the platform, aborts if the SurfaceControl is not part of the transaction.
+ */
+static const SurfaceStats &getSurfaceStats(ASurfaceTransactionStats *stats,
+                                           ASurfaceControl *surfaceControl) {
+    for (const auto &surfaceStats : stats->surfaces) {
+        if (surfaceStats.surfaceControl == surfaceControl) {
+            return surfaceStats;
+        }
+    }
+    ALOGE("ASurfaceControl not found in the transaction stats");
+    abort();
+}
+
+int64_t ASurfaceTransactionStats_getAcquireTime(
+        ASurfaceTransactionStats *surface_transaction_stats, ASurfaceControl *surface_control) {
+    return getSurfaceStats(surface_transaction_stats, surface_control).acquireTime;
+}
+
+int ASurfaceTransactionStats_getPreviousReleaseFenceFd(
+        ASurfaceTransactionStats *surface_transaction_stats, ASurfaceControl *surface_control) {
+    int fd = getSurfaceStats(surface_transaction_stats, surface_control).previousReleaseFenceFd;
+    return fd >= 0 ? dup(fd) : -1;
+}
+
+void ASurfaceTransaction_setOnComplete(ASurfaceTransaction *transaction, void *context,
+                                       ASurfaceTransaction_OnComplete func) {
+    transaction->callbacks.push_back(TransactionCallback{context, func, false});
+}
+
+void ASurfaceTransaction_setOnCommit(ASurfaceTransaction *transaction, void *context,
+                                     ASurfaceTransaction_OnCommit func) {
+    transaction->callbacks.push_back(TransactionCallback{context, func, true});
+}
+
+/**
+ * Returns the pending changes of the SurfaceControl in the transaction, marked with the flag.
+ */
+static LayerChange &getChange(ASurfaceTransaction *transaction, ASurfaceControl *surfaceControl,
+                              uint32_t flag) {
+    for (auto &change : transaction->changes) {
+        if (change.surfaceControl == surfaceControl) {
+            change.flags |= flag;
+            return change;
+        }
+    }
+    ASurfaceControl_acquire(surfaceControl);
+    transaction->changes.push_back(LayerChange{surfaceControl, flag, {}, -1});
+    return transaction->changes.back();
+}
+
+void ASurfaceTransaction_reparent(ASurfaceTransaction *transaction,
+                                  ASurfaceControl *surface_control,
+                                  ASurfaceControl *new_parent) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_PARENT);
+    if (new_parent != nullptr) {
+        ASurfaceControl_acquire(new_parent);
+    }
+    if (change.values.parent != nullptr) {
+        ASurfaceControl_release(change.values.parent);
+    }
+    change.values.parent = new_parent;
+}
+
+void ASurfaceTransaction_setVisibility(ASurfaceTransaction *transaction,
+                                       ASurfaceControl *surface_control,
+                                       enum ASurfaceTransactionVisibility visibility) {
+    getChange(transaction, surface_control, CHANGE_VISIBILITY).values.visible =
+            visibility == ASURFACE_TRANSACTION_VISIBILITY_SHOW;
+}
+
+void ASurfaceTransaction_setZOrder(ASurfaceTransaction *transaction,
+                                   ASurfaceControl *surface_control, int32_t z_order) {
+    getChange(transaction, surface_control, CHANGE_Z_ORDER).values.zOrder = z_order;
+}
+
+void ASurfaceTransaction_setBuffer(ASurfaceTransaction *transaction,
+                                   ASurfaceControl *surface_control, AHardwareBuffer *buffer,
+                                   int acquire_fence_fd) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_BUFFER);
+    if (buffer != nullptr) {
+        AHardwareBuffer_acquire(buffer);
+    }
+    if (change.values.buffer != nullptr) {
+        AHardwareBuffer_release(change.values.buffer);
+    }
+    closeFd(change.acquireFenceFd);
+    change.values.buffer = buffer;
+    change.acquireFenceFd = acquire_fence_fd;
+}
+
+void ASurfaceTransaction_setGeometry(ASurfaceTransaction *transaction,
+                                     ASurfaceControl *surface_control, const ARect &source,
+                                     const ARect &destination, int32_t transform) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_GEOMETRY);
+    change.values.source = source;
+    change.values.destination = destination;
+    change.values.transform = transform;
+}
+
+void ASurfaceTransaction_setCrop(ASurfaceTransaction *transaction,
+                                 ASurfaceControl *surface_control, const ARect &crop) {
+    getChange(transaction, surface_control, CHANGE_CROP).values.crop = crop;
+}
+
+void ASurfaceTransaction_setPosition(ASurfaceTransaction *transaction,
+                                     ASurfaceControl *surface_control, int32_t x, int32_t y) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_POSITION);
+    change.values.x = x;
+    change.values.y = y;
+}
+
+void ASurfaceTransaction_setBufferTransform(ASurfaceTransaction *transaction,
+                                            ASurfaceControl *surface_control, int32_t transform) {
+    getChange(transaction, surface_control, CHANGE_TRANSFORM).values.transform = transform;
+}
+
+void ASurfaceTransaction_setScale(ASurfaceTransaction *transaction,
+                                  ASurfaceControl *surface_control, float xScale, float yScale) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_SCALE);
+    change.values.xScale = xScale;
+    change.values.yScale = yScale;
+}
+
+void ASurfaceTransaction_setBufferTransparency(ASurfaceTransaction *transaction,
+                                               ASurfaceControl *surface_control,
+                                               enum ASurfaceTransactionTransparency transparency) {
+    getChange(transaction, surface_control, CHANGE_TRANSPARENCY).values.transparency =
+            transparency;
+}
+
+void ASurfaceTransaction_setDamageRegion(ASurfaceTransaction *transaction,
+                                         ASurfaceControl *surface_control, const ARect *rects,
+                                         uint32_t count) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_DAMAGE);
+    change.values.damage.assign(rects, rects + (rects != nullptr ? count : 0));
+}
+
+void ASurfaceTransaction_setDesiredPresentTime(ASurfaceTransaction *transaction,
+                                               int64_t desiredPresentTime) {
+    transaction->desiredPresentTime = desiredPresentTime;
+}
+
+void ASurfaceTransaction_setBufferAlpha(ASurfaceTransaction *transaction,
+                                        ASurfaceControl *surface_control, float alpha) {
+    getChange(transaction, surface_control, CHANGE_ALPHA).values.alpha = alpha;
+}
+
+void ASurfaceTransaction_setBufferDataSpace(ASurfaceTransaction *transaction,
+                                            ASurfaceControl *surface_control,
+                                            enum ADataSpace data_space) {
+    getChange(transaction, surface_control, CHANGE_DATA_SPACE).values.dataSpace = data_space;
+}
+
+void ASurfaceTransaction_setFrameRate(ASurfaceTransaction *transaction,
+                                      ASurfaceControl *surface_control, float frameRate,
+                                      int8_t compatibility) {
+    ASurfaceTransaction_setFrameRateWithChangeStrategy(transaction, surface_control, frameRate,
+                                                       compatibility, 0);
+}
+
+void ASurfaceTransaction_setFrameRateWithChangeStrategy(ASurfaceTransaction *transaction,
+                                                        ASurfaceControl *surface_control,
+                                                        float frameRate, int8_t compatibility,
+                                                        int8_t changeFrameRateStrategy) {
+    LayerChange &change = getChange(transaction, surface_control, CHANGE_FRAME_RATE);
+    change.values.frameRate = frameRate;
+    change.values.frameRateCompatibility = compatibility;
+    change.values.changeFrameRateStrategy = changeFrameRateStrategy;
+}
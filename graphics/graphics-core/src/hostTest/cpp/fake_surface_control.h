@@ -0,0 +1,178 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_FAKE_SURFACE_CONTROL_H
+#define ANDROIDX_FAKE_SURFACE_CONTROL_H
+
+#include <android/surface_control.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * State of a layer as of the last transaction the compositor latched.
+ */
+struct FakeLayerState {
+    ASurfaceControl *parent = nullptr;
+    /** Not referenced by copies returned from FakeCompositor::getLayerState */
+    AHardwareBuffer *buffer = nullptr;
+    /** Number of buffers latched on the layer */
+    uint64_t frameNumber = 0;
+    bool visible = true;
+    int32_t zOrder = 0;
+    /** Empty if the whole buffer is damaged */
+    std::vector<ARect> damage;
+    ARect crop{};
+    ARect source{};
+    ARect destination{};
+    int32_t x = 0;
+    int32_t y = 0;
+    float xScale = 1.0f;
+    float yScale = 1.0f;
+    int32_t transform = 0;
+    int8_t transparency = ASURFACE_TRANSACTION_TRANSPARENCY_TRANSLUCENT;
+    float alpha = 1.0f;
+    int32_t dataSpace = ADATASPACE_UNKNOWN;
+    float frameRate = 0.0f;
+    int8_t frameRateCompatibility = 0;
+    int8_t changeFrameRateStrategy = 0;
+};
+
+/**
+ * An applied transaction. Times are in the CLOCK_MONOTONIC time domain and are -1 until known.
+ */
+struct FakeTransactionRecord {
+    uint64_t id;
+    int64_t applyTime;
+    /** 0 if the transaction did not set a desired present time */
+    int64_t desiredPresentTime;
+    int64_t latchTime;
+    int64_t presentTime;
+    uint32_t surfaceControlCount;
+    uint32_t bufferCount;
+    uint32_t damageRectCount;
+    uint32_t callbackCount;
+};
+
+/**
+ * Stands in for SurfaceFlinger on the host. ASurfaceTransaction_apply queues the transaction and
+ * composite latches queued transactions in the order they were applied, like a composition cycle
+ * would:
+ *
+ *  - A transaction is latched once the acquire fences of its buffers have signaled and its desired
+ *    present time is at most one vsync period away. Transactions applied after it wait for it.
+ *  - Latched transactions share a present fence that signals once the present latency has elapsed,
+ *    as do the release fences of the buffers they replaced. Fences are FakeFences.
+ *  - Commit callbacks, then complete callbacks, are invoked on the compositing thread once the
+ *    transactions are latched, so the present fence may still be pending when they run.
+ *
+ * composite can be driven by the test for deterministic results, or on every vsync by a
+ * background thread between start and stop. Every transaction is recorded, see getTransactions.
+ */
+class FakeCompositor {
+public:
+    static constexpr int64_t DEFAULT_VSYNC_PERIOD = 16'666'667;
+
+    static FakeCompositor &getInstance();
+
+    /**
+     * Sets the vsync period, and the present latency to the same value.
+     */
+    void setVsyncPeriod(int64_t vsyncPeriod);
+
+    /**
+     * Sets the time from latching transactions until their present fence signals. With 0 the
+     * present fence is signaled before the callbacks are invoked.
+     */
+    void setPresentLatency(int64_t presentLatency);
+
+    int64_t getVsyncPeriod() const;
+
+    /**
+     * Runs a composition cycle now and returns the number of transactions latched.
+     */
+    size_t composite();
+
+    /**
+     * Runs a composition cycle every vsync period on a background thread until stop is called.
+     */
+    void start();
+
+    void stop();
+
+    /**
+     * Returns the last applied transactions, oldest first.
+     */
+    std::vector<FakeTransactionRecord> getTransactions() const;
+
+    /**
+     * Copies the latched state of the layer. Returns false if it has been released.
+     */
+    bool getLayerState(const ASurfaceControl *surfaceControl, FakeLayerState *outState) const;
+
+    size_t getPendingTransactionCount() const;
+
+    /**
+     * Returns the number of ASurfaceControls that are still referenced, to detect leaks.
+     */
+    size_t getSurfaceControlCount() const;
+
+    /**
+     * Stops the background thread, forgets the recorded transactions and restores the default
+     * timing. Queued transactions are kept.
+     */
+    void reset();
+
+    // Called by the ASurfaceControl and ASurfaceTransaction implementations
+    void enqueue(ASurfaceTransaction *transaction);
+    void onSurfaceControlCreated(ASurfaceControl *surfaceControl);
+    void onSurfaceControlDestroyed(ASurfaceControl *surfaceControl);
+
+private:
+    struct AppliedTransaction;
+
+    struct PendingFence {
+        int fd;
+        int64_t signalTime;
+    };
+
+    FakeCompositor() = default;
+
+    /** Called with mLock held */
+    void signalFences(int64_t now);
+
+    void run();
+
+    static constexpr size_t MAX_RECORDS = 4096;
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+    std::thread mThread;
+    bool mRunning = false;
+    int64_t mVsyncPeriod = DEFAULT_VSYNC_PERIOD;
+    int64_t mPresentLatency = DEFAULT_VSYNC_PERIOD;
+    std::deque<AppliedTransaction *> mQueue;
+    std::vector<PendingFence> mPendingFences;
+    std::deque<FakeTransactionRecord> mRecords;
+    std::vector<ASurfaceControl *> mSurfaceControls;
+    uint64_t mNextTransactionId = 1;
+};
+
+#endif //ANDROIDX_FAKE_SURFACE_CONTROL_H
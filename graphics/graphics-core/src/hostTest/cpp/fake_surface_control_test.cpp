@@ -0,0 +1,755 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Regression tests of the graphics-core native code against the host fakes, and with
+// --benchmark, measurements of the per call overhead of the JNI bindings. See README.md.
+
+#include <algorithm>
+#include <android/sync.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <jni.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include "damage_accumulator.h"
+#include "fake_platform.h"
+#include "fake_surface_control.h"
+#include "fake_sync.h"
+#include "frame_scheduler.h"
+#include "frame_timeline.h"
+#include "hardware_buffer_pool.h"
+#include "present_fence_watcher.h"
+#include "sync_fence.h"
+
+// Bindings of graphics-core.cpp that do not call into the JNIEnv, so they can be called without a
+// JVM. They are not declared in a header as they are only registered through JNI_OnLoad.
+jlong JniBindings_nTransactionCreate(JNIEnv *env, jclass);
+void JniBindings_nTransactionDelete(JNIEnv *env, jclass, jlong surfaceTransaction);
+void JniBindings_nTransactionApply(JNIEnv *env, jclass, jlong surfaceTransaction);
+void JniBindings_nSetVisibility(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                jlong surfaceControl, jbyte visibility);
+void JniBindings_nSetZOrder(JNIEnv *env, jclass, jlong surfaceTransaction, jlong surfaceControl,
+                            jint zOrder);
+void JniBindings_nSetBufferAlpha(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                 jlong surfaceControl, jfloat alpha);
+void JniBindings_nSetPosition(JNIEnv *env, jclass, jlong surfaceTransaction,
+                              jlong surfaceControl, jfloat x, jfloat y);
+void JniBindings_nSetDamageRegion(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                  jlong surfaceControl, jobject rect);
+void JniBindings_nSetDesiredPresentTime(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                        int64_t desiredPresentTime);
+void JniBindings_nSetFrameRate(JNIEnv *env, jclass, jlong surfaceTransaction,
+                               jlong surfaceControl, jfloat frameRate, jint compatibility,
+                               jint changeFrameRateStrategy);
+void JniBindings_nTransactionSetFrameTimelineRecorder(JNIEnv *env, jclass,
+                                                      jlong surfaceTransaction, jlong recorder,
+                                                      jlong surfaceControl, jlong frameId,
+                                                      jlong desiredPresentTime);
+void JniBindings_nTransactionSetFrameScheduler(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                               jlong scheduler);
+void setCoalescedDamageRegion(ASurfaceTransaction *st, ASurfaceControl *sc, const jint *rects,
+                              jint count, jint maxRects, jlong perRectCost);
+jint JniBindings_nGetPreviousReleaseFenceFd(JNIEnv *env, jclass, jlong surfaceControl,
+                                            jlong transactionStats);
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+            abort();                                                                           \
+        }                                                                                      \
+    } while (0)
+
+static int64_t now() {
+    struct timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+}
+
+static bool isSignaled(int fd) {
+    struct pollfd pollFd{fd, POLLIN, 0};
+    return poll(&pollFd, 1, 0) == 1;
+}
+
+static AHardwareBuffer *allocateBuffer() {
+    AHardwareBuffer_Desc desc{};
+    desc.width = 64;
+    desc.height = 64;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+    AHardwareBuffer *buffer = nullptr;
+    CHECK(AHardwareBuffer_allocate(&desc, &buffer) == 0);
+    return buffer;
+}
+
+struct Layers {
+    ANativeWindow *window;
+    ASurfaceControl *root;
+    ASurfaceControl *child;
+
+    Layers() {
+        window = FakePlatform::createWindow(64, 64);
+        root = ASurfaceControl_createFromWindow(window, "root");
+        child = ASurfaceControl_create(root, "child");
+    }
+
+    ~Layers() {
+        ASurfaceControl_release(child);
+        ASurfaceControl_release(root);
+        ANativeWindow_release(window);
+    }
+};
+
+static void testFence() {
+    int fd = FakeFence::create("test");
+    CHECK(fd >= 0);
+    int duplicate = dup(fd);
+    CHECK(!isSignaled(duplicate));
+    CHECK(get_signal_time(duplicate) == INT64_MAX);
+
+    CHECK(FakeFence::signal(fd, 1234));
+    CHECK(!FakeFence::signal(fd, 5678));
+    CHECK(isSignaled(duplicate));
+    // Resolved through the sync_file_info of libsync.so, like on a device
+    CHECK(get_signal_time(duplicate) == 1234);
+    struct sync_file_info *info = sync_file_info(duplicate);
+    CHECK(info != nullptr && info->status == 1 && info->num_fences == 1);
+    CHECK(sync_get_fence_info(info)->timestamp_ns == 1234);
+    sync_file_info_free(info);
+
+    int failed = FakeFence::create("failed");
+    CHECK(FakeFence::signalError(failed, -5));
+    CHECK(get_signal_time(failed) == -1);
+
+    int pipeFds[2];
+    CHECK(pipe(pipeFds) == 0);
+    CHECK(sync_file_info(pipeFds[0]) == nullptr);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    close(fd);
+    CHECK(FakeFence::openCount() == 2);
+    close(duplicate);
+    close(failed);
+    CHECK(FakeFence::openCount() == 0);
+}
+
+static void testSignalTimes() {
+    int signaled = FakeFence::create("signaled");
+    int pending = FakeFence::create("pending");
+    int failed = FakeFence::create("failed");
+    CHECK(FakeFence::signal(signaled, 1234));
+    CHECK(FakeFence::signalError(failed, -5));
+    int pipeFds[2];
+    CHECK(pipe(pipeFds) == 0);
+
+    const int fds[] = {signaled, -1, pending, failed, pipeFds[0]};
+    int64_t signalTimes[5];
+    int32_t statuses[5];
+    get_signal_times(fds, 5, signalTimes, statuses);
+    CHECK(signalTimes[0] == 1234 && statuses[0] == 1);
+    CHECK(signalTimes[1] == -1 && statuses[1] < 0);
+    CHECK(signalTimes[2] == INT64_MAX && statuses[2] == 0);
+    CHECK(signalTimes[3] == -1 && statuses[3] == -5);
+    CHECK(signalTimes[4] == -1 && statuses[4] < 0);
+    get_signal_times(fds, 1, signalTimes, nullptr);
+    CHECK(signalTimes[0] == 1234);
+
+    for (int fd : {signaled, pending, failed, pipeFds[0], pipeFds[1]}) {
+        close(fd);
+    }
+}
+
+static void testBindingsApplyLayerState() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    Layers layers;
+    auto sc = reinterpret_cast<jlong>(layers.child);
+
+    jlong transaction = JniBindings_nTransactionCreate(nullptr, nullptr);
+    JniBindings_nSetVisibility(nullptr, nullptr, transaction, sc, 0);
+    JniBindings_nSetZOrder(nullptr, nullptr, transaction, sc, 7);
+    JniBindings_nSetBufferAlpha(nullptr, nullptr, transaction, sc, 0.5f);
+    JniBindings_nSetPosition(nullptr, nullptr, transaction, sc, 10.0f, 20.0f);
+    JniBindings_nSetFrameRate(nullptr, nullptr, transaction, sc, 120.0f, 1, 1);
+    JniBindings_nSetDamageRegion(nullptr, nullptr, transaction, sc, nullptr);
+    JniBindings_nTransactionApply(nullptr, nullptr, transaction);
+    // Applying resets the transaction, so it can be reused
+    JniBindings_nSetZOrder(nullptr, nullptr, transaction, sc, 8);
+    JniBindings_nTransactionApply(nullptr, nullptr, transaction);
+    JniBindings_nTransactionDelete(nullptr, nullptr, transaction);
+
+    FakeLayerState state;
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.visible && state.zOrder == 0);
+    CHECK(compositor.getPendingTransactionCount() == 2);
+    CHECK(compositor.composite() == 2);
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.parent == layers.root);
+    CHECK(!state.visible && state.zOrder == 8 && state.alpha == 0.5f);
+    CHECK(state.x == 10 && state.y == 20);
+    CHECK(state.frameRate == 120.0f && state.changeFrameRateStrategy == 1);
+    CHECK(state.damage.empty());
+
+    auto records = compositor.getTransactions();
+    CHECK(records.size() == 2);
+    CHECK(records[0].surfaceControlCount == 1 && records[0].latchTime >= records[0].applyTime);
+
+    // Without ASurfaceTransaction_setFrameRateWithChangeStrategy the strategy is dropped
+    FakePlatform::setApiLevel(30);
+    transaction = JniBindings_nTransactionCreate(nullptr, nullptr);
+    JniBindings_nSetFrameRate(nullptr, nullptr, transaction, sc, 60.0f, 0, 1);
+    JniBindings_nTransactionApply(nullptr, nullptr, transaction);
+    JniBindings_nTransactionDelete(nullptr, nullptr, transaction);
+    CHECK(compositor.composite() == 1);
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.frameRate == 60.0f && state.changeFrameRateStrategy == 0);
+}
+
+static void onReleaseFenceComplete(void *context, ASurfaceTransactionStats *stats) {
+    auto [surfaceControl, outFd] =
+            *reinterpret_cast<std::pair<ASurfaceControl *, int *> *>(context);
+    *outFd = JniBindings_nGetPreviousReleaseFenceFd(
+            nullptr, nullptr, reinterpret_cast<jlong>(surfaceControl),
+            reinterpret_cast<jlong>(stats));
+}
+
+static void testBuffersAndFences() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    compositor.setPresentLatency(0);
+    Layers layers;
+    AHardwareBuffer *first = allocateBuffer();
+    AHardwareBuffer *second = allocateBuffer();
+
+    // Not latched until the acquire fence signals
+    int acquireFence = FakeFence::create("acquire");
+    ASurfaceTransaction *transaction = ASurfaceTransaction_create();
+    ASurfaceTransaction_setBuffer(transaction, layers.child, first, dup(acquireFence));
+    ASurfaceTransaction_apply(transaction);
+    CHECK(compositor.composite() == 0);
+    CHECK(FakeFence::signal(acquireFence, now()));
+    close(acquireFence);
+    CHECK(compositor.composite() == 1);
+
+    int releaseFence = -2;
+    std::pair<ASurfaceControl *, int *> context(layers.child, &releaseFence);
+    ASurfaceTransaction_setBuffer(transaction, layers.child, second, -1);
+    ASurfaceTransaction_setOnComplete(transaction, &context, onReleaseFenceComplete);
+    ASurfaceTransaction_apply(transaction);
+    CHECK(compositor.composite() == 1);
+    CHECK(releaseFence >= 0 && isSignaled(releaseFence));
+    close(releaseFence);
+
+    FakeLayerState state;
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.buffer == second && state.frameNumber == 2);
+
+    // The layer holds a reference to its buffer until it is released
+    AHardwareBuffer_release(first);
+    AHardwareBuffer_release(second);
+    CHECK(FakePlatform::getHardwareBufferCount() == 1);
+    ASurfaceTransaction_delete(transaction);
+}
+
+static void testFrameTimelineRecorder() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    const int64_t presentLatency = 2'000'000;
+    compositor.setPresentLatency(presentLatency);
+    FakePlatform::setTraceEnabled(true);
+    Layers layers;
+    FrameTimelineRecorder *recorder = FrameTimelineRecorder::create(8, "host", get_signal_time);
+
+    jlong transaction = JniBindings_nTransactionCreate(nullptr, nullptr);
+    JniBindings_nSetZOrder(nullptr, nullptr, transaction, reinterpret_cast<jlong>(layers.child), 1);
+    JniBindings_nTransactionSetFrameTimelineRecorder(
+            nullptr, nullptr, transaction, reinterpret_cast<jlong>(recorder),
+            reinterpret_cast<jlong>(layers.child), 42, -1);
+    JniBindings_nTransactionApply(nullptr, nullptr, transaction);
+    JniBindings_nTransactionDelete(nullptr, nullptr, transaction);
+    CHECK(compositor.composite() == 1);
+
+    // The present fence was pending when the transaction completed
+    FrameTimelineRecord record{};
+    for (int i = 0; i < 100 && recorder->copyRecords(&record, 1) == 0; i++) {
+        compositor.composite();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(recorder->copyRecords(&record, 1) == 1);
+    CHECK(record.frameId == 42);
+    CHECK(record.presentTime == record.latchTime + presentLatency);
+    CHECK(record.completeTime >= record.latchTime);
+    CHECK(FakePlatform::getTraceCounter("host latency") == record.presentTime - record.commitTime);
+    recorder->release();
+}
+
+static void testHardwareBufferPool() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    compositor.setPresentLatency(0);
+    Layers layers;
+    auto pool = new HardwareBufferPool(2, get_signal_time);
+    AHardwareBuffer_Desc desc{};
+    desc.width = 32;
+    desc.height = 32;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE;
+
+    // Swap two buffers through the layer, returning each one with its release fence
+    AHardwareBuffer *front = nullptr;
+    ASurfaceTransaction *transaction = ASurfaceTransaction_create();
+    for (int frame = 0; frame < 6; frame++) {
+        AHardwareBuffer *buffer = pool->obtain(desc);
+        CHECK(buffer != nullptr);
+        int releaseFence = -1;
+        std::pair<ASurfaceControl *, int *> context(layers.child, &releaseFence);
+        ASurfaceTransaction_setBuffer(transaction, layers.child, buffer, -1);
+        ASurfaceTransaction_setOnComplete(transaction, &context, onReleaseFenceComplete);
+        ASurfaceTransaction_apply(transaction);
+        CHECK(compositor.composite() == 1);
+        if (front != nullptr) {
+            CHECK(pool->release(front, releaseFence) == BUFFER_RELEASED);
+        }
+        front = buffer;
+    }
+    HardwareBufferPoolStats stats = pool->getStats();
+    CHECK(stats.allocatedCount == 2 && stats.hits == 4 && stats.exhausted == 0);
+    CHECK(pool->contains(front));
+
+    ASurfaceTransaction_delete(transaction);
+    CHECK(pool->release(front, -1) == BUFFER_RELEASED);
+    CHECK(HardwareBufferPool::destroy(pool));
+}
+
+static void testHardwareBufferPoolErrorFences() {
+    size_t openFences = FakeFence::openCount();
+    auto pool = new HardwareBufferPool(1, get_signal_time);
+    AHardwareBuffer_Desc desc{};
+    desc.width = 32;
+    desc.height = 32;
+    desc.layers = 1;
+    desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+    desc.usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE;
+
+    // A fence that signaled with an error polls as signaled, so the buffer is reused
+    AHardwareBuffer *buffer = pool->obtain(desc);
+    CHECK(buffer != nullptr);
+    int failed = FakeFence::create("failed");
+    CHECK(FakeFence::signalError(failed, -5));
+    CHECK(pool->release(buffer, failed) == BUFFER_RELEASED);
+    CHECK(pool->obtain(desc) == buffer);
+    CHECK(pool->getStats().hits == 1);
+
+    // A fence that cannot be queried and does not poll as signaled is treated as pending, so the
+    // buffer is evicted to make room for a new one
+    int pipeFds[2];
+    CHECK(pipe(pipeFds) == 0);
+    CHECK(pool->release(buffer, pipeFds[0]) == BUFFER_RELEASED);
+    buffer = pool->obtain(desc);
+    CHECK(buffer != nullptr);
+    HardwareBufferPoolStats stats = pool->getStats();
+    CHECK(stats.hits == 1 && stats.pendingSkips == 1 && stats.evictions == 1);
+    close(pipeFds[1]);
+
+    CHECK(pool->release(buffer, -1) == BUFFER_RELEASED);
+    CHECK(HardwareBufferPool::destroy(pool));
+    CHECK(FakeFence::openCount() == openFences);
+}
+
+static void testDesiredPresentTime() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    const int64_t vsyncPeriod = 4'000'000;
+    compositor.setVsyncPeriod(vsyncPeriod);
+    Layers layers;
+
+    int64_t desiredPresentTime = now() + 5 * vsyncPeriod;
+    jlong transaction = JniBindings_nTransactionCreate(nullptr, nullptr);
+    JniBindings_nSetDesiredPresentTime(nullptr, nullptr, transaction, desiredPresentTime);
+    JniBindings_nSetZOrder(nullptr, nullptr, transaction, reinterpret_cast<jlong>(layers.child), 3);
+    JniBindings_nTransactionApply(nullptr, nullptr, transaction);
+    JniBindings_nTransactionDelete(nullptr, nullptr, transaction);
+    CHECK(compositor.composite() == 0);
+
+    compositor.start();
+    for (int i = 0; i < 200 && compositor.getPendingTransactionCount() > 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    compositor.stop();
+    CHECK(compositor.getPendingTransactionCount() == 0);
+    FakeTransactionRecord record = compositor.getTransactions().back();
+    CHECK(record.desiredPresentTime == desiredPresentTime);
+    CHECK(record.latchTime >= desiredPresentTime - vsyncPeriod);
+}
+
+static int64_t gFakeTime = 0;
+
+static int64_t fakeClock() {
+    return gFakeTime;
+}
+
+static void testFrameScheduler() {
+    // Present times of a display slightly slower than the hint, with jitter and skipped vsyncs
+    const int64_t vsyncPeriod = 16'600'000;
+    const int64_t latency = 12'000'000;
+    const int64_t start = 1'000'000'000;
+    FrameScheduler *scheduler = FrameScheduler::create(16'666'667, fakeClock, nullptr);
+    gFakeTime = start;
+    int64_t vsyncs[2];
+    CHECK(scheduler->predictVsyncs(vsyncs, 2) == 0);
+    FrameSchedule schedule = scheduler->schedule(4'000'000);
+    CHECK(schedule.startTime == start && schedule.vsyncPeriod == 16'666'667);
+
+    int64_t vsync = 0;
+    for (int frame = 0; frame < 12; frame++) {
+        vsync += frame % 4 == 3 ? 2 : 1;
+        int64_t presentTime = start + vsync * vsyncPeriod + (frame % 2 == 0 ? 200'000 : -200'000);
+        scheduler->addPresentTime(presentTime - latency, presentTime);
+        // Another transaction presented on the same vsync
+        scheduler->addPresentTime(presentTime - latency, presentTime);
+    }
+    CHECK(llabs(scheduler->getVsyncPeriod() - vsyncPeriod) < 50'000);
+    CHECK(scheduler->getCompositorLatency() == latency);
+
+    gFakeTime = start + vsync * vsyncPeriod + 3'000'000;
+    CHECK(scheduler->predictVsyncs(vsyncs, 2) == 2);
+    CHECK(llabs(vsyncs[0] - (start + (vsync + 1) * vsyncPeriod)) < 300'000);
+    CHECK(vsyncs[1] - vsyncs[0] == scheduler->getVsyncPeriod());
+
+    schedule = scheduler->schedule(4'000'000);
+    CHECK(schedule.desiredPresentTime - schedule.commitDeadline == latency);
+    CHECK(schedule.commitDeadline - schedule.startTime == 4'000'000);
+    CHECK(schedule.startTime >= gFakeTime && schedule.startTime < gFakeTime + vsyncPeriod);
+
+    scheduler->reset();
+    CHECK(scheduler->predictVsyncs(vsyncs, 2) == 0);
+    scheduler->release();
+
+    // Present times collected from transactions through the compositor
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    const int64_t presentLatency = 2'000'000;
+    compositor.setPresentLatency(presentLatency);
+    Layers layers;
+    scheduler = FrameScheduler::create(compositor.getVsyncPeriod(), now, get_signal_time);
+    jlong transaction = JniBindings_nTransactionCreate(nullptr, nullptr);
+    JniBindings_nSetZOrder(nullptr, nullptr, transaction, reinterpret_cast<jlong>(layers.child), 1);
+    JniBindings_nTransactionSetFrameScheduler(nullptr, nullptr, transaction,
+                                              reinterpret_cast<jlong>(scheduler));
+    JniBindings_nTransactionApply(nullptr, nullptr, transaction);
+    JniBindings_nTransactionDelete(nullptr, nullptr, transaction);
+    CHECK(compositor.composite() == 1);
+    for (int i = 0; i < 100 && scheduler->predictVsyncs(vsyncs, 2) == 0; i++) {
+        compositor.composite();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(scheduler->predictVsyncs(vsyncs, 2) == 2);
+    CHECK(vsyncs[0] >= now() - 1'000'000);
+    CHECK(scheduler->getCompositorLatency() == presentLatency);
+    scheduler->release();
+}
+
+/**
+ * Returns the average duration of a call to frame in nanoseconds.
+ */
+template <typename Frame>
+static double measure(int iterations, Frame frame) {
+    for (int i = 0; i < iterations / 10; i++) {
+        frame();
+    }
+    int64_t start = now();
+    for (int i = 0; i < iterations; i++) {
+        frame();
+    }
+    return static_cast<double>(now() - start) / iterations;
+}
+
+static void runBenchmarks() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    compositor.setPresentLatency(0);
+    Layers layers;
+    auto sc = reinterpret_cast<jlong>(layers.child);
+    const int iterations = 100'000;
+
+    jlong transaction = JniBindings_nTransactionCreate(nullptr, nullptr);
+    printf("nSetZOrder: %.1f ns\n", measure(iterations, [&]() {
+        JniBindings_nSetZOrder(nullptr, nullptr, transaction, sc, 1);
+    }));
+    JniBindings_nTransactionDelete(nullptr, nullptr, transaction);
+
+    printf("frame of 4 setters, applied and latched: %.1f ns\n", measure(iterations, [&]() {
+        jlong frame = JniBindings_nTransactionCreate(nullptr, nullptr);
+        JniBindings_nSetVisibility(nullptr, nullptr, frame, sc, 1);
+        JniBindings_nSetZOrder(nullptr, nullptr, frame, sc, 1);
+        JniBindings_nSetBufferAlpha(nullptr, nullptr, frame, sc, 1.0f);
+        JniBindings_nSetPosition(nullptr, nullptr, frame, sc, 0.0f, 0.0f);
+        JniBindings_nTransactionApply(nullptr, nullptr, frame);
+        JniBindings_nTransactionDelete(nullptr, nullptr, frame);
+        compositor.composite();
+    }));
+
+    FrameTimelineRecorder *recorder = FrameTimelineRecorder::create(64, nullptr, get_signal_time);
+    printf("frame with a timeline record: %.1f ns\n", measure(iterations / 10, [&]() {
+        jlong frame = JniBindings_nTransactionCreate(nullptr, nullptr);
+        JniBindings_nSetZOrder(nullptr, nullptr, frame, sc, 1);
+        JniBindings_nTransactionSetFrameTimelineRecorder(
+                nullptr, nullptr, frame, reinterpret_cast<jlong>(recorder), sc, 1, -1);
+        JniBindings_nTransactionApply(nullptr, nullptr, frame);
+        JniBindings_nTransactionDelete(nullptr, nullptr, frame);
+        compositor.composite();
+    }));
+    recorder->release();
+
+    const int64_t vsyncPeriod = compositor.getVsyncPeriod();
+    FrameScheduler *scheduler = FrameScheduler::create(vsyncPeriod, now, nullptr);
+    int64_t presentTime = now();
+    printf("FrameScheduler present time fit and schedule: %.1f ns\n", measure(iterations, [&]() {
+        presentTime += vsyncPeriod;
+        scheduler->addPresentTime(presentTime - vsyncPeriod, presentTime);
+        scheduler->schedule(0);
+    }));
+    scheduler->release();
+
+    int fence = FakeFence::create("benchmark");
+    FakeFence::signal(fence, now());
+    printf("get_signal_time: %.1f ns\n",
+           measure(iterations, [fence]() { get_signal_time(fence); }));
+    int fences[32];
+    std::fill(fences, fences + 32, fence);
+    int64_t signalTimes[32];
+    printf("get_signal_times of 32 fences: %.1f ns\n", measure(iterations / 10, [&]() {
+        get_signal_times(fences, 32, signalTimes, nullptr);
+    }));
+    close(fence);
+}
+
+static bool rectsOverlap(const ARect &a, const ARect &b) {
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static bool rectContains(const ARect &outer, const ARect &inner) {
+    return outer.left <= inner.left && outer.top <= inner.top && outer.right >= inner.right &&
+           outer.bottom >= inner.bottom;
+}
+
+static bool rectEquals(const ARect &a, const ARect &b) {
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+/**
+ * Coalesces the rects and checks the invariants of the result: at most maxRects rects, or 1 if
+ * maxRects is 0, none overlapping another, and every added rect inside one of them.
+ */
+static std::vector<ARect> coalesceAndCheck(int64_t perRectCost, const std::vector<ARect> &rects,
+                                           size_t maxRects) {
+    DamageAccumulator accumulator(perRectCost);
+    for (const ARect &rect : rects) {
+        accumulator.add(rect);
+    }
+    std::vector<ARect> coalesced = accumulator.coalesce(maxRects);
+    CHECK(coalesced.size() <= std::max<size_t>(maxRects, 1));
+    for (size_t i = 0; i < coalesced.size(); i++) {
+        for (size_t j = i + 1; j < coalesced.size(); j++) {
+            CHECK(!rectsOverlap(coalesced[i], coalesced[j]));
+        }
+    }
+    for (const ARect &rect : rects) {
+        if (rect.left >= rect.right || rect.top >= rect.bottom) {
+            continue;
+        }
+        CHECK(std::any_of(coalesced.begin(), coalesced.end(),
+                          [&rect](const ARect &outer) { return rectContains(outer, rect); }));
+    }
+    return coalesced;
+}
+
+static size_t threadCount() {
+    DIR *tasks = opendir("/proc/self/task");
+    CHECK(tasks != nullptr);
+    size_t count = 0;
+    while (struct dirent *entry = readdir(tasks)) {
+        count += entry->d_name[0] != '.' ? 1 : 0;
+    }
+    closedir(tasks);
+    return count;
+}
+
+static void testPresentFenceWatcher() {
+    const size_t threadsBefore = threadCount();
+    FrameTimelineRecorder *recorder = FrameTimelineRecorder::create(8, nullptr, get_signal_time);
+    FrameScheduler *scheduler = FrameScheduler::create(16'666'667, now, get_signal_time);
+    int recorded = FakeFence::create("recorded");
+    int presented = FakeFence::create("presented");
+    int failed = FakeFence::create("failed");
+    recorder->record(FrameTimelineRecord{7, -1, -1, -1, -1, -1, -1}, dup(recorded));
+    scheduler->addPresentFence(-1, dup(presented));
+    // A pending fence keeps the scheduler alive once its owner released it
+    FrameScheduler *released = FrameScheduler::create(16'666'667, now, get_signal_time);
+    released->addPresentFence(-1, dup(failed));
+    released->release();
+    CHECK(PresentFenceWatcher::pendingCount() == 3);
+    // They all share the watcher thread, which may have been started by an earlier test
+    CHECK(threadCount() <= threadsBefore + 1);
+
+    CHECK(FakeFence::signal(recorded, 1000));
+    CHECK(FakeFence::signal(presented, 2000));
+    CHECK(FakeFence::signalError(failed, -5));
+    for (int i = 0; i < 100 && PresentFenceWatcher::pendingCount() > 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(PresentFenceWatcher::pendingCount() == 0);
+
+    FrameTimelineRecord record{};
+    CHECK(recorder->copyRecords(&record, 1) == 1);
+    CHECK(record.frameId == 7 && record.presentTime == 1000);
+    int64_t vsync = 0;
+    CHECK(scheduler->predictVsyncs(&vsync, 1) == 1);
+    close(recorded);
+    close(presented);
+    close(failed);
+    recorder->release();
+    scheduler->release();
+}
+
+static void testDamageAccumulator() {
+    // Empty rects are ignored
+    DamageAccumulator empty(100);
+    empty.add(ARect{10, 10, 10, 20});
+    empty.add(ARect{10, 20, 20, 10});
+    CHECK(empty.isEmpty());
+
+    // Overlapping rects are merged into their bounding box
+    std::vector<ARect> coalesced = coalesceAndCheck(0, {{0, 0, 10, 10}, {5, 5, 15, 15}}, 4);
+    CHECK(coalesced.size() == 1 && rectEquals(coalesced[0], ARect{0, 0, 15, 15}));
+
+    // So are rects whose bounding box adds fewer pixels than a rect costs, here 10 pixels
+    coalesced = coalesceAndCheck(100, {{0, 0, 10, 10}, {11, 0, 21, 10}}, 4);
+    CHECK(coalesced.size() == 1 && rectEquals(coalesced[0], ARect{0, 0, 21, 10}));
+
+    // Distant rects are kept apart
+    const ARect first{0, 0, 10, 10};
+    const ARect second{100, 100, 110, 110};
+    coalesced = coalesceAndCheck(100, {first, second}, 4);
+    CHECK(coalesced.size() == 2);
+    CHECK(rectEquals(coalesced[0], first) || rectEquals(coalesced[0], second));
+    CHECK(rectEquals(coalesced[1], first) || rectEquals(coalesced[1], second));
+
+    // A rect overlapping two others merges all three
+    coalesced = coalesceAndCheck(0, {{0, 0, 10, 10}, {20, 0, 30, 10}, {5, 5, 25, 8}}, 4);
+    CHECK(coalesced.size() == 1 && rectEquals(coalesced[0], ARect{0, 0, 30, 10}));
+
+    // Distant rects are merged down to the limit
+    std::vector<ARect> distant;
+    for (int32_t i = 0; i < 10; i++) {
+        distant.push_back(ARect{i * 100, 0, i * 100 + 10, 10});
+    }
+    coalesced = coalesceAndCheck(0, distant, 3);
+    CHECK(coalesced.size() == 3);
+
+    // Over the limit, the rects that waste the fewest pixels are merged first, so the two pairs
+    // of close rects are merged rather than the pairs with each other
+    coalesced = coalesceAndCheck(0, {{0, 0, 10, 10}, {12, 0, 22, 10}, {500, 0, 510, 10},
+                                     {512, 0, 522, 10}}, 2);
+    CHECK(coalesced.size() == 2);
+    CHECK(std::any_of(coalesced.begin(), coalesced.end(),
+                      [](const ARect &rect) { return rectEquals(rect, ARect{0, 0, 22, 10}); }));
+    CHECK(std::any_of(coalesced.begin(), coalesced.end(), [](const ARect &rect) {
+        return rectEquals(rect, ARect{500, 0, 522, 10});
+    }));
+
+    // A single rect is always allowed
+    coalesced = coalesceAndCheck(0, distant, 0);
+    CHECK(coalesced.size() == 1 && rectEquals(coalesced[0], ARect{0, 0, 910, 10}));
+
+    // More rects than are kept pending, scattered over a grid with some overlapping others
+    std::vector<ARect> scattered;
+    uint32_t seed = 1;
+    for (int i = 0; i < 300; i++) {
+        seed = seed * 1103515245 + 12345;
+        int32_t x = static_cast<int32_t>((seed >> 8) % 1000);
+        int32_t y = static_cast<int32_t>((seed >> 18) % 1000);
+        int32_t size = static_cast<int32_t>(1 + (seed >> 4) % 40);
+        scattered.push_back(ARect{x, y, x + size, y + size});
+    }
+    for (size_t maxRects : {1, 4, 16, 64}) {
+        coalesceAndCheck(64, scattered, maxRects);
+    }
+}
+
+static void testCoalescedDamageRegion() {
+    FakeCompositor &compositor = FakeCompositor::getInstance();
+    Layers layers;
+    ASurfaceTransaction *transaction = ASurfaceTransaction_create();
+    FakeLayerState state;
+
+    // The overlapping rects are merged, the distant one is kept apart
+    const jint rects[] = {0, 0, 10, 10, 5, 5, 15, 15, 100, 100, 110, 110};
+    setCoalescedDamageRegion(transaction, layers.child, rects, 3, 4, 0);
+    ASurfaceTransaction_apply(transaction);
+    CHECK(compositor.composite() == 1);
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.damage.size() == 2);
+    for (const ARect &rect : state.damage) {
+        CHECK(rectEquals(rect, ARect{0, 0, 15, 15}) || rectEquals(rect, ARect{100, 100, 110, 110}));
+    }
+
+    // Over the limit, the rects are merged down to it
+    jint distant[40];
+    for (int i = 0; i < 10; i++) {
+        jint rect[] = {i * 100, 0, i * 100 + 10, 10};
+        std::copy(rect, rect + 4, distant + i * 4);
+    }
+    setCoalescedDamageRegion(transaction, layers.child, distant, 10, 2, 0);
+    ASurfaceTransaction_apply(transaction);
+    CHECK(compositor.composite() == 1);
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.damage.size() == 2 && !rectsOverlap(state.damage[0], state.damage[1]));
+    CHECK(compositor.getTransactions().back().damageRectCount == 2);
+
+    // Only empty rects damage nothing, rather than the whole buffer
+    const jint empty[] = {10, 10, 10, 20};
+    setCoalescedDamageRegion(transaction, layers.child, empty, 1, 4, 0);
+    ASurfaceTransaction_apply(transaction);
+    CHECK(compositor.composite() == 1);
+    CHECK(compositor.getLayerState(layers.child, &state));
+    CHECK(state.damage.size() == 1 && rectEquals(state.damage[0], ARect{0, 0, 0, 0}));
+    ASurfaceTransaction_delete(transaction);
+}
+
+int main(int argc, char **argv) {
+    bool benchmark = argc > 1 && strcmp(argv[1], "--benchmark") == 0;
+    void (*tests[])() = {testFence, testSignalTimes, testBindingsApplyLayerState,
+                         testBuffersAndFences, testFrameTimelineRecorder, testHardwareBufferPool,
+                         testHardwareBufferPoolErrorFences, testDesiredPresentTime,
+                         testFrameScheduler, testPresentFenceWatcher, testDamageAccumulator,
+                         testCoalescedDamageRegion};
+    for (auto test : tests) {
+        FakePlatform::reset();
+        FakeCompositor::getInstance().reset();
+        test();
+        FakeCompositor::getInstance().composite();
+        CHECK(FakeCompositor::getInstance().getSurfaceControlCount() == 0);
+        CHECK(FakePlatform::getHardwareBufferCount() == 0);
+    }
+    printf("%zu tests passed\n", sizeof(tests) / sizeof(tests[0]));
+    if (benchmark) {
+        FakeCompositor::getInstance().reset();
+        runBenchmarks();
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fake_sync.h"
+#include <algorithm>
+#include <android/sync.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+struct Fence {
+    /** Write end of the pipe, kept open to detect once every read end is closed */
+    int writeFd;
+    int32_t status;
+    int64_t signalTime;
+    char name[32];
+};
+
+/** Identifies a pipe independently of which duplicated file descriptor refers to it */
+using FenceKey = std::pair<dev_t, ino_t>;
+
+static std::mutex gLock;
+static std::map<FenceKey, Fence> gFences;
+static size_t gSweepThreshold = 64;
+
+static bool getKey(int fd, FenceKey *outKey) {
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) {
+        return false;
+    }
+    *outKey = FenceKey(st.st_dev, st.st_ino);
+    return true;
+}
+
+/**
+ * Forgets fences whose read ends are all closed, which report POLLERR on their write end.
+ * Called with gLock held.
+ */
+static void sweep() {
+    for (auto it = gFences.begin(); it != gFences.end();) {
+        struct pollfd pollFd{it->second.writeFd, 0, 0};
+        if (poll(&pollFd, 1, 0) > 0 && (pollFd.revents & POLLERR)) {
+            close(it->second.writeFd);
+            it = gFences.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static bool setStatus(int fd, int32_t status, int64_t signalTime) {
+    FenceKey key;
+    if (!getKey(fd, &key)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(gLock);
+    auto it = gFences.find(key);
+    if (it == gFences.end() || it->second.status != 0) {
+        return false;
+    }
+    it->second.status = status;
+    it->second.signalTime = signalTime;
+    char signaled = 1;
+    return write(it->second.writeFd, &signaled, 1) == 1;
+}
+
+int FakeFence::create(const char *name) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return -1;
+    }
+    FenceKey key;
+    if (!getKey(fds[0], &key)) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    Fence fence{fds[1], 0, 0, {}};
+    strncpy(fence.name, name != nullptr ? name : "", sizeof(fence.name) - 1);
+
+    std::lock_guard<std::mutex> lock(gLock);
+    if (gFences.size() >= gSweepThreshold) {
+        sweep();
+        gSweepThreshold = std::max<size_t>(64, gFences.size() * 2);
+    }
+    gFences[key] = fence;
+    return fds[0];
+}
+
+bool FakeFence::signal(int fd, int64_t signalTime) {
+    return setStatus(fd, 1, signalTime);
+}
+
+bool FakeFence::signalError(int fd, int32_t error) {
+    return error < 0 && setStatus(fd, error, 0);
+}
+
+int64_t FakeFence::getSignalTime(int fd) {
+    FenceKey key;
+    if (!getKey(fd, &key)) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(gLock);
+    auto it = gFences.find(key);
+    if (it == gFences.end() || it->second.status < 0) {
+        return -1;
+    }
+    return it->second.status == 0 ? INT64_MAX : it->second.signalTime;
+}
+
+size_t FakeFence::openCount() {
+    std::lock_guard<std::mutex> lock(gLock);
+    sweep();
+    return gFences.size();
+}
+
+struct sync_file_info *sync_file_info(int32_t fd) {
+    FenceKey key;
+    if (!getKey(fd, &key)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(gLock);
+    auto it = gFences.find(key);
+    if (it == gFences.end()) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    const Fence &fence = it->second;
+
+    // Laid out like the allocation of libsync, with the fence info following the file info
+    auto info = static_cast<struct sync_file_info *>(
+            calloc(1, sizeof(struct sync_file_info) + sizeof(struct sync_fence_info)));
+    if (info == nullptr) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    auto fenceInfo = reinterpret_cast<struct sync_fence_info *>(info + 1);
+    strncpy(info->name, fence.name, sizeof(info->name) - 1);
+    info->status = fence.status;
+    info->num_fences = 1;
+    info->sync_fence_info = reinterpret_cast<uintptr_t>(fenceInfo);
+    strncpy(fenceInfo->obj_name, fence.name, sizeof(fenceInfo->obj_name) - 1);
+    strncpy(fenceInfo->driver_name, "fake_sync", sizeof(fenceInfo->driver_name) - 1);
+    fenceInfo->status = fence.status;
+    fenceInfo->timestamp_ns = fence.status == 1 ? static_cast<uint64_t>(fence.signalTime) : 0;
+    return info;
+}
+
+void sync_file_info_free(struct sync_file_info *info) {
+    free(info);
+}
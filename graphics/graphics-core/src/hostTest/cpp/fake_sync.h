@@ -0,0 +1,61 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_FAKE_SYNC_H
+#define ANDROIDX_FAKE_SYNC_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fences for host builds, which cannot create sync_files without the sw_sync debugfs interface.
+ * A fake fence is the read end of a pipe that becomes readable once the fence signals, so it can
+ * be duplicated, polled and added to an epoll set like a sync_file. sync_file_info reports its
+ * status and signal time, but sync_file ioctls such as SYNC_IOC_MERGE fail with ENOTTY.
+ *
+ * This is built into libsync.so, which graphics-core resolves sync_file_info from at runtime.
+ */
+class FakeFence {
+public:
+    /**
+     * Returns a pending fence, or -1 on failure. The caller owns the file descriptor.
+     */
+    static int create(const char *name);
+
+    /**
+     * Signals the fence, with the given signal time in the CLOCK_MONOTONIC time domain. Returns
+     * false if the file descriptor is not a pending fake fence.
+     */
+    static bool signal(int fd, int64_t signalTime);
+
+    /**
+     * Signals the fence with an error status, which must be negative.
+     */
+    static bool signalError(int fd, int32_t error);
+
+    /**
+     * Returns the time the fence signaled, INT64_MAX if it is pending or -1 if the file descriptor
+     * is not a fake fence or signaled with an error.
+     */
+    static int64_t getSignalTime(int fd);
+
+    /**
+     * Returns the number of fences that still have an open file descriptor, to detect leaks.
+     */
+    static size_t openCount();
+};
+
+#endif //ANDROIDX_FAKE_SYNC_H
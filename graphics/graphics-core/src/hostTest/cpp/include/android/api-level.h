@@ -0,0 +1,29 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_API_LEVEL_H
+#define ANDROIDX_HOST_ANDROID_API_LEVEL_H
+
+extern "C" {
+
+/**
+ * Returns the API level set with FakePlatform::setApiLevel.
+ */
+int android_get_device_api_level();
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_API_LEVEL_H
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_DATA_SPACE_H
+#define ANDROIDX_HOST_ANDROID_DATA_SPACE_H
+
+enum ADataSpace {
+    ADATASPACE_UNKNOWN = 0,
+    ADATASPACE_SRGB_LINEAR = 138477568,
+    ADATASPACE_SRGB = 142671872,
+    ADATASPACE_DISPLAY_P3 = 143261696,
+    ADATASPACE_BT2020 = 147193856,
+    ADATASPACE_BT2020_PQ = 163971072,
+    ADATASPACE_BT2020_HLG = 168165376,
+    ADATASPACE_SCRGB_LINEAR = 406913024,
+    ADATASPACE_SCRGB = 411107328,
+};
+
+#endif //ANDROIDX_HOST_ANDROID_DATA_SPACE_H
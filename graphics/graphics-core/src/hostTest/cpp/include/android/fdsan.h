@@ -0,0 +1,38 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_FDSAN_H
+#define ANDROIDX_HOST_ANDROID_FDSAN_H
+
+#include <cstdint>
+
+// graphics-core resolves these from libc.so at runtime, which fails on the host, so they are only
+// declared.
+
+enum android_fdsan_owner_type {
+    ANDROID_FDSAN_OWNER_TYPE_GENERIC_00 = 0,
+    ANDROID_FDSAN_OWNER_TYPE_GENERIC_FF = 255,
+};
+
+extern "C" {
+
+uint64_t android_fdsan_get_owner_tag(int fd);
+
+int android_fdsan_close_with_tag(int fd, uint64_t tag);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_FDSAN_H
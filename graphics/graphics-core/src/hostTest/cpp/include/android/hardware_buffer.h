@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_HARDWARE_BUFFER_H
+#define ANDROIDX_HOST_ANDROID_HARDWARE_BUFFER_H
+
+#include <android/rect.h>
+#include <cstdint>
+
+enum AHardwareBuffer_Format {
+    AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM = 1,
+    AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM = 2,
+    AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM = 3,
+    AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM = 4,
+    AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT = 0x16,
+    AHARDWAREBUFFER_FORMAT_R10G10B10A2_UNORM = 0x2b,
+    AHARDWAREBUFFER_FORMAT_BLOB = 0x21,
+    AHARDWAREBUFFER_FORMAT_R8_UNORM = 0x38,
+};
+
+enum AHardwareBuffer_UsageFlags {
+    AHARDWAREBUFFER_USAGE_CPU_READ_NEVER = 0UL,
+    AHARDWAREBUFFER_USAGE_CPU_READ_RARELY = 2UL,
+    AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN = 3UL,
+    AHARDWAREBUFFER_USAGE_CPU_READ_MASK = 0xFUL,
+    AHARDWAREBUFFER_USAGE_CPU_WRITE_NEVER = 0UL << 4,
+    AHARDWAREBUFFER_USAGE_CPU_WRITE_RARELY = 2UL << 4,
+    AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN = 3UL << 4,
+    AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK = 0xFUL << 4,
+    AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE = 1UL << 8,
+    AHARDWAREBUFFER_USAGE_GPU_FRAMEBUFFER = 1UL << 9,
+    AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT = AHARDWAREBUFFER_USAGE_GPU_FRAMEBUFFER,
+    AHARDWAREBUFFER_USAGE_COMPOSER_OVERLAY = 1ULL << 11,
+    AHARDWAREBUFFER_USAGE_FRONT_BUFFER = 1ULL << 32,
+};
+
+typedef struct AHardwareBuffer_Desc {
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t format;
+    uint64_t usage;
+    uint32_t stride;
+    uint32_t rfu0;
+    uint64_t rfu1;
+} AHardwareBuffer_Desc;
+
+typedef struct AHardwareBuffer AHardwareBuffer;
+
+extern "C" {
+
+/**
+ * Allocates the buffer in host memory. Returns -EINVAL for formats that cannot be mapped, see
+ * FakePlatform::hardwareBufferCount to detect leaked references.
+ */
+int AHardwareBuffer_allocate(const AHardwareBuffer_Desc *desc, AHardwareBuffer **outBuffer);
+
+void AHardwareBuffer_acquire(AHardwareBuffer *buffer);
+
+void AHardwareBuffer_release(AHardwareBuffer *buffer);
+
+void AHardwareBuffer_describe(const AHardwareBuffer *buffer, AHardwareBuffer_Desc *outDesc);
+
+/**
+ * Waits for the fence, if any, and closes it before mapping the buffer.
+ */
+int AHardwareBuffer_lock(AHardwareBuffer *buffer, uint64_t usage, int32_t fence,
+                         const ARect *rect, void **outVirtualAddress);
+
+/**
+ * Unmaps the buffer. No fence is returned, the buffer may be used as soon as this returns.
+ */
+int AHardwareBuffer_unlock(AHardwareBuffer *buffer, int32_t *fence);
+
+int AHardwareBuffer_getId(const AHardwareBuffer *buffer, uint64_t *outId);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_HARDWARE_BUFFER_H
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_HARDWARE_BUFFER_JNI_H
+#define ANDROIDX_HOST_ANDROID_HARDWARE_BUFFER_JNI_H
+
+#include <android/hardware_buffer.h>
+#include <jni.h>
+
+extern "C" {
+
+/**
+ * There is no android.hardware.HardwareBuffer on the host, so host tests pass the AHardwareBuffer
+ * pointer itself as the jobject and it is returned as is.
+ */
+AHardwareBuffer *AHardwareBuffer_fromHardwareBuffer(JNIEnv *env, jobject hardwareBufferObj);
+
+/**
+ * Returns the buffer itself as the jobject, see AHardwareBuffer_fromHardwareBuffer.
+ */
+jobject AHardwareBuffer_toHardwareBuffer(JNIEnv *env, AHardwareBuffer *hardwareBuffer);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_HARDWARE_BUFFER_JNI_H
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_NATIVE_WINDOW_H
+#define ANDROIDX_HOST_ANDROID_NATIVE_WINDOW_H
+
+#include <android/hardware_buffer.h>
+#include <android/rect.h>
+#include <cstdint>
+
+typedef struct ANativeWindow ANativeWindow;
+
+extern "C" {
+
+void ANativeWindow_acquire(ANativeWindow *window);
+
+void ANativeWindow_release(ANativeWindow *window);
+
+int32_t ANativeWindow_getWidth(ANativeWindow *window);
+
+int32_t ANativeWindow_getHeight(ANativeWindow *window);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_NATIVE_WINDOW_H
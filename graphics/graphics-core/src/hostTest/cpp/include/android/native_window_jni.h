@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_NATIVE_WINDOW_JNI_H
+#define ANDROIDX_HOST_ANDROID_NATIVE_WINDOW_JNI_H
+
+#include <android/native_window.h>
+#include <jni.h>
+
+extern "C" {
+
+/**
+ * There is no android.view.Surface on the host, so host tests pass a window created with
+ * FakePlatform::createWindow as the jobject. A new reference to it is returned.
+ */
+ANativeWindow *ANativeWindow_fromSurface(JNIEnv *env, jobject surface);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_NATIVE_WINDOW_JNI_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_SURFACE_CONTROL_H
+#define ANDROIDX_HOST_ANDROID_SURFACE_CONTROL_H
+
+#include <android/data_space.h>
+#include <android/hardware_buffer.h>
+#include <android/native_window.h>
+#include <android/rect.h>
+#include <cstddef>
+#include <cstdint>
+
+// Implemented by fake_surface_control.cpp. Applied transactions are queued on the FakeCompositor
+// and latched by FakeCompositor::composite.
+
+typedef struct ASurfaceControl ASurfaceControl;
+typedef struct ASurfaceTransaction ASurfaceTransaction;
+typedef struct ASurfaceTransactionStats ASurfaceTransactionStats;
+
+typedef void (*ASurfaceTransaction_OnComplete)(void *context, ASurfaceTransactionStats *stats);
+typedef void (*ASurfaceTransaction_OnCommit)(void *context, ASurfaceTransactionStats *stats);
+
+enum ASurfaceTransactionVisibility : int8_t {
+    ASURFACE_TRANSACTION_VISIBILITY_HIDE = 0,
+    ASURFACE_TRANSACTION_VISIBILITY_SHOW = 1,
+};
+
+enum ASurfaceTransactionTransparency : int8_t {
+    ASURFACE_TRANSACTION_TRANSPARENCY_TRANSPARENT = 0,
+    ASURFACE_TRANSACTION_TRANSPARENCY_TRANSLUCENT = 1,
+    ASURFACE_TRANSACTION_TRANSPARENCY_OPAQUE = 2,
+};
+
+extern "C" {
+
+ASurfaceControl *ASurfaceControl_createFromWindow(ANativeWindow *parent, const char *debug_name);
+
+ASurfaceControl *ASurfaceControl_create(ASurfaceControl *parent, const char *debug_name);
+
+void ASurfaceControl_acquire(ASurfaceControl *surface_control);
+
+void ASurfaceControl_release(ASurfaceControl *surface_control);
+
+ASurfaceTransaction *ASurfaceTransaction_create();
+
+void ASurfaceTransaction_delete(ASurfaceTransaction *transaction);
+
+void ASurfaceTransaction_apply(ASurfaceTransaction *transaction);
+
+int64_t ASurfaceTransactionStats_getLatchTime(ASurfaceTransactionStats *surface_transaction_stats);
+
+int ASurfaceTransactionStats_getPresentFenceFd(
+        ASurfaceTransactionStats *surface_transaction_stats);
+
+void ASurfaceTransactionStats_getASurfaceControls(
+        ASurfaceTransactionStats *surface_transaction_stats,
+        ASurfaceControl ***outASurfaceControls, size_t *outASurfaceControlsSize);
+
+void ASurfaceTransactionStats_releaseASurfaceControls(ASurfaceControl **surface_controls);
+
+int64_t ASurfaceTransactionStats_getAcquireTime(
+        ASurfaceTransactionStats *surface_transaction_stats, ASurfaceControl *surface_control);
+
+int ASurfaceTransactionStats_getPreviousReleaseFenceFd(
+        ASurfaceTransactionStats *surface_transaction_stats, ASurfaceControl *surface_control);
+
+void ASurfaceTransaction_setOnComplete(ASurfaceTransaction *transaction, void *context,
+                                       ASurfaceTransaction_OnComplete func);
+
+void ASurfaceTransaction_setOnCommit(ASurfaceTransaction *transaction, void *context,
+                                     ASurfaceTransaction_OnCommit func);
+
+void ASurfaceTransaction_reparent(ASurfaceTransaction *transaction,
+                                  ASurfaceControl *surface_control,
+                                  ASurfaceControl *new_parent);
+
+void ASurfaceTransaction_setVisibility(ASurfaceTransaction *transaction,
+                                       ASurfaceControl *surface_control,
+                                       enum ASurfaceTransactionVisibility visibility);
+
+void ASurfaceTransaction_setZOrder(ASurfaceTransaction *transaction,
+                                   ASurfaceControl *surface_control, int32_t z_order);
+
+void ASurfaceTransaction_setBuffer(ASurfaceTransaction *transaction,
+                                   ASurfaceControl *surface_control, AHardwareBuffer *buffer,
+                                   int acquire_fence_fd);
+
+void ASurfaceTransaction_setGeometry(ASurfaceTransaction *transaction,
+                                     ASurfaceControl *surface_control, const ARect &source,
+                                     const ARect &destination, int32_t transform);
+
+void ASurfaceTransaction_setCrop(ASurfaceTransaction *transaction,
+                                 ASurfaceControl *surface_control, const ARect &crop);
+
+void ASurfaceTransaction_setPosition(ASurfaceTransaction *transaction,
+                                     ASurfaceControl *surface_control, int32_t x, int32_t y);
+
+void ASurfaceTransaction_setBufferTransform(ASurfaceTransaction *transaction,
+                                            ASurfaceControl *surface_control, int32_t transform);
+
+void ASurfaceTransaction_setScale(ASurfaceTransaction *transaction,
+                                  ASurfaceControl *surface_control, float xScale, float yScale);
+
+void ASurfaceTransaction_setBufferTransparency(ASurfaceTransaction *transaction,
+                                               ASurfaceControl *surface_control,
+                                               enum ASurfaceTransactionTransparency transparency);
+
+void ASurfaceTransaction_setDamageRegion(ASurfaceTransaction *transaction,
+                                         ASurfaceControl *surface_control, const ARect *rects,
+                                         uint32_t count);
+
+void ASurfaceTransaction_setDesiredPresentTime(ASurfaceTransaction *transaction,
+                                               int64_t desiredPresentTime);
+
+void ASurfaceTransaction_setBufferAlpha(ASurfaceTransaction *transaction,
+                                        ASurfaceControl *surface_control, float alpha);
+
+void ASurfaceTransaction_setBufferDataSpace(ASurfaceTransaction *transaction,
+                                            ASurfaceControl *surface_control,
+                                            enum ADataSpace data_space);
+
+void ASurfaceTransaction_setFrameRate(ASurfaceTransaction *transaction,
+                                      ASurfaceControl *surface_control, float frameRate,
+                                      int8_t compatibility);
+
+void ASurfaceTransaction_setFrameRateWithChangeStrategy(ASurfaceTransaction *transaction,
+                                                        ASurfaceControl *surface_control,
+                                                        float frameRate, int8_t compatibility,
+                                                        int8_t changeFrameRateStrategy);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_SURFACE_CONTROL_H
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_SYNC_H
+#define ANDROIDX_HOST_ANDROID_SYNC_H
+
+#include <cstdint>
+#include <linux/sync_file.h>
+
+extern "C" {
+
+/**
+ * Implemented for fences created with FakeFence::create by the libsync.so built from
+ * fake_sync.cpp. Returns nullptr with errno set to EINVAL for any other file descriptor.
+ */
+struct sync_file_info *sync_file_info(int32_t fd);
+
+void sync_file_info_free(struct sync_file_info *info);
+
+}
+
+static inline struct sync_fence_info *sync_get_fence_info(const struct sync_file_info *info) {
+    return reinterpret_cast<struct sync_fence_info *>(
+            static_cast<uintptr_t>(info->sync_fence_info));
+}
+
+#endif //ANDROIDX_HOST_ANDROID_SYNC_H
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_ANDROID_TRACE_H
+#define ANDROIDX_HOST_ANDROID_TRACE_H
+
+#include <cstdint>
+
+extern "C" {
+
+bool ATrace_isEnabled();
+
+void ATrace_beginSection(const char *sectionName);
+
+void ATrace_endSection();
+
+/**
+ * Keeps the last value of each counter while tracing is enabled, see FakePlatform::traceCounter.
+ */
+void ATrace_setCounter(const char *counterName, int64_t counterValue);
+
+}
+
+#endif //ANDROIDX_HOST_ANDROID_TRACE_H
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HOST_SYS_SYSTEM_PROPERTIES_H
+#define ANDROIDX_HOST_SYS_SYSTEM_PROPERTIES_H
+
+#define PROP_VALUE_MAX 92
+
+extern "C" {
+
+/**
+ * Returns properties set with FakePlatform::setSystemProperty, or an empty value.
+ */
+int __system_property_get(const char *name, char *value);
+
+}
+
+#endif //ANDROIDX_HOST_SYS_SYSTEM_PROPERTIES_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "damage_accumulator.h"
+#include <algorithm>
+
+/**
+ * Coalescing is quadratic in the number of rects, so pending rects are coalesced down to half of
+ * this whenever it is reached.
+ */
+static constexpr size_t MAX_PENDING_RECTS = 64;
+
+static int64_t area(const ARect &rect) {
+    return static_cast<int64_t>(rect.right - rect.left) * (rect.bottom - rect.top);
+}
+
+static bool overlaps(const ARect &a, const ARect &b) {
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static ARect boundingBox(const ARect &a, const ARect &b) {
+    return ARect{std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right),
+                 std::max(a.bottom, b.bottom)};
+}
+
+void DamageAccumulator::add(const ARect &rect) {
+    if (rect.left >= rect.right || rect.top >= rect.bottom) {
+        return;
+    }
+    mRects.push_back(rect);
+    if (mRects.size() >= MAX_PENDING_RECTS) {
+        coalesce(MAX_PENDING_RECTS / 2);
+    }
+}
+
+void DamageAccumulator::mergeOverlapping() {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < mRects.size(); i++) {
+            for (size_t j = i + 1; j < mRects.size();) {
+                if (overlaps(mRects[i], mRects[j])) {
+                    // The bounding box may overlap rects that were already checked against i
+                    mRects[i] = boundingBox(mRects[i], mRects[j]);
+                    mRects[j] = mRects.back();
+                    mRects.pop_back();
+                    merged = true;
+                } else {
+                    j++;
+                }
+            }
+        }
+    }
+}
+
+const std::vector<ARect> &DamageAccumulator::coalesce(size_t maxRects) {
+    maxRects = std::max<size_t>(maxRects, 1);
+    mergeOverlapping();
+    while (mRects.size() > 1) {
+        // The rects are disjoint, so merging two of them adds the area of their bounding box not
+        // covered by either
+        size_t bestI = 0;
+        size_t bestJ = 1;
+        int64_t bestWaste = INT64_MAX;
+        for (size_t i = 0; i < mRects.size(); i++) {
+            for (size_t j = i + 1; j < mRects.size(); j++) {
+                int64_t waste = area(boundingBox(mRects[i], mRects[j])) - area(mRects[i]) -
+                                area(mRects[j]);
+                if (waste < bestWaste) {
+                    bestWaste = waste;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        if (mRects.size() <= maxRects && bestWaste > mPerRectCost) {
+            break;
+        }
+        mRects[bestI] = boundingBox(mRects[bestI], mRects[bestJ]);
+        mRects[bestJ] = mRects.back();
+        mRects.pop_back();
+        mergeOverlapping();
+    }
+    return mRects;
+}
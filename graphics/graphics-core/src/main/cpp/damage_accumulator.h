@@ -0,0 +1,67 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_DAMAGE_ACCUMULATOR_H
+#define ANDROIDX_DAMAGE_ACCUMULATOR_H
+
+#include <android/rect.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Collects the rects damaged during a frame and coalesces them into a bounded number of
+ * non-overlapping rects before they are passed to ASurfaceTransaction_setDamageRegion. Dozens of
+ * tiny rects make some compositors fall back to recomposing the whole frame.
+ *
+ * Coalescing minimizes the cost of the damage region, modeled as its area in pixels plus
+ * perRectCost pixels for every rect. Two rects are merged into their bounding box when that adds
+ * fewer pixels than a rect costs, or when there are more rects than allowed.
+ */
+class DamageAccumulator {
+public:
+    explicit DamageAccumulator(int64_t perRectCost) : mPerRectCost(perRectCost) {}
+
+    /**
+     * Adds a damaged rect, ignoring empty ones.
+     */
+    void add(const ARect &rect);
+
+    /**
+     * Coalesces the damage into at most maxRects non-overlapping rects, which must be at least 1.
+     */
+    const std::vector<ARect> &coalesce(size_t maxRects);
+
+    const std::vector<ARect> &rects() const {
+        return mRects;
+    }
+
+    bool isEmpty() const {
+        return mRects.empty();
+    }
+
+    void reset() {
+        mRects.clear();
+    }
+
+private:
+    void mergeOverlapping();
+
+    const int64_t mPerRectCost;
+    std::vector<ARect> mRects;
+};
+
+#endif //ANDROIDX_DAMAGE_ACCUMULATOR_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EGLImageCache"
+
+#include "egl_image_cache.h"
+#include <android/log.h>
+
+#define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+EGLImageCache *EGLImageCache::create(EGLDisplay display, size_t capacity) {
+    auto getNativeClientBuffer = reinterpret_cast<PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC>(
+            eglGetProcAddress("eglGetNativeClientBufferANDROID"));
+    auto createImage = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(
+            eglGetProcAddress("eglCreateImageKHR"));
+    auto destroyImage = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(
+            eglGetProcAddress("eglDestroyImageKHR"));
+    auto imageTargetTexture = reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(
+            eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+    if (getNativeClientBuffer == nullptr || createImage == nullptr || destroyImage == nullptr ||
+        imageTargetTexture == nullptr || capacity == 0) {
+        ALOGE("Unable to create EGLImage cache");
+        return nullptr;
+    }
+    return new EGLImageCache(display, capacity, getNativeClientBuffer, createImage, destroyImage,
+                             imageTargetTexture);
+}
+
+void EGLImageCache::destroy(EGLImageCache *cache) {
+    if (cache != nullptr) {
+        cache->clear();
+        delete cache;
+    }
+}
+
+EGLImageCache::EGLImageCache(EGLDisplay display, size_t capacity,
+                             PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC getNativeClientBuffer,
+                             PFNEGLCREATEIMAGEKHRPROC createImage,
+                             PFNEGLDESTROYIMAGEKHRPROC destroyImage,
+                             PFNGLEGLIMAGETARGETTEXTURE2DOESPROC imageTargetTexture)
+        : mDisplay(display),
+          mCapacity(capacity),
+          mGetNativeClientBuffer(getNativeClientBuffer),
+          mCreateImage(createImage),
+          mDestroyImage(destroyImage),
+          mImageTargetTexture(imageTargetTexture) {
+    mEntries.reserve(capacity);
+}
+
+GLuint EGLImageCache::getTexture(AHardwareBuffer *buffer, GLenum target) {
+    if (buffer == nullptr) {
+        return 0;
+    }
+    for (auto &entry : mEntries) {
+        if (entry.buffer != buffer) {
+            continue;
+        }
+        mStats.hits++;
+        entry.lastUse = ++mUseCount;
+        if (entry.target != target) {
+            // A texture is bound to a single target, bind the image to a new one
+            glDeleteTextures(1, &entry.texture);
+            glGenTextures(1, &entry.texture);
+            glBindTexture(target, entry.texture);
+            mImageTargetTexture(target, entry.image);
+            entry.target = target;
+        } else {
+            glBindTexture(target, entry.texture);
+        }
+        return entry.texture;
+    }
+
+    mStats.misses++;
+    EGLint imageAttrs[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
+    EGLImageKHR image = mCreateImage(mDisplay, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID,
+                                     mGetNativeClientBuffer(buffer), imageAttrs);
+    if (image == EGL_NO_IMAGE_KHR) {
+        ALOGE("Unable to create EGLImage: 0x%x", eglGetError());
+        return 0;
+    }
+
+    if (mEntries.size() >= mCapacity) {
+        auto leastRecentlyUsed = mEntries.begin();
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+            if (it->lastUse < leastRecentlyUsed->lastUse) {
+                leastRecentlyUsed = it;
+            }
+        }
+        releaseEntry(*leastRecentlyUsed);
+        mEntries.erase(leastRecentlyUsed);
+        mStats.evictions++;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    mImageTargetTexture(target, image);
+    AHardwareBuffer_acquire(buffer);
+    mEntries.push_back(Entry{buffer, image, texture, target, ++mUseCount});
+    return texture;
+}
+
+bool EGLImageCache::evict(AHardwareBuffer *buffer) {
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->buffer == buffer) {
+            releaseEntry(*it);
+            mEntries.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t EGLImageCache::evictUnless(bool (*keep)(void *context, AHardwareBuffer *buffer),
+                                  void *context) {
+    size_t evicted = 0;
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        if (keep(context, it->buffer)) {
+            ++it;
+            continue;
+        }
+        releaseEntry(*it);
+        it = mEntries.erase(it);
+        evicted++;
+    }
+    return evicted;
+}
+
+void EGLImageCache::clear() {
+    for (auto &entry : mEntries) {
+        releaseEntry(entry);
+    }
+    mEntries.clear();
+}
+
+EGLImageCacheStats EGLImageCache::getStats() const {
+    EGLImageCacheStats stats = mStats;
+    stats.size = static_cast<int64_t>(mEntries.size());
+    return stats;
+}
+
+void EGLImageCache::releaseEntry(Entry &entry) {
+    glDeleteTextures(1, &entry.texture);
+    mDestroyImage(mDisplay, entry.image);
+    AHardwareBuffer_release(entry.buffer);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_EGL_IMAGE_CACHE_H
+#define ANDROIDX_EGL_IMAGE_CACHE_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <android/hardware_buffer.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct EGLImageCacheStats {
+    int64_t hits;
+    int64_t misses;
+    /** Entries dropped to stay within the capacity */
+    int64_t evictions;
+    int64_t size;
+};
+
+/** Number of int64_t fields of EGLImageCacheStats, used to copy the stats to Java */
+static constexpr size_t EGL_IMAGE_CACHE_STATS_FIELDS = 4;
+
+/**
+ * Caches the EGLImage created for an AHardwareBuffer along with a texture bound to it, so that
+ * binding a pooled buffer every frame is a lookup instead of an eglCreateImageKHR call, which
+ * takes milliseconds on some drivers.
+ *
+ * Entries are keyed by the AHardwareBuffer address. Each entry holds a reference to its buffer so
+ * the address cannot be reused by another allocation while it is cached, which would otherwise
+ * return a stale image. Entries must be evicted when their buffer is released, for instance with
+ * evictUnless once a HardwareBufferPool no longer holds it, and the cache cleared before its
+ * display is terminated.
+ *
+ * This class is not thread safe and must be used on a thread where a GL context of the display is
+ * current, as it creates and deletes textures.
+ */
+class EGLImageCache {
+public:
+    /**
+     * Returns nullptr if the EGLImage extensions are not supported.
+     */
+    static EGLImageCache *create(EGLDisplay display, size_t capacity);
+
+    /**
+     * Destroys every cached EGLImage and texture, then the cache itself.
+     */
+    static void destroy(EGLImageCache *cache);
+
+    /**
+     * Returns the texture bound to the EGLImage of the buffer, creating both if the buffer is not
+     * cached yet. The texture is left bound to target. Returns 0 if the EGLImage cannot be created.
+     */
+    GLuint getTexture(AHardwareBuffer *buffer, GLenum target);
+
+    /**
+     * Destroys the EGLImage and texture of the buffer. Returns false if it is not cached.
+     */
+    bool evict(AHardwareBuffer *buffer);
+
+    /**
+     * Destroys the EGLImage and texture of every buffer for which keep returns false. Returns the
+     * number of buffers evicted.
+     */
+    size_t evictUnless(bool (*keep)(void *context, AHardwareBuffer *buffer), void *context);
+
+    /**
+     * Destroys every cached EGLImage and texture.
+     */
+    void clear();
+
+    EGLImageCacheStats getStats() const;
+
+private:
+    struct Entry {
+        AHardwareBuffer *buffer;
+        EGLImageKHR image;
+        GLuint texture;
+        GLenum target;
+        uint64_t lastUse;
+    };
+
+    EGLImageCache(EGLDisplay display, size_t capacity,
+                  PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC getNativeClientBuffer,
+                  PFNEGLCREATEIMAGEKHRPROC createImage, PFNEGLDESTROYIMAGEKHRPROC destroyImage,
+                  PFNGLEGLIMAGETARGETTEXTURE2DOESPROC imageTargetTexture);
+
+    void releaseEntry(Entry &entry);
+
+    const EGLDisplay mDisplay;
+    const size_t mCapacity;
+    const PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC mGetNativeClientBuffer;
+    const PFNEGLCREATEIMAGEKHRPROC mCreateImage;
+    const PFNEGLDESTROYIMAGEKHRPROC mDestroyImage;
+    const PFNGLEGLIMAGETARGETTEXTURE2DOESPROC mImageTargetTexture;
+
+    /** Most caches hold a handful of buffers, for which a linear scan beats a hash map */
+    std::vector<Entry> mEntries;
+    uint64_t mUseCount = 0;
+    EGLImageCacheStats mStats{};
+};
+
+#endif //ANDROIDX_EGL_IMAGE_CACHE_H
@@ -26,7 +26,9 @@
 #include <android/sync.h>
 #include <android/hardware_buffer_jni.h>
 #include <mutex>
+#include "egl_image_cache.h"
 #include "egl_utils.h"
+#include "hardware_buffer_pool.h"
 
 #define EGL_UTILS "EglUtils"
 #define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, EGL_UTILS, __VA_ARGS__)
@@ -512,6 +514,92 @@ jboolean EGLBindings_nEqualToNativeForeverTimeout(JNIEnv *env, jclass, jlong tim
     return static_cast<EGLTimeKHR>(timeout_nanos) == EGL_FOREVER_KHR;
 }
 
+jlong EGLImageCache_nCreate(JNIEnv *env, jclass, jlong egl_display_ptr, jint capacity) {
+    if (capacity <= 0) {
+        return 0;
+    }
+    auto display = reinterpret_cast<EGLDisplay>(egl_display_ptr);
+    return reinterpret_cast<jlong>(EGLImageCache::create(display, static_cast<size_t>(capacity)));
+}
+
+jint EGLImageCache_nGetTexture(JNIEnv *env, jclass, jlong cache, jobject hardware_buffer,
+                               jint target) {
+    AHardwareBuffer *buffer = AHardwareBuffer_fromHardwareBuffer(env, hardware_buffer);
+    return static_cast<jint>(reinterpret_cast<EGLImageCache *>(cache)->getTexture(
+            buffer, static_cast<GLenum>(target)));
+}
+
+jboolean EGLImageCache_nEvict(JNIEnv *env, jclass, jlong cache, jobject hardware_buffer) {
+    AHardwareBuffer *buffer = AHardwareBuffer_fromHardwareBuffer(env, hardware_buffer);
+    return static_cast<jboolean>(reinterpret_cast<EGLImageCache *>(cache)->evict(buffer));
+}
+
+static bool isPooled(void *pool, AHardwareBuffer *buffer) {
+    return pool != nullptr && reinterpret_cast<HardwareBufferPool *>(pool)->contains(buffer);
+}
+
+jint EGLImageCache_nEvictUnpooled(JNIEnv *env, jclass, jlong cache, jlong pool) {
+    return static_cast<jint>(reinterpret_cast<EGLImageCache *>(cache)->evictUnless(
+            isPooled, reinterpret_cast<void *>(pool)));
+}
+
+void EGLImageCache_nClear(JNIEnv *env, jclass, jlong cache) {
+    reinterpret_cast<EGLImageCache *>(cache)->clear();
+}
+
+void EGLImageCache_nGetStats(JNIEnv *env, jclass, jlong cache, jlongArray out) {
+    if (env->GetArrayLength(out) < static_cast<jsize>(EGL_IMAGE_CACHE_STATS_FIELDS)) {
+        return;
+    }
+    EGLImageCacheStats stats = reinterpret_cast<EGLImageCache *>(cache)->getStats();
+    const jlong fields[EGL_IMAGE_CACHE_STATS_FIELDS] = {
+            stats.hits, stats.misses, stats.evictions, stats.size
+    };
+    env->SetLongArrayRegion(out, 0, EGL_IMAGE_CACHE_STATS_FIELDS, fields);
+}
+
+void EGLImageCache_nDestroy(JNIEnv *env, jclass, jlong cache) {
+    EGLImageCache::destroy(reinterpret_cast<EGLImageCache *>(cache));
+}
+
+static const JNINativeMethod EGL_IMAGE_CACHE_METHOD_TABLE[] = {
+        {
+            "nCreate",
+            "(JI)J",
+            (void*)EGLImageCache_nCreate
+        },
+        {
+            "nGetTexture",
+            "(JLandroid/hardware/HardwareBuffer;I)I",
+            (void*)EGLImageCache_nGetTexture
+        },
+        {
+            "nEvict",
+            "(JLandroid/hardware/HardwareBuffer;)Z",
+            (void*)EGLImageCache_nEvict
+        },
+        {
+            "nEvictUnpooled",
+            "(JJ)I",
+            (void*)EGLImageCache_nEvictUnpooled
+        },
+        {
+            "nClear",
+            "(J)V",
+            (void*)EGLImageCache_nClear
+        },
+        {
+            "nGetStats",
+            "(J[J)V",
+            (void*)EGLImageCache_nGetStats
+        },
+        {
+            "nDestroy",
+            "(J)V",
+            (void*)EGLImageCache_nDestroy
+        }
+};
+
 static const JNINativeMethod EGL_METHOD_TABLE[] = {
         {
             "nCreateImageFromHardwareBuffer",
@@ -614,5 +702,14 @@ jint loadEGLMethods(JNIEnv* env) {
                              sizeof(EGL_METHOD_TABLE) / sizeof(JNINativeMethod)) != JNI_OK) {
         return JNI_ERR;
     }
+    jclass eglImageCacheClass = env->FindClass("androidx/graphics/opengl/EGLImageCache");
+    if (eglImageCacheClass == nullptr) {
+        return JNI_ERR;
+    }
+    if (env->RegisterNatives(eglImageCacheClass, EGL_IMAGE_CACHE_METHOD_TABLE,
+                             sizeof(EGL_IMAGE_CACHE_METHOD_TABLE) / sizeof(JNINativeMethod)) !=
+        JNI_OK) {
+        return JNI_ERR;
+    }
     return JNI_OK;
 }
\ No newline at end of file
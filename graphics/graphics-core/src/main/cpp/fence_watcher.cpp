@@ -0,0 +1,261 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FenceWatcher"
+
+#include "fence_watcher.h"
+#include <android/log.h>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+/**
+ * epoll user data of the eventfd used to wake up the watcher thread. Registration ids start at 1.
+ */
+static constexpr uint64_t WAKE_ID = 0;
+
+/**
+ * Maximum number of file descriptors reported by a single epoll_wait call. Any remaining ready
+ * file descriptors are reported by the next call, which returns immediately.
+ */
+static constexpr int MAX_EPOLL_EVENTS = 32;
+
+static constexpr int64_t NANOS_PER_MILLI = 1000000LL;
+
+int64_t FenceWatcher::now() {
+    struct timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+
+FenceWatcher *FenceWatcher::create(const FenceWatcherCallbacks &callbacks) {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        ALOGE("Unable to create epoll set: %d", errno);
+        return nullptr;
+    }
+    int wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0) {
+        ALOGE("Unable to create eventfd: %d", errno);
+        close(epollFd);
+        return nullptr;
+    }
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_ID;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) != 0) {
+        ALOGE("Unable to watch eventfd: %d", errno);
+        close(wakeFd);
+        close(epollFd);
+        return nullptr;
+    }
+    auto watcher = new FenceWatcher(callbacks, epollFd, wakeFd);
+    watcher->mThread = std::thread(&FenceWatcher::run, watcher);
+    return watcher;
+}
+
+void FenceWatcher::destroy(FenceWatcher *watcher) {
+    if (watcher == nullptr) {
+        return;
+    }
+    if (std::this_thread::get_id() == watcher->mThread.get_id()) {
+        // Called from onEvents, the thread releases the watcher once the callback returns
+        watcher->mDeleteOnExit = true;
+        watcher->mStopping = true;
+        return;
+    }
+    watcher->mStopping = true;
+    watcher->wake();
+    watcher->mThread.join();
+    delete watcher;
+}
+
+FenceWatcher::FenceWatcher(const FenceWatcherCallbacks &callbacks, int epollFd, int wakeFd)
+        : mCallbacks(callbacks), mEpollFd(epollFd), mWakeFd(wakeFd) {}
+
+FenceWatcher::~FenceWatcher() {
+    close(mWakeFd);
+    close(mEpollFd);
+}
+
+bool FenceWatcher::watch(int fd, int64_t token, int64_t deadlineNanos) {
+    if (fd < 0) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        uint64_t id = mNextId++;
+        struct epoll_event event{};
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = id;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ALOGE("Unable to watch fd %d: %d", fd, errno);
+            close(fd);
+            return false;
+        }
+        mRegistrations.push_back(Registration{id, fd, token, deadlineNanos});
+    }
+    // The epoll set picks up the new file descriptor by itself, only a deadline requires the
+    // thread to recompute its timeout
+    if (deadlineNanos >= 0) {
+        wake();
+    }
+    return true;
+}
+
+bool FenceWatcher::cancel(int64_t token) {
+    std::lock_guard<std::mutex> lock(mLock);
+    bool found = false;
+    for (auto it = mRegistrations.begin(); it != mRegistrations.end();) {
+        if (it->token == token) {
+            closeRegistration(*it);
+            it = mRegistrations.erase(it);
+            found = true;
+        } else {
+            ++it;
+        }
+    }
+    return found;
+}
+
+size_t FenceWatcher::pendingCount() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mRegistrations.size();
+}
+
+void FenceWatcher::wake() {
+    uint64_t value = 1;
+    ssize_t ret;
+    do {
+        ret = write(mWakeFd, &value, sizeof(value));
+    } while (ret < 0 && errno == EINTR);
+}
+
+int FenceWatcher::computeTimeoutMillis() {
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t deadline = INT64_MAX;
+    for (const auto &registration : mRegistrations) {
+        if (registration.deadline >= 0 && registration.deadline < deadline) {
+            deadline = registration.deadline;
+        }
+    }
+    if (deadline == INT64_MAX) {
+        return -1;
+    }
+    int64_t remaining = deadline - now();
+    if (remaining <= 0) {
+        return 0;
+    }
+    // Round up so the deadline has passed when epoll_wait times out
+    int64_t millis = (remaining + NANOS_PER_MILLI - 1) / NANOS_PER_MILLI;
+    return millis > INT_MAX ? INT_MAX : static_cast<int>(millis);
+}
+
+bool FenceWatcher::takeRegistration(uint64_t id, Registration *out) {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto it = mRegistrations.begin(); it != mRegistrations.end(); ++it) {
+        if (it->id == id) {
+            *out = *it;
+            mRegistrations.erase(it);
+            return true;
+        }
+    }
+    // Cancelled after epoll_wait reported it
+    return false;
+}
+
+void FenceWatcher::closeRegistration(const Registration &registration) {
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, registration.fd, nullptr);
+    close(registration.fd);
+}
+
+void FenceWatcher::run() {
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    std::vector<FenceWatcherEvent> batch;
+    while (!mStopping) {
+        int count = epoll_wait(mEpollFd, events, MAX_EPOLL_EVENTS, computeTimeoutMillis());
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("epoll_wait failed: %d", errno);
+            break;
+        }
+
+        int64_t observedTime = now();
+        batch.clear();
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.u64 == WAKE_ID) {
+                uint64_t value;
+                while (read(mWakeFd, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            Registration registration{};
+            if (!takeRegistration(events[i].data.u64, &registration)) {
+                continue;
+            }
+            FenceWatcherEvent event{registration.token, FENCE_SIGNALED, observedTime};
+            if ((events[i].events & EPOLLERR) || !(events[i].events & EPOLLIN)) {
+                event.status = FENCE_ERROR;
+                event.signalTime = -1;
+            } else if (mCallbacks.resolveSignalTime != nullptr) {
+                int64_t signalTime = mCallbacks.resolveSignalTime(registration.fd);
+                if (signalTime >= 0 && signalTime != INT64_MAX) {
+                    event.signalTime = signalTime;
+                }
+            }
+            closeRegistration(registration);
+            batch.push_back(event);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            for (auto it = mRegistrations.begin(); it != mRegistrations.end();) {
+                if (it->deadline >= 0 && it->deadline <= observedTime) {
+                    batch.push_back(FenceWatcherEvent{it->token, FENCE_TIMED_OUT, -1});
+                    closeRegistration(*it);
+                    it = mRegistrations.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        if (!batch.empty() && !mStopping) {
+            mCallbacks.onEvents(mCallbacks.context, batch.data(), batch.size());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const auto &registration : mRegistrations) {
+            closeRegistration(registration);
+        }
+        mRegistrations.clear();
+    }
+    if (mCallbacks.onThreadExit != nullptr) {
+        mCallbacks.onThreadExit(mCallbacks.context);
+    }
+    if (mDeleteOnExit) {
+        mThread.detach();
+        delete this;
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_FENCE_WATCHER_H
+#define ANDROIDX_FENCE_WATCHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum FenceWatcherStatus : int32_t {
+    FENCE_SIGNALED = 0,
+    FENCE_TIMED_OUT = 1,
+    FENCE_ERROR = 2
+};
+
+/**
+ * Outcome of a fence registered with FenceWatcher::watch.
+ */
+struct FenceWatcherEvent {
+    int64_t token;
+    FenceWatcherStatus status;
+    /**
+     * Time the fence signaled in the CLOCK_MONOTONIC time domain. Only meaningful if status is
+     * FENCE_SIGNALED.
+     */
+    int64_t signalTime;
+};
+
+struct FenceWatcherCallbacks {
+    void *context;
+    /**
+     * Invoked on the watcher thread with every fence resolved during one wake up of the thread.
+     */
+    void (*onEvents)(void *context, const FenceWatcherEvent *events, size_t count);
+    /**
+     * Optional, invoked on the watcher thread right before it exits. The watcher does not access
+     * the context afterwards.
+     */
+    void (*onThreadExit)(void *context);
+    /**
+     * Optional, resolves the signal time of a signaled fence. A negative value or INT64_MAX
+     * means the time is unknown, in which case the time the watcher observed the fence signal is
+     * reported instead. This allows any pollable file descriptor, such as an eventfd, to stand in
+     * for a sync_file.
+     */
+    int64_t (*resolveSignalTime)(int fd);
+};
+
+/**
+ * Waits for any number of fence file descriptors on a single background thread through an epoll
+ * set, instead of blocking one thread per fence in poll.
+ */
+class FenceWatcher {
+public:
+    /**
+     * Starts the watcher thread. Returns nullptr if the epoll set cannot be created.
+     */
+    static FenceWatcher *create(const FenceWatcherCallbacks &callbacks);
+
+    /**
+     * Stops the watcher thread and closes the file descriptors still being watched, without
+     * reporting them. Safe to call from within onEvents, in which case the watcher is released
+     * once the callback returns.
+     */
+    static void destroy(FenceWatcher *watcher);
+
+    /**
+     * Watches the file descriptor until it becomes readable, which is when a sync_file signals,
+     * or until deadlineNanos in the CLOCK_MONOTONIC time domain if it is not negative. The watcher
+     * takes ownership of fd and closes it once its event is reported, or right away if it cannot
+     * be watched, in which case false is returned.
+     */
+    bool watch(int fd, int64_t token, int64_t deadlineNanos);
+
+    /**
+     * Stops watching every fence registered with the token and closes them without reporting
+     * them. Returns false if no such fence is still being watched.
+     */
+    bool cancel(int64_t token);
+
+    /**
+     * Number of fences still being watched.
+     */
+    size_t pendingCount();
+
+    static int64_t now();
+
+private:
+    struct Registration {
+        uint64_t id;
+        int fd;
+        int64_t token;
+        int64_t deadline;
+    };
+
+    FenceWatcher(const FenceWatcherCallbacks &callbacks, int epollFd, int wakeFd);
+    ~FenceWatcher();
+
+    void wake();
+    void run();
+    int computeTimeoutMillis();
+    bool takeRegistration(uint64_t id, Registration *out);
+    void closeRegistration(const Registration &registration);
+
+    const FenceWatcherCallbacks mCallbacks;
+    const int mEpollFd;
+    const int mWakeFd;
+
+    std::mutex mLock;
+    std::vector<Registration> mRegistrations;
+    uint64_t mNextId = 1;
+
+    std::atomic<bool> mStopping{false};
+    std::atomic<bool> mDeleteOnExit{false};
+    std::thread mThread;
+};
+
+#endif //ANDROIDX_FENCE_WATCHER_H
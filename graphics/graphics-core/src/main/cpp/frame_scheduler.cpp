@@ -0,0 +1,230 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "frame_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+#include "present_fence_watcher.h"
+
+/** Minimum number of distinct vsyncs fitted before the fitted period replaces the hint */
+static constexpr size_t MIN_FIT_SAMPLES = 6;
+
+/**
+ * Present times more than this many vsyncs before the latest one are not fitted, as numbering the
+ * vsyncs in between with the period hint would accumulate its error.
+ */
+static constexpr int64_t MAX_FIT_VSYNCS = 120;
+
+/**
+ * Latencies longer than this many vsyncs, such as those of a frame stuck behind a slow GPU, are
+ * not tracked so that a single hiccup does not delay the following frames.
+ */
+static constexpr int64_t MAX_LATENCY_VSYNCS = 4;
+
+/** Latch time of a transaction whose present fence is pending */
+struct PendingLatchTime {
+    FrameScheduler *scheduler;
+    int64_t latchTime;
+};
+
+FrameScheduler *FrameScheduler::create(int64_t vsyncPeriodHint, int64_t (*clock)(),
+                                       int64_t (*resolveSignalTime)(int fd)) {
+    if (vsyncPeriodHint <= 0 || clock == nullptr) {
+        return nullptr;
+    }
+    return new FrameScheduler(vsyncPeriodHint, clock, resolveSignalTime);
+}
+
+FrameScheduler::FrameScheduler(int64_t vsyncPeriodHint, int64_t (*clock)(),
+                               int64_t (*resolveSignalTime)(int fd))
+        : mClock(clock),
+          mResolveSignalTime(resolveSignalTime),
+          mVsyncPeriodHint(vsyncPeriodHint),
+          mVsyncPeriod(vsyncPeriodHint) {}
+
+void FrameScheduler::setVsyncPeriodHint(int64_t vsyncPeriodHint) {
+    if (vsyncPeriodHint <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    mVsyncPeriodHint = vsyncPeriodHint;
+    clearHistory();
+}
+
+void FrameScheduler::addPresentTime(int64_t latchTime, int64_t presentTime) {
+    if (presentTime < 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    if (latchTime >= 0 && presentTime >= latchTime &&
+        presentTime - latchTime <= MAX_LATENCY_VSYNCS * mVsyncPeriodHint) {
+        mLatencies[mNextLatency] = presentTime - latchTime;
+        mNextLatency = (mNextLatency + 1) % HISTORY_SIZE;
+        mLatencyCount = std::min(mLatencyCount + 1, HISTORY_SIZE);
+    }
+    // Transactions presented on the same vsync share their present fence
+    size_t previous = (mNextPresentTime + HISTORY_SIZE - 1) % HISTORY_SIZE;
+    if (mPresentTimeCount > 0 && mPresentTimes[previous] == presentTime) {
+        return;
+    }
+    mPresentTimes[mNextPresentTime] = presentTime;
+    mNextPresentTime = (mNextPresentTime + 1) % HISTORY_SIZE;
+    mPresentTimeCount = std::min(mPresentTimeCount + 1, HISTORY_SIZE);
+    updateModel();
+}
+
+void FrameScheduler::addPresentFence(int64_t latchTime, int presentFenceFd) {
+    if (presentFenceFd < 0) {
+        return;
+    }
+    int64_t signalTime = mResolveSignalTime != nullptr ? mResolveSignalTime(presentFenceFd) : -1;
+    if (signalTime != INT64_MAX) {
+        close(presentFenceFd);
+        addPresentTime(latchTime, signalTime);
+        return;
+    }
+    auto pending = new PendingLatchTime{this, latchTime};
+    acquire();
+    if (!PresentFenceWatcher::watch(presentFenceFd, onPresented, pending)) {
+        onPresented(pending, -1);
+    }
+}
+
+void FrameScheduler::onPresented(void *context, int64_t presentTime) {
+    auto pending = reinterpret_cast<PendingLatchTime *>(context);
+    pending->scheduler->addPresentTime(pending->latchTime, presentTime);
+    pending->scheduler->release();
+    delete pending;
+}
+
+void FrameScheduler::updateModel() {
+    mVsyncPeriod = mVsyncPeriodHint;
+    if (mPresentTimeCount == 0) {
+        mVsyncAnchor = -1;
+        return;
+    }
+    int64_t samples[HISTORY_SIZE];
+    std::copy(mPresentTimes, mPresentTimes + mPresentTimeCount, samples);
+    // Fences resolved by the watcher may be added out of order
+    std::sort(samples, samples + mPresentTimeCount);
+    const int64_t latest = samples[mPresentTimeCount - 1];
+    mVsyncAnchor = latest;
+
+    // Number each present time by the vsyncs since the latest one and fit time = a + b * vsync
+    const double period = static_cast<double>(mVsyncPeriodHint);
+    size_t n = 0;
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    int64_t previousVsync = INT64_MIN;
+    for (size_t i = 0; i < mPresentTimeCount; i++) {
+        auto offset = static_cast<double>(samples[i] - latest);
+        auto vsync = static_cast<int64_t>(std::llround(offset / period));
+        if (vsync < -MAX_FIT_VSYNCS || vsync == previousVsync ||
+            std::fabs(offset - static_cast<double>(vsync) * period) > period / 4) {
+            continue;
+        }
+        previousVsync = vsync;
+        auto x = static_cast<double>(vsync);
+        sumX += x;
+        sumY += offset;
+        sumXX += x * x;
+        sumXY += x * offset;
+        n++;
+    }
+    if (n < MIN_FIT_SAMPLES) {
+        return;
+    }
+    double varianceX = sumXX - sumX * sumX / n;
+    if (varianceX <= 0) {
+        return;
+    }
+    double slope = (sumXY - sumX * sumY / n) / varianceX;
+    double intercept = (sumY - slope * sumX) / n;
+    // A fit this far off the hint means the refresh rate changed without the hint being updated
+    if (std::fabs(slope - period) > period / 10) {
+        return;
+    }
+    mVsyncPeriod = std::llround(slope);
+    mVsyncAnchor = latest + std::llround(intercept);
+}
+
+int64_t FrameScheduler::nextVsync(int64_t time) const {
+    if (mVsyncAnchor < 0) {
+        return time;
+    }
+    int64_t delta = time - mVsyncAnchor;
+    // Rounds towards zero, which is already the ceiling for negative deltas
+    int64_t vsyncs = delta / mVsyncPeriod;
+    if (vsyncs * mVsyncPeriod < delta) {
+        vsyncs++;
+    }
+    return mVsyncAnchor + vsyncs * mVsyncPeriod;
+}
+
+int64_t FrameScheduler::compositorLatency() const {
+    if (mLatencyCount == 0) {
+        return mVsyncPeriod;
+    }
+    return *std::max_element(mLatencies, mLatencies + mLatencyCount);
+}
+
+size_t FrameScheduler::predictVsyncs(int64_t *out, size_t count) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mVsyncAnchor < 0) {
+        return 0;
+    }
+    int64_t vsync = nextVsync(mClock());
+    for (size_t i = 0; i < count; i++) {
+        out[i] = vsync;
+        vsync += mVsyncPeriod;
+    }
+    return count;
+}
+
+FrameSchedule FrameScheduler::schedule(int64_t workDuration) {
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t work = std::max<int64_t>(workDuration, 0);
+    int64_t latency = compositorLatency();
+    FrameSchedule schedule{};
+    schedule.vsyncPeriod = mVsyncPeriod;
+    schedule.desiredPresentTime = nextVsync(mClock() + work + latency);
+    schedule.commitDeadline = schedule.desiredPresentTime - latency;
+    schedule.startTime = schedule.commitDeadline - work;
+    return schedule;
+}
+
+int64_t FrameScheduler::getVsyncPeriod() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mVsyncPeriod;
+}
+
+int64_t FrameScheduler::getCompositorLatency() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return compositorLatency();
+}
+
+void FrameScheduler::reset() {
+    std::lock_guard<std::mutex> lock(mLock);
+    clearHistory();
+}
+
+void FrameScheduler::clearHistory() {
+    mPresentTimeCount = 0;
+    mNextPresentTime = 0;
+    mLatencyCount = 0;
+    mNextLatency = 0;
+    updateModel();
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_FRAME_SCHEDULER_H
+#define ANDROIDX_FRAME_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "ref_counted.h"
+
+/**
+ * When to render a frame and which present time to request for it, in nanoseconds in the time
+ * domain of the scheduler clock.
+ */
+struct FrameSchedule {
+    /** Time to start rendering the frame so that it is committed by commitDeadline */
+    int64_t startTime;
+    /** Latest time to apply the transaction for it to be latched in time for desiredPresentTime */
+    int64_t commitDeadline;
+    /** Predicted vsync to pass to ASurfaceTransaction_setDesiredPresentTime */
+    int64_t desiredPresentTime;
+    int64_t vsyncPeriod;
+};
+
+/** Number of int64_t fields of FrameSchedule, used to copy a schedule to Java */
+static constexpr size_t FRAME_SCHEDULE_FIELDS = 4;
+
+/**
+ * Predicts the vsync deadlines of the display from the present times of recent transactions, so
+ * that callers know when to start rendering a frame and which present time to request for it.
+ *
+ * Present fences signal on vsync, so the present times are fitted to a line by least squares to
+ * average out their jitter, with the vsync period hint used to number the vsyncs between them.
+ * The time from latching a transaction until it is presented is tracked as well, it is how long
+ * before a vsync a transaction must be committed to be presented on it. Until enough frames were
+ * presented, the hint is used as is and frames are scheduled to start right away.
+ *
+ * The scheduler is reference counted as transaction callbacks may outlive its owner.
+ */
+class FrameScheduler : public RefCounted<FrameScheduler> {
+public:
+    /**
+     * @param vsyncPeriodHint Expected vsync period, such as the one of the refresh rate of the
+     * display. Present times further than a quarter of it from the fitted vsyncs are ignored.
+     * @param clock Returns the current time in the CLOCK_MONOTONIC time domain, or a fake time for
+     * tests
+     * @param resolveSignalTime Resolves the signal time of a fence, returning INT64_MAX if it is
+     * pending or a negative value on error. Pending fences are handed to PresentFenceWatcher.
+     */
+    static FrameScheduler *create(int64_t vsyncPeriodHint, int64_t (*clock)(),
+                                  int64_t (*resolveSignalTime)(int fd));
+
+    /**
+     * Replaces the vsync period hint, such as when the refresh rate of the display changes, and
+     * drops the present times fitted so far.
+     */
+    void setVsyncPeriodHint(int64_t vsyncPeriodHint);
+
+    /**
+     * Adds the latch and present time of a presented transaction. Either is ignored if negative.
+     */
+    void addPresentTime(int64_t latchTime, int64_t presentTime);
+
+    /**
+     * Adds the present time of a transaction once presentFenceFd signals. Takes ownership of
+     * presentFenceFd. A pending fence holds a reference to the scheduler until it signals.
+     */
+    void addPresentFence(int64_t latchTime, int presentFenceFd);
+
+    /**
+     * Writes up to count predicted vsync times, starting with the first one after now, and
+     * returns the number written. Returns 0 until a present time was added.
+     */
+    size_t predictVsyncs(int64_t *out, size_t count);
+
+    /**
+     * Schedules the next frame that can be presented if rendering it takes workDuration, starting
+     * no earlier than now.
+     */
+    FrameSchedule schedule(int64_t workDuration);
+
+    int64_t getVsyncPeriod();
+
+    /**
+     * Time from latching a transaction until it is presented, the largest of the recent frames, or
+     * the vsync period if none was presented yet.
+     */
+    int64_t getCompositorLatency();
+
+    /**
+     * Drops the present times added so far.
+     */
+    void reset();
+
+private:
+    friend class RefCounted<FrameScheduler>;
+
+    /** Number of most recent present times fitted */
+    static constexpr size_t HISTORY_SIZE = 20;
+
+    FrameScheduler(int64_t vsyncPeriodHint, int64_t (*clock)(),
+                   int64_t (*resolveSignalTime)(int fd));
+    ~FrameScheduler() = default;
+
+    /** Called with mLock held */
+    void clearHistory();
+    /** Called with mLock held */
+    void updateModel();
+    /** Called with mLock held, returns the first predicted vsync at or after time */
+    int64_t nextVsync(int64_t time) const;
+    /** Called with mLock held */
+    int64_t compositorLatency() const;
+    static void onPresented(void *context, int64_t presentTime);
+
+    int64_t (*const mClock)();
+    int64_t (*const mResolveSignalTime)(int fd);
+
+    std::mutex mLock;
+    int64_t mVsyncPeriodHint;
+    int64_t mPresentTimes[HISTORY_SIZE]{};
+    size_t mPresentTimeCount = 0;
+    int64_t mLatencies[HISTORY_SIZE]{};
+    size_t mLatencyCount = 0;
+    /** Index of the next present time and latency written, wrapping around */
+    size_t mNextPresentTime = 0;
+    size_t mNextLatency = 0;
+
+    /** Fitted vsync period and the fitted vsync of the latest present time, or -1 */
+    int64_t mVsyncPeriod;
+    int64_t mVsyncAnchor = -1;
+};
+
+#endif //ANDROIDX_FRAME_SCHEDULER_H
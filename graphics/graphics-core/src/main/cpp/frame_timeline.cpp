@@ -0,0 +1,212 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "frame_timeline.h"
+#include <algorithm>
+#include <android/api-level.h>
+#include <android/trace.h>
+#include <unistd.h>
+#include <vector>
+#include "present_fence_watcher.h"
+
+static constexpr size_t MIN_CAPACITY = 16;
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = MIN_CAPACITY;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static void toFields(const FrameTimelineRecord &record, int64_t *fields) {
+    fields[0] = record.frameId;
+    fields[1] = record.desiredPresentTime;
+    fields[2] = record.commitTime;
+    fields[3] = record.latchTime;
+    fields[4] = record.acquireTime;
+    fields[5] = record.presentTime;
+    fields[6] = record.completeTime;
+}
+
+static void fromFields(const int64_t *fields, FrameTimelineRecord *record) {
+    record->frameId = fields[0];
+    record->desiredPresentTime = fields[1];
+    record->commitTime = fields[2];
+    record->latchTime = fields[3];
+    record->acquireTime = fields[4];
+    record->presentTime = fields[5];
+    record->completeTime = fields[6];
+}
+
+/**
+ * Nearest rank percentile of values, which must be sorted, or -1 if there are none.
+ */
+static int64_t percentile(const std::vector<int64_t> &values, int percent) {
+    if (values.empty()) {
+        return -1;
+    }
+    size_t rank = (values.size() * percent + 99) / 100;
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+/** Record of a transaction whose present fence is pending */
+struct PendingRecord {
+    FrameTimelineRecorder *recorder;
+    FrameTimelineRecord record;
+};
+
+FrameTimelineRecorder *FrameTimelineRecorder::create(size_t capacity, const char *traceName,
+                                                     int64_t (*resolveSignalTime)(int fd)) {
+    return new FrameTimelineRecorder(capacity, traceName, resolveSignalTime);
+}
+
+FrameTimelineRecorder::FrameTimelineRecorder(size_t capacity, const char *traceName,
+                                             int64_t (*resolveSignalTime)(int fd))
+        : mCapacity(roundUpToPowerOfTwo(capacity)),
+          mSlots(new Slot[mCapacity]),
+          mTrace(traceName != nullptr),
+          mLatencyCounter(std::string(traceName != nullptr ? traceName : "") + " latency"),
+          mPresentDelayCounter(
+                  std::string(traceName != nullptr ? traceName : "") + " present delay"),
+          mResolveSignalTime(resolveSignalTime) {}
+
+void FrameTimelineRecorder::record(const FrameTimelineRecord &record, int presentFenceFd) {
+    FrameTimelineRecord resolved = record;
+    if (presentFenceFd >= 0) {
+        int64_t signalTime = mResolveSignalTime != nullptr ? mResolveSignalTime(presentFenceFd)
+                                                           : -1;
+        if (signalTime == INT64_MAX) {
+            auto pending = new PendingRecord{this, record};
+            acquire();
+            if (!PresentFenceWatcher::watch(presentFenceFd, onPresented, pending)) {
+                onPresented(pending, -1);
+            }
+            return;
+        }
+        close(presentFenceFd);
+        resolved.presentTime = signalTime < 0 ? -1 : signalTime;
+    }
+    publish(resolved);
+}
+
+void FrameTimelineRecorder::onPresented(void *context, int64_t presentTime) {
+    auto pending = reinterpret_cast<PendingRecord *>(context);
+    pending->record.presentTime = presentTime;
+    pending->recorder->publish(pending->record);
+    pending->recorder->release();
+    delete pending;
+}
+
+void FrameTimelineRecorder::publish(const FrameTimelineRecord &record) {
+    int64_t fields[FRAME_TIMELINE_RECORD_FIELDS];
+    toFields(record, fields);
+
+    uint64_t index = mWriteIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = mSlots[index & (mCapacity - 1)];
+    // Seqlock write, readers discard the slot if its sequence changes while they copy it
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < FRAME_TIMELINE_RECORD_FIELDS; i++) {
+        slot.fields[i].store(fields[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+    traceCounters(record);
+}
+
+void FrameTimelineRecorder::traceCounters(const FrameTimelineRecord &record) {
+    if (!mTrace || android_get_device_api_level() < 29 || !ATrace_isEnabled()) {
+        return;
+    }
+    if (record.presentTime >= 0 && record.commitTime >= 0) {
+        ATrace_setCounter(mLatencyCounter.c_str(), record.presentTime - record.commitTime);
+    }
+    if (record.presentTime >= 0 && record.desiredPresentTime > 0) {
+        ATrace_setCounter(mPresentDelayCounter.c_str(),
+                          record.presentTime - record.desiredPresentTime);
+    }
+}
+
+size_t FrameTimelineRecorder::copyRecords(FrameTimelineRecord *out, size_t maxCount) {
+    uint64_t end = mWriteIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > mCapacity ? end - mCapacity : 0;
+    begin = std::max(begin, mResetIndex.load(std::memory_order_relaxed));
+    if (end - begin > maxCount) {
+        begin = end - maxCount;
+    }
+
+    size_t count = 0;
+    int64_t fields[FRAME_TIMELINE_RECORD_FIELDS];
+    for (uint64_t index = begin; index < end; index++) {
+        Slot &slot = mSlots[index & (mCapacity - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            // Still being written or already overwritten
+            continue;
+        }
+        for (size_t i = 0; i < FRAME_TIMELINE_RECORD_FIELDS; i++) {
+            fields[i] = slot.fields[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        fromFields(fields, &out[count++]);
+    }
+    return count;
+}
+
+FrameTimelineSummary FrameTimelineRecorder::summarize(int64_t deadlineToleranceNanos) {
+    std::vector<FrameTimelineRecord> records(mCapacity);
+    records.resize(copyRecords(records.data(), records.size()));
+
+    FrameTimelineSummary summary{};
+    summary.frameCount = static_cast<int64_t>(records.size());
+    std::vector<int64_t> latencies;
+    std::vector<int64_t> presentDelays;
+    for (const auto &record : records) {
+        if (record.presentTime < 0) {
+            summary.unknownPresentCount++;
+            continue;
+        }
+        if (record.commitTime >= 0) {
+            latencies.push_back(record.presentTime - record.commitTime);
+        }
+        if (record.desiredPresentTime > 0) {
+            int64_t delay = record.presentTime - record.desiredPresentTime;
+            presentDelays.push_back(delay);
+            if (delay > deadlineToleranceNanos) {
+                summary.missedDeadlineCount++;
+            }
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(presentDelays.begin(), presentDelays.end());
+    summary.latencyP50 = percentile(latencies, 50);
+    summary.latencyP90 = percentile(latencies, 90);
+    summary.latencyP99 = percentile(latencies, 99);
+    summary.latencyMax = percentile(latencies, 100);
+    summary.presentDelayP50 = percentile(presentDelays, 50);
+    summary.presentDelayP90 = percentile(presentDelays, 90);
+    summary.presentDelayP99 = percentile(presentDelays, 99);
+    summary.presentDelayMax = percentile(presentDelays, 100);
+    return summary;
+}
+
+void FrameTimelineRecorder::reset() {
+    mResetIndex.store(mWriteIndex.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
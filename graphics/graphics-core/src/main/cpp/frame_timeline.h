@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_FRAME_TIMELINE_H
+#define ANDROIDX_FRAME_TIMELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "ref_counted.h"
+
+/**
+ * Timestamps of one transaction, in nanoseconds in the CLOCK_MONOTONIC time domain. Timestamps
+ * that are not known are -1.
+ */
+struct FrameTimelineRecord {
+    /** Caller provided identifier of the frame, such as a frame number */
+    int64_t frameId;
+    /** Present time requested through ASurfaceTransaction_setDesiredPresentTime */
+    int64_t desiredPresentTime;
+    /** Time the transaction was applied */
+    int64_t commitTime;
+    /** Time SurfaceFlinger latched the transaction */
+    int64_t latchTime;
+    /** Time the acquire fence of the buffer of the tracked surface control signaled */
+    int64_t acquireTime;
+    /** Time the present fence signaled, that is when the frame reached the display */
+    int64_t presentTime;
+    /** Time the transaction completed callback was invoked */
+    int64_t completeTime;
+};
+
+/** Number of int64_t fields of FrameTimelineRecord, used to copy records to Java */
+static constexpr size_t FRAME_TIMELINE_RECORD_FIELDS = 7;
+
+struct FrameTimelineSummary {
+    int64_t frameCount;
+    /** Frames with a desired present time that were presented later than it plus the tolerance */
+    int64_t missedDeadlineCount;
+    /** Frames whose present time could not be resolved */
+    int64_t unknownPresentCount;
+    /** Percentiles of present time minus commit time */
+    int64_t latencyP50;
+    int64_t latencyP90;
+    int64_t latencyP99;
+    int64_t latencyMax;
+    /** Percentiles of present time minus desired present time, for frames with one */
+    int64_t presentDelayP50;
+    int64_t presentDelayP90;
+    int64_t presentDelayP99;
+    int64_t presentDelayMax;
+};
+
+/** Number of int64_t fields of FrameTimelineSummary, used to copy a summary to Java */
+static constexpr size_t FRAME_TIMELINE_SUMMARY_FIELDS = 11;
+
+/**
+ * Records the timeline of the last capacity transactions into a ring buffer. Records are
+ * published without locks, so the transaction completed callbacks are never blocked by readers.
+ * A record whose present fence has not signaled yet when the transaction completes is published
+ * once the fence signals. The recorder is reference counted as transaction callbacks may outlive
+ * its owner.
+ */
+class FrameTimelineRecorder : public RefCounted<FrameTimelineRecorder> {
+public:
+    /**
+     * @param capacity Number of records kept, rounded up to a power of two
+     * @param traceName If not null, latency counters prefixed with this name are emitted to
+     * systrace and Perfetto while tracing is enabled
+     * @param resolveSignalTime Resolves the signal time of a fence, returning INT64_MAX if it is
+     * pending or a negative value on error. Pending fences are handed to PresentFenceWatcher.
+     */
+    static FrameTimelineRecorder *create(size_t capacity, const char *traceName,
+                                         int64_t (*resolveSignalTime)(int fd));
+
+    /**
+     * Records a completed transaction. Takes ownership of presentFenceFd, which may be -1 if
+     * record.presentTime is already known. A pending fence holds a reference to the recorder
+     * until it signals.
+     */
+    void record(const FrameTimelineRecord &record, int presentFenceFd);
+
+    /**
+     * Copies up to maxCount records, oldest first, and returns the number copied.
+     */
+    size_t copyRecords(FrameTimelineRecord *out, size_t maxCount);
+
+    FrameTimelineSummary summarize(int64_t deadlineToleranceNanos);
+
+    /**
+     * Drops the records published so far.
+     */
+    void reset();
+
+private:
+    friend class RefCounted<FrameTimelineRecorder>;
+
+    struct Slot {
+        /** Odd while the slot is written, 2 * (index + 1) once record index is published */
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> fields[FRAME_TIMELINE_RECORD_FIELDS];
+    };
+
+    FrameTimelineRecorder(size_t capacity, const char *traceName,
+                          int64_t (*resolveSignalTime)(int fd));
+    ~FrameTimelineRecorder() = default;
+
+    void publish(const FrameTimelineRecord &record);
+    void traceCounters(const FrameTimelineRecord &record);
+    static void onPresented(void *context, int64_t presentTime);
+
+    const size_t mCapacity;
+    std::unique_ptr<Slot[]> mSlots;
+    std::atomic<uint64_t> mWriteIndex{0};
+    std::atomic<uint64_t> mResetIndex{0};
+
+    const bool mTrace;
+    const std::string mLatencyCounter;
+    const std::string mPresentDelayCounter;
+    int64_t (*const mResolveSignalTime)(int fd);
+};
+
+#endif //ANDROIDX_FRAME_TIMELINE_H
@@ -17,7 +17,10 @@
 #define LOG_TAG "ASurfaceControlTest"
 
 #include <jni.h>
+#include <algorithm>
 #include <string>
+#include <cstring>
+#include <vector>
 #include <poll.h>
 #include <unistd.h>
 #include <ctime>
@@ -31,7 +34,11 @@
 #include <android/log.h>
 #include <android/sync.h>
 #include <sys/system_properties.h>
+#include "damage_accumulator.h"
 #include "egl_utils.h"
+#include "frame_scheduler.h"
+#include "frame_timeline.h"
+#include "hardware_buffer_pool.h"
 #include "sync_fence.h"
 
 #define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
@@ -266,6 +273,219 @@ void JniBindings_nTransactionSetOnCommit(JNIEnv *env, jclass, jlong surfaceTrans
     }
 }
 
+/**
+ * Records the timeline of a transaction into a FrameTimelineRecorder once it completes, without
+ * calling back into Java.
+ */
+class FrameTimelineCallbackWrapper : public CallbackWrapper {
+public:
+    FrameTimelineCallbackWrapper(FrameTimelineRecorder *recorder, ASurfaceControl *surfaceControl,
+                                 int64_t frameId, int64_t desiredPresentTime)
+            : mRecorder(recorder), mSurfaceControl(surfaceControl) {
+        mRecorder->acquire();
+        mRecord.frameId = frameId;
+        mRecord.desiredPresentTime = desiredPresentTime;
+        mRecord.commitTime = getSystemTime();
+    }
+
+    ~FrameTimelineCallbackWrapper() override {
+        mRecorder->release();
+    }
+
+    void callback(ASurfaceTransactionStats *stats) override {
+        mRecord.latchTime = ASurfaceTransactionStats_getLatchTime(stats);
+        mRecord.acquireTime = -1;
+        // The SurfaceControl is only compared by address, querying the acquire time of one that is
+        // not part of the stats crashes, see JniBindings_nGetPreviousReleaseFenceFd
+        size_t numSurfaceControls;
+        ASurfaceControl **surfaceControls;
+        ASurfaceTransactionStats_getASurfaceControls(stats, &surfaceControls, &numSurfaceControls);
+        for (size_t i = 0; i < numSurfaceControls; i++) {
+            if (surfaceControls[i] == mSurfaceControl) {
+                mRecord.acquireTime =
+                        ASurfaceTransactionStats_getAcquireTime(stats, mSurfaceControl);
+                break;
+            }
+        }
+        ASurfaceTransactionStats_releaseASurfaceControls(surfaceControls);
+        mRecord.presentTime = -1;
+        mRecord.completeTime = getSystemTime();
+        mRecorder->record(mRecord, ASurfaceTransactionStats_getPresentFenceFd(stats));
+    }
+
+private:
+    FrameTimelineRecorder *mRecorder;
+    ASurfaceControl *mSurfaceControl;
+    FrameTimelineRecord mRecord{};
+};
+
+/**
+ * Records the timeline of the transaction into the recorder once it completes. The commit time is
+ * sampled now, so this is expected to be called right before the transaction is applied.
+ */
+void JniBindings_nTransactionSetFrameTimelineRecorder(JNIEnv *env, jclass,
+                                                      jlong surfaceTransaction, jlong recorder,
+                                                      jlong surfaceControl, jlong frameId,
+                                                      jlong desiredPresentTime) {
+    if (android_get_device_api_level() >= 29 && recorder != 0) {
+        void *context = new FrameTimelineCallbackWrapper(
+                reinterpret_cast<FrameTimelineRecorder *>(recorder),
+                reinterpret_cast<ASurfaceControl *>(surfaceControl), frameId, desiredPresentTime);
+        ASurfaceTransaction_setOnComplete(
+                reinterpret_cast<ASurfaceTransaction *>(surfaceTransaction),
+                reinterpret_cast<void *>(context),
+                CallbackWrapper::transactionCallbackThunk);
+    }
+}
+
+jlong FrameTimelineRecorder_nCreate(JNIEnv *env, jclass, jint capacity, jstring traceName) {
+    if (capacity <= 0) {
+        return 0;
+    }
+    const char *name = traceName != nullptr ? env->GetStringUTFChars(traceName, nullptr) : nullptr;
+    auto recorder = FrameTimelineRecorder::create(static_cast<size_t>(capacity), name,
+                                                  get_signal_time);
+    if (name != nullptr) {
+        env->ReleaseStringUTFChars(traceName, name);
+    }
+    return reinterpret_cast<jlong>(recorder);
+}
+
+void FrameTimelineRecorder_nRelease(JNIEnv *env, jclass, jlong recorder) {
+    reinterpret_cast<FrameTimelineRecorder *>(recorder)->release();
+}
+
+void FrameTimelineRecorder_nGetSummary(JNIEnv *env, jclass, jlong recorder, jlongArray out,
+                                       jlong deadlineToleranceNanos) {
+    if (env->GetArrayLength(out) < static_cast<jsize>(FRAME_TIMELINE_SUMMARY_FIELDS)) {
+        return;
+    }
+    FrameTimelineSummary summary =
+            reinterpret_cast<FrameTimelineRecorder *>(recorder)->summarize(
+                    deadlineToleranceNanos);
+    const jlong fields[FRAME_TIMELINE_SUMMARY_FIELDS] = {
+            summary.frameCount, summary.missedDeadlineCount, summary.unknownPresentCount,
+            summary.latencyP50, summary.latencyP90, summary.latencyP99, summary.latencyMax,
+            summary.presentDelayP50, summary.presentDelayP90, summary.presentDelayP99,
+            summary.presentDelayMax
+    };
+    env->SetLongArrayRegion(out, 0, FRAME_TIMELINE_SUMMARY_FIELDS, fields);
+}
+
+/**
+ * Copies the records, oldest first, into out as consecutive groups of
+ * FRAME_TIMELINE_RECORD_FIELDS values and returns the number of records copied.
+ */
+jint FrameTimelineRecorder_nCopyRecords(JNIEnv *env, jclass, jlong recorder, jlongArray out) {
+    size_t maxCount = static_cast<size_t>(env->GetArrayLength(out)) / FRAME_TIMELINE_RECORD_FIELDS;
+    if (maxCount == 0) {
+        return 0;
+    }
+    std::vector<FrameTimelineRecord> records(maxCount);
+    size_t count = reinterpret_cast<FrameTimelineRecorder *>(recorder)->copyRecords(
+            records.data(), maxCount);
+    std::vector<jlong> fields;
+    fields.reserve(count * FRAME_TIMELINE_RECORD_FIELDS);
+    for (size_t i = 0; i < count; i++) {
+        const auto &record = records[i];
+        fields.insert(fields.end(), {record.frameId, record.desiredPresentTime, record.commitTime,
+                                     record.latchTime, record.acquireTime, record.presentTime,
+                                     record.completeTime});
+    }
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(fields.size()), fields.data());
+    return static_cast<jint>(count);
+}
+
+void FrameTimelineRecorder_nReset(JNIEnv *env, jclass, jlong recorder) {
+    reinterpret_cast<FrameTimelineRecorder *>(recorder)->reset();
+}
+
+/**
+ * Adds the latch and present time of a transaction to a FrameScheduler once it completes, without
+ * calling back into Java.
+ */
+class FrameSchedulerCallbackWrapper : public CallbackWrapper {
+public:
+    explicit FrameSchedulerCallbackWrapper(FrameScheduler *scheduler) : mScheduler(scheduler) {
+        mScheduler->acquire();
+    }
+
+    ~FrameSchedulerCallbackWrapper() override {
+        mScheduler->release();
+    }
+
+    void callback(ASurfaceTransactionStats *stats) override {
+        mScheduler->addPresentFence(ASurfaceTransactionStats_getLatchTime(stats),
+                                    ASurfaceTransactionStats_getPresentFenceFd(stats));
+    }
+
+private:
+    FrameScheduler *mScheduler;
+};
+
+void JniBindings_nTransactionSetFrameScheduler(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                               jlong scheduler) {
+    if (android_get_device_api_level() >= 29 && scheduler != 0) {
+        void *context = new FrameSchedulerCallbackWrapper(
+                reinterpret_cast<FrameScheduler *>(scheduler));
+        ASurfaceTransaction_setOnComplete(
+                reinterpret_cast<ASurfaceTransaction *>(surfaceTransaction),
+                reinterpret_cast<void *>(context),
+                CallbackWrapper::transactionCallbackThunk);
+    }
+}
+
+jlong FrameScheduler_nCreate(JNIEnv *env, jclass, jlong vsyncPeriodHint) {
+    return reinterpret_cast<jlong>(
+            FrameScheduler::create(vsyncPeriodHint, getSystemTime, get_signal_time));
+}
+
+void FrameScheduler_nRelease(JNIEnv *env, jclass, jlong scheduler) {
+    reinterpret_cast<FrameScheduler *>(scheduler)->release();
+}
+
+void FrameScheduler_nSetVsyncPeriodHint(JNIEnv *env, jclass, jlong scheduler,
+                                        jlong vsyncPeriodHint) {
+    reinterpret_cast<FrameScheduler *>(scheduler)->setVsyncPeriodHint(vsyncPeriodHint);
+}
+
+void FrameScheduler_nSchedule(JNIEnv *env, jclass, jlong scheduler, jlong workDuration,
+                              jlongArray out) {
+    if (env->GetArrayLength(out) < static_cast<jsize>(FRAME_SCHEDULE_FIELDS)) {
+        return;
+    }
+    FrameSchedule schedule =
+            reinterpret_cast<FrameScheduler *>(scheduler)->schedule(workDuration);
+    const jlong fields[FRAME_SCHEDULE_FIELDS] = {
+            schedule.startTime, schedule.commitDeadline, schedule.desiredPresentTime,
+            schedule.vsyncPeriod
+    };
+    env->SetLongArrayRegion(out, 0, FRAME_SCHEDULE_FIELDS, fields);
+}
+
+/**
+ * Fills out with the predicted vsync times, returning 0 until a frame was presented.
+ */
+jint FrameScheduler_nPredictVsyncs(JNIEnv *env, jclass, jlong scheduler, jlongArray out) {
+    jsize length = env->GetArrayLength(out);
+    if (length == 0) {
+        return 0;
+    }
+    std::vector<jlong> vsyncs(length);
+    size_t count = reinterpret_cast<FrameScheduler *>(scheduler)->predictVsyncs(
+            reinterpret_cast<int64_t *>(vsyncs.data()), static_cast<size_t>(length));
+    env->SetLongArrayRegion(out, 0, static_cast<jsize>(count), vsyncs.data());
+    return static_cast<jint>(count);
+}
+
+jlong FrameScheduler_nGetCompositorLatency(JNIEnv *env, jclass, jlong scheduler) {
+    return reinterpret_cast<FrameScheduler *>(scheduler)->getCompositorLatency();
+}
+
+void FrameScheduler_nReset(JNIEnv *env, jclass, jlong scheduler) {
+    reinterpret_cast<FrameScheduler *>(scheduler)->reset();
+}
+
 void setupSyncFenceClassInfo(JNIEnv *env) {
     if (!gSyncFenceClassInfo.CLASS_INFO_INITIALIZED) {
         jclass syncFenceClazz = env->FindClass("androidx/hardware/SyncFenceV19");
@@ -352,6 +572,58 @@ void JniBindings_nSetDamageRegion(
     }
 }
 
+/**
+ * Sets the damage region to count rects packed as left, top, right, bottom, coalesced into at
+ * most maxRects rects. Split from JniBindings_nSetCoalescedDamageRegion so it can be called
+ * without a JVM.
+ */
+void setCoalescedDamageRegion(ASurfaceTransaction *st, ASurfaceControl *sc, const jint *rects,
+                              jint count, jint maxRects, jlong perRectCost) {
+    DamageAccumulator accumulator(perRectCost);
+    for (jint i = 0; i < count; i++) {
+        const jint *rect = rects + i * 4;
+        accumulator.add(ARect{rect[0], rect[1], rect[2], rect[3]});
+    }
+
+    if (accumulator.isEmpty()) {
+        // Every rect was empty, so nothing was damaged. Passing no rects would instead mark the
+        // whole buffer as damaged
+        ARect empty = {0, 0, 0, 0};
+        ASurfaceTransaction_setDamageRegion(st, sc, &empty, 1);
+        return;
+    }
+    const std::vector<ARect> &coalesced =
+            accumulator.coalesce(static_cast<size_t>(std::max(maxRects, 1)));
+    ASurfaceTransaction_setDamageRegion(st, sc, coalesced.data(),
+                                        static_cast<uint32_t>(coalesced.size()));
+}
+
+void JniBindings_nSetCoalescedDamageRegion(
+        JNIEnv *env, jclass,
+        jlong surfaceTransaction, jlong surfaceControl,
+        jintArray rects, jint count, jint maxRects, jlong perRectCost) {
+    if (android_get_device_api_level() >= 29) {
+        auto st = reinterpret_cast<ASurfaceTransaction *>(surfaceTransaction);
+        auto sc = reinterpret_cast<ASurfaceControl *>(surfaceControl);
+
+        // rects holds count rects packed as left, top, right, bottom
+        if (count < 0 || env->GetArrayLength(rects) / 4 < count) {
+            ASurfaceTransaction_setDamageRegion(st, sc, nullptr, 0);
+            return;
+        }
+        if (count == 0) {
+            setCoalescedDamageRegion(st, sc, nullptr, 0, maxRects, perRectCost);
+            return;
+        }
+        jint *values = env->GetIntArrayElements(rects, nullptr);
+        if (values == nullptr) {
+            return;
+        }
+        setCoalescedDamageRegion(st, sc, values, count, maxRects, perRectCost);
+        env->ReleaseIntArrayElements(rects, values, JNI_ABORT);
+    }
+}
+
 void JniBindings_nSetDesiredPresentTime(
         JNIEnv *env, jclass,
         jlong surfaceTransaction, int64_t desiredPresentTimeNano) {
@@ -518,6 +790,227 @@ void JniBindings_nSetFrameRate(JNIEnv *env, jclass,
     }
 }
 
+/**
+ * Opcodes of the command stream decoded by JniBindings_nApplyTransactionCommands. These must be
+ * kept in sync with TransactionCommandBuffer on the Kotlin side.
+ */
+enum TransactionCommand : int32_t {
+    COMMAND_SET_VISIBILITY = 1,
+    COMMAND_SET_Z_ORDER = 2,
+    COMMAND_SET_DAMAGE_REGION = 3,
+    COMMAND_SET_BUFFER_TRANSPARENCY = 4,
+    COMMAND_SET_BUFFER_ALPHA = 5,
+    COMMAND_SET_CROP = 6,
+    COMMAND_SET_POSITION = 7,
+    COMMAND_SET_SCALE = 8,
+    COMMAND_SET_BUFFER_TRANSFORM = 9,
+    COMMAND_SET_DATA_SPACE = 10,
+    COMMAND_SET_GEOMETRY = 11,
+    COMMAND_SET_FRAME_RATE = 12,
+    COMMAND_REPARENT = 13,
+    COMMAND_SET_DESIRED_PRESENT_TIME = 14
+};
+
+/**
+ * Sequential reader over the command stream. Every value is written in native byte order and
+ * occupies 4 bytes, apart from the surface control handles and timestamps which occupy 8.
+ */
+class CommandReader {
+public:
+    CommandReader(const uint8_t *data, size_t length) : mPosition(data), mEnd(data + length) {}
+
+    bool hasRemaining() const {
+        return mPosition < mEnd;
+    }
+
+    template<typename T>
+    bool read(T *out) {
+        if (static_cast<size_t>(mEnd - mPosition) < sizeof(T)) {
+            return false;
+        }
+        memcpy(out, mPosition, sizeof(T));
+        mPosition += sizeof(T);
+        return true;
+    }
+
+    bool readRect(ARect *out) {
+        return read(&out->left) && read(&out->top) && read(&out->right) && read(&out->bottom);
+    }
+
+    /**
+     * Returns the next count rects in place, avoiding a copy when the stream is suitably aligned,
+     * or nullptr if the stream is too short or misaligned.
+     */
+    const ARect *readRects(int32_t count) {
+        size_t size = static_cast<size_t>(count) * sizeof(ARect);
+        if (static_cast<size_t>(mEnd - mPosition) < size ||
+            reinterpret_cast<uintptr_t>(mPosition) % alignof(ARect) != 0) {
+            return nullptr;
+        }
+        auto rects = reinterpret_cast<const ARect *>(mPosition);
+        mPosition += size;
+        return rects;
+    }
+
+private:
+    const uint8_t *mPosition;
+    const uint8_t *mEnd;
+};
+
+/**
+ * Decodes one command from the stream and applies it to the transaction. Returns false if the
+ * command is unknown or truncated.
+ */
+static bool applyTransactionCommand(ASurfaceTransaction *st, CommandReader &reader) {
+    int32_t command;
+    int64_t surfaceControl;
+    if (!reader.read(&command) || !reader.read(&surfaceControl)) {
+        return false;
+    }
+    auto sc = reinterpret_cast<ASurfaceControl *>(surfaceControl);
+    switch (command) {
+        case COMMAND_SET_VISIBILITY: {
+            int32_t visibility;
+            if (!reader.read(&visibility)) return false;
+            ASurfaceTransaction_setVisibility(
+                    st, sc, static_cast<ASurfaceTransactionVisibility>(visibility));
+            return true;
+        }
+        case COMMAND_SET_Z_ORDER: {
+            int32_t zOrder;
+            if (!reader.read(&zOrder)) return false;
+            ASurfaceTransaction_setZOrder(st, sc, zOrder);
+            return true;
+        }
+        case COMMAND_SET_DAMAGE_REGION: {
+            int32_t count;
+            if (!reader.read(&count) || count < 0) return false;
+            if (count == 0) {
+                ASurfaceTransaction_setDamageRegion(st, sc, nullptr, 0);
+                return true;
+            }
+            const ARect *rects = reader.readRects(count);
+            if (rects == nullptr) return false;
+            ASurfaceTransaction_setDamageRegion(st, sc, rects, count);
+            return true;
+        }
+        case COMMAND_SET_BUFFER_TRANSPARENCY: {
+            int32_t transparency;
+            if (!reader.read(&transparency)) return false;
+            ASurfaceTransaction_setBufferTransparency(
+                    st, sc, static_cast<ASurfaceTransactionTransparency>(transparency));
+            return true;
+        }
+        case COMMAND_SET_BUFFER_ALPHA: {
+            float alpha;
+            if (!reader.read(&alpha)) return false;
+            ASurfaceTransaction_setBufferAlpha(st, sc, alpha);
+            return true;
+        }
+        case COMMAND_SET_CROP: {
+            ARect crop;
+            if (!reader.readRect(&crop)) return false;
+            ASurfaceTransaction_setCrop(st, sc, crop);
+            return true;
+        }
+        case COMMAND_SET_POSITION: {
+            float x, y;
+            if (!reader.read(&x) || !reader.read(&y)) return false;
+            ASurfaceTransaction_setPosition(st, sc, x, y);
+            return true;
+        }
+        case COMMAND_SET_SCALE: {
+            float scaleX, scaleY;
+            if (!reader.read(&scaleX) || !reader.read(&scaleY)) return false;
+            ASurfaceTransaction_setScale(st, sc, scaleX, scaleY);
+            return true;
+        }
+        case COMMAND_SET_BUFFER_TRANSFORM: {
+            int32_t transformation;
+            if (!reader.read(&transformation)) return false;
+            ASurfaceTransaction_setBufferTransform(st, sc, transformation);
+            return true;
+        }
+        case COMMAND_SET_DATA_SPACE: {
+            int32_t dataspace;
+            if (!reader.read(&dataspace)) return false;
+            ASurfaceTransaction_setBufferDataSpace(st, sc, static_cast<ADataSpace>(dataspace));
+            return true;
+        }
+        case COMMAND_SET_GEOMETRY: {
+            int32_t bufferWidth, bufferHeight, dstWidth, dstHeight, transformation;
+            if (!reader.read(&bufferWidth) || !reader.read(&bufferHeight) ||
+                !reader.read(&dstWidth) || !reader.read(&dstHeight) ||
+                !reader.read(&transformation)) {
+                return false;
+            }
+            auto src = ARect{0, 0, bufferWidth, bufferHeight};
+            auto dest = ARect{0, 0, dstWidth, dstHeight};
+            ASurfaceTransaction_setGeometry(st, sc, src, dest, transformation);
+            return true;
+        }
+        case COMMAND_SET_FRAME_RATE: {
+            float framerate;
+            int32_t compatibility, changeFrameRateStrategy;
+            if (!reader.read(&framerate) || !reader.read(&compatibility) ||
+                !reader.read(&changeFrameRateStrategy)) {
+                return false;
+            }
+            if (android_get_device_api_level() >= 31) {
+                ASurfaceTransaction_setFrameRateWithChangeStrategy(
+                        st, sc, framerate, compatibility, changeFrameRateStrategy);
+            } else if (android_get_device_api_level() >= 30) {
+                ASurfaceTransaction_setFrameRate(st, sc, framerate, compatibility);
+            }
+            return true;
+        }
+        case COMMAND_REPARENT: {
+            int64_t newParent;
+            if (!reader.read(&newParent)) return false;
+            ASurfaceTransaction_reparent(st, sc, reinterpret_cast<ASurfaceControl *>(newParent));
+            return true;
+        }
+        case COMMAND_SET_DESIRED_PRESENT_TIME: {
+            // Applies to the whole transaction, the surface control handle is ignored.
+            int64_t desiredPresentTimeNano;
+            if (!reader.read(&desiredPresentTimeNano)) return false;
+            ASurfaceTransaction_setDesiredPresentTime(st, desiredPresentTimeNano);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * Applies every command encoded in the first length bytes of the direct ByteBuffer to the
+ * transaction with a single JNI call. Returns the number of commands applied, or -1 if the buffer
+ * is not direct or the stream is malformed, in which case the commands preceding the malformed one
+ * have already been applied.
+ */
+jint JniBindings_nApplyTransactionCommands(JNIEnv *env, jclass, jlong surfaceTransaction,
+                                           jobject commands, jint length) {
+    if (android_get_device_api_level() < 29) {
+        return 0;
+    }
+    auto data = static_cast<const uint8_t *>(env->GetDirectBufferAddress(commands));
+    if (data == nullptr || length < 0 || length > env->GetDirectBufferCapacity(commands)) {
+        ALOGE("Invalid transaction command buffer");
+        return -1;
+    }
+    auto st = reinterpret_cast<ASurfaceTransaction *>(surfaceTransaction);
+    CommandReader reader(data, static_cast<size_t>(length));
+    jint count = 0;
+    while (reader.hasRemaining()) {
+        if (!applyTransactionCommand(st, reader)) {
+            ALOGE("Malformed transaction command at index %d", count);
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
 void loadRectInfo(JNIEnv *env) {
     gRectInfo.clazz = env->FindClass("android/graphics/Rect");
 
@@ -599,6 +1092,11 @@ static const JNINativeMethod JNI_METHOD_TABLE[] = {
                 "(JJLandroid/graphics/Rect;)V",
                 (void *) JniBindings_nSetDamageRegion
         },
+        {
+                "nSetCoalescedDamageRegion",
+                "(JJ[IIIJ)V",
+                (void *) JniBindings_nSetCoalescedDamageRegion
+        },
         {
                 "nSetDesiredPresentTime",
                 "(JJ)V",
@@ -663,6 +1161,87 @@ static const JNINativeMethod JNI_METHOD_TABLE[] = {
             "nIsHwuiUsingVulkanRenderer",
                 "()Z",
                 (void *) JniBindings_nIsHwuiUsingVulkanRenderer
+        },
+        {
+            "nApplyTransactionCommands",
+                "(JLjava/nio/ByteBuffer;I)I",
+                (void *) JniBindings_nApplyTransactionCommands
+        },
+        {
+            "nTransactionSetFrameTimelineRecorder",
+                "(JJJJJ)V",
+                (void *) JniBindings_nTransactionSetFrameTimelineRecorder
+        },
+        {
+            "nTransactionSetFrameScheduler",
+                "(JJ)V",
+                (void *) JniBindings_nTransactionSetFrameScheduler
+        }
+};
+
+static const JNINativeMethod FRAME_TIMELINE_RECORDER_METHOD_TABLE[] = {
+        {
+            "nCreate",
+                "(ILjava/lang/String;)J",
+                (void *) FrameTimelineRecorder_nCreate
+        },
+        {
+            "nRelease",
+                "(J)V",
+                (void *) FrameTimelineRecorder_nRelease
+        },
+        {
+            "nGetSummary",
+                "(J[JJ)V",
+                (void *) FrameTimelineRecorder_nGetSummary
+        },
+        {
+            "nCopyRecords",
+                "(J[J)I",
+                (void *) FrameTimelineRecorder_nCopyRecords
+        },
+        {
+            "nReset",
+                "(J)V",
+                (void *) FrameTimelineRecorder_nReset
+        }
+};
+
+static const JNINativeMethod FRAME_SCHEDULER_METHOD_TABLE[] = {
+        {
+            "nCreate",
+                "(J)J",
+                (void *) FrameScheduler_nCreate
+        },
+        {
+            "nRelease",
+                "(J)V",
+                (void *) FrameScheduler_nRelease
+        },
+        {
+            "nSetVsyncPeriodHint",
+                "(JJ)V",
+                (void *) FrameScheduler_nSetVsyncPeriodHint
+        },
+        {
+            "nSchedule",
+                "(JJ[J)V",
+                (void *) FrameScheduler_nSchedule
+        },
+        {
+            "nPredictVsyncs",
+                "(J[J)I",
+                (void *) FrameScheduler_nPredictVsyncs
+        },
+        {
+            "nGetCompositorLatency",
+                "(J)J",
+                (void *) FrameScheduler_nGetCompositorLatency
+        },
+        {
+            "nReset",
+                "(J)V",
+                (void *) FrameScheduler_nReset
         }
 };
 
@@ -684,6 +1263,28 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *) {
         return JNI_ERR;
     }
 
+    jclass recorderClazz = env->FindClass("androidx/graphics/surface/FrameTimelineRecorder");
+    if (recorderClazz == nullptr) {
+        return JNI_ERR;
+    }
+
+    if (env->RegisterNatives(recorderClazz, FRAME_TIMELINE_RECORDER_METHOD_TABLE,
+                             sizeof(FRAME_TIMELINE_RECORDER_METHOD_TABLE) /
+                                     sizeof(JNINativeMethod)) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    jclass schedulerClazz = env->FindClass("androidx/graphics/surface/FrameScheduler");
+    if (schedulerClazz == nullptr) {
+        return JNI_ERR;
+    }
+
+    if (env->RegisterNatives(schedulerClazz, FRAME_SCHEDULER_METHOD_TABLE,
+                             sizeof(FRAME_SCHEDULER_METHOD_TABLE) /
+                                     sizeof(JNINativeMethod)) != JNI_OK) {
+        return JNI_ERR;
+    }
+
     loadRectInfo(env);
 
     if (loadEGLMethods(env) != JNI_OK) {
@@ -694,5 +1295,9 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *) {
         return JNI_ERR;
     }
 
+    if (loadHardwareBufferPoolMethods(env) != JNI_OK) {
+        return JNI_ERR;
+    }
+
     return JNI_VERSION_1_6;
 }
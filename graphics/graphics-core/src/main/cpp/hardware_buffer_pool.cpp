@@ -0,0 +1,339 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "HardwareBufferPool"
+
+#include "hardware_buffer_pool.h"
+#include <android/api-level.h>
+#include <android/hardware_buffer_jni.h>
+#include <android/log.h>
+#include <poll.h>
+#include <unistd.h>
+#include "sync_fence.h"
+
+#define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+HardwareBufferPool::HardwareBufferPool(size_t maxBufferCount,
+                                       int64_t (*resolveSignalTime)(int fd))
+        : mMaxBufferCount(maxBufferCount), mResolveSignalTime(resolveSignalTime) {}
+
+HardwareBufferPool::~HardwareBufferPool() {
+    for (auto &entry : mEntries) {
+        releaseEntry(entry);
+    }
+}
+
+bool HardwareBufferPool::destroy(HardwareBufferPool *pool) {
+    bool deleteNow;
+    {
+        std::lock_guard<std::mutex> lock(pool->mLock);
+        pool->mDestroyed = true;
+        for (auto it = pool->mEntries.begin(); it != pool->mEntries.end();) {
+            if (!it->inUse) {
+                pool->releaseEntry(*it);
+                it = pool->mEntries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        deleteNow = pool->mEntries.empty() && pool->mPendingAllocations == 0;
+    }
+    if (deleteNow) {
+        delete pool;
+    }
+    return deleteNow;
+}
+
+bool HardwareBufferPool::matches(const Entry &entry, const AHardwareBuffer_Desc &desc) {
+    return entry.width == desc.width && entry.height == desc.height &&
+           entry.format == desc.format && entry.usage == desc.usage;
+}
+
+bool HardwareBufferPool::isReusable(Entry &entry) {
+    if (entry.releaseFenceFd == -1) {
+        return true;
+    }
+    int64_t signalTime = mResolveSignalTime(entry.releaseFenceFd);
+    if (signalTime == INT64_MAX) {
+        return false;
+    }
+    if (signalTime < 0) {
+        // The fence could not be queried, the buffer is only reused if the fence polls as
+        // signaled, which a fence in an error state does
+        struct pollfd pollFd = {entry.releaseFenceFd, POLLIN, 0};
+        if (poll(&pollFd, 1, 0) != 1 || (pollFd.revents & POLLIN) == 0) {
+            return false;
+        }
+    }
+    close(entry.releaseFenceFd);
+    entry.releaseFenceFd = -1;
+    return true;
+}
+
+void HardwareBufferPool::releaseEntry(Entry &entry) {
+    if (entry.releaseFenceFd != -1) {
+        close(entry.releaseFenceFd);
+        entry.releaseFenceFd = -1;
+    }
+    // The compositor holds its own reference, so this is safe while the release fence is pending
+    AHardwareBuffer_release(entry.buffer);
+}
+
+bool HardwareBufferPool::evictLeastRecentlyReleased() {
+    auto victim = mEntries.end();
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (!it->inUse && (victim == mEntries.end() || it->releaseOrder < victim->releaseOrder)) {
+            victim = it;
+        }
+    }
+    if (victim == mEntries.end()) {
+        return false;
+    }
+    releaseEntry(*victim);
+    mEntries.erase(victim);
+    mStats.evictions++;
+    return true;
+}
+
+AHardwareBuffer *HardwareBufferPool::obtain(const AHardwareBuffer_Desc &desc) {
+    if (android_get_device_api_level() < 26) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mDestroyed) {
+            return nullptr;
+        }
+        bool skippedPending = false;
+        for (auto &entry : mEntries) {
+            if (entry.inUse || !matches(entry, desc)) {
+                continue;
+            }
+            if (isReusable(entry)) {
+                entry.inUse = true;
+                mStats.hits++;
+                mStats.inUseCount++;
+                return entry.buffer;
+            }
+            skippedPending = true;
+        }
+        mStats.misses++;
+        if (skippedPending) {
+            mStats.pendingSkips++;
+        }
+        if (mEntries.size() + mPendingAllocations >= mMaxBufferCount &&
+            !evictLeastRecentlyReleased()) {
+            mStats.exhausted++;
+            return nullptr;
+        }
+        mPendingAllocations++;
+    }
+
+    // Allocate outside of the lock so buffers can be released in the meantime
+    AHardwareBuffer_Desc allocationDesc = {};
+    allocationDesc.width = desc.width;
+    allocationDesc.height = desc.height;
+    allocationDesc.layers = 1;
+    allocationDesc.format = desc.format;
+    allocationDesc.usage = desc.usage;
+    AHardwareBuffer *buffer = nullptr;
+    int result = AHardwareBuffer_allocate(&allocationDesc, &buffer);
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mPendingAllocations--;
+    if (result != 0 || buffer == nullptr) {
+        ALOGE("Unable to allocate %ux%u buffer of format %u: %d", desc.width, desc.height,
+              desc.format, result);
+        return nullptr;
+    }
+    mEntries.push_back(Entry{buffer, desc.width, desc.height, desc.format, desc.usage, -1, true,
+                             0});
+    mStats.inUseCount++;
+    return buffer;
+}
+
+HardwareBufferPoolRelease HardwareBufferPool::release(AHardwareBuffer *buffer,
+                                                      int releaseFenceFd) {
+    bool deleteNow = false;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto entry = mEntries.begin();
+        while (entry != mEntries.end() && entry->buffer != buffer) {
+            ++entry;
+        }
+        if (entry == mEntries.end() || !entry->inUse) {
+            // Unknown or already released buffer
+            if (releaseFenceFd != -1) {
+                close(releaseFenceFd);
+            }
+            return BUFFER_NOT_OWNED;
+        }
+        mStats.inUseCount--;
+        if (mDestroyed) {
+            entry->releaseFenceFd = releaseFenceFd;
+            releaseEntry(*entry);
+            mEntries.erase(entry);
+            deleteNow = mEntries.empty() && mPendingAllocations == 0;
+        } else {
+            entry->releaseFenceFd = releaseFenceFd;
+            entry->inUse = false;
+            entry->releaseOrder = mNextReleaseOrder++;
+        }
+    }
+    if (deleteNow) {
+        delete this;
+        return BUFFER_POOL_DELETED;
+    }
+    return BUFFER_RELEASED;
+}
+
+size_t HardwareBufferPool::trim(size_t maxAvailableCount) {
+    std::lock_guard<std::mutex> lock(mLock);
+    size_t available = 0;
+    for (const auto &entry : mEntries) {
+        if (!entry.inUse) {
+            available++;
+        }
+    }
+    size_t released = 0;
+    while (available > maxAvailableCount && evictLeastRecentlyReleased()) {
+        available--;
+        released++;
+    }
+    return released;
+}
+
+bool HardwareBufferPool::contains(AHardwareBuffer *buffer) {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (const auto &entry : mEntries) {
+        if (entry.buffer == buffer) {
+            return true;
+        }
+    }
+    return false;
+}
+
+HardwareBufferPoolStats HardwareBufferPool::getStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    HardwareBufferPoolStats stats = mStats;
+    stats.allocatedCount = static_cast<int64_t>(mEntries.size());
+    return stats;
+}
+
+jlong HardwareBufferPool_nCreate(JNIEnv *env, jclass, jint maxBufferCount) {
+    if (maxBufferCount <= 0) {
+        return 0;
+    }
+    return reinterpret_cast<jlong>(
+            new HardwareBufferPool(static_cast<size_t>(maxBufferCount), get_signal_time));
+}
+
+jobject HardwareBufferPool_nObtain(JNIEnv *env, jclass, jlong pool, jint width, jint height,
+                                   jint format, jlong usage) {
+    if (width <= 0 || height <= 0) {
+        return nullptr;
+    }
+    AHardwareBuffer_Desc desc = {};
+    desc.width = static_cast<uint32_t>(width);
+    desc.height = static_cast<uint32_t>(height);
+    desc.layers = 1;
+    desc.format = static_cast<uint32_t>(format);
+    desc.usage = static_cast<uint64_t>(usage);
+    auto hardwareBufferPool = reinterpret_cast<HardwareBufferPool *>(pool);
+    AHardwareBuffer *buffer = hardwareBufferPool->obtain(desc);
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    jobject hardwareBuffer = AHardwareBuffer_toHardwareBuffer(env, buffer);
+    if (hardwareBuffer == nullptr) {
+        hardwareBufferPool->release(buffer, -1);
+    }
+    return hardwareBuffer;
+}
+
+jint HardwareBufferPool_nRelease(JNIEnv *env, jclass, jlong pool, jobject hardwareBuffer,
+                                 jint releaseFenceFd) {
+    AHardwareBuffer *buffer = AHardwareBuffer_fromHardwareBuffer(env, hardwareBuffer);
+    return static_cast<jint>(
+            reinterpret_cast<HardwareBufferPool *>(pool)->release(buffer, releaseFenceFd));
+}
+
+jint HardwareBufferPool_nTrim(JNIEnv *env, jclass, jlong pool, jint maxAvailableCount) {
+    size_t count = maxAvailableCount > 0 ? static_cast<size_t>(maxAvailableCount) : 0;
+    return static_cast<jint>(reinterpret_cast<HardwareBufferPool *>(pool)->trim(count));
+}
+
+void HardwareBufferPool_nGetStats(JNIEnv *env, jclass, jlong pool, jlongArray out) {
+    if (env->GetArrayLength(out) < static_cast<jsize>(HARDWARE_BUFFER_POOL_STATS_FIELDS)) {
+        return;
+    }
+    HardwareBufferPoolStats stats = reinterpret_cast<HardwareBufferPool *>(pool)->getStats();
+    const jlong fields[HARDWARE_BUFFER_POOL_STATS_FIELDS] = {
+            stats.hits, stats.misses, stats.pendingSkips, stats.exhausted, stats.evictions,
+            stats.allocatedCount, stats.inUseCount
+    };
+    env->SetLongArrayRegion(out, 0, HARDWARE_BUFFER_POOL_STATS_FIELDS, fields);
+}
+
+jboolean HardwareBufferPool_nDestroy(JNIEnv *env, jclass, jlong pool) {
+    return HardwareBufferPool::destroy(reinterpret_cast<HardwareBufferPool *>(pool));
+}
+
+static const JNINativeMethod HARDWARE_BUFFER_POOL_METHOD_TABLE[] = {
+        {
+                "nCreate",
+                "(I)J",
+                (void *) HardwareBufferPool_nCreate
+        },
+        {
+                "nObtain",
+                "(JIIIJ)Landroid/hardware/HardwareBuffer;",
+                (void *) HardwareBufferPool_nObtain
+        },
+        {
+                "nRelease",
+                "(JLandroid/hardware/HardwareBuffer;I)I",
+                (void *) HardwareBufferPool_nRelease
+        },
+        {
+                "nTrim",
+                "(JI)I",
+                (void *) HardwareBufferPool_nTrim
+        },
+        {
+                "nGetStats",
+                "(J[J)V",
+                (void *) HardwareBufferPool_nGetStats
+        },
+        {
+                "nDestroy",
+                "(J)Z",
+                (void *) HardwareBufferPool_nDestroy
+        }
+};
+
+jint loadHardwareBufferPoolMethods(JNIEnv *env) {
+    jclass poolClass = env->FindClass("androidx/hardware/HardwareBufferPool");
+    if (poolClass == nullptr) {
+        return JNI_ERR;
+    }
+    if (env->RegisterNatives(poolClass, HARDWARE_BUFFER_POOL_METHOD_TABLE,
+                             sizeof(HARDWARE_BUFFER_POOL_METHOD_TABLE) /
+                                     sizeof(JNINativeMethod)) != JNI_OK) {
+        return JNI_ERR;
+    }
+    return JNI_OK;
+}
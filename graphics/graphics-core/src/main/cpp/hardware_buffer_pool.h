@@ -0,0 +1,141 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_HARDWARE_BUFFER_POOL_H
+#define ANDROIDX_HARDWARE_BUFFER_POOL_H
+
+#include <jni.h>
+#include <android/hardware_buffer.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct HardwareBufferPoolStats {
+    /** Requests served with a pooled buffer */
+    int64_t hits;
+    /** Requests that required an allocation or could not be served */
+    int64_t misses;
+    /** Requests that skipped a pooled buffer of the same kind as its release fence was pending */
+    int64_t pendingSkips;
+    /** Requests that could not be served as every buffer was in use and the pool was full */
+    int64_t exhausted;
+    /** Pooled buffers released to make room for a buffer of another kind, or by trim */
+    int64_t evictions;
+    /** Buffers allocated, including those currently in use */
+    int64_t allocatedCount;
+    /** Buffers currently handed out */
+    int64_t inUseCount;
+};
+
+/** Number of int64_t fields of HardwareBufferPoolStats, used to copy the stats to Java */
+static constexpr size_t HARDWARE_BUFFER_POOL_STATS_FIELDS = 7;
+
+enum HardwareBufferPoolRelease : int32_t {
+    /** The buffer was not obtained from the pool, the release fence is closed */
+    BUFFER_NOT_OWNED = 0,
+    BUFFER_RELEASED = 1,
+    /** The pool was destroyed and this was its last buffer in use, the pool is now deleted */
+    BUFFER_POOL_DELETED = 2
+};
+
+/**
+ * Recycles AHardwareBuffers by width, height, format and usage. Each returned buffer keeps the
+ * release fence it was returned with, typically the one from
+ * ASurfaceTransactionStats_getPreviousReleaseFenceFd, and is only handed out again once that
+ * fence has signaled, so obtaining a buffer never blocks on the compositor.
+ *
+ * The pool holds at most maxBufferCount buffers, in use or not. When it is full, the least
+ * recently released buffer that is not in use is evicted to make room. This class is thread safe.
+ */
+class HardwareBufferPool {
+public:
+    /**
+     * @param resolveSignalTime Resolves the signal time of a release fence, returning INT64_MAX
+     * while it is pending or a negative value on error. A fence that cannot be resolved is only
+     * treated as signaled if it polls as readable.
+     */
+    HardwareBufferPool(size_t maxBufferCount, int64_t (*resolveSignalTime)(int fd));
+
+    /**
+     * Releases the buffers that are not in use. The pool is deleted now if no buffer is in use,
+     * otherwise once the last one is released. Returns true if the pool was deleted. Must not be
+     * called concurrently with obtain.
+     */
+    static bool destroy(HardwareBufferPool *pool);
+
+    /**
+     * Returns a buffer matching the width, height, format and usage of desc, or nullptr if the
+     * pool is full of buffers in use or allocation failed. The pool keeps its reference to the
+     * buffer, which remains valid until it is passed to release.
+     */
+    AHardwareBuffer *obtain(const AHardwareBuffer_Desc &desc);
+
+    /**
+     * Returns a buffer obtained from this pool. Takes ownership of releaseFenceFd, which may be
+     * -1 if the buffer can be reused right away.
+     */
+    HardwareBufferPoolRelease release(AHardwareBuffer *buffer, int releaseFenceFd);
+
+    /**
+     * Releases the least recently released buffers that are not in use until at most
+     * maxAvailableCount remain. Returns the number of buffers released.
+     */
+    size_t trim(size_t maxAvailableCount);
+
+    /**
+     * Returns whether the pool holds the buffer, in use or not. A buffer that was evicted or
+     * released after the pool was destroyed is no longer held.
+     */
+    bool contains(AHardwareBuffer *buffer);
+
+    HardwareBufferPoolStats getStats();
+
+private:
+    struct Entry {
+        AHardwareBuffer *buffer;
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint64_t usage;
+        int releaseFenceFd;
+        bool inUse;
+        /** Order in which entries were released, used to evict the least recently released */
+        uint64_t releaseOrder;
+    };
+
+    ~HardwareBufferPool();
+
+    static bool matches(const Entry &entry, const AHardwareBuffer_Desc &desc);
+    bool isReusable(Entry &entry);
+    void releaseEntry(Entry &entry);
+    bool evictLeastRecentlyReleased();
+
+    const size_t mMaxBufferCount;
+    int64_t (*const mResolveSignalTime)(int fd);
+
+    std::mutex mLock;
+    std::vector<Entry> mEntries;
+    /** Allocations in flight, which are made outside of the lock but count towards the bound */
+    size_t mPendingAllocations = 0;
+    uint64_t mNextReleaseOrder = 0;
+    bool mDestroyed = false;
+    HardwareBufferPoolStats mStats{};
+};
+
+jint loadHardwareBufferPoolMethods(JNIEnv *env);
+
+#endif //ANDROIDX_HARDWARE_BUFFER_POOL_H
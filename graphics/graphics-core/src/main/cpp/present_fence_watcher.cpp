@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "present_fence_watcher.h"
+#include <jni.h>
+#include <mutex>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "fence_watcher.h"
+#include "sync_fence.h"
+
+struct PresentFenceCallback {
+    PresentFenceWatcher::OnPresented onPresented;
+    void *context;
+};
+
+struct SharedWatcher {
+    std::mutex lock;
+    FenceWatcher *watcher = nullptr;
+    std::unordered_map<int64_t, PresentFenceCallback> pending;
+    int64_t nextToken = 0;
+};
+
+// Never destroyed, so that the watcher thread can outlive static destructors at exit
+static SharedWatcher &getSharedWatcher() {
+    static SharedWatcher *shared = new SharedWatcher();
+    return *shared;
+}
+
+static void onPresentFencesSignaled(void *context, const FenceWatcherEvent *events,
+                                    size_t count) {
+    auto shared = reinterpret_cast<SharedWatcher *>(context);
+    std::vector<std::pair<PresentFenceCallback, int64_t>> presented;
+    presented.reserve(count);
+    {
+        std::lock_guard<std::mutex> lock(shared->lock);
+        for (size_t i = 0; i < count; i++) {
+            auto it = shared->pending.find(events[i].token);
+            if (it == shared->pending.end()) {
+                continue;
+            }
+            presented.emplace_back(it->second,
+                                   events[i].status == FENCE_SIGNALED ? events[i].signalTime : -1);
+            shared->pending.erase(it);
+        }
+    }
+    // Outside of the lock, as the callbacks may release the last reference to their owner
+    for (const auto &fence : presented) {
+        fence.first.onPresented(fence.first.context, fence.second);
+    }
+}
+
+bool PresentFenceWatcher::watch(int presentFenceFd, OnPresented onPresented, void *context) {
+    SharedWatcher &shared = getSharedWatcher();
+    std::lock_guard<std::mutex> lock(shared.lock);
+    if (shared.watcher == nullptr) {
+        FenceWatcherCallbacks callbacks{};
+        callbacks.context = &shared;
+        callbacks.onEvents = onPresentFencesSignaled;
+        callbacks.resolveSignalTime = get_signal_time;
+        shared.watcher = FenceWatcher::create(callbacks);
+    }
+    if (shared.watcher == nullptr) {
+        close(presentFenceFd);
+        return false;
+    }
+    int64_t token = shared.nextToken++;
+    shared.pending[token] = PresentFenceCallback{onPresented, context};
+    int64_t deadline = FenceWatcher::now() + PRESENT_FENCE_TIMEOUT_NANOS;
+    if (!shared.watcher->watch(presentFenceFd, token, deadline)) {
+        // The watcher already closed the fence
+        shared.pending.erase(token);
+        return false;
+    }
+    return true;
+}
+
+size_t PresentFenceWatcher::pendingCount() {
+    SharedWatcher &shared = getSharedWatcher();
+    std::lock_guard<std::mutex> lock(shared.lock);
+    return shared.pending.size();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_PRESENT_FENCE_WATCHER_H
+#define ANDROIDX_PRESENT_FENCE_WATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Present fences that have not signaled this long after the transaction completed are reported
+ * with an unknown present time.
+ */
+static constexpr int64_t PRESENT_FENCE_TIMEOUT_NANOS = 1000000000LL;
+
+/**
+ * Waits for the present fences of completed transactions that have not signaled yet, on a single
+ * FenceWatcher thread shared by every FrameScheduler and FrameTimelineRecorder of the process.
+ * The thread is started by the first fence watched and lives as long as the process.
+ */
+class PresentFenceWatcher {
+public:
+    /**
+     * Invoked on the watcher thread with the time the fence signaled in the CLOCK_MONOTONIC time
+     * domain, or -1 if it signaled with an error or did not signal within
+     * PRESENT_FENCE_TIMEOUT_NANOS.
+     */
+    typedef void (*OnPresented)(void *context, int64_t presentTime);
+
+    /**
+     * Invokes onPresented once presentFenceFd signals. Takes ownership of presentFenceFd. Returns
+     * false, without invoking onPresented, if the fence cannot be watched. The caller keeps the
+     * context alive until onPresented is invoked.
+     */
+    static bool watch(int presentFenceFd, OnPresented onPresented, void *context);
+
+    /**
+     * Number of fences still being watched.
+     */
+    static size_t pendingCount();
+};
+
+#endif //ANDROIDX_PRESENT_FENCE_WATCHER_H
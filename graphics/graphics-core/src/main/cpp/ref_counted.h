@@ -0,0 +1,49 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDX_REF_COUNTED_H
+#define ANDROIDX_REF_COUNTED_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Reference count of objects whose native callbacks may outlive their owner. T is deleted once
+ * the last reference is released, it must befriend RefCounted<T> if its destructor is private.
+ * Objects start with a single reference held by their creator.
+ */
+template <typename T>
+class RefCounted {
+public:
+    void acquire() {
+        mRefCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() {
+        if (mRefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete static_cast<T *>(this);
+        }
+    }
+
+protected:
+    RefCounted() = default;
+    ~RefCounted() = default;
+
+private:
+    std::atomic<int32_t> mRefCount{1};
+};
+
+#endif //ANDROIDX_REF_COUNTED_H
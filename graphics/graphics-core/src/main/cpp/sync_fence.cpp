@@ -22,10 +22,18 @@
 #include <poll.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/sync_file.h>
+#include <cstring>
+#include <ctime>
 #include <android/file_descriptor_jni.h>
 #include <errno.h>
 #include <dlfcn.h>
+#include <atomic>
 #include <mutex>
+#include <vector>
+#include "fence_watcher.h"
+#include "sync_fence.h"
 
 static constexpr int64_t SIGNAL_TIME_INVALID = -1;
 static constexpr int64_t SIGNAL_TIME_PENDING = INT64_MAX;
@@ -165,25 +173,144 @@ void SyncFenceBindings_nForceClose(JNIEnv *env, jclass, jint fd) {
     }
 }
 
-jlong SyncFenceBindings_nGetSignalTime(JNIEnv *env, jclass, jint fd) {
+/**
+ * Number of fences of a sync_file that can be queried without allocating. Most sync_files hold a
+ * single fence, or a few once merged.
+ */
+static constexpr size_t INLINE_FENCE_COUNT = 4;
+
+/**
+ * Set once SYNC_IOC_FILE_INFO or SYNC_IOC_MERGE turned out to be unsupported by the kernel, which
+ * then only implements the legacy sync ioctls that sync_file_info of libsync translates.
+ */
+static std::atomic<bool> legacy_sync_ioctls{false};
+
+static int sync_ioctl(int fd, unsigned long request, void *arg) {
+    int ret;
+    do {
+        ret = ioctl(fd, request, arg);
+    } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+    return ret;
+}
+
+/**
+ * Scratch space for the fences reported by SYNC_IOC_FILE_INFO, one per thread, reused across
+ * queries and only grown, to the sync_file with the most fences the thread queried.
+ * sync_file_info of libsync issues two ioctls and allocates the result of every query, while a
+ * query into the scratch space usually is a single ioctl.
+ */
+class SyncFileInfoScratch {
+public:
+    /**
+     * Queries the status of the sync_file, 1 once signaled, 0 while pending and negative on error,
+     * along with its signal time as returned by get_signal_time. Returns false with errno set if
+     * the ioctl failed.
+     */
+    bool query(int fd, int32_t *status, int64_t *signalTime) {
+        struct sync_file_info info{};
+        while (true) {
+            memset(&info, 0, sizeof(info));
+            info.num_fences = static_cast<uint32_t>(capacity());
+            info.sync_fence_info = reinterpret_cast<uintptr_t>(fences());
+            if (sync_ioctl(fd, SYNC_IOC_FILE_INFO, &info) == 0) {
+                break;
+            }
+            if (errno != EINVAL) {
+                return false;
+            }
+            // Also returned if the sync_file has more fences than fit, query how many it has
+            memset(&info, 0, sizeof(info));
+            if (sync_ioctl(fd, SYNC_IOC_FILE_INFO, &info) != 0) {
+                return false;
+            }
+            if (info.num_fences <= capacity()) {
+                errno = EINVAL;
+                return false;
+            }
+            mFences.resize(info.num_fences);
+        }
+
+        *status = info.status;
+        if (info.status != 1) {
+            *signalTime = info.status < 0 ? SIGNAL_TIME_INVALID : SIGNAL_TIME_PENDING;
+            return true;
+        }
+        uint64_t timestamp = 0;
+        const struct sync_fence_info *pinfo = fences();
+        for (size_t i = 0; i < info.num_fences; i++) {
+            if (pinfo[i].timestamp_ns > timestamp) {
+                timestamp = pinfo[i].timestamp_ns;
+            }
+        }
+        *signalTime = static_cast<int64_t>(timestamp);
+        return true;
+    }
+
+private:
+    struct sync_fence_info *fences() {
+        return mFences.empty() ? mInlineFences : mFences.data();
+    }
+
+    size_t capacity() const {
+        return mFences.empty() ? INLINE_FENCE_COUNT : mFences.size();
+    }
+
+    struct sync_fence_info mInlineFences[INLINE_FENCE_COUNT];
+    std::vector<struct sync_fence_info> mFences;
+};
+
+/**
+ * Scratch space of the calling thread, kept until the thread exits so that repeated queries do not
+ * allocate.
+ */
+static SyncFileInfoScratch &get_thread_scratch() {
+    static thread_local SyncFileInfoScratch scratch;
+    return scratch;
+}
+
+/**
+ * Resolves the status and signal time of a fence with the scratch space, falling back to
+ * sync_file_info of libsync on kernels that only implement the legacy sync ioctls.
+ */
+static void resolve_fence(SyncFileInfoScratch &scratch, int fd, int32_t *status,
+                          int64_t *signalTime) {
     // Implementation sampled from Fence::getSignalTime in the framework
+    *status = -EINVAL;
+    *signalTime = SIGNAL_TIME_INVALID;
     if (fd == -1) {
-        return SIGNAL_TIME_INVALID;
+        return;
+    }
+
+    if (!legacy_sync_ioctls.load(std::memory_order_relaxed)) {
+        if (scratch.query(fd, status, signalTime)) {
+            if (*status < 0) {
+                ALOGE("nGetSignalTime: sync_file_info contains an error: <%d> for fd: <%d>",
+                      *status, fd);
+            }
+            return;
+        }
+        if (errno != ENOTTY) {
+            *status = -errno;
+            return;
+        }
     }
 
+    // The file descriptor is not a sync_file, or the kernel predates SYNC_IOC_FILE_INFO
     struct sync_file_info* finfo = get_sync_file_info(fd);
     if (finfo == nullptr) {
-        return SIGNAL_TIME_INVALID;
+        return;
     }
+    legacy_sync_ioctls.store(true, std::memory_order_relaxed);
 
+    *status = finfo->status;
     if (finfo->status != 1) {
-        const auto status = finfo->status;
-        if (status < 0) {
-            ALOGE("nGetSignalTime: sync_file_info contains an error: <%d> for fd: <%d>", status,
-                  fd);
+        if (finfo->status < 0) {
+            ALOGE("nGetSignalTime: sync_file_info contains an error: <%d> for fd: <%d>",
+                  finfo->status, fd);
         }
+        *signalTime = finfo->status < 0 ? SIGNAL_TIME_INVALID : SIGNAL_TIME_PENDING;
         release_sync_file_info(finfo);
-        return status < 0 ? SIGNAL_TIME_INVALID : SIGNAL_TIME_PENDING;
+        return;
     }
 
     uint64_t timestamp = 0;
@@ -195,7 +322,29 @@ jlong SyncFenceBindings_nGetSignalTime(JNIEnv *env, jclass, jint fd) {
     }
 
     release_sync_file_info(finfo);
-    return static_cast<int64_t>(timestamp);
+    *signalTime = static_cast<int64_t>(timestamp);
+}
+
+int64_t get_signal_time(int fd) {
+    int32_t status;
+    int64_t signalTime;
+    resolve_fence(get_thread_scratch(), fd, &status, &signalTime);
+    return signalTime;
+}
+
+void get_signal_times(const int *fds, size_t count, int64_t *signalTimes, int32_t *statuses) {
+    SyncFileInfoScratch &scratch = get_thread_scratch();
+    for (size_t i = 0; i < count; i++) {
+        int32_t status;
+        resolve_fence(scratch, fds[i], &status, &signalTimes[i]);
+        if (statuses != nullptr) {
+            statuses[i] = status;
+        }
+    }
+}
+
+jlong SyncFenceBindings_nGetSignalTime(JNIEnv *env, jclass, jint fd) {
+    return static_cast<jlong>(get_signal_time(fd));
 }
 
 // Implementation of sync_wait obtained from libsync/sync.c in the framework
@@ -241,6 +390,220 @@ jboolean SyncFence_nWait(JNIEnv *env, jobject, jint fd, jint timeout_millis) {
     return static_cast<jboolean>(err == 0);
 }
 
+/**
+ * Owns the file descriptors duplicated from an array of SyncFenceV19 objects, with -1 standing in
+ * for invalid fences, and closes them once out of scope.
+ */
+class ScopedFenceFds {
+public:
+    ScopedFenceFds(JNIEnv *env, jobjectArray fences) {
+        jsize count = fences != nullptr ? env->GetArrayLength(fences) : 0;
+        mFds.reserve(static_cast<size_t>(count));
+        for (jsize i = 0; i < count; i++) {
+            jobject fence = env->GetObjectArrayElement(fences, i);
+            mFds.push_back(fence != nullptr ? dup_fence_fd(env, fence) : -1);
+            env->DeleteLocalRef(fence);
+        }
+    }
+
+    ~ScopedFenceFds() {
+        for (int fd : mFds) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    const std::vector<int> &fds() const {
+        return mFds;
+    }
+
+private:
+    std::vector<int> mFds;
+};
+
+static int64_t monotonic_time_millis() {
+    struct timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+/**
+ * Argument of the merge ioctl of the legacy sync ioctls, from libsync/sync.c in the framework.
+ */
+struct sync_legacy_merge_data {
+    int32_t fd2;
+    char name[32];
+    int32_t fence;
+};
+
+#define SYNC_IOC_LEGACY_MERGE _IOWR(SYNC_IOC_MAGIC, 1, struct sync_legacy_merge_data)
+
+/**
+ * Merges two sync_files into a new one that signals once both have signaled. Implementation of
+ * sync_merge obtained from libsync/sync.c in the framework, issuing the ioctls directly as the NDK
+ * only exposes sync_merge from API level 26. Falls back to the legacy merge ioctl on kernels that
+ * predate SYNC_IOC_MERGE, as resolve_fence does for SYNC_IOC_FILE_INFO.
+ */
+static int merge_sync_files(const char *name, int fd1, int fd2) {
+    if (!legacy_sync_ioctls.load(std::memory_order_relaxed)) {
+        struct sync_merge_data data{};
+        strncpy(data.name, name, sizeof(data.name) - 1);
+        data.fd2 = fd2;
+        if (sync_ioctl(fd1, SYNC_IOC_MERGE, &data) == 0) {
+            return data.fence;
+        }
+        if (errno != ENOTTY) {
+            return -1;
+        }
+    }
+
+    struct sync_legacy_merge_data legacyData{};
+    strncpy(legacyData.name, name, sizeof(legacyData.name) - 1);
+    legacyData.fd2 = fd2;
+    if (sync_ioctl(fd1, SYNC_IOC_LEGACY_MERGE, &legacyData) != 0) {
+        return -1;
+    }
+    legacy_sync_ioctls.store(true, std::memory_order_relaxed);
+    return legacyData.fence;
+}
+
+/**
+ * Waits with a single poll call for any or all of the file descriptors to signal. Invalid file
+ * descriptors are treated as signaled. Returns the index of a signaled file descriptor, or of the
+ * last one to signal when waiting for all of them, or -1 on timeout or error.
+ */
+static int sync_wait_multiple(const std::vector<int> &fds, bool waitAll, int timeout) {
+    std::vector<struct pollfd> pollFds(fds.size());
+    size_t pending = 0;
+    int signaled = -1;
+    for (size_t i = 0; i < fds.size(); i++) {
+        pollFds[i].fd = fds[i];
+        pollFds[i].events = POLLIN;
+        if (fds[i] < 0) {
+            signaled = static_cast<int>(i);
+            if (!waitAll) {
+                return signaled;
+            }
+        } else {
+            pending++;
+        }
+    }
+
+    int64_t deadline = timeout < 0 ? -1 : monotonic_time_millis() + timeout;
+    while (pending > 0) {
+        int remaining = -1;
+        if (deadline >= 0) {
+            int64_t now = monotonic_time_millis();
+            remaining = deadline > now ? static_cast<int>(deadline - now) : 0;
+        }
+        int ret = poll(pollFds.data(), pollFds.size(), remaining);
+        if (ret == 0) {
+            errno = ETIME;
+            return -1;
+        } else if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        for (size_t i = 0; i < pollFds.size(); i++) {
+            if (pollFds[i].fd < 0 || pollFds[i].revents == 0) {
+                continue;
+            }
+            if (pollFds[i].revents & (POLLERR | POLLNVAL)) {
+                errno = EINVAL;
+                return -1;
+            }
+            if (!waitAll) {
+                return static_cast<int>(i);
+            }
+            // Negative file descriptors are ignored by poll
+            pollFds[i].fd = -1;
+            signaled = static_cast<int>(i);
+            pending--;
+        }
+    }
+    return signaled;
+}
+
+jint SyncFenceBindings_nMerge(JNIEnv *env, jclass, jstring name, jobjectArray fences) {
+    ScopedFenceFds fenceFds(env, fences);
+    const char *mergeName = env->GetStringUTFChars(name, nullptr);
+    int merged = -1;
+    for (int fd : fenceFds.fds()) {
+        if (fd == -1) {
+            continue;
+        }
+        int next = merged == -1 ? dup(fd) : merge_sync_files(mergeName, merged, fd);
+        if (merged != -1) {
+            close(merged);
+        }
+        merged = next;
+        if (merged == -1) {
+            ALOGE("nMerge: unable to merge fence fd: <%d>", fd);
+            break;
+        }
+    }
+    env->ReleaseStringUTFChars(name, mergeName);
+    return static_cast<jint>(merged);
+}
+
+jint SyncFenceBindings_nWaitAny(JNIEnv *env, jclass, jobjectArray fences, jint timeout_millis) {
+    ScopedFenceFds fenceFds(env, fences);
+    if (fenceFds.fds().empty()) {
+        return -1;
+    }
+    return static_cast<jint>(sync_wait_multiple(fenceFds.fds(), false, timeout_millis));
+}
+
+jboolean SyncFenceBindings_nWaitAll(JNIEnv *env, jclass, jobjectArray fences,
+                                    jint timeout_millis) {
+    ScopedFenceFds fenceFds(env, fences);
+    if (fenceFds.fds().empty()) {
+        return static_cast<jboolean>(true);
+    }
+    return static_cast<jboolean>(
+            sync_wait_multiple(fenceFds.fds(), true, timeout_millis) != -1);
+}
+
+void SyncFenceBindings_nGetSignalTimes(JNIEnv *env, jclass, jobjectArray fences,
+                                       jlongArray signalTimes) {
+    ScopedFenceFds fenceFds(env, fences);
+    const std::vector<int> &fds = fenceFds.fds();
+    auto count = static_cast<jsize>(fds.size());
+    if (env->GetArrayLength(signalTimes) < count) {
+        return;
+    }
+    std::vector<jlong> times(fds.size());
+    get_signal_times(fds.data(), fds.size(), reinterpret_cast<int64_t *>(times.data()), nullptr);
+    env->SetLongArrayRegion(signalTimes, 0, count, times.data());
+}
+
+/**
+ * Resolves the signal times and statuses of the fence file descriptors in one call, see
+ * get_signal_times. The file descriptors remain owned by the caller. statuses may be null.
+ */
+void SyncFenceBindings_nGetFenceInfos(JNIEnv *env, jclass, jintArray fds, jlongArray signalTimes,
+                                      jintArray statuses) {
+    jsize count = env->GetArrayLength(fds);
+    if (env->GetArrayLength(signalTimes) < count ||
+        (statuses != nullptr && env->GetArrayLength(statuses) < count)) {
+        return;
+    }
+    std::vector<jint> fdValues(count);
+    std::vector<jlong> times(count);
+    std::vector<jint> statusValues(count);
+    env->GetIntArrayRegion(fds, 0, count, fdValues.data());
+    get_signal_times(reinterpret_cast<const int *>(fdValues.data()), fdValues.size(),
+                     reinterpret_cast<int64_t *>(times.data()),
+                     reinterpret_cast<int32_t *>(statusValues.data()));
+    env->SetLongArrayRegion(signalTimes, 0, count, times.data());
+    if (statuses != nullptr) {
+        env->SetIntArrayRegion(statuses, 0, count, statusValues.data());
+    }
+}
+
 jboolean SyncFenceBindings_nResolveSyncFileInfo(JNIEnv *env, jclass) {
     load_libsync();
     return sync_file_info_ptr != nullptr;
@@ -255,6 +618,123 @@ jint SyncFence_nDup(JNIEnv *env, jobject, jint fd) {
     return static_cast<jint>(dup(static_cast<int>(fd)));
 }
 
+/**
+ * Cached reference to SyncFenceWatcher#onFencesResolved
+ */
+static jmethodID gOnFencesResolvedMethod = nullptr;
+
+/**
+ * State shared between a SyncFenceWatcher and the callbacks of its native FenceWatcher. It is
+ * released on the watcher thread once that thread exits.
+ */
+struct SyncFenceWatcherContext {
+    JavaVM *vm = nullptr;
+    jobject watcher = nullptr;
+    bool attached = false;
+    std::vector<jlong> tokens;
+    std::vector<jlong> signalTimes;
+};
+
+static JNIEnv *get_watcher_thread_env(SyncFenceWatcherContext *context) {
+    JNIEnv *env = nullptr;
+    if (context->vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        if (context->vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+            ALOGW("Unable to attach fence watcher thread");
+            return nullptr;
+        }
+        context->attached = true;
+    }
+    return env;
+}
+
+static void on_fence_watcher_events(void *ctx, const FenceWatcherEvent *events, size_t count) {
+    auto context = reinterpret_cast<SyncFenceWatcherContext *>(ctx);
+    JNIEnv *env = get_watcher_thread_env(context);
+    if (env == nullptr) {
+        return;
+    }
+    context->tokens.resize(count);
+    context->signalTimes.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        context->tokens[i] = events[i].token;
+        switch (events[i].status) {
+            case FENCE_SIGNALED:
+                context->signalTimes[i] = events[i].signalTime;
+                break;
+            case FENCE_TIMED_OUT:
+                context->signalTimes[i] = SIGNAL_TIME_PENDING;
+                break;
+            default:
+                context->signalTimes[i] = SIGNAL_TIME_INVALID;
+                break;
+        }
+    }
+    auto size = static_cast<jsize>(count);
+    jlongArray tokens = env->NewLongArray(size);
+    jlongArray signalTimes = env->NewLongArray(size);
+    if (tokens != nullptr && signalTimes != nullptr) {
+        env->SetLongArrayRegion(tokens, 0, size, context->tokens.data());
+        env->SetLongArrayRegion(signalTimes, 0, size, context->signalTimes.data());
+        env->CallVoidMethod(context->watcher, gOnFencesResolvedMethod, tokens, signalTimes);
+    }
+    if (env->ExceptionCheck()) {
+        // Do not let an exception thrown by a callback leak into the next batch
+        env->ExceptionDescribe();
+        env->ExceptionClear();
+    }
+    env->DeleteLocalRef(tokens);
+    env->DeleteLocalRef(signalTimes);
+}
+
+static void on_fence_watcher_thread_exit(void *ctx) {
+    auto context = reinterpret_cast<SyncFenceWatcherContext *>(ctx);
+    JNIEnv *env = get_watcher_thread_env(context);
+    if (env != nullptr) {
+        env->DeleteGlobalRef(context->watcher);
+    }
+    if (context->attached) {
+        context->vm->DetachCurrentThread();
+    }
+    delete context;
+}
+
+jlong SyncFenceWatcher_nCreate(JNIEnv *env, jclass, jobject watcher) {
+    auto context = new SyncFenceWatcherContext();
+    env->GetJavaVM(&context->vm);
+    context->watcher = env->NewGlobalRef(watcher);
+
+    FenceWatcherCallbacks callbacks{};
+    callbacks.context = context;
+    callbacks.onEvents = on_fence_watcher_events;
+    callbacks.onThreadExit = on_fence_watcher_thread_exit;
+    callbacks.resolveSignalTime = get_signal_time;
+    FenceWatcher *fenceWatcher = FenceWatcher::create(callbacks);
+    if (fenceWatcher == nullptr) {
+        env->DeleteGlobalRef(context->watcher);
+        delete context;
+    }
+    return reinterpret_cast<jlong>(fenceWatcher);
+}
+
+jboolean SyncFenceWatcher_nWatch(JNIEnv *env, jclass, jlong watcher, jint fd, jlong token,
+                                 jlong timeoutNanos) {
+    int64_t deadline = timeoutNanos < 0 ? -1 : FenceWatcher::now() + timeoutNanos;
+    return static_cast<jboolean>(
+            reinterpret_cast<FenceWatcher *>(watcher)->watch(fd, token, deadline));
+}
+
+jboolean SyncFenceWatcher_nCancel(JNIEnv *env, jclass, jlong watcher, jlong token) {
+    return static_cast<jboolean>(reinterpret_cast<FenceWatcher *>(watcher)->cancel(token));
+}
+
+jint SyncFenceWatcher_nGetPendingCount(JNIEnv *env, jclass, jlong watcher) {
+    return static_cast<jint>(reinterpret_cast<FenceWatcher *>(watcher)->pendingCount());
+}
+
+void SyncFenceWatcher_nDestroy(JNIEnv *env, jclass, jlong watcher) {
+    FenceWatcher::destroy(reinterpret_cast<FenceWatcher *>(watcher));
+}
+
 static const JNINativeMethod SYNC_FENCE_METHOD_TABLE[] = {
         {
             "nClose",
@@ -293,6 +773,59 @@ static const JNINativeMethod SYNC_FENCE_BINDINGS_METHOD_TABLE[] = {
             "nForceClose",
             "(I)V",
                 (void *) SyncFenceBindings_nForceClose
+        },
+        {
+            "nMerge",
+            "(Ljava/lang/String;[Landroidx/hardware/SyncFenceV19;)I",
+            (void*)SyncFenceBindings_nMerge
+        },
+        {
+            "nWaitAny",
+            "([Landroidx/hardware/SyncFenceV19;I)I",
+            (void*)SyncFenceBindings_nWaitAny
+        },
+        {
+            "nWaitAll",
+            "([Landroidx/hardware/SyncFenceV19;I)Z",
+            (void*)SyncFenceBindings_nWaitAll
+        },
+        {
+            "nGetSignalTimes",
+            "([Landroidx/hardware/SyncFenceV19;[J)V",
+            (void*)SyncFenceBindings_nGetSignalTimes
+        },
+        {
+            "nGetFenceInfos",
+            "([I[J[I)V",
+            (void*)SyncFenceBindings_nGetFenceInfos
+        }
+};
+
+static const JNINativeMethod SYNC_FENCE_WATCHER_METHOD_TABLE[] = {
+        {
+            "nCreate",
+            "(Landroidx/hardware/SyncFenceWatcher;)J",
+            (void*)SyncFenceWatcher_nCreate
+        },
+        {
+            "nWatch",
+            "(JIJJ)Z",
+            (void*)SyncFenceWatcher_nWatch
+        },
+        {
+            "nCancel",
+            "(JJ)Z",
+            (void*)SyncFenceWatcher_nCancel
+        },
+        {
+            "nGetPendingCount",
+            "(J)I",
+            (void*)SyncFenceWatcher_nGetPendingCount
+        },
+        {
+            "nDestroy",
+            "(J)V",
+            (void*)SyncFenceWatcher_nDestroy
         }
 };
 
@@ -317,5 +850,21 @@ jint loadSyncFenceMethods(JNIEnv* env) {
         return JNI_ERR;
     }
 
+    jclass syncFenceWatcherClass = env->FindClass("androidx/hardware/SyncFenceWatcher");
+    if (syncFenceWatcherClass == nullptr) {
+        return JNI_ERR;
+    }
+
+    if (env->RegisterNatives(syncFenceWatcherClass, SYNC_FENCE_WATCHER_METHOD_TABLE,
+                    sizeof(SYNC_FENCE_WATCHER_METHOD_TABLE) / sizeof(JNINativeMethod)) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    gOnFencesResolvedMethod =
+            env->GetMethodID(syncFenceWatcherClass, "onFencesResolved", "([J[J)V");
+    if (gOnFencesResolvedMethod == nullptr) {
+        return JNI_ERR;
+    }
+
     return JNI_OK;
 }
@@ -19,4 +19,23 @@
 
 jint loadSyncFenceMethods(JNIEnv* env);
 
+/**
+ * Returns a duplicate of the file descriptor of the given SyncFenceV19, or -1 if it is invalid.
+ * The caller owns the returned file descriptor.
+ */
+int dup_fence_fd(JNIEnv *env, jobject syncFence);
+
+/**
+ * Returns the time the fence signaled in the CLOCK_MONOTONIC time domain, INT64_MAX if it has not
+ * signaled yet or -1 if the time cannot be resolved.
+ */
+int64_t get_signal_time(int fd);
+
+/**
+ * Resolves the signal times of count fences as get_signal_time does, reusing the memory the fence
+ * info is queried into. If statuses is not null, it receives the status of each sync_file: 1 once
+ * signaled, 0 while pending and negative if the fence signaled with an error or is invalid.
+ */
+void get_signal_times(const int *fds, size_t count, int64_t *signalTimes, int32_t *statuses);
+
 #endif //ANDROIDX_SYNC_FENCE_H
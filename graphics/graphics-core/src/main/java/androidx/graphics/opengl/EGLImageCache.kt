@@ -0,0 +1,170 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.graphics.opengl
+
+import android.hardware.HardwareBuffer
+import android.opengl.EGLDisplay
+import android.opengl.GLES20
+import android.os.Build
+import androidx.annotation.RequiresApi
+import androidx.graphics.utils.JniVisible
+import androidx.hardware.HardwareBufferPool
+import androidx.hardware.SyncFenceV19
+
+/**
+ * Caches the EGLImage created for a [HardwareBuffer] along with a texture bound to it. Rendering
+ * into pooled buffers otherwise creates and destroys an EGLImage every frame through
+ * [androidx.opengl.EGLExt.eglCreateImageFromHardwareBuffer], which takes milliseconds on some
+ * drivers.
+ *
+ * Cached buffers are kept alive by the cache, so [evict] must be called when a buffer is released
+ * and [close] before [eglDisplay] is terminated. Buffers from a [HardwareBufferPool] are returned
+ * through [releaseToPool], which evicts the buffers the pool dropped. A cache created with
+ * [androidx.graphics.opengl.egl.EGLManager.createImageCache] is closed by
+ * [androidx.graphics.opengl.egl.EGLManager.release]. Once [capacity] buffers are cached, the
+ * least recently used one is evicted.
+ *
+ * This class is not thread safe and must be used on the thread where a GL context created with
+ * [eglDisplay] is current.
+ */
+@RequiresApi(Build.VERSION_CODES.O)
+@JniVisible
+internal class EGLImageCache(val eglDisplay: EGLDisplay, val capacity: Int = DEFAULT_CAPACITY) :
+    AutoCloseable {
+
+    /**
+     * @property evictions Buffers evicted to stay within [capacity]
+     * @property size Buffers currently cached
+     */
+    data class Stats(val hits: Long, val misses: Long, val evictions: Long, val size: Long)
+
+    private var mNativeCache: Long = nCreate(eglDisplay.nativeHandle, capacity)
+
+    init {
+        if (mNativeCache == 0L) {
+            throw IllegalStateException("Unable to create EGLImage cache")
+        }
+    }
+
+    /**
+     * Returns the texture bound to the EGLImage of [hardwareBuffer], creating both on first use.
+     * The texture is left bound to [target] and is owned by the cache.
+     *
+     * @return The texture name, or 0 if the EGLImage could not be created
+     */
+    fun getTexture(hardwareBuffer: HardwareBuffer, target: Int = GLES20.GL_TEXTURE_2D): Int {
+        checkNotClosed()
+        return nGetTexture(mNativeCache, hardwareBuffer, target)
+    }
+
+    /**
+     * Destroys the EGLImage and texture of [hardwareBuffer].
+     *
+     * @return `false` if [hardwareBuffer] is not cached
+     */
+    fun evict(hardwareBuffer: HardwareBuffer): Boolean =
+        mNativeCache != 0L && nEvict(mNativeCache, hardwareBuffer)
+
+    /**
+     * Destroys the EGLImage and texture of every buffer that [pool] no longer holds, such as those
+     * it evicted to make room for other buffers or released in [HardwareBufferPool.trim].
+     *
+     * @return The number of buffers evicted
+     */
+    fun evictUnpooled(pool: HardwareBufferPool): Int {
+        checkNotClosed()
+        return pool.withNativePool { nativePool -> nEvictUnpooled(mNativeCache, nativePool) }
+    }
+
+    /**
+     * Returns [hardwareBuffer] to [pool] along with [fence], which the caller keeps ownership of,
+     * then evicts the buffers that [pool] no longer holds. The image of [hardwareBuffer] stays
+     * cached while the pool holds it, so that it is reused the next time the pool hands it out.
+     *
+     * @return `false` if [hardwareBuffer] was not obtained from [pool] or was already released
+     */
+    fun releaseToPool(
+        pool: HardwareBufferPool,
+        hardwareBuffer: HardwareBuffer,
+        fence: SyncFenceV19? = null
+    ): Boolean {
+        val released = pool.release(hardwareBuffer, fence)
+        evictUnpooled(pool)
+        return released
+    }
+
+    /** Destroys every cached EGLImage and texture. */
+    fun clear() {
+        if (mNativeCache != 0L) {
+            nClear(mNativeCache)
+        }
+    }
+
+    val stats: Stats
+        get() {
+            val fields = LongArray(STATS_FIELDS)
+            if (mNativeCache != 0L) {
+                nGetStats(mNativeCache, fields)
+            }
+            return Stats(fields[0], fields[1], fields[2], fields[3])
+        }
+
+    val isClosed: Boolean
+        get() = mNativeCache == 0L
+
+    override fun close() {
+        if (mNativeCache != 0L) {
+            nDestroy(mNativeCache)
+            mNativeCache = 0L
+        }
+    }
+
+    private fun checkNotClosed() {
+        if (mNativeCache == 0L) {
+            throw IllegalStateException("EGLImageCache is closed")
+        }
+    }
+
+    companion object {
+        const val DEFAULT_CAPACITY = 8
+
+        // Must be kept in sync with EGL_IMAGE_CACHE_STATS_FIELDS
+        private const val STATS_FIELDS = 4
+
+        @JvmStatic @JniVisible external fun nCreate(eglDisplay: Long, capacity: Int): Long
+
+        @JvmStatic
+        @JniVisible
+        external fun nGetTexture(cache: Long, hardwareBuffer: HardwareBuffer, target: Int): Int
+
+        @JvmStatic
+        @JniVisible
+        external fun nEvict(cache: Long, hardwareBuffer: HardwareBuffer): Boolean
+
+        @JvmStatic @JniVisible external fun nEvictUnpooled(cache: Long, pool: Long): Int
+
+        @JvmStatic @JniVisible external fun nClear(cache: Long)
+
+        @JvmStatic @JniVisible external fun nGetStats(cache: Long, out: LongArray)
+
+        @JvmStatic @JniVisible external fun nDestroy(cache: Long)
+
+        init {
+            System.loadLibrary("graphics-core")
+        }
+    }
+}
@@ -21,6 +21,9 @@ import android.opengl.EGLConfig
 import android.opengl.EGLContext
 import android.opengl.EGLSurface
 import android.opengl.GLES20
+import android.os.Build
+import androidx.annotation.RequiresApi
+import androidx.graphics.opengl.EGLImageCache
 import androidx.opengl.EGLExt
 import androidx.opengl.EGLExt.Companion.EGL_KHR_SURFACELESS_CONTEXT
 
@@ -42,6 +45,9 @@ class EGLManager(eglSpec: EGLSpec = EGLSpec.V14) {
     private var mIsSingleBuffered: Boolean = false
     private var mQueryResult: IntArray? = null
 
+    /** Caches created with [createImageCache], closed by [release] before the context */
+    private val mImageCaches = ArrayList<AutoCloseable>()
+
     /**
      * Initialize the EGLManager. This initializes the default display as well as queries the
      * supported extensions
@@ -101,6 +107,9 @@ class EGLManager(eglSpec: EGLSpec = EGLSpec.V14) {
      * instance if it was previously initialized. The configured EGLVersion as well as EGLExtensions
      */
     fun release() {
+        // The textures and images of the caches are destroyed while the context is still current
+        mImageCaches.forEach { it.close() }
+        mImageCaches.clear()
         mEglContext.let {
             if (it != EGL14.EGL_NO_CONTEXT) {
                 eglSpec.eglDestroyContext(it)
@@ -123,6 +132,15 @@ class EGLManager(eglSpec: EGLSpec = EGLSpec.V14) {
         }
     }
 
+    /**
+     * Creates an [EGLImageCache] for the current display, which [release] closes before the
+     * context is destroyed. Must be called on the thread where the context created by
+     * [createContext] is current.
+     */
+    @RequiresApi(Build.VERSION_CODES.O)
+    internal fun createImageCache(capacity: Int = EGLImageCache.DEFAULT_CAPACITY): EGLImageCache =
+        EGLImageCache(EGL14.eglGetCurrentDisplay(), capacity).also { mImageCaches.add(it) }
+
     val eglSpec: EGLSpec
         @Suppress("AcronymName") @JvmName("getEGLSpec") get() = mEglSpec
 
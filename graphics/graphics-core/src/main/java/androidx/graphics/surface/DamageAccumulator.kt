@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.graphics.surface
+
+import android.graphics.Rect
+
+/**
+ * Collects the rects damaged while rendering a frame so that they can be applied with
+ * [SurfaceControlWrapper.Transaction.setDamageRegion]. There the rects are coalesced into at most
+ * [maxRects] non-overlapping rects, merging nearby rects whenever the pixels this adds cost less
+ * than [perRectCost], and set with a single native call. Forwarding every rect makes some
+ * compositors fall back to recomposing the whole frame, while forwarding only the bounds, as
+ * [SurfaceControlWrapper.Transaction.setDamageRegion] does for a
+ * [android.graphics.Region], recomposes everything between two distant rects.
+ *
+ * Rects are stored in a reused array, so adding them does not allocate once it has grown. This
+ * class is not thread safe.
+ *
+ * @param maxRects Maximum number of rects in the damage region
+ * @param perRectCost Cost of each additional rect in the damage region, in pixels
+ */
+internal class DamageAccumulator(
+    val maxRects: Int = DEFAULT_MAX_RECTS,
+    val perRectCost: Long = DEFAULT_PER_RECT_COST
+) {
+
+    init {
+        require(maxRects > 0) { "maxRects must be positive" }
+    }
+
+    internal var rects = IntArray(INITIAL_CAPACITY * 4)
+        private set
+
+    /** Number of rects added since the last [reset] */
+    var rectCount = 0
+        private set
+
+    /** Adds a damaged rect. Empty rects are ignored. */
+    fun add(left: Int, top: Int, right: Int, bottom: Int): DamageAccumulator {
+        if (left >= right || top >= bottom) {
+            return this
+        }
+        if ((rectCount + 1) * 4 > rects.size) {
+            rects = rects.copyOf(rects.size * 2)
+        }
+        val offset = rectCount * 4
+        rects[offset] = left
+        rects[offset + 1] = top
+        rects[offset + 2] = right
+        rects[offset + 3] = bottom
+        rectCount++
+        return this
+    }
+
+    /** Adds a damaged rect. Empty rects are ignored. */
+    fun add(rect: Rect): DamageAccumulator = add(rect.left, rect.top, rect.right, rect.bottom)
+
+    val isEmpty: Boolean
+        get() = rectCount == 0
+
+    /** Discards the added rects to start accumulating the damage of the next frame. */
+    fun reset() {
+        rectCount = 0
+    }
+
+    companion object {
+        const val DEFAULT_MAX_RECTS = 4
+
+        /** Roughly the area of a 32x32 tile */
+        const val DEFAULT_PER_RECT_COST = 1024L
+
+        private const val INITIAL_CAPACITY = 16
+    }
+}
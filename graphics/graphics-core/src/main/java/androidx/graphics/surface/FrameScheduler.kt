@@ -0,0 +1,171 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.graphics.surface
+
+import android.os.Build
+import androidx.annotation.RequiresApi
+import androidx.graphics.utils.JniVisible
+import java.util.concurrent.locks.ReentrantLock
+import kotlin.concurrent.withLock
+
+/**
+ * Predicts the vsyncs of the display from the present times of transactions committed through
+ * [SurfaceControlWrapper.Transaction.setFrameScheduler], to choose when to start rendering a frame
+ * and the value to pass to [SurfaceControlWrapper.Transaction.setDesiredPresentTime].
+ *
+ * Present times are collected natively from the transaction completed callbacks without calling
+ * back into Java. They are fitted to the vsync period to average out their jitter, and the time
+ * from the compositor latching a transaction until presenting it gives how long before a vsync a
+ * frame must be committed. Until enough frames have been presented, [schedule] falls back to
+ * [vsyncPeriodHintNanos] and to starting frames right away.
+ *
+ * @param vsyncPeriodHintNanos Vsync period of the display, such as 1e9 divided by
+ *   [android.view.Display.getRefreshRate]. Update it with [setVsyncPeriodHint] when the refresh
+ *   rate changes.
+ */
+@RequiresApi(Build.VERSION_CODES.Q)
+@JniVisible
+internal class FrameScheduler(vsyncPeriodHintNanos: Long) : AutoCloseable {
+
+    /**
+     * When to render a frame, in nanoseconds in the [System.nanoTime] time domain.
+     *
+     * @property startTimeNanos Time to start rendering, no earlier than when [schedule] was called
+     * @property commitDeadlineNanos Latest time to commit the transaction for it to be presented at
+     *   [desiredPresentTimeNanos]
+     * @property desiredPresentTimeNanos Predicted vsync to pass to
+     *   [SurfaceControlWrapper.Transaction.setDesiredPresentTime]
+     * @property vsyncPeriodNanos Predicted vsync period
+     */
+    data class Schedule(
+        val startTimeNanos: Long,
+        val commitDeadlineNanos: Long,
+        val desiredPresentTimeNanos: Long,
+        val vsyncPeriodNanos: Long
+    )
+
+    private val mLock = ReentrantLock()
+    private val mScheduleFields = LongArray(SCHEDULE_FIELDS)
+    private var mNativeScheduler: Long = nCreate(vsyncPeriodHintNanos)
+
+    init {
+        if (mNativeScheduler == 0L) {
+            throw IllegalArgumentException("Invalid vsync period $vsyncPeriodHintNanos")
+        }
+    }
+
+    /**
+     * Adds the present time of [transaction] once it completes. Pending transaction callbacks keep
+     * the native scheduler alive after [close].
+     */
+    internal fun attach(transaction: Long) {
+        mLock.withLock {
+            if (mNativeScheduler != 0L) {
+                JniBindings.nTransactionSetFrameScheduler(transaction, mNativeScheduler)
+            }
+        }
+    }
+
+    /**
+     * Replaces the vsync period hint and drops the present times collected so far, for instance
+     * when the refresh rate of the display changes.
+     */
+    fun setVsyncPeriodHint(vsyncPeriodHintNanos: Long) {
+        require(vsyncPeriodHintNanos > 0) { "Invalid vsync period $vsyncPeriodHintNanos" }
+        mLock.withLock { nSetVsyncPeriodHint(checkOpen(), vsyncPeriodHintNanos) }
+    }
+
+    /**
+     * Schedules the earliest frame that can be presented if rendering and committing it takes
+     * [workDurationNanos].
+     */
+    fun schedule(workDurationNanos: Long): Schedule =
+        mLock.withLock {
+            nSchedule(checkOpen(), workDurationNanos, mScheduleFields)
+            Schedule(mScheduleFields[0], mScheduleFields[1], mScheduleFields[2], mScheduleFields[3])
+        }
+
+    /**
+     * Returns up to [count] predicted vsync times, starting with the first one after now, or an
+     * empty array until a transaction was presented.
+     */
+    fun predictVsyncs(count: Int): LongArray {
+        require(count >= 0) { "Invalid count $count" }
+        val vsyncs = LongArray(count)
+        val predicted = mLock.withLock { nPredictVsyncs(checkOpen(), vsyncs) }
+        return if (predicted == count) vsyncs else vsyncs.copyOf(predicted)
+    }
+
+    /**
+     * Time from the compositor latching a transaction until presenting it, the largest of the
+     * recent frames.
+     */
+    val compositorLatencyNanos: Long
+        get() = mLock.withLock { nGetCompositorLatency(checkOpen()) }
+
+    /** Drops the present times collected so far. */
+    fun reset() {
+        mLock.withLock {
+            if (mNativeScheduler != 0L) {
+                nReset(mNativeScheduler)
+            }
+        }
+    }
+
+    override fun close() {
+        mLock.withLock {
+            if (mNativeScheduler != 0L) {
+                nRelease(mNativeScheduler)
+                mNativeScheduler = 0L
+            }
+        }
+    }
+
+    private fun checkOpen(): Long {
+        if (mNativeScheduler == 0L) {
+            throw IllegalStateException("FrameScheduler is closed")
+        }
+        return mNativeScheduler
+    }
+
+    companion object {
+        // Must be kept in sync with FRAME_SCHEDULE_FIELDS
+        private const val SCHEDULE_FIELDS = 4
+
+        @JvmStatic @JniVisible external fun nCreate(vsyncPeriodHint: Long): Long
+
+        @JvmStatic @JniVisible external fun nRelease(scheduler: Long)
+
+        @JvmStatic
+        @JniVisible
+        external fun nSetVsyncPeriodHint(scheduler: Long, vsyncPeriodHint: Long)
+
+        @JvmStatic
+        @JniVisible
+        external fun nSchedule(scheduler: Long, workDuration: Long, out: LongArray)
+
+        @JvmStatic @JniVisible external fun nPredictVsyncs(scheduler: Long, out: LongArray): Int
+
+        @JvmStatic @JniVisible external fun nGetCompositorLatency(scheduler: Long): Long
+
+        @JvmStatic @JniVisible external fun nReset(scheduler: Long)
+
+        init {
+            System.loadLibrary("graphics-core")
+        }
+    }
+}
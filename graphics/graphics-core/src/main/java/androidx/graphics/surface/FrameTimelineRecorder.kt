@@ -0,0 +1,211 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.graphics.surface
+
+import android.os.Build
+import androidx.annotation.RequiresApi
+import androidx.graphics.utils.JniVisible
+import java.util.concurrent.locks.ReentrantLock
+import kotlin.concurrent.withLock
+
+/**
+ * Records the timeline of transactions committed through [SurfaceControlWrapper.Transaction]:
+ * when each one was committed, latched, its buffer acquired and when it was presented. Records are
+ * kept in a native ring buffer of the last [capacity] transactions and are written from the
+ * transaction completed callbacks without calling back into Java, so recording has no per frame
+ * allocation.
+ *
+ * The present time is resolved from the present fence of the transaction. If the fence has not
+ * signaled yet when the transaction completes, the record is published once it does.
+ *
+ * @param capacity Number of most recent transactions kept
+ * @param traceName If not null, the latency and present delay of each frame are emitted as trace
+ *   counters prefixed with this name while systrace or Perfetto tracing is enabled
+ */
+@RequiresApi(Build.VERSION_CODES.Q)
+@JniVisible
+internal class FrameTimelineRecorder(
+    val capacity: Int = DEFAULT_CAPACITY,
+    traceName: String? = null
+) : AutoCloseable {
+
+    /**
+     * Timestamps of one transaction, in nanoseconds in the [System.nanoTime] time domain.
+     * Timestamps that are not known are -1.
+     */
+    data class Record(
+        val frameId: Long,
+        val desiredPresentTimeNanos: Long,
+        val commitTimeNanos: Long,
+        val latchTimeNanos: Long,
+        val acquireTimeNanos: Long,
+        val presentTimeNanos: Long,
+        val completeTimeNanos: Long
+    )
+
+    /**
+     * Statistics of the recorded transactions. Percentiles are -1 if no frame contributed to them.
+     *
+     * @property frameCount Number of recorded transactions
+     * @property missedDeadlineCount Frames with a desired present time that were presented later
+     *   than it plus the tolerance given to [getSummary]
+     * @property unknownPresentCount Frames whose present time could not be resolved
+     * @property latencyP50Nanos Median of the present time minus the commit time
+     * @property presentDelayP50Nanos Median of the present time minus the desired present time, for
+     *   frames with a desired present time
+     */
+    data class Summary(
+        val frameCount: Long,
+        val missedDeadlineCount: Long,
+        val unknownPresentCount: Long,
+        val latencyP50Nanos: Long,
+        val latencyP90Nanos: Long,
+        val latencyP99Nanos: Long,
+        val latencyMaxNanos: Long,
+        val presentDelayP50Nanos: Long,
+        val presentDelayP90Nanos: Long,
+        val presentDelayP99Nanos: Long,
+        val presentDelayMaxNanos: Long
+    )
+
+    private val mLock = ReentrantLock()
+    private var mNativeRecorder: Long = nCreate(capacity, traceName)
+
+    init {
+        if (mNativeRecorder == 0L) {
+            throw IllegalArgumentException("Invalid capacity $capacity")
+        }
+    }
+
+    /**
+     * Records [transaction] once it completes. Pending transaction callbacks keep the native
+     * recorder alive after [close].
+     */
+    internal fun attach(
+        transaction: Long,
+        surfaceControl: Long,
+        frameId: Long,
+        desiredPresentTimeNanos: Long
+    ) {
+        mLock.withLock {
+            if (mNativeRecorder != 0L) {
+                JniBindings.nTransactionSetFrameTimelineRecorder(
+                    transaction,
+                    mNativeRecorder,
+                    surfaceControl,
+                    frameId,
+                    desiredPresentTimeNanos
+                )
+            }
+        }
+    }
+
+    /**
+     * Computes the statistics of the recorded transactions.
+     *
+     * @param deadlineToleranceNanos Frames presented up to this long after their desired present
+     *   time are not counted as missing their deadline
+     */
+    fun getSummary(deadlineToleranceNanos: Long = 0): Summary {
+        val fields = LongArray(SUMMARY_FIELDS) { -1L }
+        mLock.withLock {
+            if (mNativeRecorder == 0L) {
+                throw IllegalStateException("FrameTimelineRecorder is closed")
+            }
+            nGetSummary(mNativeRecorder, fields, deadlineToleranceNanos)
+        }
+        return Summary(
+            fields[0],
+            fields[1],
+            fields[2],
+            fields[3],
+            fields[4],
+            fields[5],
+            fields[6],
+            fields[7],
+            fields[8],
+            fields[9],
+            fields[10]
+        )
+    }
+
+    /** Returns the recorded transactions, oldest first. */
+    fun getRecords(): List<Record> {
+        val fields = LongArray(capacity * RECORD_FIELDS)
+        val count =
+            mLock.withLock {
+                if (mNativeRecorder == 0L) {
+                    throw IllegalStateException("FrameTimelineRecorder is closed")
+                }
+                nCopyRecords(mNativeRecorder, fields)
+            }
+        return List(count) { i ->
+            val offset = i * RECORD_FIELDS
+            Record(
+                fields[offset],
+                fields[offset + 1],
+                fields[offset + 2],
+                fields[offset + 3],
+                fields[offset + 4],
+                fields[offset + 5],
+                fields[offset + 6]
+            )
+        }
+    }
+
+    /** Drops the transactions recorded so far. */
+    fun reset() {
+        mLock.withLock {
+            if (mNativeRecorder != 0L) {
+                nReset(mNativeRecorder)
+            }
+        }
+    }
+
+    override fun close() {
+        mLock.withLock {
+            if (mNativeRecorder != 0L) {
+                nRelease(mNativeRecorder)
+                mNativeRecorder = 0L
+            }
+        }
+    }
+
+    companion object {
+        const val DEFAULT_CAPACITY = 128
+
+        // Must be kept in sync with FRAME_TIMELINE_RECORD_FIELDS and FRAME_TIMELINE_SUMMARY_FIELDS
+        private const val RECORD_FIELDS = 7
+        private const val SUMMARY_FIELDS = 11
+
+        @JvmStatic @JniVisible external fun nCreate(capacity: Int, traceName: String?): Long
+
+        @JvmStatic @JniVisible external fun nRelease(recorder: Long)
+
+        @JvmStatic
+        @JniVisible
+        external fun nGetSummary(recorder: Long, out: LongArray, deadlineToleranceNanos: Long)
+
+        @JvmStatic @JniVisible external fun nCopyRecords(recorder: Long, out: LongArray): Int
+
+        @JvmStatic @JniVisible external fun nReset(recorder: Long)
+
+        init {
+            System.loadLibrary("graphics-core")
+        }
+    }
+}
@@ -25,6 +25,7 @@ import android.view.SurfaceControl
 import androidx.annotation.RequiresApi
 import androidx.graphics.utils.JniVisible
 import androidx.hardware.SyncFenceV19
+import java.nio.ByteBuffer
 import java.util.concurrent.Executor
 
 @JniVisible
@@ -105,6 +106,17 @@ internal class JniBindings {
         @JniVisible
         external fun nSetDamageRegion(surfaceTransaction: Long, surfaceControl: Long, rect: Rect?)
 
+        @JvmStatic
+        @JniVisible
+        external fun nSetCoalescedDamageRegion(
+            surfaceTransaction: Long,
+            surfaceControl: Long,
+            rects: IntArray,
+            count: Int,
+            maxRects: Int,
+            perRectCost: Long
+        )
+
         @JvmStatic
         @JniVisible
         external fun nSetDesiredPresentTime(surfaceTransaction: Long, desiredPresentTime: Long)
@@ -180,6 +192,28 @@ internal class JniBindings {
             changeFrameRateStrategy: Int
         )
 
+        @JvmStatic
+        @JniVisible
+        external fun nApplyTransactionCommands(
+            surfaceTransaction: Long,
+            commands: ByteBuffer,
+            length: Int
+        ): Int
+
+        @JvmStatic
+        @JniVisible
+        external fun nTransactionSetFrameTimelineRecorder(
+            surfaceTransaction: Long,
+            recorder: Long,
+            surfaceControl: Long,
+            frameId: Long,
+            desiredPresentTime: Long
+        )
+
+        @JvmStatic
+        @JniVisible
+        external fun nTransactionSetFrameScheduler(surfaceTransaction: Long, scheduler: Long)
+
         init {
             System.loadLibrary("graphics-core")
         }
@@ -221,6 +255,10 @@ internal class SurfaceControlWrapper {
     /** Compatibility class for ASurfaceTransaction. */
     class Transaction() {
         private var mNativeSurfaceTransaction: Long
+        private var mDesiredPresentTimeNanos = -1L
+        private var mFrameTimelineRecorder: FrameTimelineRecorder? = null
+        private var mFrameTimelineSurfaceControl = 0L
+        private var mFrameId = 0L
 
         init {
             mNativeSurfaceTransaction = JniBindings.nTransactionCreate()
@@ -238,7 +276,49 @@ internal class SurfaceControlWrapper {
          * are applied on the same thread are als guaranteed to be applied in order.
          */
         fun commit() {
+            mFrameTimelineRecorder?.let { recorder ->
+                // Attached right before applying so the recorded commit time is accurate
+                recorder.attach(
+                    mNativeSurfaceTransaction,
+                    mFrameTimelineSurfaceControl,
+                    mFrameId,
+                    mDesiredPresentTimeNanos
+                )
+                mFrameTimelineRecorder = null
+            }
             JniBindings.nTransactionApply(mNativeSurfaceTransaction)
+            mDesiredPresentTimeNanos = -1L
+        }
+
+        /**
+         * Records the timeline of this transaction into [recorder] once it is committed and
+         * presented.
+         *
+         * @param recorder The recorder the timeline is published to.
+         * @param surfaceControl The SurfaceControl whose buffer acquire time is recorded.
+         * @param frameId Identifier of the frame, such as a frame number, recorded with the
+         *   timeline.
+         */
+        fun setFrameTimelineRecorder(
+            recorder: FrameTimelineRecorder,
+            surfaceControl: SurfaceControlWrapper,
+            frameId: Long
+        ): Transaction {
+            mFrameTimelineRecorder = recorder
+            mFrameTimelineSurfaceControl = surfaceControl.mNativeSurfaceControl
+            mFrameId = frameId
+            return this
+        }
+
+        /**
+         * Adds the present time of this transaction to [scheduler] once it is presented, so that it
+         * can predict the vsyncs of the display.
+         *
+         * @param scheduler The scheduler the present time is added to.
+         */
+        fun setFrameScheduler(scheduler: FrameScheduler): Transaction {
+            scheduler.attach(mNativeSurfaceTransaction)
+            return this
         }
 
         // Suppression of PairedRegistration below is in order to match existing
@@ -391,6 +471,30 @@ internal class SurfaceControlWrapper {
             return this
         }
 
+        /**
+         * Updates the region for content on this surface updated in this transaction to the rects
+         * collected by [damage], coalesced into at most [DamageAccumulator.maxRects] rects. The
+         * accumulator is then reset for the next frame.
+         *
+         * @param surfaceControl The surface control for which we want to set the damage region of.
+         * @param damage The damaged rects. If no rect was added, the surface is not damaged.
+         */
+        fun setDamageRegion(
+            surfaceControl: SurfaceControlWrapper,
+            damage: DamageAccumulator
+        ): Transaction {
+            JniBindings.nSetCoalescedDamageRegion(
+                mNativeSurfaceTransaction,
+                surfaceControl.mNativeSurfaceControl,
+                damage.rects,
+                damage.rectCount,
+                damage.maxRects,
+                damage.perRectCost
+            )
+            damage.reset()
+            return this
+        }
+
         /**
          * Re-parents a given layer to a new parent. Children inherit transform (position, scaling)
          * crop, visibility, and Z-ordering from their parents, as if the children were pixels
@@ -432,6 +536,7 @@ internal class SurfaceControlWrapper {
          */
         fun setDesiredPresentTime(desiredPresentTimeNano: Long): Transaction {
             JniBindings.nSetDesiredPresentTime(mNativeSurfaceTransaction, desiredPresentTimeNano)
+            mDesiredPresentTimeNanos = desiredPresentTimeNano
             return this
         }
 
@@ -622,6 +727,28 @@ internal class SurfaceControlWrapper {
             return this
         }
 
+        /**
+         * Applies every command recorded in [commands] to this transaction with a single JNI call.
+         * The commands are applied in the order they were recorded, as if the corresponding
+         * methods of this transaction had been called. [commands] is not reset, so it can be
+         * applied to several transactions.
+         *
+         * @param commands The commands to apply.
+         * @throws IllegalStateException if the commands could not be decoded.
+         */
+        fun applyCommands(commands: TransactionCommandBuffer): Transaction {
+            if (commands.commandCount > 0) {
+                val applied =
+                    JniBindings.nApplyTransactionCommands(
+                        mNativeSurfaceTransaction,
+                        commands.buffer,
+                        commands.size
+                    )
+                check(applied >= 0) { "Unable to decode transaction commands" }
+            }
+            return this
+        }
+
         /** Destroys the transaction object. */
         fun close() {
             if (mNativeSurfaceTransaction != 0L) {
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.graphics.surface
+
+import android.graphics.Rect
+import android.os.Build
+import androidx.annotation.RequiresApi
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Records [SurfaceControlWrapper.Transaction] updates into a direct [ByteBuffer] so that they can
+ * be applied with a single JNI call through [SurfaceControlWrapper.Transaction.applyCommands]
+ * instead of one call per property. This is useful when many layers are updated every frame.
+ *
+ * Each command is encoded in native byte order as the opcode, the native handle of the target
+ * SurfaceControl and the arguments of the command. The encoding must be kept in sync with
+ * JniBindings_nApplyTransactionCommands.
+ *
+ * The buffer can be reused across frames by calling [reset] after its commands are applied.
+ */
+@RequiresApi(Build.VERSION_CODES.Q)
+internal class TransactionCommandBuffer(initialCapacity: Int = DEFAULT_CAPACITY) {
+
+    internal var buffer: ByteBuffer = allocate(maxOf(initialCapacity, MIN_CAPACITY))
+        private set
+
+    /** Number of bytes of encoded commands. */
+    internal val size: Int
+        get() = buffer.position()
+
+    /** Number of commands recorded since the last [reset]. */
+    var commandCount: Int = 0
+        private set
+
+    /** Discards the recorded commands, keeping the allocation. */
+    fun reset() {
+        buffer.clear()
+        commandCount = 0
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setVisibility] */
+    fun setVisibility(
+        surfaceControl: SurfaceControlWrapper,
+        visibility: Boolean
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_VISIBILITY, surfaceControl, 4)
+        buffer.putInt(if (visibility) 1 else 0)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setLayer] */
+    fun setLayer(surfaceControl: SurfaceControlWrapper, zOrder: Int): TransactionCommandBuffer {
+        begin(COMMAND_SET_Z_ORDER, surfaceControl, 4)
+        buffer.putInt(zOrder)
+        return this
+    }
+
+    /**
+     * Sets the damage region of the surface to the given rects. Unlike
+     * [SurfaceControlWrapper.Transaction.setDamageRegion] every rect is forwarded instead of the
+     * bounds of the region. If [rects] is null or empty, the entire buffer is assumed dirty.
+     */
+    fun setDamageRegion(
+        surfaceControl: SurfaceControlWrapper,
+        rects: Array<Rect>?
+    ): TransactionCommandBuffer {
+        val count = rects?.size ?: 0
+        begin(COMMAND_SET_DAMAGE_REGION, surfaceControl, 4 + count * 16)
+        buffer.putInt(count)
+        rects?.forEach { rect -> putRect(rect.left, rect.top, rect.right, rect.bottom) }
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setOpaque] */
+    fun setOpaque(
+        surfaceControl: SurfaceControlWrapper,
+        isOpaque: Boolean
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_BUFFER_TRANSPARENCY, surfaceControl, 4)
+        buffer.putInt(if (isOpaque) 2 else 0)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setAlpha] */
+    fun setAlpha(surfaceControl: SurfaceControlWrapper, alpha: Float): TransactionCommandBuffer {
+        if (alpha < 0.0f || alpha > 1.0f) {
+            throw IllegalArgumentException("Alpha value must be between 0.0 and 1.0.")
+        }
+        begin(COMMAND_SET_BUFFER_ALPHA, surfaceControl, 4)
+        buffer.putFloat(alpha)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setCrop] */
+    @RequiresApi(Build.VERSION_CODES.S)
+    fun setCrop(surfaceControl: SurfaceControlWrapper, crop: Rect?): TransactionCommandBuffer {
+        require((crop == null) || (crop.width() >= 0 && crop.height() >= 0)) {
+            throw IllegalArgumentException("width and height must be non-negative")
+        }
+        begin(COMMAND_SET_CROP, surfaceControl, 16)
+        if (crop == null) {
+            putRect(0, 0, 0, 0)
+        } else {
+            putRect(crop.left, crop.top, crop.right, crop.bottom)
+        }
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setPosition] */
+    @RequiresApi(Build.VERSION_CODES.S)
+    fun setPosition(
+        surfaceControl: SurfaceControlWrapper,
+        x: Float,
+        y: Float
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_POSITION, surfaceControl, 8)
+        buffer.putFloat(x)
+        buffer.putFloat(y)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setScale] */
+    @RequiresApi(Build.VERSION_CODES.S)
+    fun setScale(
+        surfaceControl: SurfaceControlWrapper,
+        scaleX: Float,
+        scaleY: Float
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_SCALE, surfaceControl, 8)
+        buffer.putFloat(scaleX)
+        buffer.putFloat(scaleY)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setBufferTransform] */
+    @RequiresApi(Build.VERSION_CODES.S)
+    fun setBufferTransform(
+        surfaceControl: SurfaceControlWrapper,
+        transformation: Int
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_BUFFER_TRANSFORM, surfaceControl, 4)
+        buffer.putInt(transformation)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setDataSpace] */
+    fun setDataSpace(
+        surfaceControl: SurfaceControlWrapper,
+        dataSpace: Int
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_DATA_SPACE, surfaceControl, 4)
+        buffer.putInt(dataSpace)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setGeometry] */
+    fun setGeometry(
+        surfaceControl: SurfaceControlWrapper,
+        width: Int,
+        height: Int,
+        dstWidth: Int,
+        dstHeight: Int,
+        transformation: Int
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_GEOMETRY, surfaceControl, 20)
+        buffer.putInt(width)
+        buffer.putInt(height)
+        buffer.putInt(dstWidth)
+        buffer.putInt(dstHeight)
+        buffer.putInt(transformation)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setFrameRate] */
+    fun setFrameRate(
+        surfaceControl: SurfaceControlWrapper,
+        frameRate: Float,
+        compatibility: Int,
+        changeFrameRateStrategy: Int
+    ): TransactionCommandBuffer {
+        begin(COMMAND_SET_FRAME_RATE, surfaceControl, 12)
+        buffer.putFloat(frameRate)
+        buffer.putInt(compatibility)
+        buffer.putInt(changeFrameRateStrategy)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.reparent] */
+    fun reparent(
+        surfaceControl: SurfaceControlWrapper,
+        newParent: SurfaceControlWrapper?
+    ): TransactionCommandBuffer {
+        begin(COMMAND_REPARENT, surfaceControl, 8)
+        buffer.putLong(newParent?.mNativeSurfaceControl ?: 0L)
+        return this
+    }
+
+    /** See [SurfaceControlWrapper.Transaction.setDesiredPresentTime] */
+    fun setDesiredPresentTime(desiredPresentTimeNano: Long): TransactionCommandBuffer {
+        ensureCapacity(HEADER_SIZE + 8)
+        buffer.putInt(COMMAND_SET_DESIRED_PRESENT_TIME)
+        buffer.putLong(0L)
+        buffer.putLong(desiredPresentTimeNano)
+        commandCount++
+        return this
+    }
+
+    private fun begin(command: Int, surfaceControl: SurfaceControlWrapper, argumentsSize: Int) {
+        ensureCapacity(HEADER_SIZE + argumentsSize)
+        buffer.putInt(command)
+        buffer.putLong(surfaceControl.mNativeSurfaceControl)
+        commandCount++
+    }
+
+    private fun putRect(left: Int, top: Int, right: Int, bottom: Int) {
+        buffer.putInt(left)
+        buffer.putInt(top)
+        buffer.putInt(right)
+        buffer.putInt(bottom)
+    }
+
+    private fun ensureCapacity(size: Int) {
+        if (buffer.remaining() < size) {
+            val grown = allocate(maxOf(buffer.capacity() * 2, buffer.position() + size))
+            buffer.flip()
+            grown.put(buffer)
+            buffer = grown
+        }
+    }
+
+    internal companion object {
+        // Opcodes, these must match the TransactionCommand enum in graphics-core.cpp
+        const val COMMAND_SET_VISIBILITY = 1
+        const val COMMAND_SET_Z_ORDER = 2
+        const val COMMAND_SET_DAMAGE_REGION = 3
+        const val COMMAND_SET_BUFFER_TRANSPARENCY = 4
+        const val COMMAND_SET_BUFFER_ALPHA = 5
+        const val COMMAND_SET_CROP = 6
+        const val COMMAND_SET_POSITION = 7
+        const val COMMAND_SET_SCALE = 8
+        const val COMMAND_SET_BUFFER_TRANSFORM = 9
+        const val COMMAND_SET_DATA_SPACE = 10
+        const val COMMAND_SET_GEOMETRY = 11
+        const val COMMAND_SET_FRAME_RATE = 12
+        const val COMMAND_REPARENT = 13
+        const val COMMAND_SET_DESIRED_PRESENT_TIME = 14
+
+        /** Size of the opcode and of the SurfaceControl handle preceding the arguments */
+        private const val HEADER_SIZE = 12
+
+        private const val MIN_CAPACITY = 64
+
+        /** Enough for the geometry, position and visibility of about 30 layers */
+        const val DEFAULT_CAPACITY = 4096
+
+        private fun allocate(capacity: Int): ByteBuffer =
+            ByteBuffer.allocateDirect(capacity).order(ByteOrder.nativeOrder())
+    }
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.hardware
+
+import android.hardware.HardwareBuffer
+import android.os.Build
+import androidx.annotation.RequiresApi
+import androidx.graphics.surface.JniBindings
+import androidx.graphics.surface.SurfaceControlWrapper
+import androidx.graphics.utils.JniVisible
+import java.util.concurrent.locks.ReentrantReadWriteLock
+import kotlin.concurrent.read
+import kotlin.concurrent.write
+
+/**
+ * Native pool of [HardwareBuffer] instances recycled by width, height, format and usage. Unlike
+ * [BufferPool], which waits on the release fence of a pooled buffer, a buffer returned with a
+ * release fence is only handed out again once its fence has signaled. If every matching buffer is
+ * still being read by the compositor, a new one is allocated instead, so [obtain] never blocks.
+ *
+ * The pool holds at most [maxBufferCount] buffers, in use or not. When it is full, the least
+ * recently released buffer is evicted to make room. This class is thread safe.
+ */
+@RequiresApi(Build.VERSION_CODES.O)
+@JniVisible
+internal class HardwareBufferPool(val maxBufferCount: Int) : AutoCloseable {
+
+    /**
+     * Counters of the pool since its creation.
+     *
+     * @property hits Requests served with a pooled buffer
+     * @property misses Requests that required an allocation or could not be served
+     * @property pendingSkips Requests that skipped a pooled buffer of the same kind as its release
+     *   fence was pending
+     * @property exhausted Requests that could not be served as every buffer was in use
+     * @property evictions Pooled buffers released to make room for another buffer, or by [trim]
+     * @property allocatedCount Buffers currently held by the pool, including those in use
+     * @property inUseCount Buffers currently obtained and not yet released
+     */
+    data class Stats(
+        val hits: Long,
+        val misses: Long,
+        val pendingSkips: Long,
+        val exhausted: Long,
+        val evictions: Long,
+        val allocatedCount: Long,
+        val inUseCount: Long
+    )
+
+    /**
+     * The native pool synchronizes obtain, release and trim itself, so they only hold the read lock
+     * to keep the pool from being destroyed under them. Destroying the pool, and deleting it once
+     * it is closed, holds the write lock.
+     */
+    private val mLock = ReentrantReadWriteLock()
+    private var mNativePool: Long = nCreate(maxBufferCount)
+    @Volatile private var mIsClosed = false
+
+    init {
+        if (mNativePool == 0L) {
+            throw IllegalArgumentException("Pool size must be at least 1")
+        }
+    }
+
+    /**
+     * Obtains a buffer with the given properties, either from the pool or newly allocated.
+     *
+     * @return The buffer, or null if all [maxBufferCount] buffers are in use or allocation failed
+     * @throws IllegalStateException if the pool is closed
+     */
+    fun obtain(width: Int, height: Int, format: Int, usage: Long): HardwareBuffer? =
+        mLock.read {
+            if (mIsClosed) {
+                throw IllegalStateException("Attempt to obtain a buffer from a closed pool")
+            }
+            nObtain(mNativePool, width, height, format, usage)
+        }
+
+    /**
+     * Returns [buffer] to the pool, which closes it. The buffer is handed out again once [fence]
+     * signals. The caller keeps ownership of [fence].
+     *
+     * @return `false` if [buffer] was not obtained from this pool or was already released
+     */
+    fun release(buffer: HardwareBuffer, fence: SyncFenceV19? = null): Boolean =
+        releaseWithFenceFd(buffer, if (fence != null) JniBindings.nDupFenceFd(fence) else -1)
+
+    /**
+     * Returns [buffer], which was last presented on [surfaceControl], to the pool along with its
+     * release fence from the transaction stats given to a transaction completed listener.
+     */
+    @RequiresApi(Build.VERSION_CODES.Q)
+    fun release(
+        buffer: HardwareBuffer,
+        surfaceControl: SurfaceControlWrapper,
+        transactionStats: Long
+    ): Boolean =
+        releaseWithFenceFd(
+            buffer,
+            JniBindings.nGetPreviousReleaseFenceFd(
+                surfaceControl.mNativeSurfaceControl,
+                transactionStats
+            )
+        )
+
+    /** Takes ownership of [fenceFd] */
+    private fun releaseWithFenceFd(buffer: HardwareBuffer, fenceFd: Int): Boolean {
+        // The pool can only be deleted by a release once it is closed
+        val result =
+            mLock.read { if (!mIsClosed) nRelease(mNativePool, buffer, fenceFd) else null }
+                ?: releaseToClosedPool(buffer, fenceFd)
+        val released = result != RELEASE_NOT_OWNED
+        if (released) {
+            buffer.close()
+        }
+        return released
+    }
+
+    /** Releases to a closed pool, which deletes it with its last buffer in use */
+    private fun releaseToClosedPool(buffer: HardwareBuffer, fenceFd: Int): Int =
+        mLock.write {
+            if (mNativePool == 0L) {
+                SyncFenceV19(fenceFd).close()
+                RELEASE_NOT_OWNED
+            } else {
+                val result = nRelease(mNativePool, buffer, fenceFd)
+                if (result == RELEASE_POOL_DELETED) {
+                    mNativePool = 0L
+                }
+                result
+            }
+        }
+
+    /**
+     * Releases the least recently released buffers that are not in use until at most
+     * [maxAvailableCount] remain, for example when the app goes to the background.
+     *
+     * @return The number of buffers released
+     */
+    fun trim(maxAvailableCount: Int = 0): Int =
+        mLock.read { if (!mIsClosed) nTrim(mNativePool, maxAvailableCount) else 0 }
+
+    val stats: Stats
+        get() {
+            val fields = LongArray(STATS_FIELDS)
+            mLock.read {
+                if (mNativePool != 0L) {
+                    nGetStats(mNativePool, fields)
+                }
+            }
+            return Stats(
+                fields[0],
+                fields[1],
+                fields[2],
+                fields[3],
+                fields[4],
+                fields[5],
+                fields[6]
+            )
+        }
+
+    val isClosed: Boolean
+        get() = mIsClosed
+
+    /**
+     * Calls [block] with the native pool, or 0 once it is deleted, which cannot be deleted until
+     * [block] returns.
+     */
+    internal fun <T> withNativePool(block: (Long) -> T): T = mLock.read { block(mNativePool) }
+
+    /**
+     * Releases the pooled buffers. Buffers still in use are released once they are returned
+     * through [release].
+     */
+    override fun close() {
+        mLock.write {
+            if (!mIsClosed) {
+                mIsClosed = true
+                if (nDestroy(mNativePool)) {
+                    mNativePool = 0L
+                }
+            }
+        }
+    }
+
+    companion object {
+        // Must be kept in sync with HardwareBufferPoolRelease and
+        // HARDWARE_BUFFER_POOL_STATS_FIELDS
+        private const val RELEASE_NOT_OWNED = 0
+        private const val RELEASE_POOL_DELETED = 2
+        private const val STATS_FIELDS = 7
+
+        @JvmStatic @JniVisible external fun nCreate(maxBufferCount: Int): Long
+
+        @JvmStatic
+        @JniVisible
+        external fun nObtain(
+            pool: Long,
+            width: Int,
+            height: Int,
+            format: Int,
+            usage: Long
+        ): HardwareBuffer?
+
+        @JvmStatic
+        @JniVisible
+        external fun nRelease(pool: Long, buffer: HardwareBuffer, fenceFd: Int): Int
+
+        @JvmStatic @JniVisible external fun nTrim(pool: Long, maxAvailableCount: Int): Int
+
+        @JvmStatic @JniVisible external fun nGetStats(pool: Long, out: LongArray)
+
+        @JvmStatic @JniVisible external fun nDestroy(pool: Long): Boolean
+
+        init {
+            System.loadLibrary("graphics-core")
+        }
+    }
+}
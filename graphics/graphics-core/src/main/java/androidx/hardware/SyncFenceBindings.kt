@@ -34,6 +34,26 @@ internal class SyncFenceBindings private constructor() {
 
         @JvmStatic @JniVisible external fun nForceClose(fd: Int)
 
+        @JvmStatic
+        @JniVisible
+        external fun nMerge(name: String, fences: Array<SyncFenceV19>): Int
+
+        @JvmStatic
+        @JniVisible
+        external fun nWaitAny(fences: Array<SyncFenceV19>, timeoutMillis: Int): Int
+
+        @JvmStatic
+        @JniVisible
+        external fun nWaitAll(fences: Array<SyncFenceV19>, timeoutMillis: Int): Boolean
+
+        @JvmStatic
+        @JniVisible
+        external fun nGetSignalTimes(fences: Array<SyncFenceV19>, signalTimes: LongArray)
+
+        @JvmStatic
+        @JniVisible
+        external fun nGetFenceInfos(fds: IntArray, signalTimes: LongArray, statuses: IntArray?)
+
         init {
             System.loadLibrary("graphics-core")
         }
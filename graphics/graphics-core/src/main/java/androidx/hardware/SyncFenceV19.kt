@@ -137,6 +137,77 @@ internal class SyncFenceV19(private var fd: Int) : AutoCloseable, SyncFenceImpl
 
     companion object {
 
+        /** Status reported by [getFenceInfos] for a fence that has signaled */
+        internal const val STATUS_SIGNALED = 1
+
+        /** Status reported by [getFenceInfos] for a fence that has not signaled yet */
+        internal const val STATUS_PENDING = 0
+
+        /**
+         * Merges [fences] into a new SyncFence that signals once all of them have signaled. Invalid
+         * fences are skipped, so merging only invalid fences returns an invalid SyncFence. The
+         * caller keeps ownership of [fences].
+         *
+         * @param name Debug name of the merged fence
+         * @param fences SyncFences to merge
+         */
+        internal fun merge(name: String, fences: Array<SyncFenceV19>): SyncFenceV19 =
+            SyncFenceV19(SyncFenceBindings.nMerge(name, fences))
+
+        /**
+         * Waits with a single poll for any of [fences] to signal, for up to [timeoutNanos]. A
+         * negative timeout waits indefinitely. Invalid fences are treated as already signaled.
+         *
+         * @return the index of a signaled fence, or -1 if none signaled before the timeout
+         */
+        internal fun awaitAny(fences: Array<SyncFenceV19>, timeoutNanos: Long): Int =
+            SyncFenceBindings.nWaitAny(fences, toTimeoutMillis(timeoutNanos))
+
+        /**
+         * Waits with a single poll for all of [fences] to signal, for up to [timeoutNanos]. A
+         * negative timeout waits indefinitely. Invalid fences are treated as already signaled.
+         *
+         * @return `true` if all fences signaled, `false` otherwise
+         */
+        internal fun awaitAll(fences: Array<SyncFenceV19>, timeoutNanos: Long): Boolean =
+            SyncFenceBindings.nWaitAll(fences, toTimeoutMillis(timeoutNanos))
+
+        /**
+         * Queries the signal time of every fence of [fences] with a single JNI call, storing them
+         * at the same index of [signalTimes]. See [getSignalTimeNanos].
+         */
+        @RequiresApi(Build.VERSION_CODES.O)
+        internal fun getSignalTimesNanos(fences: Array<SyncFenceV19>, signalTimes: LongArray) {
+            require(signalTimes.size >= fences.size) {
+                "signalTimes must have room for ${fences.size} entries"
+            }
+            SyncFenceBindings.nGetSignalTimes(fences, signalTimes)
+        }
+
+        /**
+         * Queries the signal time and status of every fence file descriptor of [fds] with a single
+         * JNI call, storing them at the same index of [signalTimes] and [statuses]. This does not
+         * allocate per fence, so it suits querying many fences every frame. Unlike
+         * [getSignalTimesNanos] the file descriptors are not duplicated, the caller must keep them
+         * open for the duration of the call.
+         *
+         * Signal times are as returned by [getSignalTimeNanos]. Statuses are [STATUS_SIGNALED],
+         * [STATUS_PENDING], or negative if the fence signaled with an error or is invalid.
+         */
+        @RequiresApi(Build.VERSION_CODES.O)
+        internal fun getFenceInfos(fds: IntArray, signalTimes: LongArray, statuses: IntArray?) {
+            require(signalTimes.size >= fds.size) {
+                "signalTimes must have room for ${fds.size} entries"
+            }
+            require(statuses == null || statuses.size >= fds.size) {
+                "statuses must have room for ${fds.size} entries"
+            }
+            SyncFenceBindings.nGetFenceInfos(fds, signalTimes, statuses)
+        }
+
+        private fun toTimeoutMillis(timeoutNanos: Long): Int =
+            if (timeoutNanos < 0) -1 else TimeUnit.NANOSECONDS.toMillis(timeoutNanos).toInt()
+
         init {
             System.loadLibrary("graphics-core")
         }
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package androidx.hardware
+
+import androidx.graphics.surface.JniBindings
+import androidx.graphics.utils.JniVisible
+import java.util.concurrent.locks.ReentrantLock
+import kotlin.concurrent.withLock
+
+/**
+ * Waits for any number of [SyncFenceV19] instances to signal on a single native thread, instead of
+ * blocking one thread per fence with [SyncFenceV19.await].
+ *
+ * Each fence is registered with a caller provided token and an optional timeout. Once fences
+ * signal or time out, [Callback.onFencesResolved] is invoked on the watcher thread with every fence
+ * resolved at the same time.
+ *
+ * The native watcher holds a reference to this instance, so [close] must be called to release it.
+ */
+@JniVisible
+internal class SyncFenceWatcher(private val callback: Callback) : AutoCloseable {
+
+    fun interface Callback {
+        /**
+         * Invoked on the watcher thread with a batch of resolved fences.
+         *
+         * @param tokens Tokens the fences were registered with
+         * @param signalTimes For each token, the time the fence signaled in the CLOCK_MONOTONIC
+         *   time domain, [SyncFenceCompat.SIGNAL_TIME_PENDING] if the fence timed out or
+         *   [SyncFenceCompat.SIGNAL_TIME_INVALID] if it is in an error state
+         */
+        fun onFencesResolved(tokens: LongArray, signalTimes: LongArray)
+    }
+
+    private val mLock = ReentrantLock()
+    private var mNativeWatcher: Long = nCreate(this)
+
+    init {
+        if (mNativeWatcher == 0L) {
+            throw IllegalStateException("Unable to create fence watcher")
+        }
+    }
+
+    /**
+     * Watches [fence] until it signals or [timeoutNanos] elapses. A negative timeout waits
+     * indefinitely. The fence is duplicated so the caller keeps ownership of [fence].
+     *
+     * @return `true` if the fence is being watched, `false` if it is invalid or this watcher is
+     *   closed
+     */
+    fun watch(fence: SyncFenceV19, token: Long, timeoutNanos: Long = -1): Boolean =
+        watchFileDescriptor(JniBindings.nDupFenceFd(fence), token, timeoutNanos)
+
+    /**
+     * Watches a pollable file descriptor until it becomes readable or [timeoutNanos] elapses. The
+     * watcher takes ownership of [fd] and closes it once it is resolved.
+     */
+    internal fun watchFileDescriptor(fd: Int, token: Long, timeoutNanos: Long = -1): Boolean =
+        mLock.withLock {
+            if (fd == -1) {
+                return false
+            }
+            if (mNativeWatcher == 0L) {
+                SyncFenceV19(fd).close()
+                return false
+            }
+            nWatch(mNativeWatcher, fd, token, timeoutNanos)
+        }
+
+    /**
+     * Stops watching the fences registered with [token] without invoking the callback for them.
+     *
+     * @return `true` if a fence registered with [token] was still being watched
+     */
+    fun cancel(token: Long): Boolean =
+        mLock.withLock { mNativeWatcher != 0L && nCancel(mNativeWatcher, token) }
+
+    /** Number of fences still being watched */
+    val pendingCount: Int
+        get() = mLock.withLock { if (mNativeWatcher != 0L) nGetPendingCount(mNativeWatcher) else 0 }
+
+    /**
+     * Stops the watcher thread. Fences still being watched are released without invoking the
+     * callback. This may be called from within [Callback.onFencesResolved].
+     */
+    override fun close() {
+        val nativeWatcher =
+            mLock.withLock {
+                val watcher = mNativeWatcher
+                mNativeWatcher = 0L
+                watcher
+            }
+        // Destroy outside of the lock as it waits for a callback in flight that may use this
+        // watcher
+        if (nativeWatcher != 0L) {
+            nDestroy(nativeWatcher)
+        }
+    }
+
+    @JniVisible
+    private fun onFencesResolved(tokens: LongArray, signalTimes: LongArray) {
+        callback.onFencesResolved(tokens, signalTimes)
+    }
+
+    companion object {
+        @JvmStatic @JniVisible external fun nCreate(watcher: SyncFenceWatcher): Long
+
+        @JvmStatic
+        @JniVisible
+        external fun nWatch(
+            watcher: Long,
+            fd: Int,
+            token: Long,
+            timeoutNanos: Long
+        ): Boolean
+
+        @JvmStatic @JniVisible external fun nCancel(watcher: Long, token: Long): Boolean
+
+        @JvmStatic @JniVisible external fun nGetPendingCount(watcher: Long): Int
+
+        @JvmStatic @JniVisible external fun nDestroy(watcher: Long)
+
+        init {
+            System.loadLibrary("graphics-core")
+        }
+    }
+}